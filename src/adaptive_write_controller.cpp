@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "adaptive_write_controller.h"
+#include <algorithm>
+#include <optional>
+
+namespace rpi_imager {
+
+namespace {
+
+constexpr int kMinWindowWrites = 8;
+constexpr double kMinGain = 1.05;      // A step must make writes this much faster to be kept
+constexpr double kMaxLoss = 0.98;      // A shallower queue may cost this much and still be kept
+constexpr double kCollapse = 0.75;     // Below this share of the best throughput, back off
+constexpr int kHoldWindows = 32;       // Windows to hold the settings before probing again
+
+const char* const kProbeReasons[] = {
+    "probe deeper queue", "probe shallower queue", "probe larger writes", "probe smaller writes"};
+
+}  // namespace
+
+AdaptiveWriteController::AdaptiveWriteController(const Limits& limits) : limits_(limits) {
+  limits_.min_depth = std::max(limits_.min_depth, 1);
+  limits_.max_depth = std::max(limits_.max_depth, limits_.min_depth);
+  limits_.max_chunk = std::max(limits_.max_chunk, limits_.min_chunk);
+  if (limits_.initial_chunk == 0) {
+    limits_.initial_chunk = limits_.max_chunk;
+  }
+  depth_ = std::clamp(limits_.initial_depth, limits_.min_depth, limits_.max_depth);
+  chunk_ = std::clamp(limits_.initial_chunk, limits_.min_chunk, limits_.max_chunk);
+}
+
+void AdaptiveWriteController::SetDecisionCallback(DecisionCallback callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  callback_ = std::move(callback);
+}
+
+void AdaptiveWriteController::RecordCompletion(std::size_t bytes, std::chrono::microseconds latency,
+                                               Clock::time_point now) {
+  std::optional<Decision> decision;
+  DecisionCallback callback;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Count the time since the later of this write's submission and the
+    // previous completion, so gaps with nothing in flight are left out
+    const Clock::time_point submitted = now - latency;
+    if (now > busy_until_) {
+      busy_ += now - std::max(submitted, busy_until_);
+      busy_until_ = now;
+    }
+
+    // Writes submitted before the last change do not show its effect
+    if (settle_writes_ > 0) {
+      --settle_writes_;
+      busy_ = Clock::duration(0);
+      return;
+    }
+
+    window_bytes_ += bytes;
+    window_latency_ += latency;
+    if (++window_writes_ < WindowWrites()) {
+      return;
+    }
+
+    const double seconds = std::chrono::duration<double>(busy_).count();
+    const double throughput = seconds > 0 ? static_cast<double>(window_bytes_) / seconds : 0;
+    const auto avg_latency = static_cast<std::uint32_t>(window_latency_.count() / window_writes_);
+    window_bytes_ = 0;
+    window_latency_ = std::chrono::microseconds(0);
+    window_writes_ = 0;
+    busy_ = Clock::duration(0);
+
+    if (throughput <= 0) {
+      return;
+    }
+    if (const char* reason = Step(throughput)) {
+      decision = Decision{depth_.load(), chunk_.load(), static_cast<std::uint64_t>(throughput),
+                          avg_latency, reason};
+      callback = callback_;
+    }
+  }
+
+  if (decision && callback) {
+    callback(*decision);
+  }
+}
+
+int AdaptiveWriteController::WindowWrites() const {
+  return std::max(kMinWindowWrites, 2 * depth_.load());
+}
+
+const char* AdaptiveWriteController::Step(double throughput) {
+  if (!measured_) {
+    // First window at these settings
+    measured_ = true;
+    best_ = throughput;
+    kept_probes_ = 0;
+    return ProbeFrom(kDepthUp);
+  }
+
+  if (probing_) {
+    if (throughput >= best_ * kMinGain || (probe_ == kDepthDown && throughput >= best_ * kMaxLoss)) {
+      // Keep the step and take another one the same way
+      best_ = std::max(best_, throughput);
+      kept_probes_ |= 1u << probe_;
+      return ProbeFrom(probe_);
+    }
+    Apply(saved_depth_, saved_chunk_);
+    return ProbeFrom(probe_ + 1);
+  }
+
+  if (throughput < best_ * kCollapse) {
+    Apply(std::max(limits_.min_depth, depth_.load() / 2), chunk_.load());
+    measured_ = false;
+    return "back off";
+  }
+  if (--hold_windows_ <= 0) {
+    best_ = throughput;
+    kept_probes_ = 0;
+    return ProbeFrom(kDepthUp);
+  }
+  return nullptr;
+}
+
+const char* AdaptiveWriteController::ProbeFrom(int probe) {
+  const int depth = depth_.load();
+  const std::size_t chunk = chunk_.load();
+
+  for (; probe < kProbeCount; ++probe) {
+    // Going back the way that just paid off is known to be worse
+    if (kept_probes_ & (1u << (probe ^ 1))) {
+      continue;
+    }
+
+    int next_depth = depth;
+    std::size_t next_chunk = chunk;
+    switch (probe) {
+      case kDepthUp: ++next_depth; break;
+      case kDepthDown: --next_depth; break;
+      case kChunkUp: next_chunk *= 2; break;
+      case kChunkDown: next_chunk /= 2; break;
+    }
+    if (next_depth < limits_.min_depth || next_depth > limits_.max_depth ||
+        next_chunk < limits_.min_chunk || next_chunk > limits_.max_chunk ||
+        (probe >= kChunkUp && next_chunk == chunk)) {
+      continue;
+    }
+
+    saved_depth_ = depth;
+    saved_chunk_ = chunk;
+    probe_ = probe;
+    probing_ = true;
+    Apply(next_depth, next_chunk);
+    return kProbeReasons[probe];
+  }
+
+  probing_ = false;
+  hold_windows_ = kHoldWindows;
+  return "hold";
+}
+
+void AdaptiveWriteController::Apply(int depth, std::size_t chunk) {
+  // Let the writes queued under the old settings drain before measuring again
+  settle_writes_ = std::max(depth, depth_.load());
+  if (chunk != chunk_.load()) {
+    settle_writes_ += limits_.backlog_writes;
+  }
+  window_bytes_ = 0;
+  window_latency_ = std::chrono::microseconds(0);
+  window_writes_ = 0;
+  depth_ = depth;
+  chunk_ = chunk;
+}
+
+}  // namespace rpi_imager
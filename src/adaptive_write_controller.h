@@ -0,0 +1,118 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef ADAPTIVE_WRITE_CONTROLLER_H_
+#define ADAPTIVE_WRITE_CONTROLLER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace rpi_imager {
+
+// Tunes the number of writes in flight and the size of each write while an
+// image is written, from the completion latencies of the writes themselves.
+//
+// Throughput is measured over windows of completed writes. Only the time the
+// device had writes in flight counts, so a slow download or decompressor does
+// not look like a slow device. The controller changes one setting at a time:
+// the queue is made one deeper (additive increase) or one shallower, writes
+// twice as large or half as large. A step is kept and repeated while it makes
+// writes at least 5% faster; a shallower queue is also kept if it is no
+// slower, as it only adds latency. Otherwise the step is undone and the next
+// one is tried. Once no step helps the settings are held and probed again
+// after a while. If throughput falls well below the best seen, e.g. when a
+// card's write cache fills up, the queue depth is halved (multiplicative
+// decrease) and the search starts again from there.
+//
+// Thread safe: completions may be recorded from any thread.
+class AdaptiveWriteController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Limits {
+    int min_depth = 1;
+    int max_depth = 16;
+    int initial_depth = 4;
+    std::size_t min_chunk = 0;      // Write size range, min == max leaves it alone
+    std::size_t max_chunk = 0;
+    std::size_t initial_chunk = 0;  // 0 = max_chunk
+    int backlog_writes = 0;         // Writes that may already be prepared at the old size
+  };
+
+  struct Decision {
+    int depth;
+    std::size_t chunk;
+    std::uint64_t throughput;       // Bytes per second in the window that led to it
+    std::uint32_t avg_latency_us;   // Average completion latency in that window
+    const char* reason;
+  };
+  using DecisionCallback = std::function<void(const Decision& decision)>;
+
+  explicit AdaptiveWriteController(const Limits& limits);
+
+  AdaptiveWriteController(const AdaptiveWriteController&) = delete;
+  AdaptiveWriteController& operator=(const AdaptiveWriteController&) = delete;
+
+  // Called after every change of the settings, outside the internal lock
+  void SetDecisionCallback(DecisionCallback callback);
+
+  // Record a completed write
+  void RecordCompletion(std::size_t bytes, std::chrono::microseconds latency,
+                        Clock::time_point now = Clock::now());
+
+  // Writes to keep in flight
+  int InFlightLimit() const { return depth_.load(std::memory_order_relaxed); }
+
+  // Size to make the next write; 0 if the write size is not tuned
+  std::size_t ChunkSize() const { return chunk_.load(std::memory_order_relaxed); }
+
+ private:
+  enum Probe { kDepthUp, kDepthDown, kChunkUp, kChunkDown, kProbeCount };
+
+  // Completions that make up one measurement at the current depth
+  int WindowWrites() const;
+
+  // Act on the throughput of a finished window; returns a reason if the
+  // settings changed
+  const char* Step(double throughput);
+
+  // Apply the first possible probe starting at the given one, or hold
+  const char* ProbeFrom(int probe);
+
+  void Apply(int depth, std::size_t chunk);
+
+  Limits limits_;
+  std::atomic<int> depth_;
+  std::atomic<std::size_t> chunk_;
+
+  std::mutex mutex_;
+  DecisionCallback callback_;
+
+  // Current window
+  Clock::time_point busy_until_;
+  Clock::duration busy_{0};
+  std::uint64_t window_bytes_ = 0;
+  std::chrono::microseconds window_latency_{0};
+  int window_writes_ = 0;
+  int settle_writes_ = 0;
+
+  // Search state
+  bool measured_ = false;
+  bool probing_ = false;
+  int probe_ = kDepthUp;
+  unsigned kept_probes_ = 0;
+  int saved_depth_ = 0;
+  std::size_t saved_chunk_ = 0;
+  double best_ = 0;
+  int hold_windows_ = 0;
+};
+
+}  // namespace rpi_imager
+
+#endif  // ADAPTIVE_WRITE_CONTROLLER_H_
@@ -6,11 +6,22 @@
 #include "asynccachewriter.h"
 #include <QDebug>
 #include <QFileInfo>
+#include <cstring>
+
+namespace {
+
+bool isZeroBlock(const char *data, qint64 len)
+{
+    return len > 0 && data[0] == 0 && std::memcmp(data, data + 1, static_cast<size_t>(len - 1)) == 0;
+}
+
+} // namespace
 
 AsyncCacheWriter::AsyncCacheWriter(QObject *parent)
     : QThread(parent)
     , _maxQueueSize(32)
     , _maxQueueMemory(64 * 1024 * 1024)
+    , _sparse(false)
     , _hash(OSLIST_HASH_ALGORITHM)
     , _isActive(false)
     , _shouldStop(false)
@@ -18,6 +29,7 @@ AsyncCacheWriter::AsyncCacheWriter(QObject *parent)
     , _finishing(false)
     , _bytesQueued(0)
     , _bytesWritten(0)
+    , _backpressureWaitMs(0)
 {
     _initializeQueueLimits();
 }
@@ -74,7 +86,7 @@ bool AsyncCacheWriter::open(const QString &filename, qint64 preallocateSize)
         return false;
     }
     
-    if (preallocateSize > 0) {
+    if (preallocateSize > 0 && !_sparse) {
         // Pre-allocate space to avoid fragmentation
         if (!_file.resize(preallocateSize)) {
             qDebug() << "AsyncCacheWriter: Failed to pre-allocate" << preallocateSize << "bytes";
@@ -90,22 +102,21 @@ bool AsyncCacheWriter::open(const QString &filename, qint64 preallocateSize)
     _finishing = false;
     _bytesQueued = 0;
     _bytesWritten = 0;
+    _backpressureWaitMs = 0;
+    _openTimer.start();
     _isActive = true;
     
     // Reset hash for fresh computation
     _hash.reset();
     
     // Clear any stale queue data
-    {
-        QMutexLocker lock(&_mutex);
-        _queue.clear();
-    }
+    discardQueue();
     
     // Start the writer thread
     start();
     
     qDebug() << "AsyncCacheWriter: Opened" << filename
-             << "with preallocation:" << preallocateSize;
+             << "with preallocation:" << (_sparse ? 0 : preallocateSize) << (_sparse ? "(sparse)" : "");
     return true;
 }
 
@@ -133,6 +144,8 @@ bool AsyncCacheWriter::openForAppend(const QString &filename)
     _finishing = false;
     _bytesQueued = existingSize;
     _bytesWritten = existingSize;
+    _backpressureWaitMs = 0;
+    _openTimer.start();
     _isActive = true;
 
     // Note: We cannot continue hashing from where we left off since we don't
@@ -141,10 +154,7 @@ bool AsyncCacheWriter::openForAppend(const QString &filename)
     _hash.reset();
 
     // Clear any stale queue data
-    {
-        QMutexLocker lock(&_mutex);
-        _queue.clear();
-    }
+    discardQueue();
 
     // Start the writer thread
     start();
@@ -154,7 +164,7 @@ bool AsyncCacheWriter::openForAppend(const QString &filename)
     return true;
 }
 
-bool AsyncCacheWriter::write(const char *data, size_t len)
+bool AsyncCacheWriter::write(const char *data, size_t len, std::function<void()> onComplete)
 {
     if (!_isActive || _hasError || _shouldStop) {
         return false;
@@ -162,45 +172,64 @@ bool AsyncCacheWriter::write(const char *data, size_t len)
     
     {
         QMutexLocker lock(&_mutex);
+
+        // Checked again under the lock: once the writer thread has stopped,
+        // nothing would ever write or drop a queued chunk
+        if (_hasError || _shouldStop || _finishing) {
+            return false;
+        }
         
-        // Check if queue is full - use non-blocking approach with graceful degradation
-        // If queue is full, we have two options:
-        // 1. Brief wait (up to 500ms) to see if space becomes available
-        // 2. If still full, disable caching rather than blocking the download
-        
-        if (_queue.size() >= _maxQueueSize || 
-            queueMemoryUsage() >= _maxQueueMemory) {
-            
-            // Try brief wait for space (don't block download for too long)
-            static constexpr int MAX_BACKPRESSURE_WAIT_MS = 500;
+        // If the queue is full, wait for the writer thread. The download is
+        // slowed down to the speed of the cache disk for as long as that costs
+        // a bounded share of the time; only then is caching given up.
+        if (queueFull()) {
             static constexpr int WAIT_INTERVAL_MS = 50;
-            int waitedMs = 0;
+            QElapsedTimer waitTimer;
+            waitTimer.start();
+            QElapsedTimer progressTimer;
+            progressTimer.start();
+            qint64 lastWritten = _bytesWritten;
             
-            while ((_queue.size() >= _maxQueueSize || 
-                    queueMemoryUsage() >= _maxQueueMemory) &&
-                   waitedMs < MAX_BACKPRESSURE_WAIT_MS) {
-                
+            while (queueFull()) {
                 if (_shouldStop || _hasError) {
+                    _backpressureWaitMs += waitTimer.elapsed();
                     return false;
                 }
                 
                 _queueNotFull.wait(&_mutex, WAIT_INTERVAL_MS);
-                waitedMs += WAIT_INTERVAL_MS;
-            }
-            
-            // If still full after waiting, cache I/O is too slow - disable caching
-            if (_queue.size() >= _maxQueueSize || 
-                queueMemoryUsage() >= _maxQueueMemory) {
-                qDebug() << "AsyncCacheWriter: Queue still full after" << waitedMs 
-                         << "ms wait. Cache I/O too slow, disabling caching to avoid blocking download.";
+                if (_bytesWritten != lastWritten) {
+                    lastWritten = _bytesWritten;
+                    progressTimer.restart();
+                }
+                
+                qint64 waitedMs = _backpressureWaitMs + waitTimer.elapsed();
+                qint64 openMs = _openTimer.elapsed();
+                if (progressTimer.elapsed() >= STALL_TIMEOUT_MS) {
+                    qDebug() << "AsyncCacheWriter: No cache write completed in" << progressTimer.elapsed()
+                             << "ms. Cache I/O stalled, disabling caching to avoid blocking download.";
+                } else if (openMs >= BACKPRESSURE_GRACE_MS && waitedMs * 100 > openMs * MAX_BACKPRESSURE_PERCENT) {
+                    qDebug() << "AsyncCacheWriter: Download waited" << waitedMs << "of" << openMs
+                             << "ms for the cache. Cache I/O too slow, disabling caching to avoid blocking download.";
+                } else {
+                    continue;
+                }
+                _backpressureWaitMs = waitedMs;
                 _hasError = true;  // Signal error state
                 return false;
             }
+            _backpressureWaitMs += waitTimer.elapsed();
         }
         
-        // Create a copy of the data for async processing
         WriteChunk chunk;
-        chunk.data = QByteArray(data, static_cast<int>(len));
+        if (onComplete) {
+            // Written in place, the caller keeps the data alive until onComplete
+            chunk.view = data;
+            chunk.onComplete = std::move(onComplete);
+        } else {
+            // Create a copy of the data for async processing
+            chunk.copy = QByteArray(data, static_cast<int>(len));
+        }
+        chunk.size = static_cast<qint64>(len);
         
         _queue.enqueue(std::move(chunk));
         _bytesQueued += len;
@@ -228,6 +257,14 @@ void AsyncCacheWriter::finish()
     
     // Wait for thread to complete
     wait();
+
+    // A hole at the end is only a seek so far, give the file its full size
+    if (_sparse && !_hasError && _file.size() != _bytesWritten && !_file.resize(_bytesWritten)) {
+        qDebug() << "AsyncCacheWriter: Failed to extend sparse file -" << _file.errorString();
+        _hasError = true;
+        emit error(tr("Cache write error: %1").arg(_file.errorString()));
+        cleanup();
+    }
     
     if (!_hasError) {
         // Flush and close the file
@@ -235,7 +272,7 @@ void AsyncCacheWriter::finish()
         _file.close();
         
         qDebug() << "AsyncCacheWriter: Finished successfully, wrote" 
-                 << _bytesWritten << "bytes";
+                 << _bytesWritten << "bytes, download waited" << _backpressureWaitMs << "ms for the cache";
         
         emit finished(_hash.result().toHex());
     }
@@ -308,10 +345,12 @@ void AsyncCacheWriter::finishPartial()
         threadStopped = wait(5000);
     }
 
+    // Discard any unwritten data
+    discardQueue();
+
     // Flush and close without deleting
     {
         QMutexLocker lock(&_mutex);
-        _queue.clear();  // Discard any unwritten data
 
         if (_file.isOpen()) {
             _file.flush();
@@ -352,11 +391,15 @@ void AsyncCacheWriter::run()
         
         if (hasData) {
             // Compute hash of the data
-            _hash.addData(chunk.data);
+            _hash.addData(chunk.data(), static_cast<int>(chunk.size));
             
             // Write to file
-            qint64 written = _file.write(chunk.data);
-            if (written != chunk.data.size()) {
+            qint64 written = _sparse ? writeSparse(chunk.data(), chunk.size)
+                                     : _file.write(chunk.data(), chunk.size);
+            if (chunk.onComplete) {
+                chunk.onComplete();
+            }
+            if (written != chunk.size) {
                 qDebug() << "AsyncCacheWriter: Write error -" << _file.errorString();
                 _hasError = true;
                 emit error(tr("Cache write error: %1").arg(_file.errorString()));
@@ -383,14 +426,37 @@ void AsyncCacheWriter::run()
     qDebug() << "AsyncCacheWriter: Thread finished, wrote" << _bytesWritten << "bytes";
 }
 
+qint64 AsyncCacheWriter::writeSparse(const char *data, qint64 len)
+{
+    qint64 pos = 0;
+    while (pos < len) {
+        // Extend a run of blocks that are all zero, or all not
+        bool zero = isZeroBlock(data + pos, qMin(SPARSE_BLOCK_SIZE, len - pos));
+        qint64 end = pos;
+        do {
+            end += qMin(SPARSE_BLOCK_SIZE, len - end);
+        } while (end < len && isZeroBlock(data + end, qMin(SPARSE_BLOCK_SIZE, len - end)) == zero);
+
+        if (zero) {
+            if (!_file.seek(_file.pos() + (end - pos))) {
+                return pos;
+            }
+        } else if (_file.write(data + pos, end - pos) != end - pos) {
+            return pos;
+        }
+        pos = end;
+    }
+    return len;
+}
+
 void AsyncCacheWriter::cleanup()
 {
+    // Clear the queue
+    discardQueue();
+
     // Use mutex to prevent double-cleanup from both cancel() and run()
     QMutexLocker lock(&_mutex);
     
-    // Clear the queue
-    _queue.clear();
-    
     // Close and remove the cache file (only once)
     if (_file.isOpen()) {
         _file.close();
@@ -408,11 +474,34 @@ QByteArray AsyncCacheWriter::hash() const
     return _hash.result().toHex();
 }
 
+void AsyncCacheWriter::discardQueue()
+{
+    QQueue<WriteChunk> dropped;
+    {
+        QMutexLocker lock(&_mutex);
+        dropped.swap(_queue);
+    }
+
+    // Hand back data written in place, outside the lock as the callbacks
+    // may take the owner's locks
+    for (const auto &chunk : dropped) {
+        if (chunk.onComplete) {
+            chunk.onComplete();
+        }
+    }
+}
+
+bool AsyncCacheWriter::queueFull() const
+{
+    return _queue.size() >= _maxQueueSize || queueMemoryUsage() >= _maxQueueMemory;
+}
+
 qint64 AsyncCacheWriter::queueMemoryUsage() const
 {
+    // Chunks written in place live in the caller's buffers
     qint64 total = 0;
     for (const auto &chunk : _queue) {
-        total += chunk.data.size();
+        total += chunk.copy.size();
     }
     return total;
 }
@@ -12,6 +12,7 @@
 #include <QWaitCondition>
 #include <QQueue>
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <atomic>
 #include <functional>
 #include "acceleratedcryptographichash.h"
@@ -50,6 +51,17 @@ public:
      */
     bool open(const QString &filename, qint64 preallocateSize = 0);
 
+    /**
+     * @brief Leave all-zero ranges of the data out of the file
+     *
+     * Zero ranges are seeked over instead of written, so they become holes
+     * on file systems that support them. The hash still covers them. Meant
+     * for decompressed images; call before open(), not for openForAppend().
+     *
+     * @param sparse true to write a sparse file
+     */
+    void setSparse(bool sparse) { _sparse = sparse; }
+
     /**
      * @brief Open cache file for appending (resume mode)
      * @param filename Path to existing cache file
@@ -62,18 +74,27 @@ public:
      * 
      * This method returns quickly after queuing the data.
      * 
+     * Without onComplete the data is copied. With it, the data is written in
+     * place: it must stay valid until onComplete is called, which happens
+     * once the data is written or dropped. If false is returned, onComplete
+     * is not called.
+     * 
      * Backpressure handling:
-     * - If the queue is full, waits briefly (up to 500ms) for space
-     * - If still full after waiting, caching is disabled to avoid
-     *   blocking the download (returns false, sets error state)
+     * - If the queue is full, the caller waits for space, so a cache disk
+     *   that is briefly slower than the download slows the download down
+     *   instead of losing the cache
+     * - Caching is only disabled (returns false, sets error state) when the
+     *   waits add up to more than MAX_BACKPRESSURE_PERCENT of the time since
+     *   the file was opened, or the disk makes no progress for STALL_TIMEOUT_MS
      * - The download continues without caching in this case
      * 
      * @param data Pointer to data buffer
      * @param len Length of data
+     * @param onComplete Called when data is no longer needed (nullptr = copy the data)
      * @return true if data was queued, false if writer is in error state
      *         or caching was disabled due to slow I/O
      */
-    bool write(const char *data, size_t len);
+    bool write(const char *data, size_t len, std::function<void()> onComplete = nullptr);
 
     /**
      * @brief Flush all pending writes and close the file
@@ -163,7 +184,12 @@ private:
     qint64 _maxQueueMemory;  // Max memory in queue (bytes)
     
     struct WriteChunk {
-        QByteArray data;
+        QByteArray copy;                    // Owned data, if not written in place
+        const char *view = nullptr;         // Caller's data, valid until onComplete
+        qint64 size = 0;
+        std::function<void()> onComplete;
+
+        const char *data() const { return view ? view : copy.constData(); }
     };
     
     QQueue<WriteChunk> _queue;
@@ -177,6 +203,8 @@ private:
     // File state
     QFile _file;
     QString _filename;
+    bool _sparse;
+    static constexpr qint64 SPARSE_BLOCK_SIZE = 64 * 1024;  // Granularity of the zero check
     
     // Hash computation
     AcceleratedCryptographicHash _hash;
@@ -190,10 +218,20 @@ private:
     // Statistics
     std::atomic<qint64> _bytesQueued;
     std::atomic<qint64> _bytesWritten;
+
+    // Backpressure accounting (see write())
+    QElapsedTimer _openTimer;
+    qint64 _backpressureWaitMs;
+    static constexpr int MAX_BACKPRESSURE_PERCENT = 20;
+    static constexpr qint64 BACKPRESSURE_GRACE_MS = 5000;   // Waits are not judged before this
+    static constexpr qint64 STALL_TIMEOUT_MS = 10000;
     
     // Helper methods
+    qint64 writeSparse(const char *data, qint64 len);
     void processQueue();
     void cleanup();
+    void discardQueue();
+    bool queueFull() const;
     qint64 queueMemoryUsage() const;
 };
 
@@ -0,0 +1,270 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "blockmap.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+namespace {
+
+bool parseNumber(const QString &text, quint64 &value)
+{
+    bool ok = false;
+    value = text.trimmed().toULongLong(&ok);
+    return ok;
+}
+
+BlockMap fail(QString *errorMessage, const QString &msg)
+{
+    qDebug() << "BlockMap: rejecting bmap file:" << msg;
+    if (errorMessage)
+        *errorMessage = msg;
+    return BlockMap();
+}
+
+} // namespace
+
+BlockMap BlockMap::parse(const QByteArray &xml, QString *errorMessage)
+{
+    BlockMap map;
+    quint64 blocksCount = 0, mappedBlocksCount = 0;
+    int majorVersion = 0;
+    QString checksumType;
+    QByteArray fileChecksum;
+    bool fileChecksumIsSha1 = false;
+
+    struct RawRange
+    {
+        quint64 first, last;
+        QByteArray checksum;
+    };
+    QVector<RawRange> rawRanges;
+
+    QXmlStreamReader reader(xml);
+    while (!reader.atEnd())
+    {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        const auto name = reader.name();
+        if (name == QLatin1String("bmap"))
+        {
+            majorVersion = reader.attributes().value("version").toString().section('.', 0, 0).toInt();
+        }
+        else if (name == QLatin1String("ImageSize"))
+        {
+            if (!parseNumber(reader.readElementText(), map._imageSize))
+                return fail(errorMessage, QStringLiteral("invalid ImageSize"));
+        }
+        else if (name == QLatin1String("BlockSize"))
+        {
+            if (!parseNumber(reader.readElementText(), map._blockSize))
+                return fail(errorMessage, QStringLiteral("invalid BlockSize"));
+        }
+        else if (name == QLatin1String("BlocksCount"))
+        {
+            if (!parseNumber(reader.readElementText(), blocksCount))
+                return fail(errorMessage, QStringLiteral("invalid BlocksCount"));
+        }
+        else if (name == QLatin1String("MappedBlocksCount"))
+        {
+            if (!parseNumber(reader.readElementText(), mappedBlocksCount))
+                return fail(errorMessage, QStringLiteral("invalid MappedBlocksCount"));
+        }
+        else if (name == QLatin1String("ChecksumType"))
+        {
+            checksumType = reader.readElementText().trimmed().toLower();
+        }
+        else if (name == QLatin1String("BmapFileChecksum"))
+        {
+            fileChecksum = reader.readElementText().trimmed().toLatin1().toLower();
+        }
+        else if (name == QLatin1String("BmapFileSHA1"))
+        {
+            fileChecksum = reader.readElementText().trimmed().toLatin1().toLower();
+            fileChecksumIsSha1 = true;
+        }
+        else if (name == QLatin1String("Range"))
+        {
+            RawRange range;
+            range.checksum = reader.attributes().value("chksum").toString().trimmed().toLatin1().toLower();
+            const QString text = reader.readElementText().trimmed();
+            const int dash = text.indexOf('-');
+            if (dash < 0)
+            {
+                if (!parseNumber(text, range.first))
+                    return fail(errorMessage, QStringLiteral("invalid Range '%1'").arg(text));
+                range.last = range.first;
+            }
+            else if (!parseNumber(text.left(dash), range.first) || !parseNumber(text.mid(dash + 1), range.last))
+            {
+                return fail(errorMessage, QStringLiteral("invalid Range '%1'").arg(text));
+            }
+            rawRanges.append(range);
+        }
+    }
+
+    if (reader.hasError())
+        return fail(errorMessage, QStringLiteral("XML error: %1").arg(reader.errorString()));
+    if (majorVersion < 1 || majorVersion > 2)
+        return fail(errorMessage, QStringLiteral("unsupported bmap version %1").arg(majorVersion));
+    if (map._blockSize == 0 || map._blockSize % 512 != 0)
+        return fail(errorMessage, QStringLiteral("block size %1 is not a multiple of 512").arg(map._blockSize));
+    if (map._imageSize == 0 || map._imageSize > blocksCount * map._blockSize)
+        return fail(errorMessage, QStringLiteral("image size does not match block count"));
+
+    /* 1.x files use SHA1 unless told otherwise, 2.x files use SHA256 */
+    if (checksumType.isEmpty())
+        checksumType = (majorVersion == 1) ? QStringLiteral("sha1") : QStringLiteral("sha256");
+    if (checksumType == QLatin1String("sha256"))
+        map._checksumAlgorithm = QCryptographicHash::Sha256;
+    else if (checksumType == QLatin1String("sha1"))
+        map._checksumAlgorithm = QCryptographicHash::Sha1;
+    else
+        return fail(errorMessage, QStringLiteral("unsupported checksum type '%1'").arg(checksumType));
+
+    /* The file checksum is calculated with its own value replaced by zeros */
+    if (!fileChecksum.isEmpty())
+    {
+        QByteArray zeroed = xml;
+        const qsizetype pos = zeroed.toLower().indexOf(fileChecksum);
+        if (pos >= 0)
+            zeroed.replace(pos, fileChecksum.size(), QByteArray(fileChecksum.size(), '0'));
+        QCryptographicHash::Algorithm algo = fileChecksumIsSha1 ? QCryptographicHash::Sha1 : map._checksumAlgorithm;
+        if (QCryptographicHash::hash(zeroed, algo).toHex() != fileChecksum)
+            return fail(errorMessage, QStringLiteral("bmap file checksum mismatch"));
+    }
+
+    quint64 mapped = 0;
+    quint64 nextFreeBlock = 0;
+    for (const RawRange &raw : rawRanges)
+    {
+        if (raw.last < raw.first || raw.first < nextFreeBlock || raw.last >= blocksCount)
+            return fail(errorMessage, QStringLiteral("ranges are unsorted, overlapping or out of bounds"));
+        nextFreeBlock = raw.last + 1;
+        mapped += raw.last - raw.first + 1;
+
+        Range range;
+        range.offset = raw.first * map._blockSize;
+        range.length = qMin((raw.last + 1) * map._blockSize, map._imageSize) - range.offset;
+        range.checksum = raw.checksum;
+        map._mappedBytes += range.length;
+        map._ranges.append(range);
+    }
+
+    if (mappedBlocksCount && mapped != mappedBlocksCount)
+        return fail(errorMessage, QStringLiteral("MappedBlocksCount does not match the ranges"));
+
+    return map;
+}
+
+QStringList BlockMap::siblingNames(const QString &imageName)
+{
+    QStringList names;
+    QString base = imageName;
+    names.append(base + ".bmap");
+
+    const QString fileName = QFileInfo(base).fileName();
+    int extensions = fileName.count('.');
+    while (extensions-- > 0)
+    {
+        base.truncate(base.lastIndexOf('.'));
+        names.append(base + ".bmap");
+    }
+
+    return names;
+}
+
+BlockMapWriter::BlockMapWriter(const BlockMap &map, size_t minSkipBytes)
+    : _map(map), _minSkipBytes(minSkipBytes), _rangeHash(map.checksumAlgorithm())
+{
+    _digests.reserve(map.ranges().size());
+}
+
+bool BlockMapWriter::_nextSegment(quint64 offset, size_t &len) const
+{
+    const QVector<BlockMap::Range> &ranges = _map.ranges();
+
+    if (_range >= ranges.size())
+    {
+        // Anything past the end of the image the bmap describes is written as is
+        if (offset >= _map.imageSize())
+            return true;
+        len = static_cast<size_t>(qMin(static_cast<quint64>(len), _map.imageSize() - offset));
+        return false;
+    }
+
+    const BlockMap::Range &range = ranges.at(_range);
+    if (offset < range.offset)
+    {
+        len = static_cast<size_t>(qMin(static_cast<quint64>(len), range.offset - offset));
+        return false;
+    }
+
+    len = static_cast<size_t>(qMin(static_cast<quint64>(len), range.offset + range.length - offset));
+    return true;
+}
+
+bool BlockMapWriter::_hashRange(quint64 offset, const char *buf, size_t len)
+{
+    const BlockMap::Range &range = _map.ranges().at(_range);
+    _rangeHash.addData(QByteArrayView(buf, static_cast<qsizetype>(len)));
+    if (offset + len < range.offset + range.length)
+        return true;
+
+    QByteArray digest = _rangeHash.result().toHex();
+    _rangeHash.reset();
+    _range++;
+
+    if (!range.checksum.isEmpty() && digest != range.checksum)
+    {
+        qDebug() << "Block map checksum mismatch for range at offset" << range.offset
+                 << "expected" << range.checksum << "got" << digest;
+        _mismatchOffset = range.offset;
+        return false;
+    }
+
+    _digests.append(digest);
+    return true;
+}
+
+BlockMapWriter::Result BlockMapWriter::write(const char *buf, size_t len, const SpanFunction &write, const SpanFunction &skip)
+{
+    size_t spanStart = 0;
+    size_t pos = 0;
+    Result result = Result::Ok;
+
+    while (result == Result::Ok && pos < len)
+    {
+        quint64 offset = _offset + pos;
+        size_t segment = len - pos;
+        bool mapped = _nextSegment(offset, segment);
+
+        if (mapped)
+        {
+            if (_range < _map.ranges().size() && !_hashRange(offset, buf + pos, segment))
+                result = Result::ChecksumMismatch;
+        }
+        else if (skip && segment >= _minSkipBytes && offset % 4096 == 0 && segment % 4096 == 0)
+        {
+            if (spanStart < pos && !write(buf + spanStart, pos - spanStart))
+                result = Result::WriteFailed;
+            else if (!skip(buf + pos, segment))
+                result = Result::WriteFailed;
+            else
+                _bytesSkipped += segment;
+            spanStart = pos + segment;
+        }
+
+        pos += segment;
+    }
+
+    if (result == Result::Ok && spanStart < len && !write(buf + spanStart, len - spanStart))
+        result = Result::WriteFailed;
+
+    _offset += len;
+    return result;
+}
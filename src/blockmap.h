@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ *
+ * Parser for bmaptool block map (.bmap) files.
+ *
+ * A block map lists which blocks of a raw disk image (typically a Yocto .wic)
+ * actually contain data. Everything else is "don't care" and does not have to
+ * be written to the target device at all.
+ */
+
+#ifndef BLOCKMAP_H
+#define BLOCKMAP_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+class BlockMap
+{
+public:
+    struct Range
+    {
+        quint64 offset;         // Byte offset into the image
+        quint64 length;         // Length in bytes (last range is clamped to the image size)
+        QByteArray checksum;    // Lower case hex digest, empty if the bmap has none
+    };
+
+    BlockMap() = default;
+
+    /**
+     * @brief Parse the XML contents of a .bmap file
+     *
+     * Supports bmap format versions 1.x (SHA1) and 2.x (SHA256). If the file
+     * carries its own checksum (BmapFileChecksum / BmapFileSHA1), it is checked too.
+     *
+     * @param xml Raw file contents
+     * @param errorMessage Receives a description of the problem on failure
+     * @return Parsed block map, or an invalid one on failure
+     */
+    static BlockMap parse(const QByteArray &xml, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Candidate names of the .bmap file belonging to an image
+     *
+     * Follows bmaptool's discovery: "<image>.bmap" first, then with the
+     * compression and image extensions stripped one at a time
+     * (e.g. "os.wic.xz" -> "os.wic.xz.bmap", "os.wic.bmap", "os.bmap").
+     */
+    static QStringList siblingNames(const QString &imageName);
+
+    bool isValid() const { return _blockSize != 0; }
+    quint64 imageSize() const { return _imageSize; }
+    quint64 blockSize() const { return _blockSize; }
+    quint64 mappedBytes() const { return _mappedBytes; }
+    QCryptographicHash::Algorithm checksumAlgorithm() const { return _checksumAlgorithm; }
+    const QVector<Range> &ranges() const { return _ranges; }
+
+private:
+    quint64 _imageSize = 0;
+    quint64 _blockSize = 0;
+    quint64 _mappedBytes = 0;
+    QCryptographicHash::Algorithm _checksumAlgorithm = QCryptographicHash::Sha256;
+    QVector<Range> _ranges;
+};
+
+/**
+ * @brief Splits an image stream into the parts its block map says to write and to skip
+ *
+ * Each mapped range is hashed as it passes and checked against its bmap
+ * checksum. The digests are kept, so verification can compare the ranges
+ * read back from the device with what was written.
+ */
+class BlockMapWriter
+{
+public:
+    enum class Result
+    {
+        Ok,
+        WriteFailed,        // The write or skip function returned false
+        ChecksumMismatch    // A mapped range differs from its bmap checksum, see mismatchOffset()
+    };
+
+    // Gets a part of the buffer passed to write(); skipped data is still the caller's to hash
+    using SpanFunction = std::function<bool(const char *data, size_t len)>;
+
+    /**
+     * @param minSkipBytes Unmapped gaps smaller than this are written anyway:
+     *        splitting a large write in two costs more than writing a small gap
+     */
+    explicit BlockMapWriter(const BlockMap &map, size_t minSkipBytes = 128 * 1024);
+
+    /**
+     * @brief Pass on the next part of the image
+     *
+     * Consecutive data to write is handed to write in one piece. Unmapped gaps
+     * of at least minSkipBytes, 4 KiB aligned, go to skip instead; without a
+     * skip function everything is written. Data past the image size the map
+     * describes is written as is.
+     */
+    Result write(const char *buf, size_t len, const SpanFunction &write, const SpanFunction &skip);
+
+    const BlockMap &map() const { return _map; }
+    quint64 offset() const { return _offset; }                  // Image bytes passed on so far
+    quint64 bytesSkipped() const { return _bytesSkipped; }
+    quint64 mismatchOffset() const { return _mismatchOffset; }
+    bool isComplete() const { return _range >= _map.ranges().size(); }
+
+    // Digest of each mapped range as written, lower case hex
+    const QVector<QByteArray> &digests() const { return _digests; }
+
+private:
+    bool _nextSegment(quint64 offset, size_t &len) const;
+    bool _hashRange(quint64 offset, const char *buf, size_t len);
+
+    BlockMap _map;
+    size_t _minSkipBytes;
+    QCryptographicHash _rangeHash;
+    QVector<QByteArray> _digests;
+    qsizetype _range = 0;           // Index of the current/next mapped range
+    quint64 _offset = 0;
+    quint64 _bytesSkipped = 0;
+    quint64 _mismatchOffset = 0;
+};
+
+#endif // BLOCKMAP_H
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "bootimgcreator.h"
+#include "disk_formatter.h"
+#include "memory_file_operations.h"
+#include "devicewrapper.h"
+#include "devicewrapperfatpartition.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <stdexcept>
+
+QByteArray BootImgCreator::buildBootImg(const QMap<QString, QByteArray> &files, qint64 totalSize)
+{
+    if (files.isEmpty()) {
+        qDebug() << "BootImgCreator: no files to pack";
+        return QByteArray();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    auto memory = std::make_unique<rpi_imager::MemoryFileOperations>();
+    rpi_imager::MemoryFileOperations *image = memory.get();
+    if (memory->CreateTestFile("boot.img", static_cast<std::uint64_t>(totalSize)) != rpi_imager::FileError::kSuccess) {
+        qDebug() << "BootImgCreator: failed to allocate" << totalSize << "byte image";
+        return QByteArray();
+    }
+
+    rpi_imager::DiskFormatter formatter(std::move(memory));
+    if (!formatter.FormatVolume(static_cast<std::uint64_t>(totalSize))) {
+        qDebug() << "BootImgCreator: failed to format image";
+        return QByteArray();
+    }
+
+    // Parent directories are created before the files in them, shallowest first
+    QStringList dirs;
+    QSet<QString> seen;
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        QStringList parts = it.key().split("/", Qt::SkipEmptyParts);
+        QString currentPath;
+        for (int i = 0; i < parts.size() - 1; i++) {
+            currentPath = currentPath.isEmpty() ? parts[i] : currentPath + "/" + parts[i];
+            if (!seen.contains(currentPath)) {
+                seen.insert(currentPath);
+                dirs.append(currentPath);
+            }
+        }
+    }
+
+    try {
+        DeviceWrapper dw(image);
+        auto fat = new DeviceWrapperFatPartition(&dw, 0, static_cast<quint64>(totalSize), &dw);
+
+        for (const QString &dir : std::as_const(dirs))
+            fat->createDirectory(dir);
+        for (auto it = files.constBegin(); it != files.constEnd(); ++it)
+            fat->writeFile(it.key(), it.value());
+
+        dw.sync();
+    }
+    catch (std::exception &e) {
+        qDebug() << "BootImgCreator: failed to write files:" << e.what();
+        return QByteArray();
+    }
+
+    QByteArray result(static_cast<qsizetype>(totalSize), Qt::Uninitialized);
+    if (image->ReadAtOffset(0, reinterpret_cast<std::uint8_t *>(result.data()), static_cast<std::size_t>(result.size()))
+        != rpi_imager::FileError::kSuccess) {
+        qDebug() << "BootImgCreator: failed to read back image";
+        return QByteArray();
+    }
+
+    qDebug() << "BootImgCreator: built" << totalSize << "byte boot.img with" << files.size()
+             << "files and" << dirs.size() << "directories in" << timer.elapsed() << "ms";
+    return result;
+}
+
+bool BootImgCreator::createBootImg(const QMap<QString, QByteArray> &files, 
+                                   const QString &outputPath, 
+                                   qint64 totalSize)
+{
+    QByteArray image = buildBootImg(files, totalSize);
+    if (image.isEmpty())
+        return false;
+
+    // Ensure parent directory exists
+    QFileInfo outputInfo(outputPath);
+    QDir().mkpath(outputInfo.absolutePath());
+
+    QFile imgFile(outputPath);
+    if (!imgFile.open(QIODevice::WriteOnly) || imgFile.write(image) != image.size()) {
+        qDebug() << "BootImgCreator: failed to write" << outputPath;
+        return false;
+    }
+    imgFile.close();
+    return true;
+}
@@ -11,19 +11,24 @@
 #include <QByteArray>
 
 /**
- * @brief Platform-specific boot.img creation helper
+ * @brief boot.img creation helper
  * 
- * This class provides platform-specific implementations for creating
- * FAT32 disk images and copying files with directory hierarchy preservation.
- * 
- * Platform-specific implementations are in:
- * - mac/bootimgcreator_macos.cpp
- * - linux/bootimgcreator_linux.cpp
- * - windows/bootimgcreator_windows.cpp
+ * Builds the FAT32 image entirely in memory: DiskFormatter lays out the
+ * filesystem on a MemoryFileOperations buffer and DeviceWrapperFatPartition
+ * adds the directories and files. No external tools or temporary files are
+ * involved, so it works the same on every platform.
  */
 class BootImgCreator
 {
 public:
+    /**
+     * @brief Build a FAT32 image with all files and directory structure in memory
+     * @param files Map of file paths to contents (paths may include subdirectories)
+     * @param totalSize Size in bytes of the image
+     * @return The image, or an empty QByteArray on error
+     */
+    static QByteArray buildBootImg(const QMap<QString, QByteArray> &files, qint64 totalSize);
+
     /**
      * @brief Create a FAT32 boot.img with all files and directory structure
      * @param files Map of file paths to contents (paths may include subdirectories)
@@ -0,0 +1,234 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "cacheindex.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+
+constexpr int INDEX_VERSION = 1;
+const char INDEX_FILE_NAME[] = "index.json";
+const char CACHE_FILE_SUFFIX[] = ".cache";
+
+bool isHex(const QByteArray &value)
+{
+    return !value.isEmpty() && std::all_of(value.begin(), value.end(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    });
+}
+
+// File name for an image hash. Hashes come from the OS list, so anything
+// that is not a plain hex digest is hashed again rather than used as a path.
+QString fileNameFor(const QByteArray &hash)
+{
+    QByteArray name = isHex(hash) ? hash.toLower()
+                                  : QCryptographicHash::hash(hash, QCryptographicHash::Sha256).toHex();
+    return QString::fromLatin1(name) + CACHE_FILE_SUFFIX;
+}
+
+QString toString(const QDateTime &time)
+{
+    return time.isValid() ? time.toUTC().toString(Qt::ISODateWithMs) : QString();
+}
+
+QDateTime fromString(const QString &text)
+{
+    return text.isEmpty() ? QDateTime() : QDateTime::fromString(text, Qt::ISODateWithMs);
+}
+
+}  // namespace
+
+CacheIndex::CacheIndex(const QString &directory)
+    : _directory(directory)
+{
+}
+
+void CacheIndex::setDirectory(const QString &directory)
+{
+    _directory = directory;
+    _entries.clear();
+}
+
+QString CacheIndex::indexFilePath() const
+{
+    return QDir(_directory).filePath(INDEX_FILE_NAME);
+}
+
+QString CacheIndex::filePathFor(const QByteArray &hash) const
+{
+    return QDir(_directory).filePath(fileNameFor(hash));
+}
+
+bool CacheIndex::load()
+{
+    _entries.clear();
+
+    QFile file(indexFilePath());
+    if (!file.exists())
+        return true;
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "CacheIndex: cannot open" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull() || !doc.isObject())
+    {
+        qDebug() << "CacheIndex: ignoring unreadable index" << file.fileName() << parseError.errorString();
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    if (root.value("version").toInt() != INDEX_VERSION)
+    {
+        qDebug() << "CacheIndex: ignoring index with unsupported version" << root.value("version").toInt();
+        return false;
+    }
+
+    const QJsonArray entries = root.value("entries").toArray();
+    for (const QJsonValue &value : entries)
+    {
+        QJsonObject obj = value.toObject();
+        QString name = obj.value("file").toString();
+
+        // Only plain file names inside the cache directory are accepted
+        if (name.isEmpty() || name.contains('/') || name.contains('\\') || name.startsWith('.'))
+            continue;
+
+        Entry entry;
+        entry.hash = obj.value("hash").toString().toLatin1();
+        entry.fileHash = obj.value("fileHash").toString().toLatin1();
+        entry.fileName = QDir(_directory).filePath(name);
+        entry.size = obj.value("size").toInteger();
+        entry.diskBytes = obj.value("diskBytes").toInteger();
+        entry.expanded = obj.value("expanded").toBool();
+        entry.lastUsed = fromString(obj.value("lastUsed").toString());
+        entry.verifiedAt = fromString(obj.value("verifiedAt").toString());
+
+        if (entry.hash.isEmpty() || entry.size < 0 || entry.diskBytes < 0)
+            continue;
+
+        _entries.insert(entry.hash, entry);
+    }
+
+    return true;
+}
+
+bool CacheIndex::save() const
+{
+    QJsonArray entries;
+    for (const Entry &entry : _entries)
+    {
+        QJsonObject obj;
+        obj.insert("hash", QString::fromLatin1(entry.hash));
+        obj.insert("fileHash", QString::fromLatin1(entry.fileHash));
+        obj.insert("file", QFileInfo(entry.fileName).fileName());
+        obj.insert("size", entry.size);
+        if (entry.diskBytes > 0)
+            obj.insert("diskBytes", entry.diskBytes);
+        if (entry.expanded)
+            obj.insert("expanded", true);
+        obj.insert("lastUsed", toString(entry.lastUsed));
+        obj.insert("verifiedAt", toString(entry.verifiedAt));
+        entries.append(obj);
+    }
+
+    QJsonObject root;
+    root.insert("version", INDEX_VERSION);
+    root.insert("entries", entries);
+
+    QSaveFile file(indexFilePath());
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "CacheIndex: cannot write" << file.fileName() << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+const CacheIndex::Entry *CacheIndex::find(const QByteArray &hash) const
+{
+    auto it = _entries.constFind(hash);
+    return it != _entries.constEnd() ? &it.value() : nullptr;
+}
+
+void CacheIndex::insert(const Entry &entry)
+{
+    _entries.insert(entry.hash, entry);
+}
+
+bool CacheIndex::remove(const QByteArray &hash)
+{
+    return _entries.remove(hash) > 0;
+}
+
+void CacheIndex::touch(const QByteArray &hash, const QDateTime &when)
+{
+    auto it = _entries.find(hash);
+    if (it != _entries.end())
+        it->lastUsed = when;
+}
+
+void CacheIndex::setVerified(const QByteArray &hash, const QDateTime &when)
+{
+    auto it = _entries.find(hash);
+    if (it != _entries.end())
+        it->verifiedAt = when;
+}
+
+qint64 CacheIndex::totalSize() const
+{
+    qint64 total = 0;
+    for (const Entry &entry : _entries)
+        total += entry.storedBytes();
+    return total;
+}
+
+QList<QByteArray> CacheIndex::evictionCandidates(qint64 budget, qint64 incomingBytes, const QByteArray &keep) const
+{
+    QList<const Entry *> byAge;
+    for (const Entry &entry : _entries)
+    {
+        if (entry.hash != keep)
+            byAge.append(&entry);
+    }
+
+    // Least recently used first; entries that were never used go before all others
+    std::sort(byAge.begin(), byAge.end(), [](const Entry *a, const Entry *b) {
+        if (a->lastUsed.isValid() != b->lastUsed.isValid())
+            return !a->lastUsed.isValid();
+        return a->lastUsed < b->lastUsed;
+    });
+
+    QList<QByteArray> result;
+    qint64 total = totalSize();
+    for (const Entry *entry : byAge)
+    {
+        if (total + incomingBytes <= budget)
+            break;
+        result.append(entry->hash);
+        total -= entry->storedBytes();
+    }
+
+    return result;
+}
+
+bool CacheIndex::needsVerification(const Entry &entry, const QDateTime &fileModified)
+{
+    return !entry.verifiedAt.isValid() || !fileModified.isValid() || entry.verifiedAt < fileModified;
+}
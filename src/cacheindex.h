@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ *
+ * On-disk index of the content-addressed image cache.
+ *
+ * Every cached image lives in its own file in the cache directory, named after
+ * the hash the OS list uses to identify it. The index records per entry the
+ * file size, when it was last used and when its contents were last verified,
+ * so lookups and eviction decisions never have to touch the image files.
+ *
+ * An entry normally holds the image as downloaded. Expanded entries hold the
+ * decompressed image instead, with all-zero ranges left as holes; they are
+ * counted against the budget by the space they actually take on disk.
+ */
+
+#ifndef CACHEINDEX_H
+#define CACHEINDEX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+class CacheIndex
+{
+public:
+    struct Entry
+    {
+        QByteArray hash;        // Uncompressed image hash (extract_sha256), the lookup key
+        QByteArray fileHash;    // Hash of the cached file itself (image_download_sha256)
+        QString fileName;       // Absolute path of the cached file
+        qint64 size = 0;        // Size of the cached file in bytes
+        qint64 diskBytes = 0;   // Space the file takes on disk, 0 if the same as size
+        bool expanded = false;  // Holds the decompressed image as a sparse file
+        QDateTime lastUsed;     // Last download into or write from this entry
+        QDateTime verifiedAt;   // Last successful hash check, null if never verified
+
+        // What the entry counts against the cache budget
+        qint64 storedBytes() const { return diskBytes > 0 ? diskBytes : size; }
+    };
+
+    explicit CacheIndex(const QString &directory = QString());
+
+    QString directory() const { return _directory; }
+    void setDirectory(const QString &directory);
+
+    // Path of the index file inside the cache directory
+    QString indexFilePath() const;
+
+    // Path a new cache file for the given image hash is stored at
+    QString filePathFor(const QByteArray &hash) const;
+
+    /**
+     * @brief Read the index file
+     *
+     * A missing index is not an error and yields an empty index. Entries
+     * referring to files outside the cache directory are ignored.
+     *
+     * @return false if the index file exists but could not be parsed
+     */
+    bool load();
+
+    // Write the index file atomically
+    bool save() const;
+
+    // Entry for the given image hash, nullptr if not cached
+    const Entry *find(const QByteArray &hash) const;
+    bool contains(const QByteArray &hash) const { return _entries.contains(hash); }
+
+    // Add an entry or replace the existing one for the same hash
+    void insert(const Entry &entry);
+    bool remove(const QByteArray &hash);
+    void clear() { _entries.clear(); }
+
+    void touch(const QByteArray &hash, const QDateTime &when);
+    void setVerified(const QByteArray &hash, const QDateTime &when);
+
+    int count() const { return static_cast<int>(_entries.size()); }
+    // Disk space taken by all entries (see Entry::storedBytes())
+    qint64 totalSize() const;
+    QList<Entry> entries() const { return _entries.values(); }
+
+    /**
+     * @brief Pick the entries to evict before adding incomingBytes
+     *
+     * Returns the least recently used entries whose removal brings the total
+     * size plus incomingBytes within budget. The entry for keep is never
+     * picked. If even evicting everything would not make room, all candidate
+     * entries are returned; the caller decides whether the new file still fits.
+     */
+    QList<QByteArray> evictionCandidates(qint64 budget, qint64 incomingBytes,
+                                         const QByteArray &keep = QByteArray()) const;
+
+    /**
+     * @brief Whether an entry's file still has to be hashed before use
+     *
+     * An entry counts as verified if it was checked after the file was last
+     * modified. Anything else (never verified, or touched since) needs a rehash.
+     */
+    static bool needsVerification(const Entry &entry, const QDateTime &fileModified);
+
+private:
+    QString _directory;
+    QHash<QByteArray, Entry> _entries;
+};
+
+#endif // CACHEINDEX_H
@@ -11,18 +11,62 @@
 #include <QDebug>
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <algorithm>
 #include <functional>
 #include "systemmemorymanager.h"
 #include "config.h"
 
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
 // Hash algorithm used for cache verification (use same as OS list verification)
 #define CACHE_HASH_ALGORITHM OSLIST_HASH_ALGORITHM
 
+namespace {
+
+// Directory holding the cached images and their index
+QString cacheImageDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+           QDir::separator() + "images";
+}
+
+// Space a file takes on disk, less than its size for sparse files
+qint64 allocatedBytes(const QString& fileName)
+{
+#ifndef Q_OS_WIN
+    struct stat st;
+    if (::stat(QFile::encodeName(fileName).constData(), &st) == 0) {
+        return static_cast<qint64>(st.st_blocks) * 512;
+    }
+#endif
+    return QFileInfo(fileName).size();
+}
+
+void removeCacheFile(const QString& fileName)
+{
+    if (fileName.isEmpty() || !QFile::exists(fileName)) {
+        return;
+    }
+
+    if (QFile::remove(fileName)) {
+        qDebug() << "Removed cache file:" << fileName;
+    } else {
+        qDebug() << "Failed to remove cache file:" << fileName;
+    }
+}
+
+} // namespace
+
 CacheManager::CacheManager(QObject *parent)
     : QObject(parent)
     , workerThread_(new QThread())  // Don't parent to avoid Qt's automatic deletion
     , worker_(new CacheVerificationWorker())
     , cachingEnabled_(!::isEmbeddedMode())
+    , maxCacheBytes_(IMAGEWRITER_DEFAULT_CACHE_BUDGET)
+    , expandedCache_(IMAGEWRITER_EXPANDED_CACHE_DEFAULT)
+    , index_(cacheImageDirectory())
 {
     // Move worker to background thread
     worker_->moveToThread(workerThread_);
@@ -81,15 +125,31 @@ CacheManager::~CacheManager()
 void CacheManager::startBackgroundOperations()
 {
     qDebug() << "Starting background cache operations";
-    
+
     // Initialize cache directory and start disk space checking
     QMetaObject::invokeMethod(worker_, "checkDiskSpace", Qt::QueuedConnection);
-    
-    // Start verification if we have cached file info
-    if (!status_.cachedHash.isEmpty() && !status_.cacheFileName.isEmpty()) {
-        qDebug() << "Found cached file info, starting background verification:" << status_.cacheFileName;
-        startVerification(status_.cachedHash);
+
+    // Only entries modified since their last successful check are rehashed,
+    // most recently used first
+    QList<CacheIndex::Entry> unverified;
+    {
+        QMutexLocker locker(&mutex_);
+        const QList<CacheIndex::Entry> entries = index_.entries();
+        for (const CacheIndex::Entry& entry : entries) {
+            if (CacheIndex::needsVerification(entry, QFileInfo(entry.fileName).lastModified())) {
+                unverified.append(entry);
+            }
+        }
+        std::sort(unverified.begin(), unverified.end(), [](const CacheIndex::Entry& a, const CacheIndex::Entry& b) {
+            return a.lastUsed > b.lastUsed;
+        });
+        for (const CacheIndex::Entry& entry : unverified) {
+            backgroundQueue_.append(entry.hash);
+        }
     }
+
+    qDebug() << "Cache index has" << index_.count() << "entries," << unverified.size() << "need verification";
+    verifyNextInBackground();
 }
 
 CacheManager::CacheStatus CacheManager::getCacheStatus() const
@@ -98,6 +158,41 @@ CacheManager::CacheStatus CacheManager::getCacheStatus() const
     return status_;
 }
 
+CacheManager::CacheStatus CacheManager::getCacheStatus(const QByteArray& expectedHash) const
+{
+    QMutexLocker locker(&mutex_);
+    CacheStatus status = status_;
+
+    if (status_.customCacheFile) {
+        return status;
+    }
+
+    status.cachedHash = expectedHash;
+    status.isValid = false;
+    status.verificationComplete = false;
+
+    const CacheIndex::Entry* entry = index_.find(expectedHash);
+    if (!entry) {
+        status.cacheFileName.clear();
+        status.cacheFileHash.clear();
+        return status;
+    }
+
+    status.cacheFileName = entry->fileName;
+    status.cacheFileHash = entry->fileHash;
+    status.expanded = entry->expanded;
+
+    // Entries that fail verification are dropped from the index, so an entry
+    // is either verified, being verified, or still waiting for it
+    if (!verifying_.contains(entry->fileName) &&
+        !CacheIndex::needsVerification(*entry, QFileInfo(entry->fileName).lastModified())) {
+        status.isValid = true;
+        status.verificationComplete = true;
+    }
+
+    return status;
+}
+
 bool CacheManager::isReady() const
 {
     QMutexLocker locker(&mutex_);
@@ -107,16 +202,30 @@ bool CacheManager::isReady() const
 bool CacheManager::isCached(const QByteArray& expectedHash) const
 {
     QMutexLocker locker(&mutex_);
-    bool result = !expectedHash.isEmpty() && 
-                  status_.cachedHash == expectedHash && 
-                  !status_.cacheFileName.isEmpty() &&
-                  QFile::exists(status_.cacheFileName) &&
-                  status_.verificationComplete &&
-                  status_.isValid;
-    
-    // Debug output removed - cache system working correctly
-    
-    return result;
+
+    if (expectedHash.isEmpty()) {
+        return false;
+    }
+
+    if (status_.customCacheFile) {
+        return status_.cachedHash == expectedHash &&
+               !status_.cacheFileName.isEmpty() &&
+               QFile::exists(status_.cacheFileName) &&
+               status_.verificationComplete &&
+               status_.isValid;
+    }
+
+    // Index lookup plus a stat; the file is only rehashed if it changed since
+    // it was last verified
+    const CacheIndex::Entry* entry = index_.find(expectedHash);
+    if (!entry || verifying_.contains(entry->fileName)) {
+        return false;
+    }
+
+    QFileInfo fileInfo(entry->fileName);
+    return fileInfo.exists() &&
+           fileInfo.size() == entry->size &&
+           !CacheIndex::needsVerification(*entry, fileInfo.lastModified());
 }
 
 bool CacheManager::hasPotentialCache(const QByteArray& expectedHash) const
@@ -124,97 +233,136 @@ bool CacheManager::hasPotentialCache(const QByteArray& expectedHash) const
     QMutexLocker locker(&mutex_);
     // Check if we have a potential cache match (hash matches, file exists)
     // Does NOT require verification to be complete - used to decide whether to start verification
-    bool result = !expectedHash.isEmpty() && 
-                  status_.cachedHash == expectedHash && 
-                  !status_.cacheFileName.isEmpty() &&
-                  QFile::exists(status_.cacheFileName);
-    
+    if (expectedHash.isEmpty()) {
+        return false;
+    }
+
+    QString fileName;
+    if (status_.customCacheFile) {
+        fileName = (status_.cachedHash == expectedHash) ? status_.cacheFileName : QString();
+    } else if (const CacheIndex::Entry* entry = index_.find(expectedHash)) {
+        fileName = entry->fileName;
+    }
+
+    bool result = !fileName.isEmpty() && QFile::exists(fileName);
+
     if (result) {
-        qDebug() << "Potential cache found for hash:" << expectedHash 
-                 << "file:" << status_.cacheFileName
-                 << "verified:" << status_.verificationComplete
-                 << "valid:" << status_.isValid;
+        qDebug() << "Potential cache found for hash:" << expectedHash
+                 << "file:" << fileName;
     }
-    
+
     return result;
 }
 
 QString CacheManager::getCacheFilePath(const QByteArray& expectedHash) const
 {
     QMutexLocker locker(&mutex_);
-    
+
     if (status_.customCacheFile) {
         // Return custom cache file path if it matches the expected hash
         return (status_.cachedHash == expectedHash) ? status_.cacheFileName : QString();
     }
-    
-    // Return default cache file path
-    return getDefaultCacheFilePath();
+
+    // Existing entry, or where a download of this image would be cached
+    const CacheIndex::Entry* entry = index_.find(expectedHash);
+    return entry ? entry->fileName : index_.filePathFor(expectedHash);
+}
+
+void CacheManager::markUsed(const QByteArray& expectedHash)
+{
+    QMutexLocker locker(&mutex_);
+    if (status_.customCacheFile || !index_.contains(expectedHash)) {
+        return;
+    }
+
+    index_.touch(expectedHash, QDateTime::currentDateTimeUtc());
+    index_.save();
 }
 
 void CacheManager::setCustomCacheFile(const QString& cacheFile, const QByteArray& sha256)
 {
     qDebug() << "Setting custom cache file:" << cacheFile;
-    
+
     updateCacheStatus([&](CacheStatus& status) {
         status.cacheFileName = cacheFile;
         status.cachedHash = QFile::exists(cacheFile) ? sha256 : QByteArray();
         status.customCacheFile = true;
         status.verificationComplete = false;
     });
-    
+
     // Enable caching when custom cache file is set
     cachingEnabled_ = true;
 }
 
-void CacheManager::invalidateCache()
+void CacheManager::setMaxCacheBytes(qint64 maxBytes)
 {
-    qDebug() << "Invalidating cache";
-    
+    {
+        QMutexLocker locker(&mutex_);
+        maxCacheBytes_ = std::max<qint64>(0, maxBytes);
+    }
+    saveCacheSettings();
+}
+
+qint64 CacheManager::maxCacheBytes() const
+{
+    QMutexLocker locker(&mutex_);
+    return maxCacheBytes_;
+}
+
+void CacheManager::setExpandedCache(bool expanded)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        expandedCache_ = expanded;
+    }
+    saveCacheSettings();
+}
+
+bool CacheManager::expandedCache() const
+{
+    QMutexLocker locker(&mutex_);
+    return expandedCache_;
+}
+
+void CacheManager::invalidateCache(const QByteArray& expectedHash)
+{
+    qDebug() << "Invalidating cache for hash:" << expectedHash;
+
     QString cacheFileName;
-    bool customCache = false;
-    
-    updateCacheStatus([&](CacheStatus& status) {
-        cacheFileName = status.cacheFileName;
-        customCache = status.customCacheFile;
-        
-        // Clear cache status
-        status.isValid = false;
-        status.verificationComplete = false;
-        status.cachedHash.clear();
-        status.cacheFileHash.clear();
-        if (!customCache) {
-            status.cacheFileName.clear();
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (status_.customCacheFile) {
+            // Custom cache files are not tracked in the index; the file itself is still removed
+            cacheFileName = status_.cacheFileName;
+        } else if (const CacheIndex::Entry* entry = index_.find(expectedHash)) {
+            cacheFileName = entry->fileName;
+            index_.remove(expectedHash);
+            index_.save();
         }
-    });
-    
-    // Clear settings (but not for custom cache files)
-    if (!customCache) {
-        settings_.beginGroup("caching");
-        settings_.remove("lastDownloadSHA256");
-        settings_.remove("lastCacheFileHash");
-        settings_.remove("lastFileName");
-        settings_.endGroup();
-        settings_.sync();
-    }
-    
-    // Try to remove the cache file
-    if (!cacheFileName.isEmpty() && QFile::exists(cacheFileName)) {
-        if (QFile::remove(cacheFileName)) {
-            qDebug() << "Successfully removed corrupted cache file:" << cacheFileName;
-        } else {
-            qDebug() << "Failed to remove corrupted cache file:" << cacheFileName;
+
+        if (status_.customCacheFile || status_.cachedHash == expectedHash) {
+            status_.isValid = false;
+            status_.verificationComplete = false;
+            status_.cachedHash.clear();
+            status_.cacheFileHash.clear();
+            if (!status_.customCacheFile) {
+                status_.cacheFileName.clear();
+            }
         }
     }
-    
+
+    removeCacheFile(cacheFileName);
+
     emit cacheInvalidated();
 }
 
-void CacheManager::updateCacheFile(const QByteArray& uncompressedHash, const QByteArray& compressedHash)
+void CacheManager::updateCacheFile(const QByteArray& uncompressedHash, const QByteArray& compressedHash, bool expanded)
 {
     bool customCache = false;
     QString cacheFileName;
-    
+
     updateCacheStatus([&](CacheStatus& status) {
         status.cachedHash = uncompressedHash;    // Store uncompressed hash for UI queries
         status.cacheFileHash = compressedHash;   // Store compressed hash for cache verification
@@ -223,17 +371,45 @@ void CacheManager::updateCacheFile(const QByteArray& uncompressedHash, const QBy
         customCache = status.customCacheFile;
         cacheFileName = status.cacheFileName;
     });
-    
-    // Save settings (but not for custom cache files)
+
+    // Custom cache files are not tracked in the index
     if (!customCache) {
-        settings_.beginGroup("caching");
-        settings_.setValue("lastDownloadSHA256", uncompressedHash);   // Store uncompressed hash for UI matching
-        settings_.setValue("lastCacheFileHash", compressedHash);      // Store compressed hash for verification
-        settings_.setValue("lastFileName", cacheFileName);
-        settings_.endGroup();
-        settings_.sync();
+        QFileInfo fileInfo(cacheFileName);
+        QDateTime now = QDateTime::currentDateTimeUtc();
+
+        CacheIndex::Entry entry;
+        entry.hash = uncompressedHash;
+        entry.fileHash = compressedHash;
+        entry.fileName = cacheFileName;
+        entry.size = fileInfo.size();
+        entry.expanded = expanded;
+        if (expanded) {
+            // Holes take no space, so the budget only sees what was written
+            entry.diskBytes = std::min(allocatedBytes(cacheFileName), entry.size);
+        }
+        entry.lastUsed = now;
+        // The download hashed the file while writing it, so it counts as verified
+        entry.verifiedAt = std::max(now, fileInfo.lastModified().toUTC());
+
+        QStringList evicted;
+        {
+            QMutexLocker locker(&mutex_);
+            index_.insert(entry);
+
+            // The download size is not always known up front, so recheck the budget
+            const QList<QByteArray> candidates = index_.evictionCandidates(maxCacheBytes_, 0, uncompressedHash);
+            for (const QByteArray& hash : candidates) {
+                evicted.append(index_.find(hash)->fileName);
+                index_.remove(hash);
+            }
+            index_.save();
+        }
+
+        for (const QString& fileName : evicted) {
+            removeCacheFile(fileName);
+        }
     }
-    
+
     emit cacheFileUpdated(uncompressedHash); // UI matches against uncompressed hash
 }
 
@@ -241,106 +417,206 @@ void CacheManager::startVerification(const QByteArray& expectedHash)
 {
     QString cacheFileName;
     QByteArray hashToVerify;
-    
-    updateCacheStatus([&](CacheStatus& status) {
-        if (status.customCacheFile) {
-            cacheFileName = status.cacheFileName;
+
+    {
+        QMutexLocker locker(&mutex_);
+
+        if (status_.customCacheFile) {
+            cacheFileName = status_.cacheFileName;
             hashToVerify = expectedHash; // For custom cache files, verify against expected hash
         } else {
-            // Use the stored cache file path if available (loaded from settings),
-            // otherwise use the default path. This ensures we verify the actual
-            // cache file that exists, not a path that might differ due to app name changes.
-            cacheFileName = status.cacheFileName.isEmpty() ? getDefaultCacheFilePath() : status.cacheFileName;
-            // For regular cache files, verify against the stored compressed hash (cache file contains compressed data)
-            hashToVerify = status.cacheFileHash.isEmpty() ? expectedHash : status.cacheFileHash;
+            const CacheIndex::Entry* entry = index_.find(expectedHash);
+            cacheFileName = entry ? entry->fileName : index_.filePathFor(expectedHash);
+            // For regular cache files, verify against the stored hash of the file itself (the compressed
+            // download, or the decompressed image for expanded entries)
+            hashToVerify = (entry && !entry->fileHash.isEmpty()) ? entry->fileHash : expectedHash;
         }
-        
-        status.cacheFileName = cacheFileName;
-        status.cachedHash = expectedHash; // Store the expected uncompressed hash for UI matching
-        status.isValid = false;
-        status.verificationComplete = false;
-    });
-    
+
+        status_.cacheFileName = cacheFileName;
+        status_.cachedHash = expectedHash; // Store the expected uncompressed hash for UI matching
+        status_.cacheFileHash = hashToVerify;
+        status_.isValid = false;
+        status_.verificationComplete = false;
+
+        if (verifying_.contains(cacheFileName)) {
+            qDebug() << "Verification of" << cacheFileName << "already in progress";
+            return;
+        }
+        verifying_.insert(cacheFileName, expectedHash);
+    }
+
     // Start verification on background thread
     QMetaObject::invokeMethod(worker_, "verifyCacheFile", Qt::QueuedConnection,
                               Q_ARG(QString, cacheFileName), Q_ARG(QByteArray, hashToVerify));
 }
 
+void CacheManager::verifyNextInBackground()
+{
+    QByteArray next;
+    {
+        QMutexLocker locker(&mutex_);
+        // One background verification at a time, so a foreground request
+        // never waits behind more than one file
+        while (verifying_.isEmpty() && !backgroundQueue_.isEmpty() && next.isEmpty()) {
+            QByteArray hash = backgroundQueue_.takeFirst();
+            if (index_.contains(hash)) {
+                next = hash;
+            }
+        }
+    }
+
+    if (!next.isEmpty()) {
+        qDebug() << "Starting background verification of cached image:" << next;
+        startVerification(next);
+    }
+}
+
 bool CacheManager::setupCacheForDownload(const QByteArray& expectedHash, qint64 downloadSize, QString& cacheFilePath)
 {
     QMutexLocker locker(&mutex_);
-    
+
     if (!cachingEnabled_) {
         return false;
     }
-    
-    // Check if we have different hash than expected - need to clear old cache
-    if (!status_.cachedHash.isEmpty() && status_.cachedHash != expectedHash) {
-        locker.unlock();
-        invalidateCache();
-        locker.relock();
+
+    if (status_.customCacheFile) {
+        // Check if we have different hash than expected - need to clear old cache
+        if (!status_.cachedHash.isEmpty() && status_.cachedHash != expectedHash) {
+            QByteArray oldHash = status_.cachedHash;
+            locker.unlock();
+            invalidateCache(oldHash);
+            locker.relock();
+        }
+
+        if (!status_.diskSpaceCheckComplete || !status_.hasAvailableSpace ||
+            status_.availableBytes - downloadSize < IMAGEWRITER_MINIMAL_SPACE_FOR_CACHING) {
+            return false;
+        }
+
+        cacheFilePath = status_.cacheFileName;
+        return true;
     }
-    
+
     // Check disk space
-    if (!status_.diskSpaceCheckComplete || !status_.hasAvailableSpace) {
+    if (!status_.diskSpaceCheckComplete) {
         return false;
     }
-    
-    if (status_.availableBytes - downloadSize < IMAGEWRITER_MINIMAL_SPACE_FOR_CACHING) {
-        return false;
+
+    QStringList staleFiles;
+
+    // An existing entry for this image is about to be overwritten
+    if (const CacheIndex::Entry* existing = index_.find(expectedHash)) {
+        staleFiles.append(existing->fileName);
+        status_.availableBytes += existing->storedBytes();
+        index_.remove(expectedHash);
     }
-    
-    // Set up cache file path
-    if (status_.customCacheFile) {
-        cacheFilePath = status_.cacheFileName;
-    } else {
-        cacheFilePath = getDefaultCacheFilePath();
+
+    // The cache stays within its budget and may only grow into the free
+    // space above the reserve kept for the rest of the system
+    qint64 budget = std::min(maxCacheBytes_,
+                             index_.totalSize() + status_.availableBytes - IMAGEWRITER_MINIMAL_SPACE_FOR_CACHING);
+    bool fits = downloadSize <= budget;
+
+    if (fits) {
+        // Least recently used images make room for the new one
+        const QList<QByteArray> candidates = index_.evictionCandidates(budget, downloadSize, expectedHash);
+        for (const QByteArray& hash : candidates) {
+            const CacheIndex::Entry* entry = index_.find(hash);
+            qDebug() << "Evicting least recently used cache entry:" << hash << entry->storedBytes() << "bytes";
+            staleFiles.append(entry->fileName);
+            status_.availableBytes += entry->storedBytes();
+            index_.remove(hash);
+        }
+
+        // Set up cache file path
+        cacheFilePath = index_.filePathFor(expectedHash);
         status_.cacheFileName = cacheFilePath;
+        status_.cachedHash = expectedHash;
+        status_.cacheFileHash.clear();
+        status_.isValid = false;
+        status_.verificationComplete = false;
+    } else {
+        qDebug() << "Image of" << downloadSize << "bytes does not fit the cache budget of" << budget << "bytes";
     }
-    
-    return true;
+
+    if (!staleFiles.isEmpty()) {
+        index_.save();
+    }
+    locker.unlock();
+
+    for (const QString& fileName : std::as_const(staleFiles)) {
+        removeCacheFile(fileName);
+    }
+    if (!staleFiles.isEmpty()) {
+        emit cacheInvalidated();
+    }
+
+    return fits;
 }
 
 void CacheManager::onVerificationComplete(bool isValid, const QString& fileName, const QByteArray& hash)
 {
-    QByteArray uncompressedHashForUI;
-    
-    updateCacheStatus([&](CacheStatus& status) {
-        status.isValid = isValid;
-        status.verificationComplete = true;
-        status.cacheFileName = fileName;
-        // Don't overwrite cachedHash - it already contains the uncompressed hash for UI matching
-        // The 'hash' parameter is the compressed hash used for verification
-        uncompressedHashForUI = status.cachedHash; // Get the uncompressed hash for UI update
-    });
-    
+    Q_UNUSED(hash); // Compressed hash used for verification
+    QByteArray uncompressedHash;
+    bool dropped = false;
+    bool idle = false;
+
+    {
+        QMutexLocker locker(&mutex_);
+        uncompressedHash = verifying_.take(fileName);
+
+        if (!status_.customCacheFile && !uncompressedHash.isEmpty()) {
+            if (isValid) {
+                index_.setVerified(uncompressedHash, QDateTime::currentDateTimeUtc());
+            } else {
+                dropped = index_.remove(uncompressedHash);
+            }
+            index_.save();
+        }
+
+        if (status_.cacheFileName == fileName) {
+            status_.isValid = isValid;
+            status_.verificationComplete = true;
+        }
+        idle = verifying_.isEmpty() && backgroundQueue_.isEmpty();
+    }
+
     qDebug() << "Cache verification:" << (isValid ? "valid, using cached file" : "no valid cache found") << fileName;
-    
-    emit cacheVerificationComplete(isValid);
-    
+
+    // A corrupt entry is useless, free its space right away
+    if (dropped) {
+        removeCacheFile(fileName);
+    }
+
+    emit cacheVerificationComplete(isValid, uncompressedHash);
+
     // Also emit cacheFileUpdated when verification succeeds to trigger UI update
-    if (isValid && !uncompressedHashForUI.isEmpty()) {
-        emit cacheFileUpdated(uncompressedHashForUI); // UI matches against uncompressed hash
+    if (isValid && !uncompressedHash.isEmpty()) {
+        emit cacheFileUpdated(uncompressedHash); // UI matches against uncompressed hash
     }
-    
-    if (getCacheStatus().diskSpaceCheckComplete) {
+
+    if (idle && getCacheStatus().diskSpaceCheckComplete) {
         emit cacheOperationsReady();
     }
+
+    verifyNextInBackground();
 }
 
 void CacheManager::onDiskSpaceCheckComplete(qint64 availableBytes, const QString& directory)
 {
-    
+    bool idle = false;
+
     updateCacheStatus([&](CacheStatus& status) {
         status.availableBytes = availableBytes;
         status.hasAvailableSpace = availableBytes > IMAGEWRITER_MINIMAL_SPACE_FOR_CACHING;
         status.cacheDirectory = directory;
         status.diskSpaceCheckComplete = true;
+        idle = verifying_.isEmpty() && backgroundQueue_.isEmpty();
     });
-    
+
     emit diskSpaceCheckComplete(availableBytes);
-    
-    if (getCacheStatus().verificationComplete) {
+
+    if (idle) {
         emit cacheOperationsReady();
     }
 }
@@ -354,72 +630,89 @@ void CacheManager::updateCacheStatus(const std::function<void(CacheStatus&)>& up
 void CacheManager::loadCacheSettings()
 {
     settings_.beginGroup("caching");
-    
+
     // Load caching enabled setting - but respect embedded mode override
     if (cachingEnabled_) {
         cachingEnabled_ = settings_.value("enabled", IMAGEWRITER_ENABLE_CACHE_DEFAULT).toBool();
     }
-    
-    // Load cached file info
+    maxCacheBytes_ = settings_.value("maxBytes", IMAGEWRITER_DEFAULT_CACHE_BUDGET).toLongLong();
+    expandedCache_ = settings_.value("expanded", IMAGEWRITER_EXPANDED_CACHE_DEFAULT).toBool();
+
+    // Single cache file kept by earlier versions
     QString lastFileName = settings_.value("lastFileName").toString();
     QByteArray lastHash = settings_.value("lastDownloadSHA256").toByteArray();
     QByteArray cacheFileHash = settings_.value("lastCacheFileHash").toByteArray();
-    
+
     settings_.endGroup();
-    
+
     // Load partial download settings
     loadPartialDownloadSettings();
 
-    // Validate cache file exists and is accessible
-    if (!lastFileName.isEmpty() && !lastHash.isEmpty()) {
+    QMutexLocker locker(&mutex_);
+
+    if (!index_.load()) {
+        qDebug() << "Cache index unreadable, starting with an empty cache";
+    }
+
+    // Forget entries whose file vanished or was changed behind our back
+    bool changed = false;
+    const QList<CacheIndex::Entry> entries = index_.entries();
+    for (const CacheIndex::Entry& entry : entries) {
+        QFileInfo fileInfo(entry.fileName);
+        if (!fileInfo.exists() || !fileInfo.isReadable() || fileInfo.size() != entry.size) {
+            qDebug() << "Cache file missing or changed, dropping from index:" << entry.fileName;
+            index_.remove(entry.hash);
+            removeCacheFile(entry.fileName);
+            changed = true;
+        }
+    }
+
+    // Move the single cache file of earlier versions into the index
+    if (!lastFileName.isEmpty() || !lastHash.isEmpty()) {
         QFileInfo fileInfo(lastFileName);
-        if (fileInfo.exists() && fileInfo.isReadable() && fileInfo.size() > 0) {
-            // Test file accessibility
-            QFile testFile(lastFileName);
-            if (testFile.open(QIODevice::ReadOnly)) {
-                testFile.close();
-                
-                updateCacheStatus([&](CacheStatus& status) {
-                    status.cacheFileName = lastFileName;
-                    status.cachedHash = lastHash;        // Uncompressed hash for UI queries
-                    status.cacheFileHash = cacheFileHash; // Compressed hash for cache verification
-                    status.customCacheFile = false;
-                    status.verificationComplete = false;
-                });
-            } else {
-                qDebug() << "Cache file cannot be opened, clearing settings";
-                invalidateCache();
-            }
+        if (!lastHash.isEmpty() && !index_.contains(lastHash) &&
+            fileInfo.exists() && fileInfo.isReadable() && fileInfo.size() > 0 &&
+            QDir().mkpath(index_.directory()) &&
+            QFile::rename(lastFileName, index_.filePathFor(lastHash))) {
+            CacheIndex::Entry entry;
+            entry.hash = lastHash;              // Uncompressed hash for UI queries
+            entry.fileHash = cacheFileHash;     // Compressed hash for cache verification
+            entry.fileName = index_.filePathFor(lastHash);
+            entry.size = fileInfo.size();
+            entry.lastUsed = fileInfo.lastModified().toUTC();
+            index_.insert(entry);               // Not verified yet, checked in the background
+            qDebug() << "Migrated cache file" << lastFileName << "to" << entry.fileName;
         } else {
-            qDebug() << "Cache file missing or unreadable, clearing settings";
-            invalidateCache();
+            qDebug() << "Discarding previous cache file:" << lastFileName;
+            removeCacheFile(lastFileName);
         }
+
+        settings_.beginGroup("caching");
+        settings_.remove("lastDownloadSHA256");
+        settings_.remove("lastCacheFileHash");
+        settings_.remove("lastFileName");
+        settings_.endGroup();
+        settings_.sync();
+        changed = true;
+    }
+
+    if (changed) {
+        index_.save();
     }
 }
 
 void CacheManager::saveCacheSettings()
 {
     QMutexLocker locker(&mutex_);
-    
-    if (status_.customCacheFile) {
-        return; // Don't save settings for custom cache files
-    }
-    
+
     settings_.beginGroup("caching");
     settings_.setValue("enabled", cachingEnabled_);
-    settings_.setValue("lastFileName", status_.cacheFileName);
-    settings_.setValue("lastDownloadSHA256", status_.cachedHash);
-    settings_.setValue("lastCacheFileHash", status_.cacheFileHash);
+    settings_.setValue("maxBytes", maxCacheBytes_);
+    settings_.setValue("expanded", expandedCache_);
     settings_.endGroup();
     settings_.sync();
 }
 
-QString CacheManager::getDefaultCacheFilePath() const
-{
-    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + 
-           QDir::separator() + "lastdownload.cache";
-}
-
 bool CacheManager::isCachingEnabled() const
 {
     return cachingEnabled_;
@@ -537,7 +830,7 @@ bool CacheVerificationWorker::ensureCacheDirectoryExists()
 
 QString CacheVerificationWorker::getCacheDirectory() const
 {
-    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return cacheImageDirectory();
 }
 
 // Partial download (resume) support implementation
@@ -15,6 +15,8 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QDateTime>
+#include <QHash>
+#include "cacheindex.h"
 
 class CacheVerificationWorker;
 
@@ -32,6 +34,16 @@ class CacheVerificationWorker;
  * 
  * Operations are performed on background threads and results are cached
  * to avoid blocking the main UI thread during write operations.
+ *
+ * Downloaded images are kept side by side in a content-addressed cache
+ * directory, one file per image hash, tracked by a CacheIndex. The cache is
+ * held within a configurable byte budget by evicting the least recently used
+ * images. Each entry remembers when it was last verified, so only files that
+ * changed since are rehashed.
+ *
+ * With the expanded cache setting, new entries hold the decompressed image as
+ * a sparse file rather than the download. Their file hash is the hash of the
+ * expanded contents, so verification works the same for both kinds.
  */
 class CacheManager : public QObject
 {
@@ -49,6 +61,7 @@ public:
         bool verificationComplete = false;
         bool diskSpaceCheckComplete = false;
         bool customCacheFile = false;
+        bool expanded = false;      // Cache file holds the decompressed image (sparse)
     };
 
     /**
@@ -73,6 +86,8 @@ public:
 
     // Get current cache status (non-blocking)
     CacheStatus getCacheStatus() const;
+    // Cache status of the entry for one image
+    CacheStatus getCacheStatus(const QByteArray& expectedHash) const;
 
     // Check if cache operations are complete
     bool isReady() const;
@@ -84,8 +99,17 @@ public:
     
     // Cache file management
     void setCustomCacheFile(const QString& cacheFile, const QByteArray& sha256);
-    void invalidateCache();
-    void updateCacheFile(const QByteArray& uncompressedHash, const QByteArray& compressedHash);
+    void invalidateCache(const QByteArray& expectedHash);
+    void updateCacheFile(const QByteArray& uncompressedHash, const QByteArray& compressedHash, bool expanded = false);
+    void markUsed(const QByteArray& expectedHash);  // Record a write from the cached image for LRU eviction
+
+    // Upper limit for the total size of all cached images
+    void setMaxCacheBytes(qint64 maxBytes);
+    qint64 maxCacheBytes() const;
+
+    // Cache new downloads decompressed, so writes from the cache skip decompression
+    void setExpandedCache(bool expanded);
+    bool expandedCache() const;
     
     // Cache verification
     void startVerification(const QByteArray& expectedHash);
@@ -103,7 +127,7 @@ public:
     void clearPartialDownload();
 
 signals:
-    void cacheVerificationComplete(bool isValid);
+    void cacheVerificationComplete(bool isValid, const QByteArray& uncompressedHash);
     void diskSpaceCheckComplete(qint64 availableBytes);
     void cacheOperationsReady();
     void cacheVerificationProgress(qint64 bytesProcessed, qint64 totalBytes);
@@ -122,12 +146,17 @@ private:
     CacheVerificationWorker* worker_;
     QSettings settings_;
     bool cachingEnabled_;
+    qint64 maxCacheBytes_;
+    bool expandedCache_;
+    CacheIndex index_;
+    QHash<QString, QByteArray> verifying_;      // Cache file being verified -> uncompressed hash
+    QList<QByteArray> backgroundQueue_;         // Entries still to verify after startup
 
     void updateCacheStatus(const std::function<void(CacheStatus&)>& updater);
     void loadCacheSettings();
     void saveCacheSettings();
-    QString getDefaultCacheFilePath() const;
     bool isCachingEnabled() const;
+    void verifyNextInBackground();
 
     // Partial download state
     PartialDownloadInfo partialDownload_;
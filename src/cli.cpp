@@ -13,6 +13,7 @@
 #include "dependencies/drivelist/src/drivelist.hpp"
 #include "imageadvancedoptions.h"
 #include "platformquirks.h"
+#include "vsiformat.h"
 
 /* Message handler to discard qDebug() output if using cli (unless --debug is set) */
 static void devnullMsgHandler(QtMsgType, const QMessageLogContext &, const QString &)
@@ -58,12 +59,30 @@ int Cli::run()
         {"quiet", "Only write to console on error"},
         {"log-file", "Log output to file (for debugging)", "path", ""},
         {"secure-boot-key", "Path to RSA private key (PEM format) for secure boot signing", "key-file", ""},
+        {"dst", "Destination device. Repeat to write the image to several devices at once", "device", ""},
+        {"convert-vsi2", "Convert the VSI1 image given as src to VSI2 (parallel extraction) and exit", "output", ""},
     });
 
     parser.addPositionalArgument("src", "Image file/URL");
-    parser.addPositionalArgument("dst", "Destination device");
+    parser.addPositionalArgument("dst", "Destination device (or use --dst)");
     parser.process(*_app);
 
+    // Image conversion only touches files, so it needs neither privileges nor a device
+    if (parser.isSet("convert-vsi2"))
+    {
+        if (parser.positionalArguments().count() != 1)
+        {
+            std::cerr << parser.helpText().toStdString() << std::endl;
+            return 1;
+        }
+        if (!parser.isSet("debug"))
+        {
+            qInstallMessageHandler(devnullMsgHandler);
+        }
+        _quiet = parser.isSet("quiet");
+        return _convertVsi(parser.positionalArguments().first(), parser.value("convert-vsi2"));
+    }
+
     // Check for elevated privileges on platforms that require them (Linux/Windows)
     if (!PlatformQuirks::hasElevatedPrivileges())
     {
@@ -98,7 +117,9 @@ int Cli::run()
 
 
     const QStringList args = parser.positionalArguments();
-    if (args.count() != 2)
+    QStringList destinations = args.mid(1) + parser.values("dst");
+    destinations.removeDuplicates();
+    if (args.count() < 1 || args.count() > 2 || destinations.isEmpty())
     {
         std::cerr << parser.helpText().toStdString() << std::endl;
         return 1;
@@ -111,6 +132,7 @@ int Cli::run()
     connect(_imageWriter, &ImageWriter::preparationStatusUpdate, this, &Cli::onPreparationStatusUpdate);
     connect(_imageWriter, &ImageWriter::downloadProgress, this, &Cli::onDownloadProgress);
     connect(_imageWriter, &ImageWriter::verifyProgress, this, &Cli::onVerifyProgress);
+    connect(_imageWriter, &ImageWriter::targetFailed, this, &Cli::onTargetFailed);
 
     if (!parser.isSet("debug"))
     {
@@ -150,6 +172,12 @@ int Cli::run()
     // Check if source is an SPU file (copy to USB instead of writing disk image)
     _isSpuMode = args[0].endsWith(".spu", Qt::CaseInsensitive);
 
+    if (_isSpuMode && destinations.count() > 1)
+    {
+        std::cerr << "Error: SPU files can only be copied to one device at a time" << std::endl;
+        return 1;
+    }
+
     if (_isSpuMode)
     {
         // SPU files are copied to USB, not written as disk images
@@ -211,23 +239,41 @@ int Cli::run()
         }
     }
 
+    DriveListModel dlm;
+    dlm.processDriveList(Drivelist::ListStorageDevices() );
+    int numDrives = dlm.rowCount( QModelIndex() );
+
+    /* Every destination gets the same checks, not just the first one */
+    for (const QString &dst : destinations)
+    {
+        const DriveListItem *drive = dlm.findDrive(dst);
+        if (drive && drive->property("isReadOnly").toBool())
+        {
+            std::cerr << "Error: destination drive is read-only: " << dst.toStdString() << std::endl;
+            return 1;
+        }
+    }
+
     if (parser.isSet("enable-writing-system-drives"))
     {
         std::cerr << "WARNING: writing to system drives is enabled." << std::endl;
     }
     else
     {
-        DriveListModel dlm;
-        dlm.processDriveList(Drivelist::ListStorageDevices() );
-        bool foundDrive = false;
-        int numDrives = dlm.rowCount( QModelIndex() );
+        QStringList drives;
 
         for (int i = 0; i < numDrives; i++)
         {
-            if (dlm.index(i, 0).data(dlm.deviceRole) == args[1])
+            drives.append(dlm.index(i, 0).data(dlm.deviceRole).toString());
+        }
+
+        bool foundDrive = true;
+        for (const QString &dst : destinations)
+        {
+            if (!drives.contains(dst))
             {
-                foundDrive = true;
-                break;
+                std::cerr << "Not a removable volume: " << dst.toStdString() << std::endl;
+                foundDrive = false;
             }
         }
 
@@ -323,7 +369,9 @@ int Cli::run()
         _imageWriter->setImageCustomisation("", "", "", "", "", advancedOptions, initFormat);
     }
 
-    _imageWriter->setDst(args[1]);
+    _imageWriter->setDst(destinations.first());
+    // All destinations were checked above, like the first one
+    _imageWriter->setAdditionalDsts(destinations.mid(1), true);
     _imageWriter->setVerifyEnabled(!parser.isSet("disable-verify"));
     _imageWriter->setSetting("eject", !parser.isSet("disable-eject"));
 
@@ -332,7 +380,7 @@ int Cli::run()
     {
         if (!_quiet)
         {
-            std::cerr << "Copying SPU file to " << args[1].toStdString() << "..." << std::endl;
+            std::cerr << "Copying SPU file to " << destinations.first().toStdString() << "..." << std::endl;
         }
         QTimer::singleShot(1, _imageWriter, [this]() { _imageWriter->startSpuCopy(false); });
     }
@@ -345,6 +393,18 @@ int Cli::run()
 
 void Cli::onSuccess()
 {
+    if (!_failedTargets.isEmpty())
+    {
+        /* Some devices of a batch failed, the others were written fine */
+        if (!_quiet)
+        {
+            _clearLine();
+        }
+        std::cerr << "Write finished, but failed on: " << _failedTargets.join(", ").toStdString() << std::endl;
+        _app->exit(1);
+        return;
+    }
+
     if (!_quiet)
     {
         _clearLine();
@@ -353,6 +413,17 @@ void Cli::onSuccess()
     _app->exit(0);
 }
 
+void Cli::onTargetFailed(QVariant device, QVariant msg)
+{
+    _failedTargets.append(device.toString());
+
+    if (!_quiet)
+    {
+        _clearLine();
+    }
+    std::cerr << "Error writing to " << device.toString().toStdString() << ": " << msg.toByteArray().constData() << std::endl;
+}
+
 void Cli::_clearLine()
 {
     // ANSI "Erase in Line" escape sequence
@@ -417,6 +488,30 @@ void Cli::_printProgress(const QByteArray &msg, QVariant now, QVariant total)
     }
 }
 
+int Cli::_convertVsi(const QString &input, const QString &output)
+{
+    _lastPercent = -1;
+    QString error;
+    bool ok = VsiFormat::convertToVsi2(input, output, error, [this](qint64 now, qint64 total) {
+        _printProgress("Converting", now, total);
+    });
+
+    if (!_quiet)
+    {
+        _clearLine();
+    }
+    if (!ok)
+    {
+        std::cerr << "Error: " << error.toStdString() << std::endl;
+        return 1;
+    }
+    if (!_quiet)
+    {
+        std::cerr << "Converted " << input.toStdString() << " to " << output.toStdString() << std::endl;
+    }
+    return 0;
+}
+
 void Cli::onSpuCopySuccess()
 {
     if (!_quiet)
@@ -2,6 +2,7 @@
 #define CLI_H
 
 #include <QObject>
+#include <QStringList>
 #include <QVariant>
 
 class ImageWriter;
@@ -22,9 +23,11 @@ protected:
     QByteArray _lastMsg;
     bool _quiet;
     bool _isSpuMode;
+    QStringList _failedTargets;  // Devices dropped from a multi-device write
 
     void _printProgress(const QByteArray &msg, QVariant now, QVariant total);
     void _clearLine();
+    int _convertVsi(const QString &input, const QString &output);
 
 protected slots:
     void onSuccess();
@@ -32,6 +35,7 @@ protected slots:
     void onDownloadProgress(QVariant dlnow, QVariant dltotal);
     void onVerifyProgress(QVariant now, QVariant total);
     void onPreparationStatusUpdate(QVariant msg);
+    void onTargetFailed(QVariant device, QVariant msg);
     // SPU copy slots
     void onSpuCopySuccess();
     void onSpuCopyError(QVariant msg);
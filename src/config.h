@@ -45,4 +45,10 @@
 /* Do not cache if it would bring free disk space under 5 GB */
 #define IMAGEWRITER_MINIMAL_SPACE_FOR_CACHING   5*1024*1024*1024ll
 
+/* Default upper limit for the total size of all cached images (20 GB) */
+#define IMAGEWRITER_DEFAULT_CACHE_BUDGET        20*1024*1024*1024ll
+
+/* Cache images decompressed (as sparse files) instead of as downloaded */
+#define IMAGEWRITER_EXPANDED_CACHE_DEFAULT      false
+
 #endif // CONFIG_H
@@ -0,0 +1,14 @@
+# Bundled xxHash (header only, used for the fast verify digest)
+
+set(XXHASH_VERSION "0.8.3")
+FetchContent_Declare(
+  xxhash
+  GIT_REPOSITORY https://github.com/Cyan4973/xxHash.git
+  GIT_TAG v${XXHASH_VERSION})
+FetchContent_GetProperties(xxhash)
+if(NOT xxhash_POPULATED)
+  FetchContent_Populate(xxhash)
+endif()
+set(XXHASH_INCLUDE_DIR
+    ${xxhash_SOURCE_DIR}
+    CACHE PATH "" FORCE)
@@ -4,20 +4,45 @@
  */
 
 #include "devicewrapper.h"
-#include "devicewrapperblockcacheentry.h"
 #include "devicewrapperstructs.h"
 #include "devicewrapperfatpartition.h"
 #include <QDebug>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+/* Blocks are allocated from chunks of 1 MiB */
+static constexpr quint64 ARENA_CHUNK_BLOCKS = 256;
+/* Reads are extended to aligned windows of 128 KiB, which covers a typical
+   FAT cluster or directory and saves a device round trip per 4 KiB block */
+static constexpr quint64 READAHEAD_BLOCKS = 32;
+/* Upper limit for a single coalesced write, and the piece size it is queued in */
+static constexpr quint64 MAX_WRITE_BLOCKS = 1024;
+static constexpr quint64 WRITE_CHUNK_BLOCKS = 256;
 
 DeviceWrapper::DeviceWrapper(rpi_imager::FileOperations *file_ops, QObject *parent)
-    : QObject(parent), _dirty(false), _file_ops(file_ops)
+    : QObject(parent), _dirty(false), _arenaNext(nullptr), _arenaFree(0), _deviceBlocks(0), _file_ops(file_ops)
 {
-
+    std::uint64_t size = 0;
+    if (_file_ops->GetSize(size) == rpi_imager::FileError::kSuccess)
+        _deviceBlocks = size / 4096;
 }
 
 DeviceWrapper::~DeviceWrapper()
 {
-    sync();
+    /* sync() now also flushes the FAT of child partitions, neither may throw out of a destructor */
+    try
+    {
+        sync();
+    }
+    catch (std::exception &e)
+    {
+        qDebug() << "Error writing changes to device:" << e.what();
+    }
+
+    for (auto chunk : std::as_const(_arena))
+        qFreeAligned(chunk);
 }
 
 void DeviceWrapper::_seekToBlock(quint64 blockNr)
@@ -28,71 +53,165 @@ void DeviceWrapper::_seekToBlock(quint64 blockNr)
     }
 }
 
+char *DeviceWrapper::_allocateBlocks(quint64 count)
+{
+    if (count > _arenaFree)
+    {
+        /* Windows requires buffers to be 4k aligned when reading/writing raw disk devices */
+        quint64 chunkBlocks = qMax(count, ARENA_CHUNK_BLOCKS);
+        char *chunk = (char *) qMallocAligned(chunkBlocks * 4096, 4096);
+        if (!chunk)
+            throw std::bad_alloc();
+
+        _arena.append(chunk);
+        _arenaNext = chunk;
+        _arenaFree = chunkBlocks;
+    }
+
+    char *blocks = _arenaNext;
+    _arenaNext += count * 4096;
+    _arenaFree -= count;
+    return blocks;
+}
+
 void DeviceWrapper::sync()
 {
+    /* FAT partitions batch their FAT updates, get those into the block cache first */
+    const auto fatPartitions = findChildren<DeviceWrapperFatPartition *>(Qt::FindDirectChildrenOnly);
+    for (auto fat : fatPartitions)
+        fat->flushFAT();
+
     if (!_dirty)
         return;
 
-    const auto blockNrs = _blockcache.keys();
-    for (auto blockNr : blockNrs)
+    /* Coalesce adjacent dirty blocks into large writes. Each run is copied into
+       its own aligned buffer, which must stay valid until the writes complete. */
+    std::vector<std::unique_ptr<char, void (*)(void *)>> buffers;
+    std::atomic<bool> writeFailed(false);
+    auto onWritten = [&writeFailed](rpi_imager::FileError result, std::size_t) {
+        if (result != rpi_imager::FileError::kSuccess)
+            writeFailed = true;
+    };
+
+    for (auto it = _blockcache.begin(); it != _blockcache.end() && !writeFailed; )
     {
-        if (blockNr == 0)
-            continue; /* Save writing first block with MBR for last */
+        if (it.key() == 0 || !it->dirty)
+        {
+            /* Save writing first block with MBR for last */
+            ++it;
+            continue;
+        }
 
-        auto block = _blockcache.value(blockNr);
+        quint64 firstBlock = it.key();
+        quint64 count = 0;
+        QList<QMap<quint64,CachedBlock>::iterator> run;
 
-        if (!block->dirty)
-            continue;
+        while (it != _blockcache.end() && it.key() == firstBlock + count && it->dirty && count < MAX_WRITE_BLOCKS)
+        {
+            run.append(it);
+            ++it;
+            count++;
+        }
 
-        _seekToBlock(blockNr);
-        auto result = _file_ops->WriteSequential(reinterpret_cast<const std::uint8_t*>(block->block), 4096);
-        if (result != rpi_imager::FileError::kSuccess) {
-            throw std::runtime_error("Error writing to device");
+        char *buf = (char *) qMallocAligned(count * 4096, 4096);
+        if (!buf)
+        {
+            /* Earlier buffers may still be in flight */
+            _file_ops->WaitForPendingWrites();
+            throw std::bad_alloc();
         }
-        block->dirty = false;
+        buffers.emplace_back(buf, qFreeAligned);
+
+        for (quint64 i = 0; i < count; i++)
+        {
+            memcpy(buf + i * 4096, run[i]->data, 4096);
+            run[i]->dirty = false;
+        }
+
+        /* Seek() waits for writes still in flight, the pieces of a run are
+           queued back to back and use io_uring where the backend has it */
+        _seekToBlock(firstBlock);
+        for (quint64 done = 0; done < count && !writeFailed; done += WRITE_CHUNK_BLOCKS)
+        {
+            quint64 pieceBlocks = qMin(WRITE_CHUNK_BLOCKS, count - done);
+            _file_ops->AsyncWriteSequential(reinterpret_cast<const std::uint8_t*>(buf + done * 4096), pieceBlocks * 4096, onWritten);
+        }
+    }
+
+    auto waitResult = _file_ops->WaitForPendingWrites();
+    buffers.clear();
+    if (writeFailed || waitResult != rpi_imager::FileError::kSuccess) {
+        throw std::runtime_error("Error writing to device");
     }
 
     if (_blockcache.contains(0))
     {
         /* Write first block with MBR */
-        auto block = _blockcache.value(0);
+        auto &block = _blockcache[0];
 
-        if (block->dirty)
+        if (block.dirty)
         {
             _seekToBlock(0);
-            auto result = _file_ops->WriteSequential(reinterpret_cast<const std::uint8_t*>(block->block), 4096);
+            auto result = _file_ops->WriteSequential(reinterpret_cast<const std::uint8_t*>(block.data), 4096);
             if (result != rpi_imager::FileError::kSuccess) {
                 throw std::runtime_error("Error writing MBR to device");
             }
-            block->dirty = false;
+            block.dirty = false;
         }
     }
 
     _dirty = false;
 }
 
+void DeviceWrapper::_readBlocks(quint64 firstBlock, quint64 count)
+{
+    char *data = _allocateBlocks(count);
+    std::size_t total = 0, bytes_read = 0;
+
+    _seekToBlock(firstBlock);
+    while (total < count * 4096)
+    {
+        auto result = _file_ops->ReadSequential(reinterpret_cast<std::uint8_t*>(data + total), count * 4096 - total, bytes_read);
+        if (result != rpi_imager::FileError::kSuccess || !bytes_read) {
+            throw std::runtime_error("Error reading from device");
+        }
+        total += bytes_read;
+    }
+
+    for (quint64 i = 0; i < count; i++)
+        _blockcache.insert(firstBlock + i, CachedBlock{data + i * 4096, false});
+}
+
 void DeviceWrapper::_readIntoBlockCacheIfNeeded(quint64 offset, quint64 size)
 {
     if (!size)
         return;
 
     quint64 firstBlock = offset/4096;
-    quint64 lastBlock = (offset+size)/4096;
+    quint64 lastBlock = (offset+size-1)/4096;
 
-    for (auto i = firstBlock; i <= lastBlock; i++)
+    /* Read ahead the aligned window around the request, but never past the end of the device */
+    if (_deviceBlocks)
     {
-        if (!_blockcache.contains(i))
-        {
-            _seekToBlock(i);
+        firstBlock -= firstBlock % READAHEAD_BLOCKS;
+        lastBlock = qMax(lastBlock, qMin(lastBlock - lastBlock % READAHEAD_BLOCKS + READAHEAD_BLOCKS, _deviceBlocks) - 1);
+    }
 
-            auto cacheEntry = new DeviceWrapperBlockCacheEntry(this);
-            std::size_t bytes_read = 0;
-            auto result = _file_ops->ReadSequential(reinterpret_cast<std::uint8_t*>(cacheEntry->block), 4096, bytes_read);
-            if (result != rpi_imager::FileError::kSuccess || bytes_read != 4096) {
-                throw std::runtime_error("Error reading from device");
-            }
-            _blockcache.insert(i, cacheEntry);
+    /* Each run of blocks not cached yet is read with a single request */
+    for (auto i = firstBlock; i <= lastBlock; )
+    {
+        if (_blockcache.contains(i))
+        {
+            i++;
+            continue;
         }
+
+        quint64 count = 1;
+        while (i + count <= lastBlock && !_blockcache.contains(i + count))
+            count++;
+
+        _readBlocks(i, count);
+        i += count;
     }
 }
 
@@ -107,9 +226,9 @@ void DeviceWrapper::pread(char *buf, quint64 size, quint64 offset)
 
     for (auto i = firstBlock; size; i++)
     {
-        auto block = _blockcache.value(i);
+        const auto &block = _blockcache[i];
         size_t bytesToCopyFromBlock = qMin(4096-offsetInBlock, size);
-        memcpy(buf, block->block + offsetInBlock, bytesToCopyFromBlock);
+        memcpy(buf, block.data + offsetInBlock, bytesToCopyFromBlock);
 
         buf  += bytesToCopyFromBlock;
         size -= bytesToCopyFromBlock;
@@ -134,16 +253,15 @@ void DeviceWrapper::pwrite(const char *buf, quint64 size, quint64 offset)
 
     for (auto i = firstBlock; size; i++)
     {
-        auto block = _blockcache.value(i, NULL);
-        if (!block)
+        auto it = _blockcache.find(i);
+        if (it == _blockcache.end())
         {
-            block = new DeviceWrapperBlockCacheEntry(this);
-            _blockcache.insert(i, block);
+            it = _blockcache.insert(i, CachedBlock{_allocateBlocks(1), false});
         }
 
-        block->dirty = true;
+        it->dirty = true;
         size_t bytesToCopyFromBlock = qMin(4096-offsetInBlock, size);
-        memcpy(block->block + offsetInBlock, buf, bytesToCopyFromBlock);
+        memcpy(it->data + offsetInBlock, buf, bytesToCopyFromBlock);
 
         buf  += bytesToCopyFromBlock;
         size -= bytesToCopyFromBlock;
@@ -11,7 +11,6 @@
 #include <memory>
 #include "file_operations.h"
 
-class DeviceWrapperBlockCacheEntry;
 class DeviceWrapperFatPartition;
 
 
@@ -27,10 +26,21 @@ public:
     DeviceWrapperFatPartition *fatPartition(int nr);
 
 protected:
+    struct CachedBlock {
+        char *data;     /* 4 KiB inside one of the arena chunks */
+        bool dirty;
+    };
+
     bool _dirty;
-    QMap<quint64,DeviceWrapperBlockCacheEntry *> _blockcache;
+    QMap<quint64,CachedBlock> _blockcache;
+    QList<char *> _arena;       /* 4K aligned chunks holding the cached blocks */
+    char *_arenaNext;
+    quint64 _arenaFree;         /* Unused blocks left in the last chunk */
+    quint64 _deviceBlocks;      /* Device size in blocks, 0 if unknown */
     rpi_imager::FileOperations *_file_ops;
 
+    char *_allocateBlocks(quint64 count);
+    void _readBlocks(quint64 firstBlock, quint64 count);
     void _readIntoBlockCacheIfNeeded(quint64 offset, quint64 size);
     void _seekToBlock(quint64 blockNr);
 
@@ -53,6 +53,7 @@ DeviceWrapperFatPartition::DeviceWrapperFatPartition(DeviceWrapper *dw, quint64
     _bytesPerCluster = bpb.fat16.BPB_SecPerClus * _bytesPerSector;
     _fat16_firstRootDirSector = bpb.fat16.BPB_RsvdSecCnt + (bpb.fat16.BPB_NumFATs * bpb.fat16.BPB_FATSz16);
     _fat32_firstRootDirCluster = bpb.fat32.BPB_RootClus;
+    _fat32_currentDirFirstCluster = _fat32_firstRootDirCluster;
 
     if (!_bytesPerSector)
         _type = EXFAT;
@@ -86,51 +87,160 @@ DeviceWrapperFatPartition::DeviceWrapperFatPartition(DeviceWrapper *dw, quint64
         _fat32_fsinfoSector = bpb.fat32.BPB_FSInfo;
         _clusterOffset = _firstFatStartOffset + (bpb.fat16.BPB_NumFATs * _fatSize * _bytesPerSector);
     }
+
+    _clusterCount = countOfClusters;
+    _fatDirtyFirst = UINT32_MAX;
+    _fatDirtyLast = 0;
+    _nextFreeCluster = 2;
+    _fsinfoFreeDelta = 0;
+    _fsinfoNextFree = 0;
+    _fsinfoDirty = false;
+    loadFAT();
 }
 
-uint32_t DeviceWrapperFatPartition::allocateCluster()
+void DeviceWrapperFatPartition::loadFAT()
 {
-    std::vector<char> sectorBuf(_bytesPerSector);
-    char *sector = sectorBuf.data();
     int bytesPerEntry = (_type == FAT16 ? 2 : 4);
-    int entriesPerSector = _bytesPerSector/bytesPerEntry;
-    uint32_t cluster;
-    uint16_t *f16 = (uint16_t *) sector;
-    uint32_t *f32 = (uint32_t *) sector;
+    /* Entries 0 and 1 are reserved, data clusters are numbered from 2 */
+    quint64 entries = qMin<quint64>(_clusterCount + 2, (quint64) _fatSize * _bytesPerSector / bytesPerEntry);
+    std::vector<char> buf(entries * bytesPerEntry);
 
     seek(_firstFatStartOffset);
+    read(buf.data(), buf.size());
+
+    _fat.resize(entries);
+    if (_type == FAT16)
+    {
+        const uint16_t *f16 = (const uint16_t *) buf.data();
+        for (quint64 i = 0; i < entries; i++)
+            _fat[i] = f16[i];
+    }
+    else
+    {
+        /* Keep the reserved high 4 bits, they have to be preserved when writing */
+        memcpy(_fat.data(), buf.data(), buf.size());
+    }
+}
 
-    for (int i = 0; i < _fatSize; i++)
+void DeviceWrapperFatPartition::flushFAT()
+{
+    if (_fatDirtyFirst <= _fatDirtyLast)
     {
-        read(sector, sizeof(sector));
+        /* Write the changed part of the FAT to all copies (usually 2) in one go each */
+        int bytesPerEntry = (_type == FAT16 ? 2 : 4);
+        uint32_t count = _fatDirtyLast - _fatDirtyFirst + 1;
+        QByteArray buf;
 
-        for (int j=0; j < entriesPerSector; j++)
+        if (_type == FAT16)
         {
-            if (_type == FAT16)
-            {
-                if (f16[j] == 0)
-                {
-                    /* Found available FAT16 cluster, mark it used/EOF */
-                    cluster = j+i*entriesPerSector;
-                    setFAT16(cluster, 0xFFFF);
-                    return cluster;
-                }
-            }
-            else
-            {
-                if ( (f32[j] & 0x0FFFFFFF) == 0)
-                {
-                    /* Found available FAT32 cluster, mark it used/EOF */
-                    cluster = j+i*entriesPerSector;
-                    setFAT32(cluster, 0xFFFFFFF);
-                    updateFSinfo(-1, cluster);
-                    return cluster;
-                }
-            }
+            buf.resize(count * 2);
+            uint16_t *f16 = (uint16_t *) buf.data();
+            for (uint32_t i = 0; i < count; i++)
+                f16[i] = _fat[_fatDirtyFirst + i];
+        }
+        else
+        {
+            buf = QByteArray((const char *) (_fat.constData() + _fatDirtyFirst), count * 4);
+        }
+
+        for (auto fatStart : std::as_const(_fatStartOffset))
+        {
+            seek(fatStart + (qint64) _fatDirtyFirst * bytesPerEntry);
+            write(buf.constData(), buf.size());
         }
+
+        _fatDirtyFirst = UINT32_MAX;
+        _fatDirtyLast = 0;
     }
 
-    throw std::runtime_error("Out of disk space on FAT partition");
+    if (_fsinfoDirty)
+    {
+        struct FSInfo fsinfo;
+
+        seek(_fat32_fsinfoSector * _bytesPerSector);
+        read((char *) &fsinfo, sizeof(fsinfo));
+
+        if (fsinfo.FSI_LeadSig[0] != 0x52 || fsinfo.FSI_LeadSig[1] != 0x52
+                || fsinfo.FSI_LeadSig[2] != 0x61 || fsinfo.FSI_LeadSig[3] != 0x41
+                || fsinfo.FSI_StrucSig[0] != 0x72 || fsinfo.FSI_StrucSig[1] != 0x72
+                || fsinfo.FSI_StrucSig[2] != 0x41 || fsinfo.FSI_StrucSig[3] != 0x61
+                || fsinfo.FSI_TrailSig[0] != 0x00 || fsinfo.FSI_TrailSig[1] != 0x00
+                || fsinfo.FSI_TrailSig[2] != 0x55 || fsinfo.FSI_TrailSig[3] != 0xAA)
+        {
+            throw std::runtime_error("FAT32 FSinfo structure corrupt. Signature does not match.");
+        }
+
+        if (_fsinfoFreeDelta != 0 && fsinfo.FSI_Free_Count != 0xFFFFFFFF)
+        {
+            fsinfo.FSI_Free_Count += _fsinfoFreeDelta;
+        }
+
+        if (_fsinfoNextFree)
+        {
+            fsinfo.FSI_Nxt_Free = _fsinfoNextFree;
+        }
+
+        seek(_fat32_fsinfoSector * _bytesPerSector);
+        write((char *) &fsinfo, sizeof(fsinfo));
+
+        _fsinfoFreeDelta = 0;
+        _fsinfoNextFree = 0;
+        _fsinfoDirty = false;
+    }
+}
+
+uint32_t DeviceWrapperFatPartition::findFreeCluster(uint32_t start, uint32_t runLength)
+{
+    uint32_t end = _fat.size();
+    uint32_t runStart = 0, run = 0;
+
+    if (end <= 2)
+        return 0;
+    if (start < 2 || start >= end)
+        start = 2;
+
+    /* First fit, searching from start to the end of the FAT and then wrapping around.
+       A run of free clusters does not continue across the wrap. */
+    for (uint32_t n = 0, cluster = start; n < end - 2; n++, cluster++)
+    {
+        if (cluster == end)
+        {
+            cluster = 2;
+            run = 0;
+        }
+
+        if (getFAT(cluster) == 0)
+        {
+            if (!run++)
+                runStart = cluster;
+            if (run == runLength)
+                return runStart;
+        }
+        else
+        {
+            run = 0;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t DeviceWrapperFatPartition::allocateCluster()
+{
+    uint32_t cluster = findFreeCluster(_nextFreeCluster);
+
+    if (!cluster)
+        throw std::runtime_error("Out of disk space on FAT partition");
+
+    /* Mark it used/EOF */
+    if (_type == FAT16)
+        setFAT16(cluster, 0xFFFF);
+    else
+        setFAT32(cluster, 0xFFFFFFF);
+    updateFSinfo(-1, cluster);
+    _nextFreeCluster = cluster + 1;
+
+    return cluster;
 }
 
 uint32_t DeviceWrapperFatPartition::allocateCluster(uint32_t previousCluster)
@@ -148,32 +258,72 @@ uint32_t DeviceWrapperFatPartition::allocateCluster(uint32_t previousCluster)
     return newCluster;
 }
 
-void DeviceWrapperFatPartition::setFAT16(uint16_t cluster, uint16_t value)
+QList<uint32_t> DeviceWrapperFatPartition::allocateClusters(int count, uint32_t previousCluster)
 {
-    /* Modify all FATs (usually 2) */
-    for (auto fatStart : std::as_const(_fatStartOffset))
+    QList<uint32_t> clusters;
+
+    if (count <= 0)
+        return clusters;
+
+    /* Prefer a single contiguous run, directly after the existing chain if possible,
+       so the file data can be written in one go. Fall back to whatever is free. */
+    uint32_t first = findFreeCluster(previousCluster ? previousCluster + 1 : _nextFreeCluster, count);
+
+    if (first)
+    {
+        for (int i = 0; i < count; i++)
+            clusters.append(first + i);
+    }
+    else
     {
-        seek(fatStart + cluster * 2);
-        write((char *) &value, 2);
+        for (uint32_t cluster = 2; cluster < (uint32_t) _fat.size() && clusters.size() < count; cluster++)
+        {
+            if (getFAT(cluster) == 0)
+                clusters.append(cluster);
+        }
+
+        if (clusters.size() < count)
+            throw std::runtime_error("Out of disk space on FAT partition");
     }
+
+    /* Link the chain */
+    uint32_t eof = (_type == FAT16 ? 0xFFFF : 0xFFFFFFF);
+    if (previousCluster)
+        setFAT(previousCluster, clusters.first());
+    for (int i = 0; i < count; i++)
+        setFAT(clusters[i], i + 1 < count ? clusters[i + 1] : eof);
+
+    updateFSinfo(-count, clusters.last());
+    _nextFreeCluster = clusters.last() + 1;
+
+    return clusters;
+}
+
+void DeviceWrapperFatPartition::setFAT16(uint16_t cluster, uint16_t value)
+{
+    if (cluster >= _fat.size())
+        throw std::runtime_error("Corrupt file system. Cluster number out of range");
+
+    _fat[cluster] = value;
+    _fatDirtyFirst = qMin<uint32_t>(_fatDirtyFirst, cluster);
+    _fatDirtyLast = qMax<uint32_t>(_fatDirtyLast, cluster);
+
+    if (!value && cluster < _nextFreeCluster)
+        _nextFreeCluster = cluster;
 }
 
 void DeviceWrapperFatPartition::setFAT32(uint32_t cluster, uint32_t value)
 {
-    uint32_t prev_value, reserved_bits;
+    if (cluster >= _fat.size())
+        throw std::runtime_error("Corrupt file system. Cluster number out of range");
 
-    /* Modify all FATs (usually 2) */
-    for (auto fatStart : std::as_const(_fatStartOffset))
-    {
-        /* Spec (p. 16) mentions we must preserve high 4 bits of FAT32 FAT entry when modifiying */
-        seek(fatStart + cluster * 4);
-        read( (char *) &prev_value, 4);
-        reserved_bits = prev_value & 0xF0000000;
-        value |= reserved_bits;
-
-        seek(fatStart + cluster * 4);
-        write((char *) &value, 4);
-    }
+    /* Spec (p. 16) mentions we must preserve high 4 bits of FAT32 FAT entry when modifiying */
+    _fat[cluster] = (value & 0x0FFFFFFF) | (_fat[cluster] & 0xF0000000);
+    _fatDirtyFirst = qMin(_fatDirtyFirst, cluster);
+    _fatDirtyLast = qMax(_fatDirtyLast, cluster);
+
+    if (!(value & 0x0FFFFFFF) && cluster < _nextFreeCluster)
+        _nextFreeCluster = cluster;
 }
 
 void DeviceWrapperFatPartition::setFAT(uint32_t cluster, uint32_t value)
@@ -186,20 +336,13 @@ void DeviceWrapperFatPartition::setFAT(uint32_t cluster, uint32_t value)
 
 uint32_t DeviceWrapperFatPartition::getFAT(uint32_t cluster)
 {
+    if (cluster >= _fat.size())
+        throw std::runtime_error("Corrupt file system. Cluster number out of range");
+
     if (_type == FAT16)
-    {
-        uint16_t result;
-        seek(_firstFatStartOffset + cluster * 2);
-        read((char *) &result, 2);
-        return result;
-    }
+        return _fat[cluster];
     else
-    {
-        uint32_t result;
-        seek(_firstFatStartOffset + cluster * 4);
-        read((char *) &result, 4);
-        return result & 0x0FFFFFFF;
-    }
+        return _fat[cluster] & 0x0FFFFFFF;
 }
 
 QList<uint32_t> DeviceWrapperFatPartition::getClusterChain(uint32_t firstCluster)
@@ -216,7 +359,8 @@ QList<uint32_t> DeviceWrapperFatPartition::getClusterChain(uint32_t firstCluster
             break;
         }
 
-        if (list.contains(cluster))
+        /* A chain longer than the number of clusters must loop back on itself */
+        if (list.size() > _clusterCount)
             throw std::runtime_error("Corrupt file system. Circular references in FAT table");
 
         list.append(cluster);
@@ -234,6 +378,28 @@ void DeviceWrapperFatPartition::seekCluster(uint32_t cluster)
 bool DeviceWrapperFatPartition::fileExists(const QString &filename)
 {
     struct dir_entry entry;
+
+    // Handle subdirectory paths (e.g., "overlays/file.dtbo")
+    if (filename.contains("/")) {
+        QStringList parts = filename.split("/", Qt::SkipEmptyParts);
+        if (parts.isEmpty())
+            return false;
+
+        QString fileNameOnly = parts.takeLast();
+        bool found = false;
+        try
+        {
+            changeDirectory(parts);
+            found = getDirEntry(fileNameOnly, &entry);
+        }
+        catch (std::runtime_error &e)
+        {
+            qDebug() << "DeviceWrapperFatPartition::fileExists:" << filename << ":" << e.what();
+        }
+        changeDirectory(QStringList());
+        return found;
+    }
+
     return getDirEntry(filename, &entry);
 }
 
@@ -248,63 +414,20 @@ bool DeviceWrapperFatPartition::deleteFile(const QString &filename)
             qDebug() << "DeviceWrapperFatPartition::deleteFile: invalid path" << filename;
             return false;
         }
-        
-        // Save current directory state
-        uint32_t savedRootDirCluster = _fat32_currentRootDirCluster;
-        QList<uint32_t> savedDirClusters = _currentDirClusters;
-        
-        // Navigate to the directory
-        QString dirName = parts[0];
-        struct dir_entry dirEntry;
-        
-        if (!getDirEntry(dirName, &dirEntry)) {
-            qDebug() << "DeviceWrapperFatPartition::deleteFile: directory not found:" << dirName;
-            return false;
-        }
-        
-        if (!(dirEntry.DIR_Attr & ATTR_DIRECTORY)) {
-            qDebug() << "DeviceWrapperFatPartition::deleteFile:" << dirName << "is not a directory";
-            return false;
+
+        QString fileNameOnly = parts.takeLast();
+        bool deleted = false;
+        try
+        {
+            changeDirectory(parts);
+            deleted = deleteFile(fileNameOnly);
         }
-        
-        // Switch to subdirectory
-        uint32_t dirCluster = (dirEntry.DIR_FstClusHI << 16) | dirEntry.DIR_FstClusLO;
-        qDebug() << "DeviceWrapperFatPartition::deleteFile: switching to directory cluster" << dirCluster;
-        _fat32_currentRootDirCluster = dirCluster;
-        _currentDirClusters.clear();
-        _currentDirClusters.append(dirCluster);
-        
-        // Get the file entry in subdirectory
-        QString fileNameOnly = parts[parts.size() - 1];
-        qDebug() << "DeviceWrapperFatPartition::deleteFile: searching for file" << fileNameOnly << "in subdirectory";
-        bool found = getDirEntry(fileNameOnly, &entry);
-        qDebug() << "DeviceWrapperFatPartition::deleteFile: getDirEntry returned" << found;
-        
-        // Restore directory state
-        _fat32_currentRootDirCluster = savedRootDirCluster;
-        _currentDirClusters = savedDirClusters;
-        
-        if (!found) {
-            qDebug() << "DeviceWrapperFatPartition::deleteFile: file not found in directory:" << filename;
-            return false;
+        catch (std::runtime_error &e)
+        {
+            qDebug() << "DeviceWrapperFatPartition::deleteFile:" << filename << ":" << e.what();
         }
-        
-        // Mark as deleted and update
-        entry.DIR_Name[0] = 0xE5;
-        
-        // Switch back to subdirectory to update
-        _fat32_currentRootDirCluster = dirCluster;
-        _currentDirClusters.clear();
-        _currentDirClusters.append(dirCluster);
-        
-        updateDirEntry(&entry);
-        
-        // Restore directory state again
-        _fat32_currentRootDirCluster = savedRootDirCluster;
-        _currentDirClusters = savedDirClusters;
-        
-        qDebug() << "DeviceWrapperFatPartition::deleteFile: deleted" << filename;
-        return true;
+        changeDirectory(QStringList());
+        return deleted;
     }
     
     // Simple case: file or directory in root directory
@@ -815,10 +938,29 @@ QStringList DeviceWrapperFatPartition::listAllFilesRecursive()
     return fileList;
 }
 
+void DeviceWrapperFatPartition::writeClusters(const QList<uint32_t> &clusters, const QByteArray &contents)
+{
+    qsizetype pos = 0;
+
+    /* Write each run of consecutive clusters with a single write */
+    for (qsizetype i = 0; i < clusters.size() && pos < contents.length(); )
+    {
+        qsizetype run = 1;
+        while (i + run < clusters.size() && clusters[i + run] == clusters[i] + run)
+            run++;
+
+        qsizetype len = qMin((qsizetype) _bytesPerCluster * run, contents.length() - pos);
+        seekCluster(clusters[i]);
+        write(contents.data() + pos, len);
+
+        pos += len;
+        i += run;
+    }
+}
+
 void DeviceWrapperFatPartition::writeFile(const QString &filename, const QByteArray &contents)
 {
     QList<uint32_t> clusterList;
-    uint32_t pos = 0;
     uint32_t firstCluster;
     int clustersNeeded = (contents.length() + _bytesPerCluster - 1) / _bytesPerCluster;
     struct dir_entry entry;
@@ -830,128 +972,20 @@ void DeviceWrapperFatPartition::writeFile(const QString &filename, const QByteAr
             qDebug() << "DeviceWrapperFatPartition::writeFile: invalid path" << filename;
             throw std::runtime_error("Invalid file path");
         }
-        
-        // Navigate to the subdirectory
-        QString dirName = parts[0];
-        struct dir_entry dirEntry;
-        
-        if (!getDirEntry(dirName, &dirEntry)) {
-            qDebug() << "DeviceWrapperFatPartition::writeFile: directory not found:" << dirName;
-            throw std::runtime_error("Directory not found");
-        }
-        
-        if (!(dirEntry.DIR_Attr & ATTR_DIRECTORY)) {
-            qDebug() << "DeviceWrapperFatPartition::writeFile:" << dirName << "is not a directory";
-            throw std::runtime_error("Path component is not a directory");
-        }
-        
-        // Save current directory context
-        uint32_t savedRootDirCluster = _fat32_currentRootDirCluster;
-        QList<uint32_t> savedDirClusters = _currentDirClusters;
-        
-        // Switch to subdirectory
-        uint32_t dirCluster = (dirEntry.DIR_FstClusHI << 16) | dirEntry.DIR_FstClusLO;
-        _fat32_currentRootDirCluster = dirCluster;
-        _currentDirClusters.clear();
-        _currentDirClusters.append(dirCluster);
-        
-        // Get the file entry in subdirectory (create if doesn't exist)
-        QString fileNameOnly = parts[parts.size() - 1];
-        getDirEntry(fileNameOnly, &entry, true);
-        firstCluster = entry.DIR_FstClusLO;
-        if (_type == FAT32)
-            firstCluster |= (entry.DIR_FstClusHI << 16);
-
-        if (firstCluster)
-            clusterList = getClusterChain(firstCluster);
-
-        if (clusterList.length() < clustersNeeded)
-        {
-            /* We need to allocate more clusters */
-            uint32_t lastCluster = 0;
-            int extraClustersNeeded = clustersNeeded - clusterList.length();
-
-            if (!clusterList.isEmpty())
-                lastCluster = clusterList.last();
-
-            for (int i = 0; i < extraClustersNeeded; i++)
-            {
-                lastCluster = allocateCluster(lastCluster);
-                clusterList.append(lastCluster);
-            }
-        }
-        else if (clusterList.length() > clustersNeeded)
-        {
-            /* We need to remove excess clusters */
-            int clustersToRemove = clusterList.length() - clustersNeeded;
-            uint32_t clusterToRemove = 0;
-            QByteArray zeroes(_bytesPerCluster, 0);
-
-            for (int i=0; i < clustersToRemove; i++)
-            {
-                clusterToRemove = clusterList.takeLast();
-
-                /* Zero out previous data in excess clusters,
-                   just in case someone wants to take a disk image later */
-                seekCluster(clusterToRemove);
-                write(zeroes.data(), zeroes.length());
-
-                /* Mark cluster available again in FAT */
-                setFAT(clusterToRemove, 0);
-            }
-            updateFSinfo(clustersToRemove, clusterToRemove);
-
-            if (!clusterList.isEmpty())
-            {
-                if (_type == FAT16)
-                    setFAT16(clusterList.last(), 0xFFFF);
-                else
-                    setFAT32(clusterList.last(), 0xFFFFFFF);
-            }
-        }
-
-        //qDebug() << "First cluster:" << firstCluster << "Clusters:" << clusterList;
 
-        /* Write file data */
-        for (uint32_t cluster : std::as_const(clusterList))
+        QString fileNameOnly = parts.takeLast();
+        changeDirectory(parts);
+        try
         {
-            seekCluster(cluster);
-            write(contents.data()+pos, qMin((qsizetype)_bytesPerCluster, (qsizetype)(contents.length()-pos)));
-
-            pos += _bytesPerCluster;
-            if (pos >= contents.length())
-                break;
+            writeFile(fileNameOnly, contents);
         }
-
-        if (clustersNeeded && contents.length() % _bytesPerCluster)
+        catch (...)
         {
-            /* Zero out last cluster tip */
-            uint32_t extraBytesAtEndOfCluster = _bytesPerCluster - (contents.length() % _bytesPerCluster);
-            if (extraBytesAtEndOfCluster)
-            {
-                QByteArray zeroes(extraBytesAtEndOfCluster, 0);
-                write(zeroes.data(), zeroes.length());
-            }
+            changeDirectory(QStringList());
+            throw;
         }
+        changeDirectory(QStringList());
 
-        /* Update directory entry */
-        if (clusterList.isEmpty())
-            firstCluster = (_type == FAT16 ? 0xFFFF : 0xFFFFFFF);
-        else
-            firstCluster = clusterList.first();
-
-        entry.DIR_FstClusLO = (firstCluster & 0xFFFF);
-        entry.DIR_FstClusHI = (firstCluster >> 16);
-        entry.DIR_WrtDate = QDateToFATdate( QDate::currentDate() );
-        entry.DIR_WrtTime = QTimeToFATtime( QTime::currentTime() );
-        entry.DIR_LstAccDate = entry.DIR_WrtDate;
-        entry.DIR_FileSize = contents.length();
-        updateDirEntry(&entry);
-        
-        // Restore directory context
-        _fat32_currentRootDirCluster = savedRootDirCluster;
-        _currentDirClusters = savedDirClusters;
-        
         qDebug() << "DeviceWrapperFatPartition::writeFile: wrote" << filename;
         return;
     }
@@ -979,11 +1013,7 @@ void DeviceWrapperFatPartition::writeFile(const QString &filename, const QByteAr
         if (!clusterList.isEmpty())
             lastCluster = clusterList.last();
 
-        for (int i = 0; i < extraClustersNeeded; i++)
-        {
-            lastCluster = allocateCluster(lastCluster);
-            clusterList.append(lastCluster);
-        }
+        clusterList.append(allocateClusters(extraClustersNeeded, lastCluster));
     }
     else if (clusterList.length() > clustersNeeded)
     {
@@ -1018,15 +1048,7 @@ void DeviceWrapperFatPartition::writeFile(const QString &filename, const QByteAr
     //qDebug() << "First cluster:" << firstCluster << "Clusters:" << clusterList;
 
     /* Write file data */
-    for (uint32_t cluster : std::as_const(clusterList))
-    {
-        seekCluster(cluster);
-        write(contents.data()+pos, qMin((qsizetype)_bytesPerCluster, (qsizetype)(contents.length()-pos)));
-
-        pos += _bytesPerCluster;
-        if (pos >= contents.length())
-            break;
-    }
+    writeClusters(clusterList, contents);
 
     if (clustersNeeded && contents.length() % _bytesPerCluster)
     {
@@ -1328,16 +1350,101 @@ void DeviceWrapperFatPartition::writeDirEntryAtCurrentPos(struct dir_entry *dirE
     }
 }
 
+void DeviceWrapperFatPartition::createDirectory(const QString &path)
+{
+    try
+    {
+        changeDirectory(path.split("/", Qt::SkipEmptyParts), true);
+    }
+    catch (...)
+    {
+        changeDirectory(QStringList());
+        throw;
+    }
+    changeDirectory(QStringList());
+}
+
+void DeviceWrapperFatPartition::changeDirectory(const QStringList &path, bool createIfNotExist)
+{
+    _fat32_currentDirFirstCluster = _fat32_firstRootDirCluster;
+    if (path.isEmpty())
+        return;
+
+    /* FAT16 subdirectories are cluster chains, which openDir()/readDir() only handle for FAT32 */
+    if (_type != FAT32)
+        throw std::runtime_error("FAT16: subdirectories are only supported for reading");
+
+    for (const QString &name : path)
+    {
+        struct dir_entry entry;
+        uint32_t parentCluster = _fat32_currentDirFirstCluster;
+
+        if (!getDirEntry(name, &entry, createIfNotExist))
+        {
+            if (!createIfNotExist)
+            {
+                qDebug() << "DeviceWrapperFatPartition::changeDirectory: directory not found:" << name;
+                throw std::runtime_error("Directory not found");
+            }
+
+            /* getDirEntry() appended a file entry, turn it into an empty directory
+               holding only the "." and ".." entries */
+            uint32_t cluster = allocateCluster();
+            uint16_t date = QDateToFATdate( QDate::currentDate() );
+            uint16_t time = QTimeToFATtime( QTime::currentTime() );
+            struct dir_entry dots[2];
+
+            memset(dots, 0, sizeof(dots));
+            for (int i = 0; i < 2; i++)
+            {
+                memset(dots[i].DIR_Name, ' ', sizeof(dots[i].DIR_Name));
+                memset(dots[i].DIR_Name, '.', i + 1);
+                dots[i].DIR_Attr = ATTR_DIRECTORY;
+                dots[i].DIR_CrtDate = dots[i].DIR_WrtDate = dots[i].DIR_LstAccDate = date;
+                dots[i].DIR_CrtTime = dots[i].DIR_WrtTime = time;
+            }
+            dots[0].DIR_FstClusLO = (cluster & 0xFFFF);
+            dots[0].DIR_FstClusHI = (cluster >> 16);
+            /* ".." of a directory in the root refers to cluster 0 */
+            if (parentCluster != _fat32_firstRootDirCluster)
+            {
+                dots[1].DIR_FstClusLO = (parentCluster & 0xFFFF);
+                dots[1].DIR_FstClusHI = (parentCluster >> 16);
+            }
+
+            QByteArray clusterData(_bytesPerCluster, 0);
+            memcpy(clusterData.data(), dots, sizeof(dots));
+            seekCluster(cluster);
+            write(clusterData.constData(), clusterData.size());
+
+            entry.DIR_Attr = ATTR_DIRECTORY;
+            entry.DIR_FstClusLO = (cluster & 0xFFFF);
+            entry.DIR_FstClusHI = (cluster >> 16);
+            entry.DIR_WrtDate = entry.DIR_CrtDate;
+            entry.DIR_WrtTime = entry.DIR_CrtTime;
+            entry.DIR_LstAccDate = entry.DIR_CrtDate;
+            updateDirEntry(&entry);
+        }
+        else if (!(entry.DIR_Attr & ATTR_DIRECTORY))
+        {
+            qDebug() << "DeviceWrapperFatPartition::changeDirectory:" << name << "is not a directory";
+            throw std::runtime_error("Path component is not a directory");
+        }
+
+        _fat32_currentDirFirstCluster = (entry.DIR_FstClusHI << 16) | entry.DIR_FstClusLO;
+    }
+}
+
 void DeviceWrapperFatPartition::openDir()
 {
-    /* Seek to start of root directory */
+    /* Seek to start of the current directory (root directory unless changeDirectory() was used) */
     if (_type == FAT16)
     {
         seek(_fat16_firstRootDirSector * _bytesPerSector);
     }
     else
     {
-        _fat32_currentRootDirCluster = _fat32_firstRootDirCluster;
+        _fat32_currentRootDirCluster = _fat32_currentDirFirstCluster;
         seekCluster(_fat32_currentRootDirCluster);
         /* Keep track of directory clusters we seeked to, to be able
            to detect circular references */
@@ -1391,36 +1498,14 @@ bool DeviceWrapperFatPartition::readDir(struct dir_entry *result)
 
 void DeviceWrapperFatPartition::updateFSinfo(int deltaClusters, uint32_t nextFreeClusterHint)
 {
-    struct FSInfo fsinfo;
-
     if (!_fat32_fsinfoSector)
         return;
 
-    seek(_fat32_fsinfoSector * _bytesPerSector);
-    read((char *) &fsinfo, sizeof(fsinfo));
-
-    if (fsinfo.FSI_LeadSig[0] != 0x52 || fsinfo.FSI_LeadSig[1] != 0x52
-            || fsinfo.FSI_LeadSig[2] != 0x61 || fsinfo.FSI_LeadSig[3] != 0x41
-            || fsinfo.FSI_StrucSig[0] != 0x72 || fsinfo.FSI_StrucSig[1] != 0x72
-            || fsinfo.FSI_StrucSig[2] != 0x41 || fsinfo.FSI_StrucSig[3] != 0x61
-            || fsinfo.FSI_TrailSig[0] != 0x00 || fsinfo.FSI_TrailSig[1] != 0x00
-            || fsinfo.FSI_TrailSig[2] != 0x55 || fsinfo.FSI_TrailSig[3] != 0xAA)
-    {
-        throw std::runtime_error("FAT32 FSinfo structure corrupt. Signature does not match.");
-    }
-
-    if (deltaClusters != 0 && fsinfo.FSI_Free_Count != 0xFFFFFFFF)
-    {
-        fsinfo.FSI_Free_Count += deltaClusters;
-    }
-
+    /* Written out by flushFAT() */
+    _fsinfoFreeDelta += deltaClusters;
     if (nextFreeClusterHint)
-    {
-        fsinfo.FSI_Nxt_Free = nextFreeClusterHint;
-    }
-
-    seek(_fat32_fsinfoSector * _bytesPerSector);
-    write((char *) &fsinfo, sizeof(fsinfo));
+        _fsinfoNextFree = nextFreeClusterHint;
+    _fsinfoDirty = true;
 }
 
 uint16_t DeviceWrapperFatPartition::QTimeToFATtime(const QTime &time)
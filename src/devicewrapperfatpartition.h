@@ -22,20 +22,38 @@ public:
 
     QByteArray readFile(const QString &filename);
     void writeFile(const QString &filename, const QByteArray &contents);
+    void createDirectory(const QString &path); // Creates missing parent directories as well
     bool fileExists(const QString &filename);
     bool deleteFile(const QString &filename);
     QStringList listAllFiles(); // List all files recursively
     QStringList listAllFilesRecursive(); // List all files including subdirectories
 
+    /* FAT changes are kept in memory and only written to all FAT copies here.
+       Called by DeviceWrapper::sync(), also when the DeviceWrapper is destroyed;
+       the partition itself does not flush, its DeviceWrapper is gone by then */
+    void flushFAT();
+
 protected:
     enum fatType _type;
     uint32_t _firstFatStartOffset, _fatSize, _bytesPerCluster, _clusterOffset;
     uint32_t _fat16_rootDirSectors, _fat16_firstRootDirSector;
     uint32_t _fat32_firstRootDirCluster, _fat32_currentRootDirCluster;
+    uint32_t _fat32_currentDirFirstCluster;     /* Directory openDir() starts at, the root unless changed */
     uint16_t _bytesPerSector, _fat32_fsinfoSector;
     QList<uint32_t> _fatStartOffset;
     QList<uint32_t> _currentDirClusters;
 
+    /* In-memory copy of the first FAT, loaded when the partition is opened.
+       Also serves as free cluster map: an entry of 0 is a free cluster. */
+    uint32_t _clusterCount;
+    QList<uint32_t> _fat;
+    uint32_t _fatDirtyFirst, _fatDirtyLast;     /* Range of entries changed since the last flushFAT() */
+    uint32_t _nextFreeCluster;                  /* Where the next free cluster search starts */
+    int _fsinfoFreeDelta;                       /* FSInfo changes pending for flushFAT() */
+    uint32_t _fsinfoNextFree;
+    bool _fsinfoDirty;
+
+    void loadFAT();
     QList<uint32_t> getClusterChain(uint32_t firstCluster);
     void setFAT16(uint16_t cluster, uint16_t value);
     void setFAT32(uint32_t cluster, uint32_t value);
@@ -44,11 +62,15 @@ protected:
     void seekCluster(uint32_t cluster);
     uint32_t allocateCluster();
     uint32_t allocateCluster(uint32_t previousCluster);
+    QList<uint32_t> allocateClusters(int count, uint32_t previousCluster);
+    uint32_t findFreeCluster(uint32_t start, uint32_t runLength = 1);
+    void writeClusters(const QList<uint32_t> &clusters, const QByteArray &contents);
     bool getDirEntry(const QString &longFilename, struct dir_entry *entry, bool createIfNotExist = false);
     bool dirNameExists(const QByteArray dirname);
     void updateDirEntry(struct dir_entry *dirEntry);
     void writeDirEntryAtCurrentPos(struct dir_entry *dirEntry);
     void openDir();
+    void changeDirectory(const QStringList &path, bool createIfNotExist = false);
     bool readDir(struct dir_entry *result);
     void listFilesInDirectory(const QString &dirPath, uint32_t dirCluster, QStringList &fileList); // Helper for recursive listing
     void updateFSinfo(int deltaClusters, uint32_t nextFreeClusterHint);
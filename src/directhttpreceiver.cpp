@@ -0,0 +1,421 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "directhttpreceiver.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+namespace {
+
+// Limits while connecting and reading the response headers
+constexpr int HEAD_TIMEOUT_MS = 30000;
+constexpr size_t MAX_HEAD_SIZE = 64 * 1024;
+constexpr int POLL_INTERVAL_MS = 100;
+
+bool headerIs(const std::string &line, const char *name)
+{
+    size_t len = strlen(name);
+    if (line.size() <= len || line[len] != ':')
+        return false;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (tolower(static_cast<unsigned char>(line[i])) != tolower(static_cast<unsigned char>(name[i])))
+            return false;
+    }
+    return true;
+}
+
+std::string headerValue(const std::string &line)
+{
+    size_t start = line.find(':') + 1;
+    while (start < line.size() && line[start] == ' ')
+        start++;
+    size_t end = line.find_last_not_of(" \r\n");
+    return (end == std::string::npos || end < start) ? std::string() : line.substr(start, end - start + 1);
+}
+
+bool equalsIgnoreCase(const std::string &a, const char *b)
+{
+    return a.size() == strlen(b) && std::equal(a.begin(), a.end(), b, [](char x, char y) {
+        return tolower(static_cast<unsigned char>(x)) == tolower(static_cast<unsigned char>(y));
+    });
+}
+
+std::string urlPart(CURLU *url, CURLUPart part)
+{
+    char *value = nullptr;
+    if (curl_url_get(url, part, &value, 0) != CURLUE_OK || !value)
+        return std::string();
+    std::string result(value);
+    curl_free(value);
+    return result;
+}
+
+} // namespace
+
+DirectHttpReceiver::DirectHttpReceiver(CURL *templateHandle, const std::string &url, quint64 startOffset,
+                                       const std::vector<std::string> &extraHeaders)
+    : _handle(curl_easy_duphandle(templateHandle)), _socket(CURL_SOCKET_BAD), _url(url),
+      _startOffset(startOffset), _extraHeaders(extraHeaders), _contentLength(0), _received(0)
+{
+}
+
+DirectHttpReceiver::~DirectHttpReceiver()
+{
+    if (_handle)
+        curl_easy_cleanup(_handle);
+}
+
+bool DirectHttpReceiver::isCandidate(const std::string &url, const std::string &proxy)
+{
+    if (url.compare(0, 7, "http://") != 0 || !proxy.empty())
+        return false;
+
+    // libcurl honours these too, and a proxied connection is not one we can speak to directly
+    for (const char *var : {"http_proxy", "HTTP_PROXY", "all_proxy", "ALL_PROXY"})
+    {
+        const char *value = getenv(var);
+        if (value && *value)
+            return false;
+    }
+    return true;
+}
+
+bool DirectHttpReceiver::isLocalAddress(const std::string &ip)
+{
+    unsigned a, b, c, d;
+    char tail;
+    std::string v4 = ip;
+
+    // IPv4-mapped IPv6 addresses are judged by their IPv4 part
+    if (v4.compare(0, 7, "::ffff:") == 0)
+        v4 = v4.substr(7);
+
+    if (sscanf(v4.c_str(), "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) == 4)
+    {
+        if (a > 255 || b > 255 || c > 255 || d > 255)
+            return false;
+        return a == 127 || a == 10
+               || (a == 172 && b >= 16 && b <= 31)
+               || (a == 192 && b == 168)
+               || (a == 169 && b == 254);
+    }
+
+    std::string v6;
+    for (char ch : ip)
+        v6 += static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+
+    if (v6 == "::1")
+        return true;
+    // Unique local fc00::/7 and link-local fe80::/10
+    return v6.size() > 4 && v6.find(':') != std::string::npos
+           && (v6.compare(0, 2, "fc") == 0 || v6.compare(0, 2, "fd") == 0
+               || v6.compare(0, 3, "fe8") == 0 || v6.compare(0, 3, "fe9") == 0
+               || v6.compare(0, 3, "fea") == 0 || v6.compare(0, 3, "feb") == 0);
+}
+
+int DirectHttpReceiver::_waitSocket(bool forRead, int timeoutMs) const
+{
+    pollfd pfd;
+    pfd.fd = _socket;
+    pfd.events = forRead ? POLLIN : POLLOUT;
+    pfd.revents = 0;
+#ifdef _WIN32
+    return WSAPoll(&pfd, 1, timeoutMs);
+#else
+    return ::poll(&pfd, 1, timeoutMs);
+#endif
+}
+
+bool DirectHttpReceiver::open(const HeaderCallback &onHeader)
+{
+    if (!_handle)
+        return false;
+
+    // Let curl resolve and connect (honouring IPv4-only, timeouts and keepalive
+    // from the template), but do the HTTP exchange ourselves
+    curl_easy_setopt(_handle, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(_handle, CURLOPT_NOPROGRESS, 1L);
+
+    CURLcode ret = curl_easy_perform(_handle);
+    if (ret != CURLE_OK)
+    {
+        qDebug() << "DirectHttpReceiver: connect failed:" << curl_easy_strerror(ret);
+        return false;
+    }
+
+    char *ip = nullptr;
+    if (curl_easy_getinfo(_handle, CURLINFO_PRIMARY_IP, &ip) != CURLE_OK || !ip || !isLocalAddress(ip))
+    {
+        qDebug() << "DirectHttpReceiver: server" << (ip ? ip : "") << "is not on the local network";
+        return false;
+    }
+
+    if (curl_easy_getinfo(_handle, CURLINFO_ACTIVESOCKET, &_socket) != CURLE_OK || _socket == CURL_SOCKET_BAD)
+        return false;
+
+    std::string head;
+    if (!_sendRequest() || !_readHead(head) || !_parseHead(head, onHeader))
+        return false;
+
+    qDebug() << "DirectHttpReceiver: receiving" << _contentLength << "bytes from" << ip
+             << "directly into the pipeline buffers";
+    return true;
+}
+
+bool DirectHttpReceiver::_sendRequest()
+{
+    CURLU *url = curl_url();
+    if (!url || curl_url_set(url, CURLUPART_URL, _url.c_str(), 0) != CURLUE_OK)
+    {
+        curl_url_cleanup(url);
+        return false;
+    }
+
+    std::string host = urlPart(url, CURLUPART_HOST);
+    std::string port = urlPart(url, CURLUPART_PORT);
+    std::string target = urlPart(url, CURLUPART_PATH);
+    std::string query = urlPart(url, CURLUPART_QUERY);
+    curl_url_cleanup(url);
+
+    if (host.empty())
+        return false;
+    if (target.empty())
+        target = "/";
+    if (!query.empty())
+        target += "?" + query;
+
+    std::string request = "GET " + target + " HTTP/1.1\r\n"
+                          "Host: " + host + (port.empty() ? "" : ":" + port) + "\r\n"
+                          "Accept: */*\r\n"
+                          "Connection: close\r\n";
+    if (_startOffset > 0)
+        request += "Range: bytes=" + std::to_string(_startOffset) + "-\r\n";
+    for (const std::string &header : _extraHeaders)
+        request += header + "\r\n";
+    request += "\r\n";
+
+    size_t sent = 0;
+    while (sent < request.size())
+    {
+        size_t n = 0;
+        CURLcode ret = curl_easy_send(_handle, request.data() + sent, request.size() - sent, &n);
+        if (ret == CURLE_AGAIN)
+        {
+            if (_waitSocket(false, HEAD_TIMEOUT_MS) <= 0)
+                return false;
+            continue;
+        }
+        if (ret != CURLE_OK)
+            return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool DirectHttpReceiver::_readHead(std::string &head)
+{
+    char chunk[4096];
+    QElapsedTimer timer;
+    timer.start();
+
+    while (head.size() < MAX_HEAD_SIZE && timer.elapsed() < HEAD_TIMEOUT_MS)
+    {
+        size_t n = 0;
+        CURLcode ret = curl_easy_recv(_handle, chunk, sizeof(chunk), &n);
+        if (ret == CURLE_AGAIN)
+        {
+            _waitSocket(true, POLL_INTERVAL_MS);
+            continue;
+        }
+        if (ret != CURLE_OK || n == 0)
+            return false;
+
+        // Only search the new bytes, plus the three before them that may start the terminator
+        size_t searchFrom = head.size() >= 3 ? head.size() - 3 : 0;
+        head.append(chunk, n);
+        size_t end = head.find("\r\n\r\n", searchFrom);
+        if (end != std::string::npos)
+        {
+            _bodyStart = head.substr(end + 4);
+            head.resize(end + 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectHttpReceiver::parseHead(const std::string &head, quint64 startOffset, ResponseHead &result)
+{
+    std::vector<std::string> &lines = result.lines;
+    lines.clear();
+    for (size_t pos = 0; pos < head.size();)
+    {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos || end == pos)
+            break;
+        lines.push_back(head.substr(pos, end + 2 - pos));
+        pos = end + 2;
+    }
+
+    int status = 0;
+    if (lines.empty() || sscanf(lines.front().c_str(), "HTTP/1.%*d %d", &status) != 1)
+        return false;
+
+    const int expectedStatus = startOffset > 0 ? 206 : 200;
+    if (status != expectedStatus)
+    {
+        qDebug() << "DirectHttpReceiver: got HTTP status" << status << "- leaving the transfer to curl";
+        return false;
+    }
+
+    bool haveLength = false, haveRange = false;
+    for (size_t i = 1; i < lines.size(); i++)
+    {
+        const std::string &line = lines[i];
+        if (headerIs(line, "Content-Length"))
+        {
+            char *end = nullptr;
+            std::string value = headerValue(line);
+            result.contentLength = strtoull(value.c_str(), &end, 10);
+            haveLength = !value.empty() && end && *end == '\0';
+        }
+        else if ((headerIs(line, "Transfer-Encoding") || headerIs(line, "Content-Encoding"))
+                 && !equalsIgnoreCase(headerValue(line), "identity"))
+        {
+            qDebug() << "DirectHttpReceiver: encoded response - leaving the transfer to curl";
+            return false;
+        }
+        else if (headerIs(line, "Content-Range"))
+        {
+            std::string expected = "bytes " + std::to_string(startOffset) + "-";
+            if (headerValue(line).compare(0, expected.size(), expected) != 0)
+                return false;
+            haveRange = true;
+        }
+    }
+
+    // A partial response has to say which part it is
+    return haveLength && (startOffset == 0 || haveRange);
+}
+
+bool DirectHttpReceiver::_parseHead(const std::string &head, const HeaderCallback &onHeader)
+{
+    ResponseHead response;
+    if (!parseHead(head, _startOffset, response) || _bodyStart.size() > response.contentLength)
+        return false;
+
+    _contentLength = response.contentLength;
+    if (onHeader)
+    {
+        for (const std::string &line : response.lines)
+            onHeader(line);
+    }
+    return true;
+}
+
+CURLcode DirectHttpReceiver::run(const AcquireBuffer &acquire, const CommitBuffer &commit, const CancelCheck &isCancelled)
+{
+    char *buffer = nullptr;
+    size_t capacity = 0;
+    size_t filled = 0;
+    QElapsedTimer holdTimer;    // Since the first byte went into the current buffer
+    QElapsedTimer stallTimer;   // Since data last arrived
+    stallTimer.start();
+
+    auto pass = [&]() -> bool {
+        char *full = buffer;
+        size_t len = filled;
+        buffer = nullptr;
+        filled = 0;
+        return commit(full, len);
+    };
+
+    // Hands back or passes on the current buffer when the transfer ends early
+    auto finish = [&](CURLcode ret) -> CURLcode {
+        if (buffer && !pass() && ret == CURLE_OK)
+            ret = CURLE_WRITE_ERROR;
+        return ret;
+    };
+
+    while (_received < _contentLength)
+    {
+        if (isCancelled())
+            return finish(CURLE_ABORTED_BY_CALLBACK);
+
+        // Only take a buffer once there is something to put in it, so a
+        // buffer is never held while the connection is idle
+        if (!buffer)
+        {
+            if (_bodyStart.empty() && _waitSocket(true, POLL_INTERVAL_MS) <= 0)
+            {
+                if (stallTimer.elapsed() > STALL_TIMEOUT_SECS * 1000)
+                    return CURLE_OPERATION_TIMEDOUT;
+                continue;
+            }
+
+            buffer = acquire(capacity);
+            if (!buffer || capacity == 0)
+                return isCancelled() ? CURLE_ABORTED_BY_CALLBACK : CURLE_WRITE_ERROR;
+            holdTimer.start();
+
+            if (!_bodyStart.empty())
+            {
+                filled = std::min(capacity, _bodyStart.size());
+                memcpy(buffer, _bodyStart.data(), filled);
+                _bodyStart.erase(0, filled);
+                _received += filled;
+            }
+        }
+
+        size_t want = static_cast<size_t>(std::min<quint64>(capacity - filled, _contentLength - _received));
+        size_t n = 0;
+        CURLcode ret = want ? curl_easy_recv(_handle, buffer + filled, want, &n) : CURLE_OK;
+
+        if (ret == CURLE_OK && want && n == 0)
+            return finish(CURLE_PARTIAL_FILE);   // Server closed the connection early
+        if (ret != CURLE_OK && ret != CURLE_AGAIN)
+            return finish(ret);
+
+        if (ret == CURLE_OK)
+        {
+            filled += n;
+            _received += n;
+            stallTimer.start();
+
+            if (filled == capacity || _received == _contentLength)
+            {
+                if (!pass())
+                    return CURLE_WRITE_ERROR;
+            }
+            continue;
+        }
+
+        // Socket drained for now: keep filling a mostly empty buffer for a moment,
+        // but don't hold data back from the consumer for long
+        if (filled >= capacity / MIN_COMMIT_FRACTION || (filled > 0 && holdTimer.elapsed() >= MAX_HOLD_MS))
+        {
+            if (!pass())
+                return CURLE_WRITE_ERROR;
+            continue;
+        }
+
+        _waitSocket(true, filled > 0 ? MAX_HOLD_MS : POLL_INTERVAL_MS);
+        if (stallTimer.elapsed() > STALL_TIMEOUT_SECS * 1000)
+            return finish(CURLE_OPERATION_TIMEDOUT);
+    }
+
+    // The body may have ended inside the bytes that came with the headers
+    return finish(CURLE_OK);
+}
@@ -0,0 +1,128 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef DIRECTHTTPRECEIVER_H
+#define DIRECTHTTPRECEIVER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+#include <QtGlobal>
+#include <curl/curl.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Receives a plain HTTP download straight into caller-owned buffers
+ *
+ * libcurl's write callback hands out data from curl's own receive buffer,
+ * so a consumer with its own buffers (the extract ring buffer) has to copy
+ * every byte once more. On multi-gigabit local mirrors that copy shows up as
+ * CPU time on the download thread.
+ *
+ * This lets curl establish the connection (CURLOPT_CONNECT_ONLY), then speaks
+ * HTTP/1.1 over it and reads the body with curl_easy_recv() directly into the
+ * buffers the consumer hands out. It deliberately covers only the simple case:
+ * a plain http:// URL on the local network, no proxy, and a 200/206 response
+ * with a Content-Length and identity encoding. Anything else is left to the
+ * normal curl transfer, which open() signals by returning false before any
+ * data has been delivered.
+ */
+class DirectHttpReceiver
+{
+public:
+    using HeaderCallback = std::function<void(const std::string &header)>;
+    // Returns the buffer the next received bytes go into, or nullptr to abort
+    using AcquireBuffer = std::function<char *(size_t &capacity)>;
+    // Passes on len bytes received into the last acquired buffer. len == 0 hands the
+    // buffer back unused. Returning false aborts the download.
+    using CommitBuffer = std::function<bool(char *buffer, size_t len)>;
+    using CancelCheck = std::function<bool()>;
+
+    // Same as CURLOPT_LOW_SPEED_TIME on the normal transfer
+    static constexpr int STALL_TIMEOUT_SECS = 60;
+
+    // A partly filled buffer is passed on once the socket runs dry and the buffer
+    // is this full, or has been waiting this long, so a slow link still streams
+    static constexpr size_t MIN_COMMIT_FRACTION = 4;
+    static constexpr int MAX_HOLD_MS = 20;
+
+    /**
+     * @param templateHandle Fully configured easy handle; it is duplicated and left untouched
+     * @param url Plain http:// URL to download
+     * @param startOffset First byte to download (non-zero when resuming)
+     * @param extraHeaders Additional request header lines, without line endings
+     */
+    DirectHttpReceiver(CURL *templateHandle, const std::string &url, quint64 startOffset,
+                       const std::vector<std::string> &extraHeaders);
+    ~DirectHttpReceiver();
+
+    DirectHttpReceiver(const DirectHttpReceiver&) = delete;
+    DirectHttpReceiver& operator=(const DirectHttpReceiver&) = delete;
+
+    /**
+     * @brief Whether a download could use this path at all
+     *
+     * Only plain http:// URLs without any configured or environment proxy qualify.
+     */
+    static bool isCandidate(const std::string &url, const std::string &proxy);
+
+    // Loopback, private and link-local addresses, IPv4 or IPv6
+    static bool isLocalAddress(const std::string &ip);
+
+    struct ResponseHead {
+        quint64 contentLength = 0;
+        std::vector<std::string> lines;  // Status line and headers, with line endings
+    };
+
+    /**
+     * @brief Parse the status line and headers of the response
+     *
+     * @param head Response up to and including the empty line
+     * @param startOffset Offset the request asked for; a resumed request must get
+     *                    a 206 for exactly that offset, a fresh one a 200
+     * @return false for malformed responses and those this class does not handle
+     */
+    static bool parseHead(const std::string &head, quint64 startOffset, ResponseHead &result);
+
+    /**
+     * @brief Connect, send the request and read the response headers
+     *
+     * @return false if the server is not on the local network or the response is
+     *         not one this class handles; nothing has been delivered in that case
+     */
+    bool open(const HeaderCallback &onHeader);
+
+    // Body length announced by the server, valid after open()
+    quint64 contentLength() const { return _contentLength; }
+
+    /**
+     * @brief Receive the body to completion, cancellation or failure
+     * @return CURLE_OK once contentLength() bytes were delivered, the failing code otherwise
+     */
+    CURLcode run(const AcquireBuffer &acquire, const CommitBuffer &commit, const CancelCheck &isCancelled);
+
+    // Body bytes delivered so far
+    quint64 received() const { return _received; }
+
+private:
+    bool _sendRequest();
+    bool _readHead(std::string &head);
+    bool _parseHead(const std::string &head, const HeaderCallback &onHeader);
+    int _waitSocket(bool forRead, int timeoutMs) const;
+
+    CURL *_handle;
+    curl_socket_t _socket;
+    std::string _url;
+    quint64 _startOffset;
+    std::vector<std::string> _extraHeaders;
+    quint64 _contentLength;
+    quint64 _received;
+    std::string _bodyStart;  // Body bytes that arrived together with the headers
+};
+
+#endif // DIRECTHTTPRECEIVER_H
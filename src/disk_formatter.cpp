@@ -165,6 +165,19 @@ Result<void> DiskFormatter::FormatFile(
   return WriteFat32(kPartitionStartSector, partition_size_sectors);
 }
 
+Result<void> DiskFormatter::FormatVolume(std::uint64_t volume_size_bytes) {
+  if (!file_ops_->IsOpen()) {
+    return Result<void>(FormatError::kFileOpenError);
+  }
+
+  std::uint64_t total_sectors = volume_size_bytes / kSectorSize;
+  if (total_sectors > UINT32_MAX) {
+    return Result<void>(FormatError::kInvalidParameters);
+  }
+
+  return WriteFat32(0, static_cast<std::uint32_t>(total_sectors));
+}
+
 Result<void> DiskFormatter::WriteMbr(
     std::uint64_t device_size_bytes) const {
   
@@ -180,6 +193,10 @@ Result<void> DiskFormatter::WriteMbr(
   if (total_sectors > UINT32_MAX) {
     total_sectors = UINT32_MAX;  // MBR limitation
   }
+  if (total_sectors <= kPartitionStartSector) {
+    std::cout << "Device too small for a partition after the first " << kPartitionStartSector << " sectors" << std::endl;
+    return Result<void>(FormatError::kInsufficientSpace);
+  }
   
   std::uint32_t partition_sectors = static_cast<std::uint32_t>(total_sectors) - kPartitionStartSector;
 
@@ -230,11 +247,15 @@ Result<void> DiskFormatter::WriteFat32(
     std::uint32_t partition_start_sector,
     std::uint32_t partition_size_sectors) const {
   
-  Fat32Config config = CalculateFat32Config(partition_size_sectors);
-  config.total_sectors = partition_size_sectors;
+  auto config_result = CalculateFat32Config(partition_size_sectors);
+  if (!config_result) {
+    std::cout << "Partition of " << partition_size_sectors << " sectors is too small for FAT32" << std::endl;
+    return Result<void>(config_result.error());
+  }
+  Fat32Config config = config_result.value();
 
   // Write boot sector
-  if (auto result = WriteBootSector(partition_start_sector, config); !result) {
+  if (auto result = WriteBootSector(partition_start_sector, 0, config); !result) {
     return result;
   }
 
@@ -243,8 +264,8 @@ Result<void> DiskFormatter::WriteFat32(
     return result;
   }
 
-  // Write backup boot sector
-  if (auto result = WriteBootSector(partition_start_sector + config.reserved_sectors / 2, config); !result) {
+  // Write backup boot sector where the boot sector says it is
+  if (auto result = WriteBootSector(partition_start_sector, kBackupBootSector, config); !result) {
     return result;
   }
 
@@ -261,9 +282,12 @@ Result<void> DiskFormatter::WriteFat32(
 }
 
 Result<void> DiskFormatter::WriteBootSector(
-    std::uint32_t offset_sectors,
+    std::uint32_t partition_start_sector,
+    std::uint32_t sector_in_partition,
     const Fat32Config& config) const {
   
+  std::uint32_t offset_sectors = partition_start_sector + sector_in_partition;
+  
   Fat32BootSector boot_sector{};
 
   // Boot jump instruction. Yes, it's x86, and yes, it's a jump to the start of the boot sector.
@@ -286,7 +310,7 @@ Result<void> DiskFormatter::WriteBootSector(
   boot_sector.sectors_per_fat_16 = 0;  // FAT32
   boot_sector.sectors_per_track = ToLittleEndian(static_cast<std::uint16_t>(63));
   boot_sector.num_heads = ToLittleEndian(static_cast<std::uint16_t>(255));
-  boot_sector.hidden_sectors = ToLittleEndian(static_cast<std::uint32_t>(offset_sectors));
+  boot_sector.hidden_sectors = ToLittleEndian(partition_start_sector);
   boot_sector.total_sectors_32 = ToLittleEndian(config.total_sectors);
 
   // FAT32 specific fields
@@ -296,7 +320,7 @@ Result<void> DiskFormatter::WriteBootSector(
   boot_sector.fs_version = 0;
   boot_sector.root_cluster = ToLittleEndian(static_cast<std::uint32_t>(2));
   boot_sector.fs_info_sector = ToLittleEndian(static_cast<std::uint16_t>(1));
-  boot_sector.backup_boot_sector = ToLittleEndian(static_cast<std::uint16_t>(6));
+  boot_sector.backup_boot_sector = ToLittleEndian(static_cast<std::uint16_t>(kBackupBootSector));
   
   // Extended fields
   boot_sector.drive_number = 0x80;
@@ -378,15 +402,21 @@ Result<void> DiskFormatter::WriteFatTables(
     const Fat32Config& config) const {
   
   std::uint32_t sectors_per_fat = CalculateSectorsPerFat(config);
-  std::uint32_t fat_size_bytes = sectors_per_fat * kSectorSize;
-  
+  std::uint64_t fat_size_bytes = static_cast<std::uint64_t>(sectors_per_fat) * kSectorSize;
+
+  // Only the reserved entries at the start of a fresh FAT are non-zero, so just
+  // that head is built in memory; the rest of each FAT is zeroed separately.
+  // FAT sizes are whole sectors, so the head stays sector-aligned.
+  std::size_t head_size = static_cast<std::size_t>(
+      std::min<std::uint64_t>(kFatHeadSize, fat_size_bytes));
+
   // Use aligned buffer for O_DIRECT compatibility on Linux
-  AlignedBuffer fat_table(fat_size_bytes);
-  if (!fat_table.valid()) {
+  AlignedBuffer fat_head(head_size);
+  if (!fat_head.valid()) {
     return Result<void>(FormatError::kFileWriteError);
   }
   
-  auto* fat_entries = fat_table.as<std::uint32_t>();
+  auto* fat_entries = fat_head.as<std::uint32_t>();
   
   // First three entries are special
   fat_entries[0] = ToLittleEndian(0x0FFFFFF8);  // Media descriptor + end marker
@@ -395,16 +425,52 @@ Result<void> DiskFormatter::WriteFatTables(
 
   // Write both FAT copies
   for (std::uint8_t fat_num = 0; fat_num < config.num_fats; ++fat_num) {
-    std::uint64_t fat_offset = static_cast<std::uint64_t>(fat_start_sector + (fat_num * sectors_per_fat)) * kSectorSize;
-    FileError error = file_ops_->WriteAtOffset(fat_offset, fat_table.data(), fat_size_bytes);
+    std::uint64_t fat_offset = (fat_start_sector + static_cast<std::uint64_t>(fat_num) * sectors_per_fat) * kSectorSize;
+    FileError error = file_ops_->WriteAtOffset(fat_offset, fat_head.data(), head_size);
     if (error != FileError::kSuccess) {
       return Result<void>(ConvertError(error));
     }
+    if (auto result = ZeroRegion(fat_offset + head_size, fat_size_bytes - head_size); !result) {
+      return result;
+    }
   }
   
   return Result<void>();
 }
 
+Result<void> DiskFormatter::ZeroRegion(
+    std::uint64_t offset,
+    std::uint64_t length) const {
+  
+  if (length == 0) {
+    return Result<void>();
+  }
+
+  // Plain discard is not used: without deterministic zeroing the old contents
+  // may read back, which would leave stale cluster chains in the FAT
+  if (file_ops_->HasFastZeroRange() &&
+      file_ops_->ZeroRange(offset, length) == FileError::kSuccess) {
+    return Result<void>();
+  }
+
+  // One bounded buffer is reused for the whole region, so memory use does not
+  // grow with the card size
+  AlignedBuffer zeros(static_cast<std::size_t>(std::min<std::uint64_t>(length, kZeroChunkSize)));
+  if (!zeros.valid()) {
+    return Result<void>(FormatError::kFileWriteError);
+  }
+
+  for (std::uint64_t done = 0; done < length;) {
+    std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(length - done, zeros.size()));
+    FileError error = file_ops_->WriteAtOffset(offset + done, zeros.data(), chunk);
+    if (error != FileError::kSuccess) {
+      return Result<void>(ConvertError(error));
+    }
+    done += chunk;
+  }
+  return Result<void>();
+}
+
 Result<void> DiskFormatter::WriteRootDirectory(
     std::uint32_t root_cluster_sector) const {
   
@@ -424,7 +490,7 @@ Result<void> DiskFormatter::WriteRootDirectory(
   return Result<void>();
 }
 
-Fat32Config DiskFormatter::CalculateFat32Config(std::uint32_t partition_size_sectors) const {
+Result<Fat32Config> DiskFormatter::CalculateFat32Config(std::uint32_t partition_size_sectors) const {
   Fat32Config config;
   config.total_sectors = partition_size_sectors;
   
@@ -440,11 +506,38 @@ Fat32Config DiskFormatter::CalculateFat32Config(std::uint32_t partition_size_sec
   } else {
     config.sectors_per_cluster = 32;  // 16KB
   }
+
+  // Sectors before the data region; compared before subtracting, as tiny
+  // volumes would otherwise wrap around to a huge cluster count
+  auto metadata_sectors = [this, &config]() {
+    return static_cast<std::uint64_t>(config.reserved_sectors) +
+           static_cast<std::uint64_t>(config.num_fats) * CalculateSectorsPerFat(config);
+  };
+
+  // Small volumes (e.g. boot images) would end up with too few clusters to
+  // be recognised as FAT32; use smaller clusters for them instead
+  while (config.sectors_per_cluster > 1) {
+    std::uint64_t metadata = metadata_sectors();
+    if (metadata < partition_size_sectors &&
+        (partition_size_sectors - metadata) / config.sectors_per_cluster >= kMinFat32Clusters) {
+      break;
+    }
+    config.sectors_per_cluster /= 2;
+  }
+
+  if (metadata_sectors() >= partition_size_sectors) {
+    return Result<Fat32Config>(FormatError::kInsufficientSpace);
+  }
   
   return config;
 }
 
 std::uint32_t DiskFormatter::CalculateSectorsPerFat(const Fat32Config& config) const {
+  // Nothing left for data, the caller reports the volume as too small
+  if (config.total_sectors <= config.reserved_sectors) {
+    return 0;
+  }
+
   // Calculate number of data sectors
   std::uint32_t data_sectors = config.total_sectors - config.reserved_sectors;
   
@@ -455,7 +548,7 @@ std::uint32_t DiskFormatter::CalculateSectorsPerFat(const Fat32Config& config) c
   
   // Account for space taken by FAT tables themselves
   std::uint32_t total_fat_sectors = fat_sectors * config.num_fats;
-  data_sectors -= total_fat_sectors;
+  data_sectors = data_sectors > total_fat_sectors ? data_sectors - total_fat_sectors : 0;
   clusters = data_sectors / config.sectors_per_cluster;
   fat_bytes = (clusters + 2) * 4;
   fat_sectors = (fat_bytes + kSectorSize - 1) / kSectorSize;
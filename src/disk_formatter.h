@@ -167,10 +167,18 @@ class DiskFormatter {
       const std::string& file_path,
       std::uint64_t file_size_bytes);
 
+  // Write a bare FAT32 filesystem without partition table (a "superfloppy",
+  // like mkfs.vfat on an image file) to the already opened FileOperations
+  Result<void> FormatVolume(std::uint64_t volume_size_bytes);
+
  private:
   static constexpr std::uint32_t kSectorSize = 512;
   static constexpr std::uint32_t kPartitionStartSector = 8192;  // 4MB offset
   static constexpr std::uint8_t kFat32PartitionType = 0x0C;    // FAT32 LBA
+  static constexpr std::size_t kFatHeadSize = 4096;            // Part of each FAT holding entries
+  static constexpr std::size_t kZeroChunkSize = 1024 * 1024;   // Zero-fill write size
+  static constexpr std::uint32_t kMinFat32Clusters = 65525;    // Fewer clusters means FAT16
+  static constexpr std::uint16_t kBackupBootSector = 6;        // Within the reserved sectors
 
   std::unique_ptr<FileOperations> file_ops_;
 
@@ -187,7 +195,8 @@ class DiskFormatter {
 
   // Helper functions
   Result<void> WriteBootSector(
-      std::uint32_t offset_sectors,
+      std::uint32_t partition_start_sector,
+      std::uint32_t sector_in_partition,
       const Fat32Config& config) const;
 
   Result<void> WriteFsInfo(
@@ -201,8 +210,15 @@ class DiskFormatter {
   Result<void> WriteRootDirectory(
       std::uint32_t root_cluster_sector) const;
 
+  // Make a region read back as zeros: offloaded to the device when it can
+  // zero deterministically, otherwise written in bounded chunks
+  Result<void> ZeroRegion(
+      std::uint64_t offset,
+      std::uint64_t length) const;
+
   // Utility functions
-  Fat32Config CalculateFat32Config(std::uint32_t partition_size_sectors) const;
+  // Fails with kInsufficientSpace if the reserved sectors and FATs leave no room for data
+  Result<Fat32Config> CalculateFat32Config(std::uint32_t partition_size_sectors) const;
   std::uint32_t CalculateSectorsPerFat(const Fat32Config& config) const;
   
   Result<void> WriteAtOffset(
@@ -4,14 +4,17 @@
  */
 
 #include "disk_formatter.h"
+#include "memory_file_operations.h"
 
 #include <iostream>
 #include <filesystem>
-#include <fstream>
 #include <array>
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace fs = std::filesystem;
 using namespace rpi_imager;
@@ -25,6 +28,8 @@ class DiskFormatterTest {
     all_passed &= TestBasicFormatting();
     all_passed &= TestMbrStructure();
     all_passed &= TestFat32Structure();
+    all_passed &= TestFatTablesOverStaleData(true);
+    all_passed &= TestFatTablesOverStaleData(false);
     all_passed &= TestSystemToolValidation();
     
     if (all_passed) {
@@ -37,6 +42,17 @@ class DiskFormatterTest {
   }
 
  private:
+  // Formats a disk image held in memory and returns its contents
+  static std::vector<std::uint8_t> FormatInMemory(std::unique_ptr<MemoryFileOperations> ops,
+                                                  std::uint64_t disk_size) {
+    MemoryFileOperations* image = ops.get();
+    DiskFormatter formatter(std::move(ops));
+    if (!formatter.FormatFile("test_disk.img", disk_size)) {
+      return {};
+    }
+    return image->Contents();
+  }
+
   static bool TestBasicFormatting() {
     std::cout << "Testing basic formatting...\n";
     
@@ -72,28 +88,16 @@ class DiskFormatterTest {
   static bool TestMbrStructure() {
     std::cout << "Testing MBR structure...\n";
     
-    const std::string test_file = "/tmp/test_mbr.img";
     const std::uint64_t disk_size = 64 * 1024 * 1024;  // 64MB
     
-    fs::remove(test_file);
-    
-    DiskFormatter formatter;
-    auto result = formatter.FormatFile(test_file, disk_size);
-    
-    if (!result) {
-      std::cout << "❌ Failed to format file\n";
-      return false;
-    }
-    
-    // Read and validate MBR
-    std::ifstream file(test_file, std::ios::binary);
-    if (!file) {
-      std::cout << "❌ Cannot open test file for reading\n";
+    std::vector<std::uint8_t> disk = FormatInMemory(std::make_unique<MemoryFileOperations>(), disk_size);
+    if (disk.empty()) {
+      std::cout << "❌ Failed to format image\n";
       return false;
     }
     
     std::array<std::uint8_t, 512> mbr{};
-    file.read(reinterpret_cast<char*>(mbr.data()), 512);
+    std::memcpy(mbr.data(), disk.data(), mbr.size());
     
     // Check MBR signature
     if (mbr[510] != 0x55 || mbr[511] != 0xAA) {
@@ -127,29 +131,17 @@ class DiskFormatterTest {
   static bool TestFat32Structure() {
     std::cout << "Testing FAT32 structure...\n";
     
-    const std::string test_file = "/tmp/test_fat32.img";
     const std::uint64_t disk_size = 64 * 1024 * 1024;  // 64MB
     
-    fs::remove(test_file);
-    
-    DiskFormatter formatter;
-    auto result = formatter.FormatFile(test_file, disk_size);
-    
-    if (!result) {
-      std::cout << "❌ Failed to format file\n";
+    std::vector<std::uint8_t> disk = FormatInMemory(std::make_unique<MemoryFileOperations>(), disk_size);
+    if (disk.empty()) {
+      std::cout << "❌ Failed to format image\n";
       return false;
     }
     
     // Read FAT32 boot sector (at partition start: sector 8192)
-    std::ifstream file(test_file, std::ios::binary);
-    if (!file) {
-      std::cout << "❌ Cannot open test file for reading\n";
-      return false;
-    }
-    
-    file.seekg(8192 * 512);  // Seek to partition start
     std::array<std::uint8_t, 512> boot_sector{};
-    file.read(reinterpret_cast<char*>(boot_sector.data()), 512);
+    std::memcpy(boot_sector.data(), disk.data() + 8192 * 512, boot_sector.size());
     
     const auto* fat32_boot = reinterpret_cast<const Fat32BootSector*>(boot_sector.data());
     
@@ -184,6 +176,69 @@ class DiskFormatterTest {
     return true;
   }
   
+  // Fills the new image with a pattern, as if it were a used card, and
+  // optionally hides offloaded zeroing so the chunked path is taken
+  class StaleFileOperations : public MemoryFileOperations {
+   public:
+    explicit StaleFileOperations(bool fast_zero) : fast_zero_(fast_zero) {}
+
+    FileError CreateTestFile(const std::string& path, std::uint64_t size) override {
+      FileError error = MemoryFileOperations::CreateTestFile(path, size);
+      std::vector<std::uint8_t> pattern(1024 * 1024, 0xA5);
+      for (std::uint64_t offset = 0; error == FileError::kSuccess && offset < size; offset += pattern.size()) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size - offset, pattern.size()));
+        error = WriteAtOffset(offset, pattern.data(), chunk);
+      }
+      return error;
+    }
+
+    bool HasFastZeroRange() const override {
+      return fast_zero_ && MemoryFileOperations::HasFastZeroRange();
+    }
+
+   private:
+    bool fast_zero_;
+  };
+
+  static bool TestFatTablesOverStaleData(bool fast_zero) {
+    std::cout << "Testing FAT tables over stale data ("
+              << (fast_zero ? "offloaded" : "chunked") << " zeroing)...\n";
+
+    const std::uint64_t disk_size = 256 * 1024 * 1024;  // 256MB, FATs span several zero chunks
+
+    std::vector<std::uint8_t> disk = FormatInMemory(std::make_unique<StaleFileOperations>(fast_zero), disk_size);
+    if (disk.empty()) {
+      std::cout << "❌ Failed to format image\n";
+      return false;
+    }
+
+    const auto* fat32_boot = reinterpret_cast<const Fat32BootSector*>(disk.data() + 8192 * 512);
+
+    const std::uint64_t fat_bytes = static_cast<std::uint64_t>(fat32_boot->sectors_per_fat_32) * 512;
+    const std::uint64_t fat_start = (8192 + static_cast<std::uint64_t>(fat32_boot->reserved_sectors)) * 512;
+    const std::array<std::uint32_t, 3> reserved = {0x0FFFFFF8, 0x0FFFFFFF, 0x0FFFFFFF};
+
+    for (std::uint8_t fat_num = 0; fat_num < fat32_boot->num_fats; ++fat_num) {
+      auto fat = disk.begin() + static_cast<std::ptrdiff_t>(fat_start + fat_num * fat_bytes);
+      auto fat_end = fat + static_cast<std::ptrdiff_t>(fat_bytes);
+
+      if (std::memcmp(&*fat, reserved.data(), sizeof(reserved)) != 0) {
+        std::cout << "❌ Wrong reserved entries in FAT " << static_cast<int>(fat_num) << "\n";
+        return false;
+      }
+      auto stale = std::find_if(fat + sizeof(reserved), fat_end,
+                                [](std::uint8_t b) { return b != 0; });
+      if (stale != fat_end) {
+        std::cout << "❌ Stale data at byte " << (stale - fat)
+                  << " of FAT " << static_cast<int>(fat_num) << "\n";
+        return false;
+      }
+    }
+
+    std::cout << "✅ FAT tables test passed\n";
+    return true;
+  }
+
   static bool TestSystemToolValidation() {
     std::cout << "Testing with system tools...\n";
     
@@ -233,7 +233,7 @@ void DownloadArchiveExtractThread::_extractCompressedEntry(struct archive *outer
         }
 
         decompressTimer.start();
-        ssize_t size = archive_read_data(innerArchive, slot->data, slot->capacity);
+        ssize_t size = archive_read_data(innerArchive, slot->data, _writeChunkSize(slot->capacity));
         _totalDecompressionMs.fetch_add(static_cast<quint64>(decompressTimer.elapsed()));
 
         if (size < 0)
@@ -309,7 +309,7 @@ void DownloadArchiveExtractThread::_extractUncompressedEntry(struct archive *out
         }
 
         decompressTimer.start();
-        ssize_t size = archive_read_data(outerArchive, slot->data, slot->capacity);
+        ssize_t size = archive_read_data(outerArchive, slot->data, _writeChunkSize(slot->capacity));
         _totalDecompressionMs.fetch_add(static_cast<quint64>(decompressTimer.elapsed()));
 
         if (size < 0)
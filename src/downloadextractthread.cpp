@@ -58,7 +58,9 @@ protected:
 DownloadExtractThread::DownloadExtractThread(const QByteArray &url, const QByteArray &localfilename, const QByteArray &expectedHash, QObject *parent)
     : DownloadThread(url, localfilename, expectedHash, parent), 
       _writeBufferSize(SystemMemoryManager::instance().getOptimalWriteBufferSize()), 
+      _maxWriteBufferSize(SystemMemoryManager::instance().getMaxWriteBufferSize()),
       _currentReadSlot(nullptr),
+      _currentReceiveSlot(nullptr),
       _currentWriteSlot(nullptr),
       _ethreadStarted(false),
       _isImage(true), 
@@ -109,17 +111,50 @@ void DownloadExtractThread::_allocateBuffers()
     int actualQueueDepth = _debugAsyncQueueDepth;
     int writeRingBufferDepth = actualQueueDepth * 2 + 8;
 
+    // Slots are sized for the largest write the write controller may move to;
+    // writes start out at _writeBufferSize
     size_t writeRingBufferSlots = static_cast<size_t>(writeRingBufferDepth);
-    _writeRingBuffer = std::make_unique<RingBuffer>(writeRingBufferSlots, _writeBufferSize, pageSize);
+    _writeRingBuffer = std::make_unique<RingBuffer>(writeRingBufferSlots, _maxWriteBufferSize, pageSize);
 
     size_t inputBufferMB = (numSlots * inputBufferSize) / (1024 * 1024);
-    size_t writeBufferMB = (writeRingBufferSlots * _writeBufferSize) / (1024 * 1024);
+    size_t writeBufferMB = (writeRingBufferSlots * _maxWriteBufferSize) / (1024 * 1024);
     qDebug() << "Input ring buffer:" << numSlots << "slots x" << (inputBufferSize / 1024) << "KB ="
              << inputBufferMB << "MB";
-    qDebug() << "Write ring buffer:" << writeRingBufferSlots << "slots x" << (_writeBufferSize / 1024) << "KB ="
+    qDebug() << "Write ring buffer:" << writeRingBufferSlots << "slots x" << (_maxWriteBufferSize / 1024) << "KB ="
              << writeBufferMB << "MB (queue depth:" << actualQueueDepth << ")";
 }
 
+std::vector<rpi_imager::FileOperations::WriteBuffer> DownloadExtractThread::_writeBuffers() const
+{
+    // Every async write comes from a write ring slot (zero-copy path)
+    std::vector<rpi_imager::FileOperations::WriteBuffer> buffers;
+    if (!_writeRingBuffer)
+        return buffers;
+
+    buffers.reserve(_writeRingBuffer->numSlots());
+    for (size_t i = 0; i < _writeRingBuffer->numSlots(); ++i) {
+        buffers.push_back({reinterpret_cast<const std::uint8_t*>(_writeRingBuffer->slotBuffer(i)),
+                           _writeRingBuffer->slotCapacity()});
+    }
+    return buffers;
+}
+
+void DownloadExtractThread::_configureWriteTuning(rpi_imager::AdaptiveWriteController::Limits &limits) const
+{
+    // Write sizes are powers of two apart, so they stay page multiples for O_DIRECT
+    limits.initial_chunk = _writeBufferSize;
+    limits.min_chunk = _writeBufferSize / 4;
+    limits.max_chunk = _maxWriteBufferSize;
+    // Slots filled before a change still go out at the old size
+    limits.backlog_writes = _writeRingBuffer ? static_cast<int>(_writeRingBuffer->numSlots()) : 0;
+}
+
+size_t DownloadExtractThread::_writeChunkSize(size_t capacity) const
+{
+    size_t chunk = _writeController ? _writeController->ChunkSize() : _writeBufferSize;
+    return chunk ? qMin(chunk, capacity) : capacity;
+}
+
 void DownloadExtractThread::run()
 {
     _allocateBuffers();
@@ -142,6 +177,21 @@ DownloadExtractThread::~DownloadExtractThread()
     if (_file && _file->IsAsyncIOSupported()) {
         _file->WaitForPendingWrites();
     }
+
+    // Hash stage callbacks release ring buffer slots too
+    _stopHashStage();
+
+    // So does the cache writer, which may still hold input slots. A finished
+    // writer is left alone; wait even for a stuck one rather than free its data.
+    if (_asyncCacheWriter) {
+        _asyncCacheWriter->cancel();
+        _asyncCacheWriter->wait();
+    }
+
+    // The device must not hold on to the slots once they are freed
+    if (_file) {
+        _file->RegisterWriteBuffers({});
+    }
     
     // Ring buffer destructors handle memory cleanup
     _writeRingBuffer.reset();
@@ -244,16 +294,11 @@ void DownloadExtractThread::_emitProgressUpdate()
     }
 }
 
-size_t DownloadExtractThread::_writeData(const char *buf, size_t len)
+void DownloadExtractThread::_onDataReceived(const char *buf, size_t len)
 {
-    if (_cancelled)
-        return 0;
-
     // Emit progress updates when data starts flowing
     _emitProgressUpdate();
 
-    _writeCache(buf, len);
-
     if (!_ethreadStarted)
     {
         // Extract thread is started when first data comes in
@@ -266,12 +311,74 @@ size_t DownloadExtractThread::_writeData(const char *buf, size_t len)
     {
         _inputHash.addData(buf, len);
     }
+}
+
+void DownloadExtractThread::_writeCacheFromSlot(RingBuffer *ring, RingBuffer::Slot *slot, size_t len)
+{
+    if (!_cacheEnabled)
+        return;
+
+    // The cache writer writes straight from the slot instead of a copy. Its
+    // reference keeps the slot from being refilled until the chunk is on disk.
+    ring->retainSlot(slot);
+    if (!_writeCache(slot->data, len, [ring, slot]() { ring->releaseReadSlot(slot); }))
+        ring->releaseReadSlot(slot);
+}
 
+size_t DownloadExtractThread::_writeData(const char *buf, size_t len)
+{
+    if (_cancelled)
+        return 0;
+
+    _onDataReceived(buf, len);
     _pushQueue(buf, len);
 
     return len;
 }
 
+bool DownloadExtractThread::_canReceiveDirect() const
+{
+    return _ringBuffer != nullptr;
+}
+
+char *DownloadExtractThread::_acquireReceiveBuffer(size_t &capacity)
+{
+    capacity = 0;
+
+    // Same blocking acquire as _pushQueue(), so producer stalls are counted alike
+    while (!_cancelled && !_ringBuffer->isCancelled())
+    {
+        _currentReceiveSlot = _ringBuffer->acquireWriteSlot(100);  // 100ms timeout
+        if (_currentReceiveSlot)
+        {
+            capacity = _currentReceiveSlot->capacity;
+            return _currentReceiveSlot->data;
+        }
+    }
+    return nullptr;
+}
+
+bool DownloadExtractThread::_commitReceiveBuffer(char *buf, size_t len)
+{
+    RingBuffer::Slot *slot = _currentReceiveSlot;
+    _currentReceiveSlot = nullptr;
+    if (!slot || slot->data != buf)
+        return false;
+
+    // An empty slot would read as end of stream, so unused ones go back
+    if (len == 0 || _cancelled)
+    {
+        _ringBuffer->abortWriteSlot(slot);
+        return len == 0 && !_cancelled;
+    }
+
+    _onDataReceived(buf, len);
+    if (!_cacheExpanded)
+        _writeCacheFromSlot(_ringBuffer.get(), slot, len);
+    _ringBuffer->commitWriteSlot(slot, len);
+    return true;
+}
+
 void DownloadExtractThread::_onDownloadSuccess()
 {
     _downloadComplete = true;
@@ -382,6 +489,9 @@ void DownloadExtractThread::extractImageRun()
             }
         }
 
+        // With a block map only the mapped ranges get written (see _writeMappedFile)
+        _startBlockMap();
+
         // Emit image extraction setup event (archive opened and header read)
         emit eventImageExtraction(static_cast<quint32>(extractionTimer.elapsed()), true);
 
@@ -403,7 +513,7 @@ void DownloadExtractThread::extractImageRun()
             
             // Time decompression (includes ring buffer wait inside libarchive's read callback)
             decompressTimer.start();
-            ssize_t size = archive_read_data(a, slot->data, slot->capacity);
+            ssize_t size = archive_read_data(a, slot->data, _writeChunkSize(slot->capacity));
             _totalDecompressionMs.fetch_add(static_cast<quint64>(decompressTimer.elapsed()));
             
             if (size < 0) {
@@ -439,6 +549,10 @@ void DownloadExtractThread::extractImageRun()
             // Emit progress updates during extraction
             _emitProgressUpdate();
 
+            // An expanded cache takes the decompressed image instead of the download
+            if (_cacheExpanded)
+                _writeCacheFromSlot(_writeRingBuffer.get(), slot, static_cast<size_t>(size));
+
             // Create a completion callback that releases the ring buffer slot
             // This enables ZERO-COPY async I/O: the slot stays valid until the
             // async write truly completes, then is returned to the pool.
@@ -458,7 +572,7 @@ void DownloadExtractThread::extractImageRun()
             // With async I/O, _writeFile returns quickly after queuing the I/O operation,
             // so running it synchronously in the extraction thread doesn't block progress.
             // The actual I/O happens asynchronously via io_uring/IOCP.
-            bool writeOk = _writeFile(slot->data, static_cast<size_t>(size), releaseCallback) > 0;
+            bool writeOk = _writeMappedFile(slot->data, static_cast<size_t>(size), releaseCallback) > 0;
             if (!writeOk && !_cancelled) {
                 // Wait for pending async writes before cleanup
                 if (_file && _file->IsAsyncIOSupported()) {
@@ -947,6 +1061,8 @@ void DownloadExtractThread::_pushQueue(const char *data, size_t len)
         // Copy data directly into the pre-allocated slot buffer (zero-copy from slot's perspective)
         size_t chunkSize = std::min(len - offset, slot->capacity);
         memcpy(slot->data, data + offset, chunkSize);
+        if (!_cacheExpanded)
+            _writeCacheFromSlot(_ringBuffer.get(), slot, chunkSize);
         
         // Commit the slot
         _ringBuffer->commitWriteSlot(slot, chunkSize);
@@ -56,13 +56,15 @@ signals:
                                    quint64 producerWaitMs, quint64 consumerWaitMs);
 
 protected:
-    size_t _writeBufferSize;
+    size_t _writeBufferSize;        // Initial write size
+    size_t _maxWriteBufferSize;     // Write ring slot size, the largest write the controller may pick
     _extractThreadClass *_extractThread;
     
     // Zero-copy ring buffer for curl -> libarchive data transfer (compressed data)
     std::unique_ptr<RingBuffer> _ringBuffer;
     static const int RING_BUFFER_SLOTS;  // Number of slots in ring buffer
     RingBuffer::Slot* _currentReadSlot;  // Current slot being read by libarchive
+    RingBuffer::Slot* _currentReceiveSlot;  // Slot the network is receiving into directly
     
     // Ring buffer for decompress -> write path (decompressed data)
     // Uses 4 slots to ensure buffers aren't reused while hash computation is pending
@@ -87,10 +89,18 @@ protected:
     void _allocateBuffers();
     void _pushQueue(const char *data, size_t len);
     void _cancelExtract();
+    void _onDataReceived(const char *buf, size_t len);
+    void _writeCacheFromSlot(RingBuffer *ring, RingBuffer::Slot *slot, size_t len);
     virtual size_t _writeData(const char *buf, size_t len) override;
+    virtual bool _canReceiveDirect() const override;
+    virtual char *_acquireReceiveBuffer(size_t &capacity) override;
+    virtual bool _commitReceiveBuffer(char *buf, size_t len) override;
     virtual void _onDownloadSuccess() override;
     virtual void _onDownloadError(const QString &msg) override;
     virtual void _updateBottleneckState() override;
+    virtual std::vector<rpi_imager::FileOperations::WriteBuffer> _writeBuffers() const override;
+    virtual void _configureWriteTuning(rpi_imager::AdaptiveWriteController::Limits &limits) const override;
+    size_t _writeChunkSize(size_t capacity) const;
     void _emitProgressUpdate();
     virtual void _onVerifyProgress() override;
 
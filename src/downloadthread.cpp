@@ -8,7 +8,11 @@
 #include "config.h"
 #include "devicewrapper.h"
 #include "devicewrapperfatpartition.h"
+#include "fanout_file_operations.h"
 #include "systemmemorymanager.h"
+#include "ringbuffer.h"
+#include "segmenteddownloader.h"
+#include "directhttpreceiver.h"
 #include "dependencies/mountutils/src/mountutils.hpp"
 #include "dependencies/drivelist/src/drivelist.hpp"
 #include <fstream>
@@ -25,6 +29,7 @@
 #include <fcntl.h>
 #endif
 #include <future>
+#include <optional>
 #include <chrono>
 #include <QDebug>
 #include <QProcess>
@@ -46,7 +51,7 @@
 #include "secureboot.h"
 #include "platformquirks.h"
 #include "curlnetworkconfig.h"
-#include <QTemporaryDir>
+#include "archiveentryiodevice.h"
 
 #ifdef Q_OS_LINUX
 #include <sys/ioctl.h>
@@ -97,7 +102,7 @@ QByteArray DownloadThread::_proxy;
 DownloadThread::DownloadThread(const QByteArray &url, const QByteArray &localfilename, const QByteArray &expectedHash, QObject *parent) :
     QThread(parent), _startOffset(0), _lastDlTotal(0), _lastDlNow(0), _extractTotal(0), _verifyTotal(0), _lastVerifyNow(0), _bytesWritten(0), _lastFailureOffset(0), _sectorsStart(-1), _url(url), _filename(localfilename), _expectedHash(expectedHash),
     _firstBlock(nullptr), _cancelled(false), _successful(false), _verifyEnabled(false), _cacheEnabled(false), _lastModified(0), _serverTime(0),  _lastFailureTime(0),
-    _inputBufferSize(SystemMemoryManager::instance().getOptimalInputBufferSize()), _writehash(OSLIST_HASH_ALGORITHM), _verifyhash(OSLIST_HASH_ALGORITHM),
+    _inputBufferSize(SystemMemoryManager::instance().getOptimalInputBufferSize()), _writehash(OSLIST_HASH_ALGORITHM), _verifyhash(std::make_unique<VerifyDigest>(VerifyDigest::Algorithm::Sha256)),
     _hasPendingHash(false)
 {
     // Ensure libcurl is initialized (handled centrally by CurlNetworkConfig)
@@ -115,6 +120,8 @@ DownloadThread::DownloadThread(const QByteArray &url, const QByteArray &localfil
     // Initialize cross-platform adaptive sync configuration
     _lastSyncBytes = 0;
     _lastSyncTime.start();
+    _writebackStart = _writebackEnd = 0;
+    _writebackBytes = 0;
     _initializeSyncConfiguration();
     
     // Initialize write timing tracking
@@ -130,6 +137,23 @@ DownloadThread::DownloadThread(const QByteArray &url, const QByteArray &localfil
     _debugAsyncQueueDepth = 16; // Default queue depth
     _debugIPv4Only = false;     // Use both IPv4 and IPv6 by default
     _debugSkipEndOfDevice = false; // For counterfeit cards with fake capacity
+    _debugTrailingVerify = false;  // Verify only after the write, as before
+
+    _trailingVerifyFd = -1;
+    _trailingVerifyCheckpoint = 0;
+
+    // Sparse writing is enabled per device in _openAndPrepareDevice()
+    _sparseWriteMode = SparseWriteMode::Disabled;
+    _sparseBytesSkipped = 0;
+
+    // Fan-out is only used if additional targets are set
+    _fanOut = nullptr;
+
+    _segmentedFallback = false;
+    _downloadSize = 0;
+
+    // The cache takes the download unless setCacheFile() says otherwise
+    _cacheExpanded = false;
     
     // Initialize bottleneck detection
     _currentBottleneck = BottleneckState::None;
@@ -147,6 +171,9 @@ DownloadThread::~DownloadThread()
         _pendingHashFuture.waitForFinished();
         _hasPendingHash = false;
     }
+    _stopHashStage();
+    bool trailingReadError;
+    _finishTrailingVerify(trailingReadError);
     
     // Close unified file operations
     if (_file && _file->IsOpen()) {
@@ -234,6 +261,140 @@ QByteArray DownloadThread::_fileGetContentsTrimmed(const QString &filename)
 }
 
 bool DownloadThread::_openAndPrepareDevice()
+{
+    // Done before any image data arrives, so extraction does not wait for the network
+    _fetchBlockMap();
+
+    if (_additionalTargets.isEmpty())
+    {
+        if (!_openAndPrepareTarget())
+            return false;
+        _registerWriteBuffers();
+        _startWriteTuning();
+        return true;
+    }
+
+    /* Fan-out mode: prepare every device on its own, then write them through
+       a single FanOutFileOperations. A device that cannot be prepared is
+       skipped, the others are still written. */
+    QList<QByteArray> devices = _additionalTargets;
+    devices.removeAll(_filename);
+    devices.removeDuplicates();
+    devices.prepend(_filename);
+    const QByteArray primary = _filename;
+
+    auto fanOut = std::make_unique<rpi_imager::FanOutFileOperations>();
+    std::optional<SparseWriteMode> sparseMode;
+    QString lastError;
+    _fanOutSectorsStart.clear();
+
+    for (const QByteArray &device : devices)
+    {
+        _filename = device;
+        _file = rpi_imager::FileOperations::Create();
+        _sparseWriteMode = SparseWriteMode::Disabled;
+        _targetPrepareError.clear();
+
+        if (!_openAndPrepareTarget())
+        {
+            lastError = _targetPrepareError.isEmpty()
+                ? tr("Cannot open storage device '%1'.").arg(QString(device))
+                : _targetPrepareError;
+            qDebug() << "Fan-out: skipping" << device << "-" << lastError;
+            emit targetFailed(QString(device), lastError);
+            if (_file->IsOpen())
+                _file->Close();
+            continue;
+        }
+
+        /* Sparse writes are only used if all devices agree on how */
+        if (!sparseMode)
+            sparseMode = _sparseWriteMode;
+        else if (*sparseMode != _sparseWriteMode)
+            sparseMode = SparseWriteMode::Disabled;
+
+        fanOut->AddTarget(device.toStdString(), std::move(_file));
+        _fanOutSectorsStart.append(_sectorsStart);
+    }
+    _filename = primary;
+
+    if (fanOut->TargetCount() == 0)
+    {
+        _file = rpi_imager::FileOperations::Create();
+        emit error(lastError);
+        return false;
+    }
+
+    _sparseWriteMode = sparseMode.value_or(SparseWriteMode::Disabled);
+    fanOut->SetTargetFailedCallback([this](std::size_t index, const std::string &reason) {
+        emit targetFailed(QString::fromStdString(_fanOut->TargetPath(index)),
+                          tr("Error writing to storage device (%1)").arg(QString::fromStdString(reason)));
+    });
+    _fanOut = fanOut.get();
+    _file = std::move(fanOut);
+
+    qDebug() << "Fan-out: writing to" << _fanOut->TargetCount() << "of" << devices.size() << "devices";
+    _registerWriteBuffers();
+    _startWriteTuning();
+    return true;
+}
+
+void DownloadThread::_registerWriteBuffers()
+{
+    std::vector<rpi_imager::FileOperations::WriteBuffer> buffers = _writeBuffers();
+    if (buffers.empty() || !_file->IsAsyncIOSupported())
+        return;
+
+    /* Only an optimisation, writes from unregistered buffers work the same */
+    if (_file->RegisterWriteBuffers(buffers))
+        qDebug() << "Registered" << buffers.size() << "write buffers with the device";
+}
+
+void DownloadThread::_startWriteTuning()
+{
+    if (!_debugAsyncIO || !_file->IsAsyncIOSupported() || _file->GetAsyncQueueDepth() <= 1)
+        return;
+
+    /* The configured queue depth is the ceiling; start where the fixed
+       O_DIRECT limit used to be and let the controller find the depth */
+    rpi_imager::AdaptiveWriteController::Limits limits;
+    limits.max_depth = _file->GetAsyncQueueDepth();
+    limits.initial_depth = 4;
+    _configureWriteTuning(limits);
+
+    _writeController = std::make_shared<rpi_imager::AdaptiveWriteController>(limits);
+    _writeController->SetDecisionCallback([this](const rpi_imager::AdaptiveWriteController::Decision &d) {
+        qDebug() << "Write tuning:" << d.reason << "- queue depth" << d.depth << "write size" << (d.chunk / 1024) << "KB"
+                 << "(" << (d.throughput / 1024) << "KB/s, avg latency" << d.avg_latency_us << "us)";
+        emit eventWriteTuning(d.depth, static_cast<quint32>(d.chunk / 1024), static_cast<quint32>(d.throughput / 1024),
+                              d.avg_latency_us, QString::fromLatin1(d.reason));
+    });
+    _file->SetWriteController(_writeController);
+}
+
+void DownloadThread::_onPrepareError(const QString &msg)
+{
+    // In fan-out mode the device is skipped instead of failing the write
+    if (!_additionalTargets.isEmpty())
+        _targetPrepareError = msg;
+    else
+        emit error(msg);
+}
+
+void DownloadThread::_onTargetError(const QString &msg)
+{
+    // In fan-out mode only the active device is dropped, unless it is the last one
+    if (_fanOut && _fanOut->HealthyTargetCount() > 1)
+    {
+        std::size_t index = _fanOut->ActiveTarget();
+        _fanOut->MarkFailed(index);
+        emit targetFailed(QString::fromStdString(_fanOut->TargetPath(index)), msg);
+        return;
+    }
+    DownloadThread::_onDownloadError(msg);
+}
+
+bool DownloadThread::_openAndPrepareTarget()
 {
     QElapsedTimer unmountTimer;
     QElapsedTimer openTimer;
@@ -254,9 +415,9 @@ bool DownloadThread::_openAndPrepareDevice()
         if (!unmountSuccess) {
             qDebug() << "Unmount failed with result:" << unmountResult;
 #ifdef Q_OS_DARWIN
-            emit error(tr("Failed to unmount disk '%1'. Please close any applications using the disk and try again.").arg(unmountPath));
+            _onPrepareError(tr("Failed to unmount disk '%1'. Please close any applications using the disk and try again.").arg(unmountPath));
 #else
-            emit error(tr("Failed to unmount disk '%1'.").arg(unmountPath));
+            _onPrepareError(tr("Failed to unmount disk '%1'.").arg(unmountPath));
 #endif
             return false;
         }
@@ -313,7 +474,7 @@ bool DownloadThread::_openAndPrepareDevice()
                 cleanResult = DiskpartUtil::cleanDisk(_filename, std::chrono::seconds(60), 3, DiskpartUtil::VolumeHandling::SkipUnmounting);
                 if (!cleanResult.success)
                 {
-                    emit error(cleanResult.errorMessage);
+                    _onPrepareError(cleanResult.errorMessage);
                     return false;
                 }
             }
@@ -336,7 +497,7 @@ bool DownloadThread::_openAndPrepareDevice()
             }
             else if (i.mountpoints.size() > 1)
             {
-                emit error(tr("Error: Multiple partitions found on disk. Please ensure the disk is completely clean."));
+                _onPrepareError(tr("Error: Multiple partitions found on disk. Please ensure the disk is completely clean."));
                 return false;
             }
             else
@@ -377,11 +538,11 @@ bool DownloadThread::_openAndPrepareDevice()
         msg += "<br>"+tr("Please verify if 'Laerdal SimServer Imager' is allowed access to 'removable volumes' in privacy settings (under 'files and folders' or alternatively give it 'full disk access').");
         QStringList args("x-apple.systempreferences:com.apple.preference.security?Privacy_RemovableVolume");
         QProcess::execute("open", args);
-        emit error(msg);
+        _onPrepareError(msg);
 #elif defined(Q_OS_LINUX)
-        emit error(tr("Cannot open storage device '%1'. Please run with elevated privileges (sudo).").arg(QString(_filename)));
+        _onPrepareError(tr("Cannot open storage device '%1'. Please run with elevated privileges (sudo).").arg(QString(_filename)));
 #else
-        emit error(tr("Cannot open storage device '%1'.").arg(QString(_filename)));
+        _onPrepareError(tr("Cannot open storage device '%1'.").arg(QString(_filename)));
 #endif
         emit eventDriveAuthorization(static_cast<quint32>(authOpenMs), false);
         return false;
@@ -474,6 +635,17 @@ bool DownloadThread::_openAndPrepareDevice()
                 }
             }
         }
+
+        /* Sparse images can leave zero blocks to the device if it zeroes ranges
+           itself (WRITE ZEROES). Whether discarded blocks read back as zeros is
+           not reported by current kernels (discard_zeroes_data is always 0), so
+           a discard alone is not enough to skip them */
+        _sparseWriteMode = _probeZeroRange() ? SparseWriteMode::ZeroRange : SparseWriteMode::Disabled;
+    }
+    else
+    {
+        /* Regular image file: skipped ranges become holes, if the filesystem can punch them */
+        _sparseWriteMode = _probeZeroRange() ? SparseWriteMode::ZeroRange : SparseWriteMode::Disabled;
     }
 #endif
 
@@ -484,7 +656,7 @@ bool DownloadThread::_openAndPrepareDevice()
     
     std::uint64_t knownsize = 0;
     if (_file->GetSize(knownsize) != rpi_imager::FileError::kSuccess) {
-        emit error(tr("Error getting device size"));
+        _onPrepareError(tr("Error getting device size"));
         return false;
     }
     
@@ -493,7 +665,7 @@ bool DownloadThread::_openAndPrepareDevice()
     constexpr size_t emptyMBSize = 1024 * 1024;
     rpi_imager::AlignedBuffer emptyMB(emptyMBSize);
     if (!emptyMB) {
-        emit error(tr("Failed to allocate buffer for MBR zeroing"));
+        _onPrepareError(tr("Failed to allocate buffer for MBR zeroing"));
         return false;
     }
     
@@ -504,7 +676,7 @@ bool DownloadThread::_openAndPrepareDevice()
     if (_file->WriteSequential(emptyMB.data(), emptyMBSize) != rpi_imager::FileError::kSuccess ||
         _file->Flush() != rpi_imager::FileError::kSuccess)
     {
-        emit error(tr("Write error while zero'ing out MBR"));
+        _onPrepareError(tr("Write error while zero'ing out MBR"));
         return false;
     }
     qint64 firstMBMs = _timer.elapsed();
@@ -541,7 +713,7 @@ bool DownloadThread::_openAndPrepareDevice()
         }, lastMBResult, kCounterfeitDetectionTimeoutSeconds);
         
         if (!completed) {
-            emit error(tr("Timeout while writing to the end of the storage device.<br>"
+            _onPrepareError(tr("Timeout while writing to the end of the storage device.<br>"
                           "This often indicates a counterfeit SD card that reports a larger "
                           "capacity than it actually has (e.g., claims to be 2TB but only has 8GB).<br><br>"
                           "Please try a different storage device."));
@@ -549,7 +721,7 @@ bool DownloadThread::_openAndPrepareDevice()
         }
         
         if (lastMBResult != rpi_imager::FileError::kSuccess) {
-            emit error(tr("Write error while trying to zero out last part of card.<br>"
+            _onPrepareError(tr("Write error while trying to zero out last part of card.<br>"
                           "Card could be advertising wrong capacity (possible counterfeit)."));
             return false;
         }
@@ -725,7 +897,9 @@ void DownloadThread::run()
 
     // Minimal logging during normal operation
     _timer.start();
-    CURLcode ret = curl_easy_perform(_c);
+    CURLcode ret;
+    if (!_directDownload(ret) && !_segmentedDownload(ret))
+        ret = curl_easy_perform(_c);
 
     /* Deal with badly configured HTTP servers that terminate the connection quickly
        if connections stalls for some seconds while kernel commits buffers to slow SD card.
@@ -802,6 +976,25 @@ void DownloadThread::run()
             curl_easy_getinfo(_c, CURLINFO_SPEED_DOWNLOAD_T, &downloadSpeed);
             curl_easy_getinfo(_c, CURLINFO_SIZE_DOWNLOAD_T, &downloadSize);
             curl_easy_getinfo(_c, CURLINFO_HTTP_VERSION, &httpVersion);
+
+            if (_segmentedStats)
+            {
+                // Most or all of the data came over the segment connections
+                const SegmentedDownloader::Stats &segmented = *_segmentedStats;
+                if (!_segmentedFallback)
+                {
+                    downloadSize = 0;
+                    totalTime = 0;
+                }
+                dnsTime = segmented.dnsTime;
+                connectTime = segmented.connectTime;
+                tlsTime = segmented.tlsTime;
+                startTransferTime = segmented.startTransferTime;
+                httpVersion = segmented.httpVersion;
+                downloadSize += static_cast<curl_off_t>(segmented.bytes);
+                totalTime += segmented.elapsedMs / 1000.0;
+                downloadSpeed = totalTime > 0 ? static_cast<curl_off_t>(downloadSize / totalTime) : 0;
+            }
             
             const char* versionStr = "unknown";
             switch (httpVersion) {
@@ -866,6 +1059,114 @@ void DownloadThread::run()
     }
 }
 
+bool DownloadThread::_segmentedDownload(CURLcode &ret)
+{
+    // Only worth it for large images streamed from HTTP servers
+    if (_filename.isEmpty() || !(_url.startsWith("http://") || _url.startsWith("https://")))
+        return false;
+
+    // A known size saves a request, the segments check it against the server's Content-Range
+    quint64 totalSize = _downloadSize;
+    if (!totalSize && !SegmentedDownloader::probeRangeSupport(_c, totalSize))
+        return false;
+
+    if (totalSize <= static_cast<quint64>(_startOffset)
+        || totalSize - static_cast<quint64>(_startOffset) < SegmentedDownloader::MIN_SEGMENTED_SIZE)
+    {
+        qDebug() << "Download of" << totalSize << "bytes too small for segmented download, using a single connection";
+        return false;
+    }
+
+    _lastDlTotal = totalSize;
+    _lastDlNow = _startOffset;
+
+    SegmentedDownloader downloader(_c, static_cast<quint64>(_startOffset), totalSize);
+    ret = downloader.run(
+        [this](const char *data, size_t len) {
+            size_t written = _writeData(data, len);
+            _lastDlNow += written;
+            return written;
+        },
+        [this]() { return _cancelled; },
+        [this](const std::string &header) { _header(header); });
+    _segmentedStats = downloader.stats();
+
+    if (ret != CURLE_OK && ret != CURLE_WRITE_ERROR && !_cancelled)
+    {
+        // Continue with a single connection from where the in-order data ends.
+        // The normal retry logic in run() takes over from here.
+        _startOffset = static_cast<curl_off_t>(downloader.deliveredOffset());
+        qDebug() << "Segmented download failed:" << curl_easy_strerror(ret)
+                 << "- continuing with a single connection from offset" << _startOffset;
+        emit eventNetworkRetry(0, QString("error: %1; offset: %2 MB; segmented download fallback")
+                                      .arg(curl_easy_strerror(ret))
+                                      .arg(_startOffset / (1024 * 1024)));
+
+        _segmentedFallback = true;
+        curl_easy_setopt(_c, CURLOPT_RESUME_FROM_LARGE, _startOffset);
+        ret = curl_easy_perform(_c);
+    }
+
+    return true;
+}
+
+bool DownloadThread::_directDownload(CURLcode &ret)
+{
+    if (!_canReceiveDirect() || !DirectHttpReceiver::isCandidate(_url.toStdString(), _proxy.toStdString()))
+        return false;
+
+    std::vector<std::string> headers;
+    if (!_useragent.isEmpty())
+        headers.push_back("User-Agent: " + _useragent.toStdString());
+    for (const QByteArray &header : _httpHeaders)
+        headers.push_back(header.toStdString());
+
+    DirectHttpReceiver receiver(_c, _url.toStdString(), static_cast<quint64>(_startOffset), headers);
+    if (!receiver.open([this](const std::string &header) { _header(header); }))
+        return false;
+
+    _lastDlTotal = static_cast<quint64>(_startOffset) + receiver.contentLength();
+    _lastDlNow = _startOffset;
+
+    ret = receiver.run(
+        [this](size_t &capacity) { return _acquireReceiveBuffer(capacity); },
+        [this](char *buf, size_t len) {
+            if (!_commitReceiveBuffer(buf, len))
+                return false;
+            _lastDlNow += len;
+            return true;
+        },
+        [this]() { return _cancelled; });
+
+    if (ret != CURLE_OK && ret != CURLE_WRITE_ERROR && ret != CURLE_ABORTED_BY_CALLBACK && !_cancelled)
+    {
+        // Continue with a normal transfer from where the delivered data ends.
+        // The usual retry logic in run() takes over from here.
+        _startOffset = static_cast<curl_off_t>(_lastDlNow.load());
+        qDebug() << "Direct receive failed:" << curl_easy_strerror(ret)
+                 << "- continuing with curl from offset" << _startOffset;
+        emit eventNetworkRetry(0, QString("error: %1; offset: %2 MB; direct receive fallback")
+                                      .arg(curl_easy_strerror(ret))
+                                      .arg(_startOffset / (1024 * 1024)));
+
+        curl_easy_setopt(_c, CURLOPT_RESUME_FROM_LARGE, _startOffset);
+        ret = curl_easy_perform(_c);
+    }
+
+    return true;
+}
+
+char *DownloadThread::_acquireReceiveBuffer(size_t &capacity)
+{
+    capacity = 0;
+    return nullptr;
+}
+
+bool DownloadThread::_commitReceiveBuffer(char *, size_t)
+{
+    return false;
+}
+
 size_t DownloadThread::_writeData(const char *buf, size_t len)
 {
     // Abort CURL cleanly if cancelled - returning 0 triggers CURLE_WRITE_ERROR
@@ -886,15 +1187,15 @@ size_t DownloadThread::_writeData(const char *buf, size_t len)
     }
 }
 
-void DownloadThread::_writeCache(const char *buf, size_t len)
+bool DownloadThread::_writeCache(const char *buf, size_t len, WriteCompleteCallback onComplete)
 {
     if (!_cacheEnabled || _cancelled)
-        return;
+        return false;
 
     // Check if async writer exists and is still healthy
     if (!_asyncCacheWriter) {
         _cacheEnabled = false;
-        return;
+        return false;
     }
     
     // Check for async errors that may have occurred in the writer thread
@@ -904,37 +1205,43 @@ void DownloadThread::_writeCache(const char *buf, size_t len)
         // Don't call cancel() here - it can block for 5+ seconds waiting for the
         // writer thread to stop, which would stall the curl download callback.
         // Cleanup will happen in _closeFiles() or destructor.
-        return;
+        return false;
     }
 
     // Use async cache writer for non-blocking I/O
-    if (_asyncCacheWriter->isActive()) {
-        if (!_asyncCacheWriter->write(buf, len)) {
-            // write() returns false on backpressure timeout or error
-            if (_asyncCacheWriter->wasDisabledDueToBackpressure()) {
-                qDebug() << "Cache I/O too slow (backpressure). Disabling caching to avoid blocking download.";
-            } else {
-                qDebug() << "Async cache writer failed. Disabling caching.";
-            }
-            _cacheEnabled = false;
-            // Don't call cancel() here - it can block for 5+ seconds waiting for the
-            // writer thread to stop, which would stall the curl download callback.
-            // The cache writer will detect _hasError and clean up on its own, or
-            // cleanup will happen in _closeFiles() when the download completes.
+    if (!_asyncCacheWriter->isActive())
+        return false;
+
+    if (!_asyncCacheWriter->write(buf, len, std::move(onComplete))) {
+        // write() returns false on backpressure timeout or error
+        if (_asyncCacheWriter->wasDisabledDueToBackpressure()) {
+            qDebug() << "Cache I/O too slow (backpressure). Disabling caching to avoid blocking download.";
+        } else {
+            qDebug() << "Async cache writer failed. Disabling caching.";
         }
+        _cacheEnabled = false;
+        // Don't call cancel() here - it can block for 5+ seconds waiting for the
+        // writer thread to stop, which would stall the curl download callback.
+        // The cache writer will detect _hasError and clean up on its own, or
+        // cleanup will happen in _closeFiles() when the download completes.
+        return false;
     }
+    return true;
 }
 
-void DownloadThread::setCacheFile(const QString &filename, qint64 filesize)
+void DownloadThread::setCacheFile(const QString &filename, qint64 filesize, bool expanded)
 {
     _cacheFilename = filename;
+    _cacheExpanded = expanded;
 
-    // Check if a partial cache file exists for resume
+    // Check if a partial cache file exists for resume. How far the download
+    // got says nothing about a partial expanded cache, so that starts over.
     QFileInfo cacheInfo(filename);
-    bool resumeMode = cacheInfo.exists() && cacheInfo.size() > 0 && cacheInfo.size() < filesize;
+    bool resumeMode = !expanded && cacheInfo.exists() && cacheInfo.size() > 0 && cacheInfo.size() < filesize;
 
     // Create async cache writer
     _asyncCacheWriter = std::make_unique<AsyncCacheWriter>(this);
+    _asyncCacheWriter->setSparse(expanded);
 
     // Connect error signal for async error propagation from writer thread
     // Using Qt::QueuedConnection to ensure thread-safe signal delivery
@@ -962,7 +1269,8 @@ void DownloadThread::setCacheFile(const QString &filename, qint64 filesize)
     {
         _cacheEnabled = true;
         qDebug() << "Async cache writer initialized for" << filename
-                 << (resumeMode ? "(resume mode)" : "(fresh download)");
+                 << (resumeMode ? "(resume mode)" : "(fresh download)")
+                 << (expanded ? "(expanded)" : "");
     }
     else
     {
@@ -974,7 +1282,16 @@ void DownloadThread::setCacheFile(const QString &filename, qint64 filesize)
 
 void DownloadThread::_hashData(const char *buf, size_t len)
 {
-    _writehash.addData(buf, len);
+    if (_writeDigest)
+        _writeDigest->addData(buf, static_cast<int>(len));
+    if (_needImageSha256())
+        _writehash.addData(buf, len);
+}
+
+bool DownloadThread::_needImageSha256() const
+{
+    // Without a fast write digest, the SHA256 is what verify compares against
+    return !_writeDigest || !_expectedHash.isEmpty();
 }
 
 size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCallback onComplete)
@@ -986,10 +1303,10 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
 
     if (!_firstBlock)
     {
-        _writehash.addData(buf, len);
         _firstBlock = (char *) qMallocAligned(len, 4096);
         _firstBlockSize = len;
         ::memcpy(_firstBlock, buf, len);
+        _addToWriteHash(_firstBlock, len);
         qDebug() << "_writeFile: captured first block (" << len << ") and advanced file offset via seek";
         if (onComplete) onComplete();
         return (_file->Seek(len) == rpi_imager::FileError::kSuccess) ? len : 0;
@@ -1016,13 +1333,28 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
     bool useZeroCopy = useAsync && onComplete;  // Zero-copy requires completion callback
 
     // Hash computation strategy:
-    // - With async I/O: Hash inline (synchronously). Since writes return immediately
-    //   after being queued, there's no benefit to threading the hash, and it avoids
-    //   the thread spawn/wait overhead that was causing 12-14ms stalls.
+    // - With zero-copy async I/O: hand the buffer to the hash stage thread, so the
+    //   extract thread goes straight back to decompressing. The buffer is released
+    //   once both the hash and the device write have completed.
     // - Without async I/O: Use pipelined threading to overlap hash with synchronous write.
+    //   Once the hash stage runs it takes this data too, to keep the hash in order.
     if (useZeroCopy) {
-        // Inline hash for async I/O - no thread overhead
-        _writehash.addData(buf, len);
+        if (!_hashStage) {
+            _hashStage = std::make_unique<HashStage>([this](const char *data, size_t n) {
+                _hashData(data, n);
+            });
+            qDebug() << "Hashing on a dedicated hash stage thread";
+        }
+
+        auto pending = std::make_shared<std::atomic<int>>(2);
+        WriteCompleteCallback release = [pending, onComplete]() {
+            if (pending->fetch_sub(1) == 1 && onComplete)
+                onComplete();
+        };
+        _hashStage->add(buf, len, release);
+        onComplete = release;
+    } else if (_hashStage) {
+        _hashStage->add(buf, len);
     } else {
         // Pipelined hash for sync I/O - overlap with write
         if (_hasPendingHash) {
@@ -1111,7 +1443,8 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
                 bytes_written = len;
                 _bytesWritten += bytes_written;
             }
-            // Call completion callback since we're done synchronously
+            // onComplete is the hash stage's shared release here, so the
+            // caller's buffer is only freed once the stage has hashed it too
             if (onComplete) onComplete();
         }
     } else if (useAsync) {
@@ -1180,8 +1513,7 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
         } else {
             qDebug() << "Write error: FileOperations write failed with error code" << static_cast<int>(write_result) << "while writing len:" << len;
         }
-        // For sync writes, call completion immediately
-        if (onComplete) onComplete();
+        // The buffer is released below, once the pipelined hash is done with it
     }
     
     syscallMs = static_cast<quint64>(opTimer.elapsed());
@@ -1197,8 +1529,17 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
         _pendingHashFuture.waitForFinished();
         postHashWaitMs = static_cast<quint64>(opTimer.elapsed());
         _writeTimingStats.totalPostHashWaitMs.fetch_add(postHashWaitMs);
+    } else if (!useZeroCopy && _hashStage) {
+        opTimer.start();
+        _hashStage->waitForIdle();
+        postHashWaitMs = static_cast<quint64>(opTimer.elapsed());
+        _writeTimingStats.totalPostHashWaitMs.fetch_add(postHashWaitMs);
     }
 
+    // Only now may the caller reuse the buffer; a ring slot released earlier
+    // could be refilled by a prefetching reader while it is still being hashed
+    if (!useZeroCopy && onComplete) onComplete();
+
     // Calculate instantaneous throughput for sync impact analysis
     qint64 timeSinceLastWriteMs = _lastWriteTimer.elapsed();
     if (timeSinceLastWriteMs > 0 && bytes_written > 0) {
@@ -1220,6 +1561,8 @@ size_t DownloadThread::_writeFile(const char *buf, size_t len, WriteCompleteCall
     // Cross-platform periodic sync
     _periodicSync();
 
+    _advanceTrailingVerify();
+
     // Update bottleneck state for UI feedback
     _updateBottleneckState();
 
@@ -1260,8 +1603,9 @@ void DownloadThread::cancelDownload()
         _file->CancelAsyncIO();
     }
 
-    // Preserve partial cache for resume support
-    if (_cacheEnabled && _asyncCacheWriter && _asyncCacheWriter->isActive()) {
+    // Preserve partial cache for resume support. An expanded cache cannot be
+    // resumed, its writer removes the file instead.
+    if (_cacheEnabled && !_cacheExpanded && _asyncCacheWriter && _asyncCacheWriter->isActive()) {
         _asyncCacheWriter->finishPartial();
         qint64 bytesWritten = _asyncCacheWriter->bytesWritten();
         QString filePath = _asyncCacheWriter->filename();
@@ -1350,8 +1694,29 @@ uint64_t DownloadThread::verifyTotal()
 
 uint64_t DownloadThread::bytesWritten()
 {
+    /* Skipped sparse ranges never show up in the device's sector counters */
+    const uint64_t skipped = _sparseBytesSkipped + (_blockMapWriter ? _blockMapWriter->bytesSkipped() : 0);
+
+    if (_fanOut)
+    {
+        /* Report the slowest device that is still being written, devices
+           that were dropped no longer hold the progress back */
+        std::optional<uint64_t> slowest;
+        for (std::size_t i = 0; i < _fanOut->TargetCount(); ++i)
+        {
+            if (!_fanOut->IsHealthy(i) || _fanOutSectorsStart.at(i) == -1)
+                continue;
+            qint64 sectors = _sectorsWritten(QByteArray::fromStdString(_fanOut->TargetPath(i)));
+            if (sectors == -1)
+                continue;
+            uint64_t written = (uint64_t) (sectors-_fanOutSectorsStart.at(i))*512 + skipped;
+            slowest = slowest ? qMin(*slowest, written) : written;
+        }
+        return slowest ? qMin(*slowest, (uint64_t) _bytesWritten) : (uint64_t) _bytesWritten;
+    }
+
     if (_sectorsStart != -1)
-        return qMin((uint64_t) (_sectorsWritten()-_sectorsStart)*512, (uint64_t) _bytesWritten);
+        return qMin((uint64_t) (_sectorsWritten()-_sectorsStart)*512 + skipped, (uint64_t) _bytesWritten);
     else
         return _bytesWritten;
 }
@@ -1450,6 +1815,9 @@ void DownloadThread::_closeFiles()
 {
     QElapsedTimer closeTimer;
     closeTimer.start();
+
+    bool trailingReadError;
+    _finishTrailingVerify(trailingReadError);
     
     // Close unified file operations
     if (_file && _file->IsOpen()) {
@@ -1516,6 +1884,15 @@ void DownloadThread::_writeComplete()
     
     // Emit write timing statistics before any cleanup
     _emitWriteTimingStats();
+
+    if (_sparseBytesSkipped > 0)
+    {
+        qDebug() << "Sparse writes: skipped" << _sparseBytesSkipped / (1024 * 1024) << "MB of zero blocks";
+    }
+    if (_blockMapWriter && _blockMapWriter->bytesSkipped() > 0)
+    {
+        qDebug() << "Block map: skipped" << _blockMapWriter->bytesSkipped() / (1024 * 1024) << "MB of unmapped blocks";
+    }
     
     // Don't report errors if the operation was cancelled
     if (_cancelled)
@@ -1525,6 +1902,7 @@ void DownloadThread::_writeComplete()
             _pendingHashFuture.waitForFinished();
             _hasPendingHash = false;
         }
+        _stopHashStage();
         _closeFiles();
         return;
     }
@@ -1539,9 +1917,21 @@ void DownloadThread::_writeComplete()
         }
         _hasPendingHash = false;
     }
+    _waitForWriteHash();
+
+    if (_blockMapWriter && !_blockMapWriter->isComplete())
+    {
+        qDebug() << "Block map: image ended at" << _blockMapWriter->offset() << "but bmap describes" << _blockMap.imageSize() << "bytes";
+        DownloadThread::_onDownloadError(tr("Image is smaller than described by its block map (.bmap) file."));
+        _closeFiles();
+        return;
+    }
 
     QByteArray computedHash = _writehash.result().toHex();
-    qDebug() << "Hash of uncompressed image:" << computedHash;
+    if (_needImageSha256())
+        qDebug() << "Hash of uncompressed image:" << computedHash;
+    else
+        qDebug() << "Hash of uncompressed image: not computed (no expected hash to compare with)";
     if (!_expectedHash.isEmpty() && _expectedHash != computedHash)
     {
         qDebug() << "Mismatch with expected hash:" << _expectedHash;
@@ -1553,7 +1943,7 @@ void DownloadThread::_writeComplete()
         
         // Provide more specific error message based on context
         QString errorMsg;
-        if (_url.startsWith("file://") && _url.contains("lastdownload.cache"))
+        if (_url.startsWith("file://") && _url.endsWith(".cache"))
         {
             errorMsg = tr("Cached file is corrupt. SHA256 hash does not match expected value.<br>"
                          "The cache file will be removed and the download will restart.");
@@ -1608,7 +1998,7 @@ void DownloadThread::_writeComplete()
     qDebug() << "Write done in" << _timer.elapsed() / 1000 << "seconds";
 
     /* Verify */
-    if (_verifyEnabled && !_verify())
+    if (_verifyEnabled && !_verifyTargets())
     {
         _closeFiles();
         return;
@@ -1677,67 +2067,239 @@ void DownloadThread::_writeComplete()
 
     if (_ejectEnabled)
     {
-        // Use canonical device path for eject (e.g., /dev/disk on macOS, not rdisk)
-        QString ejectPath = PlatformQuirks::getEjectDevicePath(_filename);
-        eject_disk(ejectPath.toLocal8Bit().constData());
+        QList<QByteArray> devices;
+        if (_fanOut)
+        {
+            for (std::size_t i = 0; i < _fanOut->TargetCount(); ++i)
+            {
+                if (_fanOut->IsHealthy(i))
+                    devices.append(QByteArray::fromStdString(_fanOut->TargetPath(i)));
+            }
+        }
+        else
+        {
+            devices.append(_filename);
+        }
+
+        for (const QByteArray &device : devices)
+        {
+            // Use canonical device path for eject (e.g., /dev/disk on macOS, not rdisk)
+            QString ejectPath = PlatformQuirks::getEjectDevicePath(device);
+            eject_disk(ejectPath.toLocal8Bit().constData());
+        }
+    }
+}
+
+bool DownloadThread::_verifyTargets()
+{
+    if (!_fanOut)
+        return _verify();
+
+    /* Each device gets its own verify pass. Reads go to the active target,
+       and the write position of all targets is restored before every pass
+       so _verify() sees the same image size each time. */
+    const std::uint64_t imageEnd = _file->Tell();
+    for (std::size_t i = 0; i < _fanOut->TargetCount() && !_cancelled; ++i)
+    {
+        if (!_fanOut->IsHealthy(i))
+            continue;
+
+        qDebug() << "Fan-out: verifying" << QString::fromStdString(_fanOut->TargetPath(i));
+        _fanOut->SetActiveTarget(i);
+        _file->Seek(imageEnd);
+        _verifyhash->reset();
+
+        // A failing device is dropped by _onTargetError(), unless it was the last one
+        if (!_verify() && _cancelled)
+            return false;
     }
+
+    return true;
 }
 
 bool DownloadThread::_verify()
 {
-    _lastVerifyNow = 0;
-    _verifyTotal = _file->Tell();
+    bool trailingReadError = false;
+    const std::uint64_t trailingEnd = _finishTrailingVerify(trailingReadError);
+    if (trailingReadError)
+    {
+        _onTargetError(tr("Error reading from storage.<br>"
+                       "SD card may be broken."));
+        return false;
+    }
+
+    /* Without a block map the image is read back in one range and hashed as a whole.
+       With one only the mapped ranges were written, each of them is compared with
+       the digest taken while writing it. */
+    QVector<BlockMap::Range> ranges;
+    std::unique_ptr<QCryptographicHash> rangeHash;
+    QVector<QByteArray> rangeDigests;
+    if (_blockMapWriter)
+    {
+        ranges = _blockMap.ranges();
+        rangeHash = std::make_unique<QCryptographicHash>(_blockMap.checksumAlgorithm());
+        rangeDigests.reserve(ranges.size());
+        _verifyTotal = _blockMap.mappedBytes();
+    }
+    else
+    {
+        // _verifyhash already covers the first block and everything up to trailingEnd
+        _verifyTotal = _file->Tell();
+        ranges.append({trailingEnd, _verifyTotal - trailingEnd, QByteArray()});
+    }
+    _lastVerifyNow = trailingEnd;
     
-    // Use adaptive buffer size based on file size and system memory for optimal verification performance
-    size_t verifyBufferSize = SystemMemoryManager::instance().getAdaptiveVerifyBufferSize(_verifyTotal);
-    char *verifyBuf = (char *) qMallocAligned(verifyBufferSize, 4096);
+    // Reads and hashing are pipelined: this thread reads the device into a ring of
+    // aligned buffers while a second thread hashes the filled ones, so device reads
+    // and hashing overlap instead of taking turns.
+    SystemMemoryManager::VerifyPipelineConfiguration pipeline =
+        SystemMemoryManager::instance().calculateVerifyPipelineConfiguration(_verifyTotal);
+    RingBuffer verifyRing(pipeline.bufferCount, pipeline.bufferSize);
     
     QElapsedTimer t1;
     t1.start();
     
-    qDebug() << "Post-write verification using" << verifyBufferSize/1024 << "KB buffer for" 
-             << _verifyTotal/(1024*1024) << "MB image";
+    qDebug() << "Post-write verification using" << pipeline.bufferCount << "x" << pipeline.bufferSize/1024
+             << "KB buffers (read-ahead depth" << pipeline.readAheadDepth << ") for"
+             << _verifyTotal/(1024*1024) << "MB in" << ranges.size() << (rangeHash ? "mapped ranges" : "range");
+    if (trailingEnd)
+    {
+        qDebug() << "Trailing verify covered" << trailingEnd/(1024*1024) << "MB, reading the remaining"
+                 << (_verifyTotal - trailingEnd)/(1024*1024) << "MB";
+    }
 
     // Platform-specific optimization for sequential read verification
     // Invalidates cache and enables read-ahead hints
-    _file->PrepareForSequentialRead(0, _verifyTotal);
-
-    if (!_firstBlock)
-    {
-        _file->Seek(0);
-    }
-    else
+    if (!ranges.isEmpty())
     {
-        _verifyhash.addData(_firstBlock, _firstBlockSize);
-        _file->Seek(_firstBlockSize);
-        _lastVerifyNow += _firstBlockSize;
+        const std::uint64_t readStart = ranges.first().offset;
+        _file->PrepareForSequentialRead(readStart, ranges.last().offset + ranges.last().length - readStart);
     }
 
-    while (_verifyEnabled && _lastVerifyNow < _verifyTotal && !_cancelled)
+    // Buffers are handed over in read order and never span two ranges, so hashing stays sequential
+    QFuture<void> hasher = QtConcurrent::run([this, &verifyRing, &ranges, &rangeHash, &rangeDigests]() {
+        qsizetype range = 0;
+        quint64 rangeLeft = ranges.isEmpty() ? 0 : ranges.first().length;
+        while (RingBuffer::Slot *slot = verifyRing.acquireReadSlot())
+        {
+            if (!rangeHash)
+            {
+                _verifyhash->addData(slot->data, static_cast<int>(slot->size));
+            }
+            else
+            {
+                rangeHash->addData(QByteArrayView(slot->data, static_cast<qsizetype>(slot->size)));
+                rangeLeft -= slot->size;
+                if (!rangeLeft)
+                {
+                    rangeDigests.append(rangeHash->result().toHex());
+                    rangeHash->reset();
+                    if (++range < ranges.size())
+                        rangeLeft = ranges.at(range).length;
+                }
+            }
+            verifyRing.releaseReadSlot(slot);
+        }
+    });
+
+    bool readError = false;
+    qsizetype range = 0;
+    quint64 pos = ranges.isEmpty() ? 0 : ranges.first().offset;
+    bool seekNeeded = true;
+    while (_verifyEnabled && range < ranges.size() && !_cancelled)
     {
-        size_t bytes_to_read = qMin((qint64) verifyBufferSize, (qint64) (_verifyTotal-_lastVerifyNow));
+        const quint64 end = ranges.at(range).offset + ranges.at(range).length;
+        if (pos == end)
+        {
+            if (++range < ranges.size())
+            {
+                seekNeeded = seekNeeded || pos != ranges.at(range).offset;
+                pos = ranges.at(range).offset;
+            }
+            continue;
+        }
+
+        RingBuffer::Slot *slot = verifyRing.acquireWriteSlot(100);
+        if (!slot)
+            continue;
+
+        size_t bytes_to_read = static_cast<size_t>(qMin(static_cast<quint64>(slot->capacity), end - pos));
         size_t lenRead = 0;
-        rpi_imager::FileError read_result = _file->ReadSequential(reinterpret_cast<std::uint8_t*>(verifyBuf), bytes_to_read, lenRead);
-        if (read_result != rpi_imager::FileError::kSuccess)
+        if (_firstBlock && pos < _firstBlockSize)
         {
-            DownloadThread::_onDownloadError(tr("Error reading from storage.<br>"
-                                                "SD card may be broken."));
-            qFreeAligned(verifyBuf);
-            return false;
+            // The first block is only written after verification, compare our copy of it
+            lenRead = qMin(bytes_to_read, static_cast<size_t>(_firstBlockSize - pos));
+            memcpy(slot->data, _firstBlock + pos, lenRead);
+            seekNeeded = true;
+        }
+        else
+        {
+            rpi_imager::FileError read_result = rpi_imager::FileError::kSuccess;
+            if (seekNeeded)
+            {
+                read_result = _file->Seek(pos);
+                seekNeeded = false;
+            }
+            if (read_result == rpi_imager::FileError::kSuccess)
+                read_result = _file->ReadSequential(reinterpret_cast<std::uint8_t*>(slot->data), bytes_to_read, lenRead);
+            if (read_result != rpi_imager::FileError::kSuccess || !lenRead)
+            {
+                verifyRing.commitWriteSlot(slot, 0);
+                readError = true;
+                break;
+            }
         }
 
-        _verifyhash.addData(verifyBuf, static_cast<qint64>(lenRead));
+        verifyRing.commitWriteSlot(slot, lenRead);
+        pos += lenRead;
         _lastVerifyNow += static_cast<qint64>(lenRead);
         
         // Allow subclasses to emit progress updates
         _onVerifyProgress();
     }
-    qFreeAligned(verifyBuf);
 
-    qDebug() << "Verify hash:" << _verifyhash.result().toHex();
+    if (readError)
+        verifyRing.cancel();
+    else
+        verifyRing.producerDone();
+    hasher.waitForFinished();
+
+    uint64_t readerStalls, hasherStalls, readerWaitMs, hasherWaitMs;
+    verifyRing.getStarvationStats(readerStalls, hasherStalls, readerWaitMs, hasherWaitMs);
+    qDebug() << "Verify pipeline: reader waited" << readerWaitMs << "ms for the hasher,"
+             << "hasher waited" << hasherWaitMs << "ms for reads";
+
+    if (readError)
+    {
+        _onTargetError(tr("Error reading from storage.<br>"
+                       "SD card may be broken."));
+        return false;
+    }
+
+    bool matches = true;
+    if (rangeHash)
+    {
+        const QVector<QByteArray> &writtenDigests = _blockMapWriter->digests();
+        for (qsizetype i = 0; i < rangeDigests.size() && matches; i++)
+        {
+            if (rangeDigests.at(i) != writtenDigests.value(i))
+            {
+                qDebug() << "Verify mismatch in mapped range at offset" << ranges.at(i).offset;
+                matches = false;
+            }
+        }
+        matches = matches && rangeDigests.size() == ranges.size();
+    }
+    else
+    {
+        const QByteArray writtenDigest = _writeDigest ? _writeDigest->result() : _writehash.result();
+        qDebug() << "Verify hash:" << _verifyhash->result().toHex()
+                 << "using" << VerifyDigest::algorithmName(_verifyhash->algorithm());
+        matches = _verifyhash->result() == writtenDigest;
+    }
     qDebug() << "Verify done in" << t1.elapsed() / 1000.0 << "seconds";
 
-    if (_verifyhash.result() == _writehash.result() || !_verifyEnabled || _cancelled)
+    if (matches || !_verifyEnabled || _cancelled)
     {
         emit eventVerify(static_cast<quint32>(t1.elapsed()), true);
         return true;
@@ -1745,10 +2307,393 @@ bool DownloadThread::_verify()
     else
     {
         emit eventVerify(static_cast<quint32>(t1.elapsed()), false);
-        DownloadThread::_onDownloadError(tr("Verifying write failed. Contents of SD card is different from what was written to it."));
+        _onTargetError(tr("Verifying write failed. Contents of SD card is different from what was written to it."));
+    }
+
+    return false;
+}
+
+void DownloadThread::_advanceTrailingVerify()
+{
+    if (!_debugTrailingVerify || !_verifyEnabled || !_firstBlock || _cancelled)
+        return;
+
+    const std::uint64_t pos = _file->Tell();
+    if (pos < _trailingVerifyCheckpoint + TRAILING_VERIFY_CHECKPOINT_BYTES)
+        return;
+    _trailingVerifyCheckpoint = pos;
+
+    if (!_trailingVerifier && !_startTrailingVerify())
+    {
+        _debugTrailingVerify = false;
+        return;
+    }
+
+    // Everything before pos has to be on the device before it can be read back:
+    // with direct I/O that means no write still in flight, otherwise a flush
+    rpi_imager::FileError result = _file->IsDirectIOEnabled() ? _file->WaitForPendingWrites() : _file->Flush();
+    if (result == rpi_imager::FileError::kSuccess)
+        _trailingVerifier->setSafeEnd(pos);
+}
+
+bool DownloadThread::_startTrailingVerify()
+{
+    if (_fanOut || _blockMapWriter || _firstBlockSize % 4096 != 0)
+    {
+        qDebug() << "Trailing verify not used for this write; verifying after the write instead";
+        return false;
+    }
+
+#ifdef Q_OS_LINUX
+    /* A read-only handle of its own, so reads neither move the write position
+       nor come from the page cache */
+    _trailingVerifyFd = ::open(_filename.constData(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (_trailingVerifyFd < 0)
+    {
+        qDebug() << "Trailing verify: cannot open" << _filename << "for reading:" << strerror(errno);
+        return false;
     }
 
+    const int fd = _trailingVerifyFd;
+    auto read = [fd](std::uint64_t offset, char *buf, std::size_t len) {
+        std::size_t done = 0;
+        while (done < len)
+        {
+            ssize_t n = ::pread(fd, buf + done, len - done, static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            done += static_cast<std::size_t>(n);
+        }
+        return true;
+    };
+
+    // The first block is only written at the very end; hash it from memory like _verify() does
+    _verifyhash->reset();
+    _verifyhash->addData(_firstBlock, _firstBlockSize);
+    _trailingVerifier = std::make_unique<TrailingVerifier>(
+        _firstBlockSize, TRAILING_VERIFY_CHUNK_SIZE, read,
+        [this](const char *data, std::size_t len) { _verifyhash->addData(data, static_cast<int>(len)); });
+
+    qDebug() << "Trailing verify started behind the write cursor";
+    return true;
+#else
+    qDebug() << "Trailing verify is not available on this platform";
     return false;
+#endif
+}
+
+std::uint64_t DownloadThread::_finishTrailingVerify(bool &readError)
+{
+    readError = false;
+    if (!_trailingVerifier)
+        return 0;
+
+    std::uint64_t end = _trailingVerifier->finish();
+    readError = _trailingVerifier->failed();
+    qDebug() << "Trailing verify: read back" << (end - _firstBlockSize)/(1024*1024) << "MB during the write in"
+             << _trailingVerifier->busyMs() << "ms" << (readError ? "before a read error" : "");
+    _trailingVerifier.reset();
+
+    if (_trailingVerifyFd >= 0)
+    {
+        ::close(_trailingVerifyFd);
+        _trailingVerifyFd = -1;
+    }
+
+    // Nothing read yet: the normal pass starts from scratch
+    if (end <= _firstBlockSize)
+    {
+        _verifyhash->reset();
+        return 0;
+    }
+    return end;
+}
+
+bool DownloadThread::_probeZeroRange()
+{
+    /* Offloaded zeroing is advertised by the device (write_zeroes_max_bytes) or,
+       for image files, probed with a hole punch past the end of the file */
+    if (!_file->HasFastZeroRange())
+    {
+        qDebug() << "Sparse writes: disabled, target cannot zero ranges without writing them";
+        return false;
+    }
+
+    /* Some USB bridges advertise WRITE ZEROES and then fail it. The first
+       block is zeroed along with the first MB next anyway, so try it there */
+    std::uint64_t size = 0;
+    if (_file->GetSize(size) == rpi_imager::FileError::kSuccess && size >= 4096
+        && _file->ZeroRange(0, 4096) != rpi_imager::FileError::kSuccess)
+    {
+        qDebug() << "Sparse writes: disabled, zeroing the first block failed";
+        return false;
+    }
+
+    qDebug() << "Sparse writes: zeroing skipped ranges with" << (_filename.startsWith("/dev/") ? "BLKZEROOUT" : "hole punching");
+    return true;
+}
+
+bool DownloadThread::_canSkipSparse() const
+{
+    // The first block is held back and written last, so only ranges after it
+    // can be skipped without disturbing that bookkeeping
+    return _sparseWriteMode != SparseWriteMode::Disabled && _firstBlock && !_cancelled;
+}
+
+void DownloadThread::_addToWriteHash(const char *buf, size_t len, WriteCompleteCallback onHashed)
+{
+    if (_hashStage)
+    {
+        _hashStage->add(buf, len, std::move(onHashed));
+        return;
+    }
+
+    _hashData(buf, len);
+    if (onHashed)
+        onHashed();
+}
+
+void DownloadThread::_waitForWriteHash()
+{
+    if (!_hashStage)
+        return;
+
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+    _hashStage->waitForIdle();
+    qDebug() << "Hash stage: hashed for" << _hashStage->busyMs() << "ms, final wait"
+             << waitTimer.elapsed() << "ms";
+}
+
+void DownloadThread::_stopHashStage()
+{
+    if (_hashStage)
+        _hashStage->stop();
+}
+
+bool DownloadThread::_skipSparseRange(quint64 len)
+{
+    if (len == 0)
+        return true;
+
+    if (!_canSkipSparse())
+        return false;
+
+    std::uint64_t offset = _file->Tell();
+
+    if (_sparseWriteMode == SparseWriteMode::ZeroRange
+        && _file->ZeroRange(offset, len) != rpi_imager::FileError::kSuccess)
+    {
+        qDebug() << "ZeroRange failed at offset" << offset << "- falling back to writing zeros";
+        _sparseWriteMode = SparseWriteMode::Disabled;
+        return false;
+    }
+
+    if (_file->SkipSequential(len) != rpi_imager::FileError::kSuccess)
+    {
+        qDebug() << "Failed to skip sparse range at offset" << offset;
+        return false;
+    }
+
+    // The write hash covers the full image, including the ranges we did not write
+    if (_hashStage)
+    {
+        _hashStage->addZeros(len);
+    }
+    else
+    {
+        static const QByteArray zeros(1024 * 1024, '\0');
+        quint64 remaining = len;
+        while (remaining > 0)
+        {
+            int chunk = static_cast<int>(qMin(remaining, static_cast<quint64>(zeros.size())));
+            _hashData(zeros.constData(), static_cast<size_t>(chunk));
+            remaining -= chunk;
+        }
+    }
+
+    _bytesWritten += len;
+    _sparseBytesSkipped += len;
+
+    _updateBottleneckState();
+    _logWriteProgress();
+
+    return true;
+}
+
+// bmap files are small XML documents, anything this big is not one
+static const qsizetype MAX_BMAP_SIZE = 16 * 1024 * 1024;
+
+static size_t _appendToByteArray(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    auto *buffer = static_cast<QByteArray*>(userdata);
+    size_t len = size * nmemb;
+    if (buffer->size() + static_cast<qsizetype>(len) > MAX_BMAP_SIZE)
+        return 0;
+    buffer->append(ptr, static_cast<qsizetype>(len));
+    return len;
+}
+
+QByteArray DownloadThread::_fetchBlockMapSource(const QByteArray &source)
+{
+    QByteArray data;
+
+    if (source.startsWith("archive:"))
+    {
+        QUrl url(QString::fromUtf8(source));
+        ArchiveEntryIODevice entry(url.path(), url.fragment());
+        if (entry.open(QIODevice::ReadOnly))
+            data = entry.read(MAX_BMAP_SIZE);
+        return data;
+    }
+
+    if (source.startsWith("file:"))
+    {
+        QFile f(QUrl(QString::fromUtf8(source)).toLocalFile());
+        if (f.open(QIODevice::ReadOnly))
+            data = f.read(MAX_BMAP_SIZE);
+        return data;
+    }
+
+    char errorBuf[CURL_ERROR_SIZE] = {0};
+    CURL *c = curl_easy_init();
+    if (!c)
+        return data;
+
+    CurlNetworkConfig::instance().applyCurlSettings(c, CurlNetworkConfig::FetchProfile::SmallFile, errorBuf);
+    curl_easy_setopt(c, CURLOPT_URL, source.constData());
+    curl_easy_setopt(c, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, &_appendToByteArray);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, &data);
+    if (_debugIPv4Only)
+        curl_easy_setopt(c, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+    if (!_useragent.isEmpty())
+        curl_easy_setopt(c, CURLOPT_USERAGENT, _useragent.constData());
+
+    // Private release assets need the same credentials as the image itself
+    struct curl_slist *headers = nullptr;
+    if (QUrl(QString::fromUtf8(source)).host() == QUrl(QString::fromUtf8(_url)).host())
+    {
+        for (const QByteArray &header : std::as_const(_httpHeaders))
+        {
+            if (header.startsWith("Authorization:"))
+                headers = curl_slist_append(headers, header.constData());
+        }
+        if (headers)
+            curl_easy_setopt(c, CURLOPT_HTTPHEADER, headers);
+    }
+
+    CURLcode res = curl_easy_perform(c);
+    if (res != CURLE_OK)
+    {
+        qDebug() << "No block map at" << source << "-" << (errorBuf[0] ? errorBuf : curl_easy_strerror(res));
+        data.clear();
+    }
+
+    curl_easy_cleanup(c);
+    if (headers)
+        curl_slist_free_all(headers);
+
+    return data;
+}
+
+bool DownloadThread::_fetchBlockMap()
+{
+    for (const QByteArray &source : std::as_const(_blockMapSources))
+    {
+        if (_cancelled)
+            return false;
+
+        QByteArray xml = _fetchBlockMapSource(source);
+        if (xml.isEmpty())
+            continue;
+
+        QString parseError;
+        BlockMap map = BlockMap::parse(xml, &parseError);
+        if (!map.isValid())
+        {
+            qDebug() << "Ignoring block map" << source << "-" << parseError;
+            continue;
+        }
+
+        // The image size may only be known from the archive header, _startBlockMap() checks it again
+        quint64 extractTotal = _extractTotal.load();
+        if (extractTotal && extractTotal != map.imageSize())
+        {
+            qDebug() << "Ignoring block map" << source << "- describes a" << map.imageSize()
+                     << "byte image, expected" << extractTotal;
+            continue;
+        }
+
+        qDebug() << "Fetched block map" << source;
+        _blockMap = map;
+        return true;
+    }
+
+    return false;
+}
+
+bool DownloadThread::_startBlockMap()
+{
+    if (!_blockMap.isValid())
+        return false;
+
+    quint64 extractTotal = _extractTotal.load();
+    if (extractTotal && extractTotal != _blockMap.imageSize())
+    {
+        qDebug() << "Ignoring block map - describes a" << _blockMap.imageSize()
+                 << "byte image, expected" << extractTotal;
+        return false;
+    }
+
+    _blockMapWriter = std::make_unique<BlockMapWriter>(_blockMap);
+
+    qDebug() << "Using block map:" << _blockMap.ranges().size() << "ranges,"
+             << _blockMap.mappedBytes() / (1024 * 1024) << "MB mapped of"
+             << _blockMap.imageSize() / (1024 * 1024) << "MB image";
+    return true;
+}
+
+size_t DownloadThread::_writeMappedFile(const char *buf, size_t len, WriteCompleteCallback onComplete)
+{
+    if (!_blockMapWriter || _cancelled)
+        return _writeFile(buf, len, onComplete);
+
+    // The buffer may end up split over several writes, so only hand it
+    // back to the caller once the last of them has completed
+    auto pending = std::make_shared<std::atomic<int>>(1);
+    WriteCompleteCallback release = [pending, onComplete]() {
+        if (pending->fetch_sub(1) == 1 && onComplete)
+            onComplete();
+    };
+    auto writeSpan = [&](const char *data, size_t spanLen) {
+        pending->fetch_add(1);
+        return _writeFile(data, spanLen, release) > 0;
+    };
+    auto skipSpan = [&](const char *data, size_t spanLen) {
+        // Unmapped data is not written, but is part of the image hash
+        pending->fetch_add(1);
+        _addToWriteHash(data, spanLen, release);
+        if (_file->SkipSequential(spanLen) != rpi_imager::FileError::kSuccess)
+            return false;
+
+        _bytesWritten += spanLen;
+        _updateBottleneckState();
+        _logWriteProgress();
+        return true;
+    };
+
+    /* The first block is held back and written last, so it is always written in full */
+    BlockMapWriter::Result result = _blockMapWriter->write(buf, len, writeSpan,
+        _firstBlock ? BlockMapWriter::SpanFunction(skipSpan) : BlockMapWriter::SpanFunction());
+    release();
+
+    if (result == BlockMapWriter::Result::ChecksumMismatch)
+        _onDownloadError(tr("Image does not match its block map (.bmap) file. Checksum mismatch at offset %1.").arg(_blockMapWriter->mismatchOffset()));
+
+    return result == BlockMapWriter::Result::Ok ? len : 0;
 }
 
 void DownloadThread::_updateBottleneckState()
@@ -1824,7 +2769,20 @@ void DownloadThread::_updateBottleneckState()
 
 void DownloadThread::_initializeSyncConfiguration()
 {
-    _syncConfig = SystemMemoryManager::instance().calculateSyncConfiguration();
+    SystemMemoryManager &memMgr = SystemMemoryManager::instance();
+    _syncConfig = memMgr.calculateSyncConfiguration();
+
+    /* The memory tier only bounds the range size now; within it the governor
+       sizes ranges from the measured drain rate. Dirty data is kept under
+       the kernel's default background writeback threshold, 10% of available
+       memory, so the writer is not throttled in balance_dirty_pages() */
+    rpi_imager::PageCacheSyncGovernor::Limits limits;
+    limits.max_range_bytes = static_cast<std::uint64_t>(_syncConfig.syncIntervalBytes);
+    limits.min_range_bytes = qMin<std::uint64_t>(limits.min_range_bytes, limits.max_range_bytes);
+    limits.initial_range_bytes = qMin<std::uint64_t>(limits.initial_range_bytes, limits.max_range_bytes);
+    limits.max_interval = std::chrono::milliseconds(_syncConfig.syncIntervalMs);
+    limits.dirty_limit_bytes = static_cast<std::uint64_t>(memMgr.getAvailableMemoryMB()) * 1024 * 1024 / 10;
+    _syncGovernor = std::make_unique<rpi_imager::PageCacheSyncGovernor>(limits);
 }
 
 void DownloadThread::_periodicSync()
@@ -1846,57 +2804,86 @@ void DownloadThread::_periodicSync()
     qint64 currentBytes = _bytesWritten;
     qint64 bytesSinceLastSync = currentBytes - _lastSyncBytes;
     qint64 timeSinceLastSync = _lastSyncTime.elapsed();
-    
-    // Sync if we've written more than the configured sync interval
-    // OR if it's been more than the time interval since last sync
-    // AND we've written at least some data since last sync
-    if ((bytesSinceLastSync >= _syncConfig.syncIntervalBytes || 
-         (timeSinceLastSync >= _syncConfig.syncIntervalMs && bytesSinceLastSync > 0)) &&
-        !_cancelled)
-    {
-        QElapsedTimer syncTimer;
-        syncTimer.start();
-        
-        qDebug() << "Performing periodic sync at" << currentBytes << "bytes written"
-                 << "(" << bytesSinceLastSync << "bytes since last sync,"
-                 << timeSinceLastSync << "ms elapsed)"
-                 << "on" << SystemMemoryManager::instance().getPlatformName();
-        
+    if (bytesSinceLastSync <= 0 || _cancelled)
+        return;
+
+    SystemMemoryManager::PageCacheState state = SystemMemoryManager::instance().getPageCacheState();
+    rpi_imager::PageCacheSyncGovernor::Sample sample;
+    sample.dirty_bytes = state.dirtyBytes;
+    sample.writeback_bytes = state.writebackBytes;
+    sample.memory_pressure = state.memoryPressure;
+
+    rpi_imager::PageCacheSyncGovernor::Decision decision = _syncGovernor->Check(
+        static_cast<std::uint64_t>(bytesSinceLastSync), std::chrono::milliseconds(timeSinceLastSync), sample);
+    if (!decision.sync)
+        return;
+
+    QElapsedTimer syncTimer;
+    syncTimer.start();
+
+    qDebug() << "Performing periodic sync at" << currentBytes << "bytes written"
+             << "(" << bytesSinceLastSync << "bytes since last sync,"
+             << timeSinceLastSync << "ms elapsed, reason:" << decision.reason
+             << ", range" << (decision.range_bytes / 1024 / 1024) << "MB)"
+             << "on" << SystemMemoryManager::instance().getPlatformName();
+
+    const char *failure = nullptr;
+    if (_file->CanControlWriteback()) {
+        /* Start writeback of what was written since the last sync and wait for
+           the range before it, so about two ranges are dirty at most. The wait
+           only blocks while the device is behind the writer. Async writes that
+           have not completed yet are picked up by the next range's wait */
+        std::uint64_t end = _file->Tell();
+        if (end > _writebackEnd &&
+            _file->StartWriteback(_writebackEnd, end - _writebackEnd) != rpi_imager::FileError::kSuccess) {
+            failure = "StartWriteback()";
+        } else if (_writebackBytes > 0 &&
+                   _file->WaitForWriteback(_writebackStart, _writebackEnd - _writebackStart) != rpi_imager::FileError::kSuccess) {
+            failure = "WaitForWriteback()";
+        } else {
+            if (_writebackBytes > 0) {
+                _syncGovernor->RecordDrain(static_cast<std::uint64_t>(_writebackBytes),
+                                           std::chrono::microseconds(_writebackTimer.nsecsElapsed() / 1000));
+            }
+            _writebackStart = _writebackEnd;
+            _writebackEnd = qMax(end, _writebackEnd);
+            _writebackBytes = bytesSinceLastSync;
+            _writebackTimer.start();
+        }
+    } else {
         // Use unified FileOperations for flushing and syncing
         if (_file->Flush() != rpi_imager::FileError::kSuccess) {
-            quint64 syncMs = static_cast<quint64>(syncTimer.elapsed());
-            _writeTimingStats.totalSyncMs.fetch_add(syncMs);
-            _writeTimingStats.syncCount.fetch_add(1);
-            emit eventPeriodicSync(static_cast<quint32>(syncMs), false, currentBytes);
-            qDebug() << "Warning: Flush() failed during periodic sync";
-            return;
-        }
-        
-        // Force filesystem sync using unified FileOperations
-        if (_file->ForceSync() != rpi_imager::FileError::kSuccess) {
-            quint64 syncMs = static_cast<quint64>(syncTimer.elapsed());
-            _writeTimingStats.totalSyncMs.fetch_add(syncMs);
-            _writeTimingStats.syncCount.fetch_add(1);
-            emit eventPeriodicSync(static_cast<quint32>(syncMs), false, currentBytes);
-            qDebug() << "Warning: ForceSync() failed during periodic sync";
-            return;
+            failure = "Flush()";
+        } else if (_file->ForceSync() != rpi_imager::FileError::kSuccess) {
+            failure = "ForceSync()";
+        } else {
+            // Everything written since the last sync has drained by now
+            _syncGovernor->RecordDrain(static_cast<std::uint64_t>(bytesSinceLastSync),
+                                       std::chrono::milliseconds(qMax<qint64>(timeSinceLastSync, syncTimer.elapsed())));
         }
-        
-        quint64 syncMs = static_cast<quint64>(syncTimer.elapsed());
-        _writeTimingStats.totalSyncMs.fetch_add(syncMs);
-        _writeTimingStats.syncCount.fetch_add(1);
-        
-        // Track the next 5 writes after this sync to measure post-sync throughput impact
-        _writeTimingStats.writesUntilNextSync.store(5);
-        
-        emit eventPeriodicSync(static_cast<quint32>(syncMs), true, currentBytes);
-        
-        // Update tracking variables
-        _lastSyncBytes = currentBytes;
-        _lastSyncTime.restart();
-        
-        qDebug() << "Periodic sync completed successfully in" << syncMs << "ms";
     }
+
+    quint64 syncMs = static_cast<quint64>(syncTimer.elapsed());
+    _writeTimingStats.totalSyncMs.fetch_add(syncMs);
+    _writeTimingStats.syncCount.fetch_add(1);
+
+    if (failure) {
+        emit eventPeriodicSync(static_cast<quint32>(syncMs), false, currentBytes);
+        qDebug() << "Warning:" << failure << "failed during periodic sync";
+        return;
+    }
+
+    // Track the next 5 writes after this sync to measure post-sync throughput impact
+    _writeTimingStats.writesUntilNextSync.store(5);
+
+    emit eventPeriodicSync(static_cast<quint32>(syncMs), true, currentBytes);
+
+    // Update tracking variables
+    _lastSyncBytes = currentBytes;
+    _lastSyncTime.restart();
+
+    qDebug() << "Periodic sync completed successfully in" << syncMs << "ms"
+             << "(device drain rate" << static_cast<qint64>(_syncGovernor->DrainRate() / 1024) << "KB/s)";
 }
 
 void DownloadThread::_logWriteProgress()
@@ -1997,6 +2984,31 @@ void DownloadThread::setVerifyEnabled(bool verify)
     _verifyEnabled = verify;
 }
 
+void DownloadThread::setVerifyDigest(VerifyDigest::Algorithm algorithm)
+{
+    _verifyhash = std::make_unique<VerifyDigest>(algorithm);
+    if (algorithm == VerifyDigest::Algorithm::Sha256)
+        _writeDigest.reset();
+    else
+        _writeDigest = std::make_unique<VerifyDigest>(algorithm);
+    qDebug() << "DownloadThread: Verify digest" << VerifyDigest::algorithmName(algorithm);
+}
+
+void DownloadThread::setDownloadSize(quint64 size)
+{
+    _downloadSize = size;
+}
+
+void DownloadThread::setBlockMapSources(const QList<QByteArray> &sources)
+{
+    _blockMapSources = sources;
+}
+
+void DownloadThread::setAdditionalTargets(const QList<QByteArray> &devices)
+{
+    _additionalTargets = devices;
+}
+
 bool DownloadThread::isImage()
 {
     return true;
@@ -2014,12 +3026,17 @@ void DownloadThread::setInputBufferSize(int len)
 }
 
 qint64 DownloadThread::_sectorsWritten()
+{
+    return _sectorsWritten(_filename);
+}
+
+qint64 DownloadThread::_sectorsWritten(const QByteArray &device)
 {
 #ifdef Q_OS_LINUX
-    if (!_filename.startsWith("/dev/"))
+    if (!device.startsWith("/dev/"))
         return -1;
 
-    QFile f("/sys/class/block/"+_filename.mid(5)+"/stat");
+    QFile f("/sys/class/block/"+device.mid(5)+"/stat");
     if (!f.open(f.ReadOnly))
         return -1;
     QByteArray ioline = f.readAll().simplified();
@@ -2087,6 +3104,12 @@ void DownloadThread::setDebugSkipEndOfDevice(bool enabled)
     qDebug() << "DownloadThread: Skip end-of-device operations" << (enabled ? "enabled (for counterfeit cards)" : "disabled");
 }
 
+void DownloadThread::setDebugTrailingVerify(bool enabled)
+{
+    _debugTrailingVerify = enabled;
+    qDebug() << "DownloadThread: Trailing verify" << (enabled ? "enabled" : "disabled");
+}
+
 bool DownloadThread::_customizeImage()
 {
     emit preparationStatusUpdate(tr("Customising OS..."));
@@ -2296,20 +3319,10 @@ bool DownloadThread::_createSecureBootFiles(DeviceWrapperFatPartition *fat)
     qDebug() << "DownloadThread:" << bootFiles.size() << "boot files," 
              << customFiles.size() << "customization files";
 
-    // Create temporary directory for boot.img and boot.sig
-    QTemporaryDir tempDir;
-    if (!tempDir.isValid()) {
-        qDebug() << "DownloadThread: failed to create temp directory";
-        emit error(tr("Failed to create temporary directory"));
-        return false;
-    }
-
-    QString bootImgPath = tempDir.path() + "/boot.img";
-    QString bootSigPath = tempDir.path() + "/boot.sig";
-
     // Create boot.img (only with boot files, not customization files)
     emit preparationStatusUpdate(tr("Creating boot.img..."));
-    if (!SecureBoot::createBootImg(bootFiles, bootImgPath)) {
+    QByteArray bootImgData = SecureBoot::buildBootImg(bootFiles);
+    if (bootImgData.isEmpty()) {
         qDebug() << "DownloadThread: failed to create boot.img";
         emit error(tr("Failed to create boot.img"));
         return false;
@@ -2317,31 +3330,13 @@ bool DownloadThread::_createSecureBootFiles(DeviceWrapperFatPartition *fat)
 
     // Generate boot.sig
     emit preparationStatusUpdate(tr("Signing boot image..."));
-    if (!SecureBoot::generateBootSig(bootImgPath, rsaKeyPath, bootSigPath)) {
+    QByteArray bootSigData = SecureBoot::bootSig(bootImgData, rsaKeyPath);
+    if (bootSigData.isEmpty()) {
         qDebug() << "DownloadThread: failed to generate boot.sig";
         emit error(tr("Failed to generate boot.sig"));
         return false;
     }
 
-    // Read boot.img and boot.sig
-    QFile bootImgFile(bootImgPath);
-    if (!bootImgFile.open(QIODevice::ReadOnly)) {
-        qDebug() << "DownloadThread: failed to read boot.img";
-        emit error(tr("Failed to read boot.img"));
-        return false;
-    }
-    QByteArray bootImgData = bootImgFile.readAll();
-    bootImgFile.close();
-
-    QFile bootSigFile(bootSigPath);
-    if (!bootSigFile.open(QIODevice::ReadOnly)) {
-        qDebug() << "DownloadThread: failed to read boot.sig";
-        emit error(tr("Failed to read boot.sig"));
-        return false;
-    }
-    QByteArray bootSigData = bootSigFile.readAll();
-    bootSigFile.close();
-
     // Delete ALL original files from the boot partition FIRST (before writing boot.img/boot.sig)
     // This ensures we use the original filenames from extraction, avoiding LFN issues
     // Boot files will be inside boot.img
@@ -17,13 +17,22 @@
 #include <QFuture>
 #include <atomic>
 #include <chrono>
+#include <optional>
 #include <time.h>
 #include <curl/curl.h>
 #include "acceleratedcryptographichash.h"
 #include "imageadvancedoptions.h"
 #include "systemmemorymanager.h"
 #include "file_operations.h"
+#include "page_cache_sync_governor.h"
 #include "asynccachewriter.h"
+#include "blockmap.h"
+#include "hashstage.h"
+#include "trailingverifier.h"
+#include "verifydigest.h"
+#include "segmenteddownloader.h"
+
+namespace rpi_imager { class FanOutFileOperations; }
 
 
 class DownloadThread : public QThread
@@ -122,16 +131,47 @@ public:
      */
     void setVerifyEnabled(bool verify);
 
+    /*
+     * Digest used to compare the written data with what is read back.
+     * Defaults to SHA256. With a faster one, SHA256 of the image is only
+     * computed when there is an expected hash to compare it with.
+     */
+    void setVerifyDigest(VerifyDigest::Algorithm algorithm);
+
     /*
      * Enable disk cache
+     *
+     * With expanded, the cache takes the decompressed image as a sparse file
+     * instead of the download (image extraction only) and cannot be resumed.
      */
-    void setCacheFile(const QString &filename, qint64 filesize = 0);
+    void setCacheFile(const QString &filename, qint64 filesize = 0, bool expanded = false);
 
     /*
      * Set input buffer size
      */
     void setInputBufferSize(int len);
 
+    /*
+     * Size of the file at the URL, if known beforehand.
+     * Lets a segmented download start without probing the server first.
+     */
+    void setDownloadSize(quint64 size);
+
+    /*
+     * Candidate locations of a bmaptool block map (.bmap) for the image, tried in order.
+     * Accepts http(s):// and file:// URLs, and archive:///path/to.zip#entry for ZIP entries.
+     * If one of them loads, only the mapped ranges are written and verified.
+     */
+    void setBlockMapSources(const QList<QByteArray> &sources);
+
+    /*
+     * Write the image to these devices as well (fan-out mode).
+     * All devices are written from the same download and decompression pass and
+     * each one is verified on its own. A device that fails is dropped and reported
+     * with targetFailed(), the write only fails once no device is left.
+     */
+    void setAdditionalTargets(const QList<QByteArray> &devices);
+
     /*
      * Enable image customization
      */
@@ -147,6 +187,7 @@ public:
     void setDebugAsyncQueueDepth(int depth);
     void setDebugIPv4Only(bool enabled);
     void setDebugSkipEndOfDevice(bool enabled);
+    void setDebugTrailingVerify(bool enabled);
 
     /*
      * Thread safe download progress query functions
@@ -179,6 +220,7 @@ signals:
     void cacheFileHashUpdated(QByteArray cacheFileHash, QByteArray imageHash);
     void finalizing();
     void preparationStatusUpdate(QString msg);
+    void targetFailed(QString device, QString msg);  // Fan-out mode: one device was dropped
     
     // Performance event signals (connected by ImageWriter to PerformanceStats)
     void eventDriveUnmount(quint32 durationMs, bool success);
@@ -208,6 +250,7 @@ signals:
     void eventWriteAfterSyncImpact(quint32 avgThroughputBeforeSyncKBps, quint32 avgThroughputAfterSyncKBps, quint32 sampleCount);
     void eventAsyncIOConfig(bool enabled, bool supported, int queueDepth, quint32 pendingAtEnd);
     void eventAsyncIOTiming(quint32 totalMs, quint64 bytesWritten, quint32 writeCount);
+    void eventWriteTuning(int queueDepth, quint32 writeSizeKB, quint32 throughputKBps, quint32 avgLatencyUs, QString reason);
     
     // Bottleneck state signal for UI feedback
     void bottleneckStateChanged(DownloadThread::BottleneckState state, quint32 throughputKBps);
@@ -231,14 +274,109 @@ protected:
     virtual void _onVerifyProgress() {}  // Called during verify loop for progress updates
     int _authopen(const QByteArray &filename);
     bool _openAndPrepareDevice();
-    void _writeCache(const char *buf, size_t len);
+    bool _openAndPrepareTarget();
+    /* Long-lived buffers that async writes are issued from. They are
+       registered with the device once it is open, see
+       FileOperations::RegisterWriteBuffers(). */
+    virtual std::vector<rpi_imager::FileOperations::WriteBuffer> _writeBuffers() const { return {}; }
+    void _registerWriteBuffers();
+    /* Queue depth and write size are tuned while writing, see
+       AdaptiveWriteController. Subclasses that control their write size
+       fill in the write size range. */
+    virtual void _configureWriteTuning(rpi_imager::AdaptiveWriteController::Limits &limits) const { Q_UNUSED(limits); }
+    void _startWriteTuning();
+    void _onPrepareError(const QString &msg);
+    void _onTargetError(const QString &msg);
+    bool _verifyTargets();
+    /* Returns true if the data was queued. With onComplete the data is
+       written in place and onComplete is called once it is no longer needed,
+       see AsyncCacheWriter::write() */
+    bool _writeCache(const char *buf, size_t len, WriteCompleteCallback onComplete = nullptr);
     qint64 _sectorsWritten();
+    qint64 _sectorsWritten(const QByteArray &device);
     void _closeFiles();
     QByteArray _fileGetContentsTrimmed(const QString &filename);
     bool _customizeImage();
     bool _createSecureBootFiles(class DeviceWrapperFatPartition *fat);
     void _periodicSync();
 
+    /*
+     * Sparse write support
+     *
+     * Lets extractors of sparse formats (VSI) advance past runs of zero blocks
+     * instead of writing them out. The skipped range is still fed to _writehash
+     * as zeros, so the verify pass (which reads everything back) confirms the
+     * device really returns zeros there.
+     */
+    enum class SparseWriteMode {
+        Disabled,   // Zeros must be written like any other data
+        ZeroRange   // Device/filesystem can zero the range cheaply (BLKZEROOUT, hole punching)
+    };
+    bool _probeZeroRange();
+    bool _canSkipSparse() const;
+    bool _skipSparseRange(quint64 len);
+
+    /*
+     * Block map support
+     *
+     * The .bmap is fetched by _fetchBlockMap() while the device is prepared, so
+     * extraction never waits for it. Once extraction starts, _writeMappedFile()
+     * only writes the ranges the map lists and seeks past the rest (see
+     * BlockMapWriter). Every byte still goes into _writehash so the image hash
+     * check is unaffected, while each mapped range is additionally checked
+     * against its bmap checksum. Verification then reads back only the mapped ranges.
+     */
+    bool _fetchBlockMap();
+    QByteArray _fetchBlockMapSource(const QByteArray &source);
+    bool _startBlockMap();
+    size_t _writeMappedFile(const char *buf, size_t len, WriteCompleteCallback onComplete = nullptr);
+
+    /*
+     * Write hash stage (see HashStage)
+     *
+     * Once the hash stage runs, every byte for _writehash has to go through it
+     * to keep the order. _addToWriteHash() does that, and hashes inline while
+     * no stage is running; onHashed runs once buf is no longer needed.
+     */
+    void _addToWriteHash(const char *buf, size_t len, WriteCompleteCallback onHashed = nullptr);
+    void _waitForWriteHash();
+    void _stopHashStage();
+
+    /*
+     * Trailing verify (see TrailingVerifier)
+     *
+     * While writing, every TRAILING_VERIFY_CHECKPOINT_BYTES the write position
+     * is made durable and handed to a verifier thread that reads the device
+     * back through its own O_DIRECT handle, feeding _verifyhash. _verify() then
+     * only reads what the verifier has not covered yet. Single target, whole
+     * image verify on Linux only; otherwise the normal verify pass runs.
+     */
+    void _advanceTrailingVerify();
+    bool _startTrailingVerify();
+    std::uint64_t _finishTrailingVerify(bool &readError);
+
+    /*
+     * Download over several concurrent range requests (see SegmentedDownloader).
+     * Returns false if the server or download is not suitable, in which case
+     * the caller performs a normal single connection transfer.
+     */
+    bool _segmentedDownload(CURLcode &ret);
+    // Set once a segmented download ran; _c then only ran for a fallback, if at all
+    std::optional<SegmentedDownloader::Stats> _segmentedStats;
+    bool _segmentedFallback;
+    quint64 _downloadSize;
+
+    /*
+     * Receive a plain HTTP download from a local mirror straight into buffers
+     * provided by the subclass (see DirectHttpReceiver), saving the copy out of
+     * curl's receive buffer. Returns false if the subclass has no such buffers
+     * or the server is not suitable; the caller then uses the other methods.
+     */
+    bool _directDownload(CURLcode &ret);
+    virtual bool _canReceiveDirect() const { return false; }
+    virtual char *_acquireReceiveBuffer(size_t &capacity);
+    virtual bool _commitReceiveBuffer(char *buf, size_t len);
+
     /*
      * libcurl callbacks
      */
@@ -268,10 +406,27 @@ protected:
 
     // Unified cross-platform file operations
     std::unique_ptr<rpi_imager::FileOperations> _file;
+
+    // Fan-out state: with additional targets _file is a FanOutFileOperations
+    // and _fanOut points to it (see _openAndPrepareDevice)
+    QList<QByteArray> _additionalTargets;
+    rpi_imager::FanOutFileOperations *_fanOut;
+    QList<qint64> _fanOutSectorsStart;  // Sector counter of each target when its write started
+    QString _targetPrepareError;
+
+    // Sparse write state (see _skipSparseRange)
+    SparseWriteMode _sparseWriteMode;
+    quint64 _sparseBytesSkipped;
+
+    // Block map state (see _writeMappedFile)
+    QList<QByteArray> _blockMapSources;
+    BlockMap _blockMap;                                 // As fetched, before the image size is known
+    std::unique_ptr<BlockMapWriter> _blockMapWriter;    // Set once extraction uses the map
     
     // Async cache writer for non-blocking cache file I/O
     std::unique_ptr<AsyncCacheWriter> _asyncCacheWriter;
     QString _cacheFilename;  // Store filename for legacy signal emission
+    bool _cacheExpanded;     // Cache holds the decompressed image (see setCacheFile)
 
 #ifdef Q_OS_WIN
     // Windows-specific volume file for legacy compatibility
@@ -279,16 +434,36 @@ protected:
     QByteArray _nr;
 #endif
 
-    AcceleratedCryptographicHash _writehash, _verifyhash;
+    // _writehash: SHA256 of the image, compared with the expected hash.
+    // _writeDigest is set when verify uses another digest than SHA256
+    AcceleratedCryptographicHash _writehash;
+    std::unique_ptr<VerifyDigest> _writeDigest, _verifyhash;
+    bool _needImageSha256() const;
 
     // Pipelined hash computation - store future for previous hash operation
     QFuture<void> _pendingHashFuture;
     bool _hasPendingHash;
 
-    // Cross-platform adaptive page cache flushing
+    // Hash thread for the zero-copy async path, started by the first such write
+    std::unique_ptr<HashStage> _hashStage;
+
+    // Trailing verify state (see _advanceTrailingVerify)
+    std::unique_ptr<TrailingVerifier> _trailingVerifier;
+    int _trailingVerifyFd;
+    std::uint64_t _trailingVerifyCheckpoint;
+    static constexpr std::uint64_t TRAILING_VERIFY_CHECKPOINT_BYTES = 64 * 1024 * 1024;
+    static constexpr std::size_t TRAILING_VERIFY_CHUNK_SIZE = 4 * 1024 * 1024;
+
+    // Cross-platform adaptive page cache flushing (see _periodicSync)
     qint64 _lastSyncBytes;
     QElapsedTimer _lastSyncTime;
     SystemMemoryManager::SyncConfiguration _syncConfig;
+    std::unique_ptr<rpi_imager::PageCacheSyncGovernor> _syncGovernor;
+    // Range whose writeback was started last and is waited for at the next sync
+    std::uint64_t _writebackStart;
+    std::uint64_t _writebackEnd;
+    qint64 _writebackBytes;
+    QElapsedTimer _writebackTimer;
     
     // Debug options
     bool _debugDirectIO;
@@ -296,8 +471,10 @@ protected:
     bool _debugVerboseLogging;
     bool _debugAsyncIO;
     int _debugAsyncQueueDepth;
+    std::shared_ptr<rpi_imager::AdaptiveWriteController> _writeController;
     bool _debugIPv4Only;
     bool _debugSkipEndOfDevice;
+    bool _debugTrailingVerify;
     
     void _initializeSyncConfiguration();
     virtual void _updateBottleneckState();
@@ -21,7 +21,8 @@ DriveListModel::DriveListModel(QObject *parent)
         {isReadOnlyRole, "isReadOnly"},
         {isSystemRole, "isSystem"},
         {mountpointsRole, "mountpoints"},
-        {childDevicesRole, "childDevices"}
+        {childDevicesRole, "childDevices"},
+        {selectedRole, "selected"}
     };
 
     // Enumerate drives in seperate thread, but process results in UI thread
@@ -54,6 +55,8 @@ QVariant DriveListModel::data(const QModelIndex &index, int role) const
     else {
         auto it = _drivelist.cbegin();
         std::advance(it, row);
+        if (role == selectedRole)
+            return _selectedDevices.contains(it.value()->property("device").toString());
         return it.value()->property(propertyName);
     }
 }
@@ -175,6 +178,9 @@ void DriveListModel::processDriveList(std::vector<Drivelist::DeviceDescriptor> l
 
                 // Emit signal for this specific device removal
                 emit deviceRemoved(devicePath);
+
+                if (_selectedDevices.removeAll(devicePath))
+                    emit selectionChanged();
             }
         }
     }
@@ -255,6 +261,16 @@ void DriveListModel::refreshNow()
     _thread.refreshNow();
 }
 
+const DriveListItem *DriveListModel::findDrive(const QString &device) const
+{
+    for (auto it = _drivelist.cbegin(); it != _drivelist.cend(); ++it)
+    {
+        if (it.value() && it.value()->property("device").toString() == device)
+            return it.value();
+    }
+    return nullptr;
+}
+
 QStringList DriveListModel::getChildDevices(const QString &device) const
 {
     // Search through cached drive list for matching device
@@ -267,4 +283,42 @@ QStringList DriveListModel::getChildDevices(const QString &device) const
         }
     }
     return QStringList();
-}
\ No newline at end of file
+}
+
+void DriveListModel::setSelected(const QString &device, bool selected)
+{
+    if (selected == _selectedDevices.contains(device))
+        return;
+
+    if (selected)
+        _selectedDevices.append(device);
+    else
+        _selectedDevices.removeAll(device);
+
+    int row = 0;
+    for (auto it = _drivelist.cbegin(); it != _drivelist.cend(); ++it, ++row)
+    {
+        if (it.value()->property("device").toString() == device)
+        {
+            QModelIndex idx = index(row);
+            emit dataChanged(idx, idx, {selectedRole});
+        }
+    }
+    emit selectionChanged();
+}
+
+QStringList DriveListModel::selectedDevices() const
+{
+    return _selectedDevices;
+}
+
+void DriveListModel::clearSelection()
+{
+    if (_selectedDevices.isEmpty())
+        return;
+
+    _selectedDevices.clear();
+    if (!_drivelist.isEmpty())
+        emit dataChanged(index(0), index(_drivelist.count() - 1), {selectedRole});
+    emit selectionChanged();
+}
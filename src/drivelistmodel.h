@@ -74,12 +74,26 @@ public:
      */
     Q_INVOKABLE QStringList getChildDevices(const QString &device) const;
 
+    /**
+     * @brief Multi-select support for writing one image to several drives
+     *
+     * Selected drives are remembered by device path and exposed through
+     * the "selected" role. Drives that disappear are deselected.
+     */
+    Q_INVOKABLE void setSelected(const QString &device, bool selected);
+    Q_INVOKABLE QStringList selectedDevices() const;
+    Q_INVOKABLE void clearSelection();
+
+    /* Drive currently listed under the given device path, or nullptr */
+    const DriveListItem *findDrive(const QString &device) const;
+
     enum driveListRoles {
-        deviceRole = Qt::UserRole + 1, descriptionRole, sizeRole, isUsbRole, isScsiRole, isReadOnlyRole, isSystemRole, mountpointsRole, childDevicesRole
+        deviceRole = Qt::UserRole + 1, descriptionRole, sizeRole, isUsbRole, isScsiRole, isReadOnlyRole, isSystemRole, mountpointsRole, childDevicesRole, selectedRole
     };
 
 signals:
     void deviceRemoved(const QString &device);
+    void selectionChanged();
     void eventDriveListPoll(quint32 durationMs);
 
 public slots:
@@ -88,6 +102,7 @@ public slots:
 protected:
     QMap<QString,DriveListItem *> _drivelist;
     QHash<int, QByteArray> _rolenames;
+    QStringList _selectedDevices;
     DriveListModelPollThread _thread;
 };
 
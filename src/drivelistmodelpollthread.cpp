@@ -4,6 +4,9 @@
 #ifdef Q_OS_WIN
 #include <windows.h>
 #endif
+#ifdef Q_OS_LINUX
+#include "linux/drivehotplugmonitor.h"
+#endif
 
 /*
  * SPDX-License-Identifier: Apache-2.0
@@ -20,6 +23,7 @@ DriveListModelPollThread::~DriveListModelPollThread()
 {
     _terminate = true;
     _modeChanged.wakeAll();  // Wake thread if it's waiting
+    quit();                  // Leave the event loop when event-driven
     if (!wait(2000)) {
         terminate();
     }
@@ -29,6 +33,7 @@ void DriveListModelPollThread::stop()
 {
     _terminate = true;
     _modeChanged.wakeAll();  // Wake thread to check terminate flag
+    quit();
 }
 
 void DriveListModelPollThread::start()
@@ -52,6 +57,7 @@ void DriveListModelPollThread::setScanMode(ScanMode mode)
         if (oldMode == ScanMode::Paused && mode != ScanMode::Paused) {
             _modeChanged.wakeAll();
         }
+        _applyModeToMonitor();
         
         emit scanModeChanged(mode);
     }
@@ -79,6 +85,71 @@ void DriveListModelPollThread::refreshNow()
     _refreshRequested = true;
     qDebug() << "Drive list refresh requested";
     _modeChanged.wakeAll();  // Wake thread to perform immediate scan
+#ifdef Q_OS_LINUX
+    if (_monitor) {
+        _refreshRequested = false;
+        QMetaObject::invokeMethod(_monitor, &DriveHotplugMonitor::rescan, Qt::QueuedConnection);
+    }
+#endif
+}
+
+/* Called with _mutex held */
+void DriveListModelPollThread::_applyModeToMonitor()
+{
+#ifdef Q_OS_LINUX
+    if (!_monitor)
+        return;
+
+    DriveHotplugMonitor *monitor = _monitor;
+    ScanMode mode = _scanMode;
+    auto apply = [monitor, mode]() {
+        // Events are still picked up immediately; only the safety net rescan slows down
+        monitor->setFallbackInterval(mode == ScanMode::Slow ? 60000 : 30000);
+        monitor->setPaused(mode == ScanMode::Paused);
+    };
+
+    if (QThread::currentThread() == this)
+        apply();
+    else
+        QMetaObject::invokeMethod(monitor, apply, Qt::QueuedConnection);
+#endif
+}
+
+bool DriveListModelPollThread::_runEventDriven()
+{
+#ifdef Q_OS_LINUX
+    DriveHotplugMonitor monitor;
+    if (!monitor.start()) {
+        qDebug() << "Drive hotplug events unavailable, polling instead";
+        return false;
+    }
+
+    connect(&monitor, &DriveHotplugMonitor::driveListChanged, &monitor,
+            [this](std::vector<Drivelist::DeviceDescriptor> list) { emit newDriveList(list); });
+    connect(&monitor, &DriveHotplugMonitor::scanned, &monitor,
+            [this](quint32 durationMs) { emit eventDriveListPoll(durationMs); });
+
+    bool paused;
+    {
+        QMutexLocker lock(&_mutex);
+        _monitor = &monitor;
+        _applyModeToMonitor();
+        paused = _scanMode == ScanMode::Paused && !_refreshRequested;
+        _refreshRequested = false;
+    }
+
+    // When paused, the first scan happens on resume
+    if (!paused)
+        monitor.rescan();
+    if (!_terminate)
+        exec();
+
+    QMutexLocker lock(&_mutex);
+    _monitor = nullptr;
+    return true;
+#else
+    return false;
+#endif
 }
 
 void DriveListModelPollThread::run()
@@ -92,6 +163,9 @@ void DriveListModelPollThread::run()
     }
 #endif
 
+    if (_runEventDriven())
+        return;
+
     QElapsedTimer t1;
 
     while (!_terminate)
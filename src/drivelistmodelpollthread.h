@@ -11,6 +11,8 @@
 #include <QWaitCondition>
 #include "dependencies/drivelist/src/drivelist.hpp"
 
+class DriveHotplugMonitor;
+
 /**
  * @brief Background thread for polling available storage devices
  * 
@@ -19,6 +21,12 @@
  * - Paused mode: No scanning (during write operations to avoid contention)
  * - Slow mode: Scans every 5 seconds (during final stages, minimal UI updates)
  * 
+ * On Linux the thread instead runs an event loop that listens for block
+ * device uevents (see DriveHotplugMonitor), updates only the disks that
+ * changed and emits newDriveList only when the list differs; the modes then
+ * control how often the fallback full rescan runs. Polling is used when the
+ * uevent socket cannot be opened.
+ *
  * Pausing scanning during write operations prevents:
  * - I/O contention on the target device
  * - Device lock conflicts on Windows
@@ -86,8 +94,11 @@ protected:
     ScanMode _scanMode = ScanMode::Normal;
     mutable QMutex _mutex;
     QWaitCondition _modeChanged;
+    DriveHotplugMonitor *_monitor = nullptr;  // Lives in this thread while it runs event-driven
     
     virtual void run() override;
+    bool _runEventDriven();
+    void _applyModeToMonitor();
 
 signals:
     void newDriveList(std::vector<Drivelist::DeviceDescriptor> list);
@@ -0,0 +1,533 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "fanout_file_operations.h"
+#include <algorithm>
+#include <condition_variable>
+#include <sstream>
+#include <thread>
+
+namespace rpi_imager {
+
+namespace {
+
+// Shared by the per-target completions of one fanned out async write. They
+// arrive on the completion threads of different targets, possibly at once.
+struct PendingFanOutWrite {
+  std::mutex mutex;
+  std::size_t remaining = 0;
+  bool any_success = false;
+  std::size_t size = 0;
+  FileOperations::AsyncWriteCallback callback;
+};
+
+}  // namespace
+
+class FanOutFileOperations::Worker {
+ public:
+  Worker() : thread_([this]() { Run(); }) {}
+
+  ~Worker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  void Post(std::function<FileError()> job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = std::move(job);
+      done_ = false;
+    }
+    wake_.notify_one();
+  }
+
+  // Result of the job posted last
+  FileError Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_.wait(lock, [this]() { return done_; });
+    return result_;
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [this]() { return stop_ || job_; });
+      if (stop_) {
+        return;
+      }
+      std::function<FileError()> job = std::move(job_);
+      job_ = nullptr;
+      lock.unlock();
+      FileError result = job();
+      lock.lock();
+      result_ = result;
+      done_ = true;
+      finished_.notify_one();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable finished_;
+  std::function<FileError()> job_;
+  FileError result_ = FileError::kSuccess;
+  bool done_ = true;
+  bool stop_ = false;
+  std::thread thread_;  // Last, so it starts with everything else initialised
+};
+
+FanOutFileOperations::FanOutFileOperations() = default;
+
+FanOutFileOperations::~FanOutFileOperations() {
+  Close();
+}
+
+void FanOutFileOperations::AddTarget(const std::string& path, std::unique_ptr<FileOperations> file) {
+  auto target = std::make_unique<Target>();
+  target->path = path;
+  target->file = std::move(file);
+  targets_.push_back(std::move(target));
+}
+
+std::size_t FanOutFileOperations::HealthyTargetCount() const {
+  return static_cast<std::size_t>(std::count_if(targets_.begin(), targets_.end(),
+      [](const std::unique_ptr<Target>& t) { return !t->failed.load(); }));
+}
+
+bool FanOutFileOperations::IsHealthy(std::size_t index) const {
+  return index < targets_.size() && !targets_[index]->failed.load();
+}
+
+const std::string& FanOutFileOperations::TargetPath(std::size_t index) const {
+  return targets_.at(index)->path;
+}
+
+void FanOutFileOperations::MarkFailed(std::size_t index) {
+  if (index < targets_.size() && !targets_[index]->failed.exchange(true)) {
+    FileOperationsLog("FanOut: dropping target " + targets_[index]->path);
+  }
+}
+
+void FanOutFileOperations::SetActiveTarget(std::size_t index) {
+  if (index < targets_.size()) {
+    active_ = index;
+  }
+}
+
+std::size_t FanOutFileOperations::ActiveTarget() const {
+  return active_;
+}
+
+FileOperations* FanOutFileOperations::Active() const {
+  if (active_ < targets_.size() && !targets_[active_]->failed.load()) {
+    return targets_[active_]->file.get();
+  }
+  for (const auto& target : targets_) {
+    if (!target->failed.load()) {
+      return target->file.get();
+    }
+  }
+  return targets_.empty() ? nullptr : targets_.front()->file.get();
+}
+
+void FanOutFileOperations::Fail(std::size_t index, FileError error, const char* what) {
+  std::lock_guard<std::mutex> lock(fail_mutex_);
+  Target& target = *targets_[index];
+  if (target.failed.exchange(true)) {
+    return;
+  }
+
+  last_error_code_ = target.file->GetLastErrorCode();
+
+  std::ostringstream oss;
+  oss << "FanOut: dropping target " << target.path << " after " << what
+      << " failed (error " << static_cast<int>(error) << ", code " << last_error_code_.load() << ")";
+  FileOperationsLog(oss.str());
+
+  if (target_failed_callback_) {
+    target_failed_callback_(index, std::string(what) + " failed");
+  }
+}
+
+FileError FanOutFileOperations::ForEachTarget(const std::function<FileError(FileOperations&)>& op,
+                                              const char* what, bool parallel, bool include_failed) {
+  std::vector<std::size_t> indices;
+  for (std::size_t i = 0; i < targets_.size(); ++i) {
+    if (include_failed || !targets_[i]->failed.load()) {
+      indices.push_back(i);
+    }
+  }
+  if (indices.empty()) {
+    return FileError::kWriteError;
+  }
+
+  std::vector<FileError> results(indices.size(), FileError::kSuccess);
+  if (parallel && indices.size() > 1) {
+    for (std::size_t n = 1; n < indices.size(); ++n) {
+      Target& target = *targets_[indices[n]];
+      if (!target.worker) {
+        target.worker = std::make_unique<Worker>();
+      }
+      FileOperations* file = target.file.get();
+      target.worker->Post([&op, file]() { return op(*file); });
+    }
+    results[0] = op(*targets_[indices[0]]->file);
+    for (std::size_t n = 1; n < indices.size(); ++n) {
+      results[n] = targets_[indices[n]]->worker->Wait();
+    }
+  } else {
+    for (std::size_t n = 0; n < indices.size(); ++n) {
+      results[n] = op(*targets_[indices[n]]->file);
+    }
+  }
+
+  FileError first_error = FileError::kSuccess;
+  for (std::size_t n = 0; n < indices.size(); ++n) {
+    if (results[n] != FileError::kSuccess && !targets_[indices[n]]->failed.load()) {
+      if (first_error == FileError::kSuccess) {
+        first_error = results[n];
+      }
+      Fail(indices[n], results[n], what);
+    }
+  }
+
+  if (HealthyTargetCount() > 0) {
+    return FileError::kSuccess;
+  }
+  return first_error != FileError::kSuccess ? first_error : FileError::kWriteError;
+}
+
+FileError FanOutFileOperations::OpenDevice(const std::string& path) {
+  auto file = FileOperations::Create();
+  FileError result = file->OpenDevice(path);
+  if (result == FileError::kSuccess) {
+    AddTarget(path, std::move(file));
+  }
+  return result;
+}
+
+FileError FanOutFileOperations::CreateTestFile(const std::string& path, std::uint64_t size) {
+  auto file = FileOperations::Create();
+  FileError result = file->CreateTestFile(path, size);
+  if (result == FileError::kSuccess) {
+    AddTarget(path, std::move(file));
+  }
+  return result;
+}
+
+FileError FanOutFileOperations::WriteAtOffset(std::uint64_t offset, const std::uint8_t* data, std::size_t size) {
+  return ForEachTarget([offset, data, size](FileOperations& f) { return f.WriteAtOffset(offset, data, size); },
+                       "write", true, false);
+}
+
+FileError FanOutFileOperations::GetSize(std::uint64_t& size) {
+  // The image has to fit on every device, so report the smallest one
+  std::uint64_t smallest = UINT64_MAX;
+  FileError result = ForEachTarget([&smallest](FileOperations& f) {
+    std::uint64_t target_size = 0;
+    FileError r = f.GetSize(target_size);
+    if (r == FileError::kSuccess) {
+      smallest = std::min(smallest, target_size);
+    }
+    return r;
+  }, "size query", false, false);
+
+  size = (result == FileError::kSuccess) ? smallest : 0;
+  return result;
+}
+
+FileError FanOutFileOperations::Close() {
+  FileError first_error = FileError::kSuccess;
+  for (auto& target : targets_) {
+    if (target->file->IsOpen()) {
+      FileError r = target->file->Close();
+      if (r != FileError::kSuccess && first_error == FileError::kSuccess) {
+        first_error = r;
+      }
+    }
+  }
+  return first_error;
+}
+
+bool FanOutFileOperations::IsOpen() const {
+  return std::any_of(targets_.begin(), targets_.end(), [](const std::unique_ptr<Target>& t) {
+    return !t->failed.load() && t->file->IsOpen();
+  });
+}
+
+FileError FanOutFileOperations::WriteSequential(const std::uint8_t* data, std::size_t size) {
+  return ForEachTarget([data, size](FileOperations& f) { return f.WriteSequential(data, size); },
+                       "write", true, false);
+}
+
+FileError FanOutFileOperations::ReadSequential(std::uint8_t* data, std::size_t size, std::size_t& bytes_read) {
+  FileOperations* file = Active();
+  if (file == nullptr) {
+    bytes_read = 0;
+    return FileError::kReadError;
+  }
+  return file->ReadSequential(data, size, bytes_read);
+}
+
+bool FanOutFileOperations::SetAsyncQueueDepth(int depth) {
+  bool any = false;
+  for (auto& target : targets_) {
+    any = target->file->SetAsyncQueueDepth(depth) || any;
+  }
+  return any;
+}
+
+int FanOutFileOperations::GetAsyncQueueDepth() const {
+  FileOperations* file = Active();
+  return file ? file->GetAsyncQueueDepth() : 1;
+}
+
+bool FanOutFileOperations::IsAsyncIOSupported() const {
+  FileOperations* file = Active();
+  return file && file->IsAsyncIOSupported();
+}
+
+FileError FanOutFileOperations::AsyncWriteSequential(const std::uint8_t* data, std::size_t size,
+                                                     AsyncWriteCallback callback) {
+  std::vector<std::size_t> healthy;
+  for (std::size_t i = 0; i < targets_.size(); ++i) {
+    if (!targets_[i]->failed.load()) {
+      healthy.push_back(i);
+    } else if (targets_[i]->file->GetPendingWriteCount() > 0) {
+      // Writes still in flight on a dropped target hold shared buffers
+      targets_[i]->file->PollAsyncCompletions();
+    }
+  }
+  if (healthy.empty()) {
+    if (callback) callback(FileError::kWriteError, 0);
+    return FileError::kWriteError;
+  }
+
+  auto pending = std::make_shared<PendingFanOutWrite>();
+  pending->remaining = healthy.size();
+  pending->size = size;
+  pending->callback = std::move(callback);
+
+  // Each target queues on its own ring, so the devices write concurrently.
+  // The caller's callback runs once the last target has completed the write.
+  bool queued = false;
+  FileError first_error = FileError::kSuccess;
+  for (std::size_t index : healthy) {
+    FileError r = targets_[index]->file->AsyncWriteSequential(data, size,
+        [this, index, pending](FileError result, std::size_t written) {
+          (void)written;
+          if (result != FileError::kSuccess) {
+            Fail(index, result, "async write");
+          }
+
+          bool last = false;
+          bool ok = false;
+          {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->any_success = pending->any_success || result == FileError::kSuccess;
+            last = --pending->remaining == 0;
+            ok = pending->any_success;
+          }
+          if (last && pending->callback) {
+            pending->callback(ok ? FileError::kSuccess : FileError::kWriteError, ok ? pending->size : 0);
+          }
+        });
+    if (r == FileError::kSuccess) {
+      queued = true;
+    } else if (first_error == FileError::kSuccess) {
+      first_error = r;
+    }
+  }
+
+  return queued ? FileError::kSuccess : first_error;
+}
+
+int FanOutFileOperations::GetPendingWriteCount() const {
+  int pending = 0;
+  for (const auto& target : targets_) {
+    pending = std::max(pending, target->file->GetPendingWriteCount());
+  }
+  return pending;
+}
+
+void FanOutFileOperations::PollAsyncCompletions() {
+  for (auto& target : targets_) {
+    target->file->PollAsyncCompletions();
+  }
+}
+
+FileError FanOutFileOperations::WaitForPendingWrites() {
+  // Dropped targets are drained as well so their completions release shared buffers
+  return ForEachTarget([](FileOperations& f) { return f.WaitForPendingWrites(); },
+                       "async write", true, true);
+}
+
+void FanOutFileOperations::CancelAsyncIO() {
+  for (auto& target : targets_) {
+    target->file->CancelAsyncIO();
+  }
+}
+
+bool FanOutFileOperations::RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) {
+  // The same buffers feed every target, each registers them with its own ring
+  bool any = false;
+  for (auto& target : targets_) {
+    any = target->file->RegisterWriteBuffers(buffers) || any;
+  }
+  return any;
+}
+
+void FanOutFileOperations::GetAsyncIOStats(uint32_t& wallClockMs, uint32_t& writeCount,
+                                           uint32_t& minLatencyUs, uint32_t& maxLatencyUs,
+                                           uint32_t& avgLatencyUs) const {
+  // Report the slowest device, it determines the overall write time
+  wallClockMs = writeCount = minLatencyUs = maxLatencyUs = avgLatencyUs = 0;
+  for (const auto& target : targets_) {
+    if (target->failed.load()) {
+      continue;
+    }
+    uint32_t wall, count, min_us, max_us, avg_us;
+    target->file->GetAsyncIOStats(wall, count, min_us, max_us, avg_us);
+    if (wall >= wallClockMs) {
+      wallClockMs = wall;
+      writeCount = count;
+      minLatencyUs = min_us;
+      maxLatencyUs = max_us;
+      avgLatencyUs = avg_us;
+    }
+  }
+}
+
+void FanOutFileOperations::ResetAsyncIOStats() {
+  for (auto& target : targets_) {
+    target->file->ResetAsyncIOStats();
+  }
+}
+
+void FanOutFileOperations::SetWriteController(std::shared_ptr<AdaptiveWriteController> controller) {
+  // One controller for all targets: the batch moves at the pace of the slowest
+  // device, so the shared settings are tuned for the set as a whole
+  for (auto& target : targets_) {
+    target->file->SetWriteController(controller);
+  }
+  FileOperations::SetWriteController(std::move(controller));
+}
+
+FileError FanOutFileOperations::Seek(std::uint64_t position) {
+  return ForEachTarget([position](FileOperations& f) { return f.Seek(position); },
+                       "seek", false, false);
+}
+
+std::uint64_t FanOutFileOperations::Tell() const {
+  FileOperations* file = Active();
+  return file ? file->Tell() : 0;
+}
+
+FileError FanOutFileOperations::SkipSequential(std::uint64_t size) {
+  return ForEachTarget([size](FileOperations& f) { return f.SkipSequential(size); },
+                       "seek", false, false);
+}
+
+FileError FanOutFileOperations::ZeroRange(std::uint64_t offset, std::uint64_t length) {
+  // Only used once HasFastZeroRange() said every target can do it, so a
+  // target that fails here has failed like it would on a write
+  return ForEachTarget([offset, length](FileOperations& f) { return f.ZeroRange(offset, length); },
+                       "zero range", true, false);
+}
+
+bool FanOutFileOperations::HasFastZeroRange() const {
+  bool any = false;
+  for (const auto& target : targets_) {
+    if (target->failed.load()) {
+      continue;
+    }
+    if (!target->file->HasFastZeroRange()) {
+      return false;
+    }
+    any = true;
+  }
+  return any;
+}
+
+FileError FanOutFileOperations::ForceSync() {
+  return ForEachTarget([](FileOperations& f) { return f.ForceSync(); }, "sync", true, false);
+}
+
+FileError FanOutFileOperations::Flush() {
+  return ForEachTarget([](FileOperations& f) { return f.Flush(); }, "flush", true, false);
+}
+
+bool FanOutFileOperations::CanControlWriteback() const {
+  bool any = false;
+  for (const auto& target : targets_) {
+    if (target->failed.load()) {
+      continue;
+    }
+    if (!target->file->CanControlWriteback()) {
+      return false;
+    }
+    any = true;
+  }
+  return any;
+}
+
+FileError FanOutFileOperations::StartWriteback(std::uint64_t offset, std::uint64_t length) {
+  return ForEachTarget([offset, length](FileOperations& f) { return f.StartWriteback(offset, length); },
+                       "writeback", false, false);
+}
+
+FileError FanOutFileOperations::WaitForWriteback(std::uint64_t offset, std::uint64_t length) {
+  return ForEachTarget([offset, length](FileOperations& f) { return f.WaitForWriteback(offset, length); },
+                       "writeback", true, false);
+}
+
+void FanOutFileOperations::PrepareForSequentialRead(std::uint64_t offset, std::uint64_t length) {
+  FileOperations* file = Active();
+  if (file) {
+    file->PrepareForSequentialRead(offset, length);
+  }
+}
+
+int FanOutFileOperations::GetHandle() const {
+  FileOperations* file = Active();
+  return file ? file->GetHandle() : -1;
+}
+
+int FanOutFileOperations::GetLastErrorCode() const {
+  int code = last_error_code_.load();
+  if (code != 0) {
+    return code;
+  }
+  FileOperations* file = Active();
+  return file ? file->GetLastErrorCode() : 0;
+}
+
+bool FanOutFileOperations::IsDirectIOEnabled() const {
+  FileOperations* file = Active();
+  return file && file->IsDirectIOEnabled();
+}
+
+FileError FanOutFileOperations::SetDirectIOEnabled(bool enabled) {
+  FileError first_error = FileError::kSuccess;
+  for (auto& target : targets_) {
+    FileError r = target->file->SetDirectIOEnabled(enabled);
+    if (r != FileError::kSuccess && first_error == FileError::kSuccess) {
+      first_error = r;
+    }
+  }
+  return first_error;
+}
+
+FileOperations::DirectIOInfo FanOutFileOperations::GetDirectIOInfo() const {
+  FileOperations* file = Active();
+  return file ? file->GetDirectIOInfo() : DirectIOInfo();
+}
+
+}  // namespace rpi_imager
@@ -0,0 +1,143 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef FANOUT_FILE_OPERATIONS_H_
+#define FANOUT_FILE_OPERATIONS_H_
+
+#include "file_operations.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rpi_imager {
+
+// Writes the same data stream to several already opened devices at once.
+//
+// Every write, seek and sync is applied to all healthy targets. Each target
+// keeps its own FileOperations instance and therefore its own async I/O queue,
+// so a batch of cards is written in parallel and runs at the speed of the
+// slowest one. An async write completes (and its buffer may be released) only
+// once all targets have finished with it.
+//
+// A target that fails is dropped from the set instead of failing the whole
+// operation, this includes a failed ZeroRange. Operations only report an
+// error once no healthy target is left.
+//
+// Reads go to a single "active" target, selected with SetActiveTarget(), so
+// each device can be verified on its own.
+class FanOutFileOperations : public FileOperations {
+ public:
+  // Called when a target is dropped because an I/O operation failed on it.
+  // May be invoked from the thread that processes async completions.
+  using TargetFailedCallback = std::function<void(std::size_t index, const std::string& reason)>;
+
+  FanOutFileOperations();
+  ~FanOutFileOperations() override;
+
+  FanOutFileOperations(const FanOutFileOperations&) = delete;
+  FanOutFileOperations& operator=(const FanOutFileOperations&) = delete;
+
+  // Add an opened and prepared device
+  void AddTarget(const std::string& path, std::unique_ptr<FileOperations> file);
+
+  std::size_t TargetCount() const { return targets_.size(); }
+  std::size_t HealthyTargetCount() const;
+  bool IsHealthy(std::size_t index) const;
+  const std::string& TargetPath(std::size_t index) const;
+
+  // Drop a target, e.g. after it failed verification. Does not invoke the callback.
+  void MarkFailed(std::size_t index);
+
+  // Select the target used for reads, Tell() and handle queries
+  void SetActiveTarget(std::size_t index);
+  std::size_t ActiveTarget() const;
+
+  void SetTargetFailedCallback(TargetFailedCallback callback) { target_failed_callback_ = std::move(callback); }
+
+  // FileOperations
+  FileError OpenDevice(const std::string& path) override;
+  FileError CreateTestFile(const std::string& path, std::uint64_t size) override;
+  FileError WriteAtOffset(
+      std::uint64_t offset,
+      const std::uint8_t* data,
+      std::size_t size) override;
+  FileError GetSize(std::uint64_t& size) override;
+  FileError Close() override;
+  bool IsOpen() const override;
+
+  FileError WriteSequential(const std::uint8_t* data, std::size_t size) override;
+  FileError ReadSequential(std::uint8_t* data, std::size_t size, std::size_t& bytes_read) override;
+
+  bool SetAsyncQueueDepth(int depth) override;
+  int GetAsyncQueueDepth() const override;
+  bool IsAsyncIOSupported() const override;
+  FileError AsyncWriteSequential(const std::uint8_t* data, std::size_t size,
+                                 AsyncWriteCallback callback = nullptr) override;
+  int GetPendingWriteCount() const override;
+  void PollAsyncCompletions() override;
+  FileError WaitForPendingWrites() override;
+  void CancelAsyncIO() override;
+  bool RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) override;
+  void GetAsyncIOStats(uint32_t& wallClockMs, uint32_t& writeCount,
+                       uint32_t& minLatencyUs, uint32_t& maxLatencyUs,
+                       uint32_t& avgLatencyUs) const override;
+  void ResetAsyncIOStats() override;
+  void SetWriteController(std::shared_ptr<AdaptiveWriteController> controller) override;
+
+  FileError Seek(std::uint64_t position) override;
+  std::uint64_t Tell() const override;
+  FileError SkipSequential(std::uint64_t size) override;
+  FileError ZeroRange(std::uint64_t offset, std::uint64_t length) override;
+  bool HasFastZeroRange() const override;
+
+  FileError ForceSync() override;
+  FileError Flush() override;
+  bool CanControlWriteback() const override;
+  FileError StartWriteback(std::uint64_t offset, std::uint64_t length) override;
+  FileError WaitForWriteback(std::uint64_t offset, std::uint64_t length) override;
+  void PrepareForSequentialRead(std::uint64_t offset, std::uint64_t length) override;
+
+  int GetHandle() const override;
+  int GetLastErrorCode() const override;
+  bool IsDirectIOEnabled() const override;
+  FileError SetDirectIOEnabled(bool enabled) override;
+  DirectIOInfo GetDirectIOInfo() const override;
+
+ private:
+  // Runs a target's part of parallel operations. Its thread is started
+  // once and kept, rather than one being started for every operation.
+  class Worker;
+
+  struct Target {
+    std::string path;
+    std::unique_ptr<FileOperations> file;
+    std::atomic<bool> failed{false};
+    std::unique_ptr<Worker> worker;  // Started on first parallel use
+  };
+
+  // Run op on every healthy target (and on failed ones too with include_failed).
+  // With parallel set, the first target runs on the calling thread and the
+  // others concurrently on their workers.
+  // Healthy targets for which op fails are dropped. Returns kSuccess while at
+  // least one healthy target is left, otherwise the first error.
+  FileError ForEachTarget(const std::function<FileError(FileOperations&)>& op,
+                          const char* what, bool parallel, bool include_failed);
+
+  void Fail(std::size_t index, FileError error, const char* what);
+
+  // Active target, or the first healthy one if the active target has failed
+  FileOperations* Active() const;
+
+  std::vector<std::unique_ptr<Target>> targets_;
+  std::size_t active_ = 0;
+  std::atomic<int> last_error_code_{0};
+  TargetFailedCallback target_failed_callback_;
+  std::mutex fail_mutex_;  // Async completions of several targets can fail at once
+};
+
+}  // namespace rpi_imager
+
+#endif  // FANOUT_FILE_OPERATIONS_H_
@@ -8,10 +8,13 @@
 
 #include "devicewrapper.h"
 #include "devicewrapperfatpartition.h"
+#include "disk_formatter.h"
 #include "file_operations.h"
+#include "memory_file_operations.h"
 
 #include <QDebug>
 #include <QFile>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 
@@ -27,6 +30,8 @@ namespace fs = std::filesystem;
 static std::string getTestMountPath();
 static std::string getWholeDiskPath(const std::string& partition_path);
 static int getPartitionNumber(const std::string& partition_path);
+static std::unique_ptr<rpi_imager::FileOperations> createMemoryDisk();
+static void populateMemoryDisk(DeviceWrapper* device_wrapper);
 
 // Global shared device wrapper (opened once, reused by all tests)
 static std::shared_ptr<rpi_imager::FileOperations> g_shared_file_ops;
@@ -42,7 +47,26 @@ static void initializeSharedDevice() {
     
     std::string mount_path = getTestMountPath();
     if (mount_path.empty()) {
-        std::cout << "WARNING: No test device path available" << std::endl;
+        std::cout << "No test device path available, using a disk image in memory" << std::endl;
+        
+        auto file_ops = createMemoryDisk();
+        if (!file_ops) {
+            std::cout << "ERROR: Failed to create in-memory disk" << std::endl;
+            return;
+        }
+        
+        auto device_wrapper = std::make_unique<DeviceWrapper>(file_ops.get());
+        try {
+            populateMemoryDisk(device_wrapper.get());
+        } catch (const std::exception& e) {
+            std::cout << "ERROR: Failed to populate in-memory disk: " << e.what() << std::endl;
+            return;
+        }
+        
+        g_test_device_path = "(in-memory disk)";
+        g_partition_num = 1;
+        g_shared_file_ops = std::shared_ptr<rpi_imager::FileOperations>(std::move(file_ops));
+        g_shared_device_wrapper = std::shared_ptr<DeviceWrapper>(std::move(device_wrapper));
         return;
     }
     
@@ -150,10 +174,48 @@ static int getPartitionNumber(const std::string& partition_path) {
     }
 }
 
+// Helper to build an MBR disk with one empty FAT32 partition in memory
+static std::unique_ptr<rpi_imager::FileOperations> createMemoryDisk() {
+    const std::string name = "fat_partition_test.img";
+    const std::uint64_t disk_size = 64 * 1024 * 1024;  // 64MB
+    
+    rpi_imager::MemoryFileOperations::Options options;
+    options.sparse = true;
+    
+    auto formatted = std::make_unique<rpi_imager::MemoryFileOperations>(options);
+    rpi_imager::MemoryFileOperations* image = formatted.get();
+    rpi_imager::DiskFormatter formatter(std::move(formatted));
+    if (!formatter.FormatFile(name, disk_size)) {
+        return nullptr;
+    }
+    
+    // The formatter keeps its FileOperations, so the tests get a copy
+    std::vector<std::uint8_t> contents = image->Contents();
+    auto disk = std::make_unique<rpi_imager::MemoryFileOperations>(options);
+    if (disk->CreateTestFile(name, disk_size) != rpi_imager::FileError::kSuccess ||
+        disk->WriteAtOffset(0, contents.data(), contents.size()) != rpi_imager::FileError::kSuccess) {
+        return nullptr;
+    }
+    return disk;
+}
+
+// Helper to give the in-memory disk the files the tests expect on a boot partition
+static void populateMemoryDisk(DeviceWrapper* device_wrapper) {
+    DeviceWrapperFatPartition* fat = device_wrapper->fatPartition(1);
+    
+    fat->writeFile("config.txt", "[all]\narm_64bit=1\ndtoverlay=vc4-kms-v3d\n");
+    fat->writeFile("cmdline.txt", "console=serial0,115200 console=tty1 root=/dev/mmcblk0p2 rootwait\n");
+    fat->createDirectory("overlays");
+    fat->writeFile("overlays/README", "Device Tree overlays\n");
+    fat->writeFile("overlays/vc4-kms-v3d.dtbo", QByteArray(3000, '\xd0'));
+    fat->writeFile("overlays/disable-bt.dtbo", QByteArray(1200, '\xd0'));
+    device_wrapper->sync();
+}
+
 // Helper to get the shared FAT partition (all tests use the same device)
 static DeviceWrapperFatPartition* getSharedFatPartition() {
     if (!g_shared_device_wrapper) {
-        throw std::runtime_error("Shared device not initialized. Set FAT_TEST_MOUNT_PATH environment variable.");
+        throw std::runtime_error("Shared device not initialized");
     }
     
     DeviceWrapperFatPartition* fat = g_shared_device_wrapper->fatPartition(g_partition_num);
@@ -721,3 +783,79 @@ TEST_CASE("DeviceWrapperFatPartition comprehensive tests", "[fat][!mayfail][.des
     }
 }
 
+
+// Helper to read a little-endian value out of a disk image
+static std::uint64_t readLE(const std::vector<std::uint8_t>& image, std::uint64_t offset, int bytes) {
+    std::uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = (value << 8) | image[offset + i];
+    }
+    return value;
+}
+
+TEST_CASE("DeviceWrapperFatPartition keeps FAT changes in memory until sync", "[fat]") {
+    // A disk of its own, the shared one may be a real device
+    auto file_ops = createMemoryDisk();
+    REQUIRE(file_ops);
+    auto* memory = static_cast<rpi_imager::MemoryFileOperations*>(file_ops.get());
+
+    const std::vector<std::uint8_t> before = memory->Contents();
+    const std::uint64_t part = readLE(before, 0x1C6, 4) * 512;
+    const std::uint64_t bytes_per_sector = readLE(before, part + 0x0B, 2);
+    const std::uint64_t bytes_per_cluster = before[part + 0x0D] * bytes_per_sector;
+    const std::uint64_t fat_start = part + readLE(before, part + 0x0E, 2) * bytes_per_sector;
+    const std::uint64_t fat_bytes = readLE(before, part + 0x24, 4) * bytes_per_sector;
+    const std::uint64_t fsinfo = part + readLE(before, part + 0x30, 2) * bytes_per_sector;
+    REQUIRE(before[part + 0x10] == 2);
+
+    const QByteArray contents(200 * 1024, 'x');
+    {
+        DeviceWrapper dw(file_ops.get());
+        DeviceWrapperFatPartition* fat = dw.fatPartition(1);
+        fat->writeFile("batched.bin", contents);
+        REQUIRE(fat->readFile("batched.bin") == contents);
+
+        // The cluster chain is only in the partition's own copy so far
+        QByteArray cached(static_cast<qsizetype>(fat_bytes), '\0');
+        dw.pread(cached.data(), fat_bytes, fat_start);
+        REQUIRE(std::memcmp(cached.constData(), before.data() + fat_start, fat_bytes) == 0);
+
+        // Going out of scope syncs, which flushes the FAT first
+    }
+
+    const std::vector<std::uint8_t> after = memory->Contents();
+    REQUIRE(std::memcmp(after.data() + fat_start, before.data() + fat_start, fat_bytes) != 0);
+    REQUIRE(std::memcmp(after.data() + fat_start, after.data() + fat_start + fat_bytes, fat_bytes) == 0);
+
+    const std::uint64_t free_before = readLE(before, fsinfo + 488, 4);
+    if (free_before != 0xFFFFFFFF) {
+        const std::uint64_t clusters = (contents.size() + bytes_per_cluster - 1) / bytes_per_cluster;
+        REQUIRE(readLE(after, fsinfo + 488, 4) == free_before - clusters);
+    }
+
+    DeviceWrapper reopened(file_ops.get());
+    REQUIRE(reopened.fatPartition(1)->readFile("batched.bin") == contents);
+}
+
+TEST_CASE("DeviceWrapper tears down cleanly when the final FAT flush fails", "[fat]") {
+    auto file_ops = createMemoryDisk();
+    REQUIRE(file_ops);
+    auto* memory = static_cast<rpi_imager::MemoryFileOperations*>(file_ops.get());
+
+    const std::vector<std::uint8_t> image = memory->Contents();
+    const std::uint64_t part = readLE(image, 0x1C6, 4) * 512;
+    const std::uint64_t fsinfo = part + readLE(image, part + 0x30, 2) * readLE(image, part + 0x0B, 2);
+
+    {
+        DeviceWrapper dw(file_ops.get());
+        DeviceWrapperFatPartition* fat = dw.fatPartition(1);
+        fat->writeFile("lost.txt", "never written\n");
+
+        // The FSInfo update then throws part way through flushing the FAT, in
+        // the destructor; nothing may touch the DeviceWrapper after that
+        const char garbage[4] = {0, 0, 0, 0};
+        dw.pwrite(garbage, sizeof(garbage), fsinfo);
+    }
+
+    SUCCEED();
+}
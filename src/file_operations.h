@@ -6,6 +6,7 @@
 #ifndef FILE_OPERATIONS_H_
 #define FILE_OPERATIONS_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <memory>
@@ -13,6 +14,9 @@
 #include <atomic>
 #include <chrono>
 #include <mutex>
+#include <vector>
+
+#include "adaptive_write_controller.h"
 
 namespace rpi_imager {
 
@@ -53,10 +57,14 @@ class WriteLatencyStats {
     first_submit_ns_.compare_exchange_strong(expected, now_ns);
   }
   
-  void recordCompletion(std::chrono::steady_clock::time_point submit_time) {
+  void recordCompletion(std::chrono::steady_clock::time_point submit_time, std::size_t bytes = 0) {
     auto now = std::chrono::steady_clock::now();
     auto latency_us = static_cast<uint64_t>(
         std::chrono::duration_cast<std::chrono::microseconds>(now - submit_time).count());
+
+    if (AdaptiveWriteController* controller = controller_.load()) {
+      controller->RecordCompletion(bytes, std::chrono::microseconds(latency_us), now);
+    }
     
     // Update min (lock-free)
     uint64_t current_min = min_us_.load();
@@ -77,6 +85,9 @@ class WriteLatencyStats {
     last_complete_ns_.store(now_ns);
   }
   
+  // Also feed every completion to a controller (nullptr to stop)
+  void setController(AdaptiveWriteController* controller) { controller_ = controller; }
+
   void reset() {
     min_us_ = UINT64_MAX;
     max_us_ = 0;
@@ -116,6 +127,7 @@ class WriteLatencyStats {
   std::atomic<uint32_t> count_{0};
   std::atomic<int64_t> first_submit_ns_{0};  // nanoseconds since epoch
   std::atomic<int64_t> last_complete_ns_{0}; // nanoseconds since epoch
+  std::atomic<AdaptiveWriteController*> controller_{nullptr};
 };
 
 // Abstract interface for platform-specific file operations
@@ -198,6 +210,23 @@ class FileOperations {
   // Cancel pending async I/O and wake up any blocking waits.
   // After calling this, WaitForPendingWrites and AsyncWriteSequential will return quickly.
   virtual void CancelAsyncIO() {}
+
+  // A long-lived buffer that async writes are issued from
+  struct WriteBuffer {
+    const std::uint8_t* data;
+    std::size_t size;
+  };
+
+  // Register the buffers async writes will come from, so the kernel can pin
+  // them once instead of on every write (io_uring fixed buffers on Linux).
+  // Writes from other memory still work, they just take the normal path.
+  // Replaces any earlier registration; an empty list drops it. The buffers
+  // must stay allocated until they are unregistered. Waits for pending writes.
+  // Returns true if the buffers are now registered.
+  virtual bool RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) {
+    (void)buffers;
+    return false;
+  }
   
   // Get async I/O timing statistics
   // - wallClockMs: total time from first submit to last completion
@@ -213,19 +242,70 @@ class FileOperations {
   virtual void ResetAsyncIOStats() {
     write_latency_stats_.reset();
   }
+
+  // Let a controller tune the number of writes in flight from their completion
+  // latencies. The queue depth set with SetAsyncQueueDepth() stays the upper
+  // bound. Pass nullptr to go back to the fixed depth.
+  virtual void SetWriteController(std::shared_ptr<AdaptiveWriteController> controller) {
+    write_latency_stats_.setController(controller.get());
+    write_controller_ = std::move(controller);
+  }
   
  protected:
+  // Writes to allow in flight for the configured queue depth
+  int InFlightLimit(int configured) const {
+    return write_controller_ ? std::min(configured, write_controller_->InFlightLimit()) : configured;
+  }
+
   mutable WriteLatencyStats write_latency_stats_;
+  std::shared_ptr<AdaptiveWriteController> write_controller_;
   
  public:
   // File positioning for streaming operations
   virtual FileError Seek(std::uint64_t position) = 0;
   virtual std::uint64_t Tell() const = 0;
-  
+
+  // Advance the sequential write position without writing any data.
+  // Used to skip runs of zero blocks in sparse images. Implementations whose async
+  // writes carry explicit offsets can do this without draining the queue.
+  virtual FileError SkipSequential(std::uint64_t size) { return Seek(Tell() + size); }
+
+  // Make a range read back as zeros without transferring the data
+  // (e.g. BLKZEROOUT on Linux block devices, hole punching on regular files).
+  // Returns an error if not supported - the caller must then write zeros itself.
+  virtual FileError ZeroRange(std::uint64_t offset, std::uint64_t length) {
+    (void)offset; (void)length;
+    return FileError::kWriteError;
+  }
+
+  // True if ZeroRange() is offloaded to the device or filesystem (WRITE ZEROES,
+  // hole punching) rather than transferring zeros, so it is worth trying for
+  // large ranges. A device without it may still read back garbage after discard.
+  virtual bool HasFastZeroRange() const { return false; }
+
   // Force filesystem sync (for page cache management)
   virtual FileError ForceSync() = 0;
   virtual FileError Flush() = 0;
-  
+
+  // True if writeback of a range can be started and waited for separately
+  // (sync_file_range() on Linux). Without it, page cache data can only be
+  // pushed out with Flush()/ForceSync().
+  virtual bool CanControlWriteback() const { return false; }
+
+  // Start writing back the dirty pages of a range without waiting for them.
+  // A length of 0 means up to the end of the file.
+  virtual FileError StartWriteback(std::uint64_t offset, std::uint64_t length) {
+    (void)offset; (void)length;
+    return FileError::kSyncError;
+  }
+
+  // Wait until the pages of a range are on the device, writing back any that
+  // are still dirty. Does not flush device caches or metadata, see ForceSync().
+  virtual FileError WaitForWriteback(std::uint64_t offset, std::uint64_t length) {
+    (void)offset; (void)length;
+    return FileError::kSyncError;
+  }
+
   // Prepare for sequential read (e.g., verification)
   // Invalidates cache and enables read-ahead hints for optimal sequential read performance
   virtual void PrepareForSequentialRead(std::uint64_t offset, std::uint64_t length) = 0;
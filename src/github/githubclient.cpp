@@ -4,6 +4,7 @@
  */
 
 #include "githubclient.h"
+#include "../zipcentraldirectory.h"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -16,6 +17,7 @@
 #include <QSettings>
 #include <archive.h>
 #include <archive_entry.h>
+#include <memory>
 
 GitHubClient::GitHubClient(QObject *parent)
     : QObject(parent)
@@ -342,7 +344,7 @@ void GitHubClient::downloadArtifact(const QString &owner, const QString &repo,
 
     qDebug() << "GitHubClient: Starting artifact download from" << urlStr << "to" << destinationPath;
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, destinationPath]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, owner, repo, artifactId, destinationPath]() {
         _activeInspectionReply = nullptr;
         reply->deleteLater();
 
@@ -352,7 +354,7 @@ void GitHubClient::downloadArtifact(const QString &owner, const QString &repo,
             QUrl redirectUrl = reply->header(QNetworkRequest::LocationHeader).toUrl();
             if (redirectUrl.isValid()) {
                 qDebug() << "GitHubClient: Following redirect to" << redirectUrl.toString();
-                downloadArtifactFromUrl(redirectUrl, destinationPath);
+                downloadArtifactFromUrl(redirectUrl, owner, repo, artifactId, destinationPath);
                 return;
             }
         }
@@ -382,7 +384,8 @@ void GitHubClient::downloadArtifact(const QString &owner, const QString &repo,
     });
 }
 
-void GitHubClient::downloadArtifactFromUrl(const QUrl &url, const QString &destinationPath)
+void GitHubClient::downloadArtifactFromUrl(const QUrl &url, const QString &owner, const QString &repo,
+                                           qint64 artifactId, const QString &destinationPath)
 {
     // Check if this is a GitHub URL or an external URL (like Azure blob storage)
     // External URLs (like Azure) use SAS tokens in the query string and don't need/want our GitHub auth header
@@ -403,37 +406,62 @@ void GitHubClient::downloadArtifactFromUrl(const QUrl &url, const QString &desti
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                          QNetworkRequest::NoLessSafeRedirectPolicy);
 
+    // Resume an earlier attempt for the same artifact (this may be a partial
+    // file left by an inspection download, which is fine - it is the same ZIP)
+    QString partialPath = destinationPath + ".partial";
+    qint64 startOffset = resumeOffsetFor(artifactId, partialPath);
+    if (startOffset > 0) {
+        qDebug() << "GitHubClient: Resuming artifact download from offset:" << startOffset;
+        request.setRawHeader("Range", QString("bytes=%1-").arg(startOffset).toUtf8());
+    } else {
+        // Starting over, nothing of an earlier write carries over
+        _partialArtifactDownload = PartialArtifactDownload();
+    }
+
+    _partialArtifactDownload.partialPath = partialPath;
+    _partialArtifactDownload.finalPath = destinationPath;
+    _partialArtifactDownload.owner = owner;
+    _partialArtifactDownload.repo = repo;
+    _partialArtifactDownload.artifactId = artifactId;
+    _partialArtifactDownload.downloadUrl = url;
+
+    if (!openActiveArtifactFile(partialPath, startOffset)) {
+        return;
+    }
+
     QNetworkReply *reply = _networkManager.get(request);
+    _activeInspectionReply = reply;
+    _activeInspectionZipPath = destinationPath;
+    _activeInspectionPartialPath = partialPath;
+    streamReplyToActiveFile(reply);
 
     qDebug() << "GitHubClient: Downloading artifact from redirect URL (isGitHubUrl:" << isGitHubUrl << ")";
 
     connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 bytesReceived, qint64 bytesTotal) {
-        emit artifactDownloadProgress(bytesReceived, bytesTotal);
+        qint64 totalSize = (bytesTotal > 0) ? (_activeInspectionResumeOffset + bytesTotal) : -1;
+        if (totalSize > 0) {
+            _partialArtifactDownload.totalSize = totalSize;
+        }
+        emit artifactDownloadProgress(_activeInspectionResumeOffset + bytesReceived, totalSize);
     });
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, destinationPath]() {
-        reply->deleteLater();
+    connect(reply, &QNetworkReply::finished, this, [this, reply, partialPath, destinationPath]() {
+        QString errorMessage;
+        bool ok = finishActiveArtifactFile(reply, partialPath, destinationPath, errorMessage);
 
-        if (reply->error() != QNetworkReply::NoError) {
-            qWarning() << "GitHubClient: Artifact download from redirect failed:" << reply->errorString();
-            emit error(tr("Failed to download artifact: %1").arg(reply->errorString()));
+        if (reply->error() == QNetworkReply::OperationCanceledError && errorMessage.isEmpty()) {
+            qDebug() << "GitHubClient: Artifact download cancelled by user";
             return;
         }
 
-        // Save the downloaded data to the destination file
-        QFile file(destinationPath);
-        if (!file.open(QIODevice::WriteOnly)) {
-            qWarning() << "GitHubClient: Failed to open destination file:" << destinationPath;
-            emit error(tr("Failed to save artifact: %1").arg(file.errorString()));
+        if (!ok) {
+            qWarning() << "GitHubClient: Artifact download from redirect failed:" << errorMessage;
+            emit error(tr("Failed to download artifact: %1").arg(errorMessage));
             return;
         }
 
-        QByteArray data = reply->readAll();
-        file.write(data);
-        file.close();
-
         qDebug() << "GitHubClient: Artifact downloaded successfully to" << destinationPath
-                 << "size:" << data.size();
+                 << "size:" << QFileInfo(destinationPath).size();
 
         emit artifactDownloadComplete(destinationPath);
     });
@@ -494,8 +522,15 @@ void GitHubClient::inspectArtifactContents(const QString &owner, const QString &
         if (statusCode == 302 || statusCode == 301 || statusCode == 307 || statusCode == 308) {
             QUrl redirectUrl = reply->header(QNetworkRequest::LocationHeader).toUrl();
             if (redirectUrl.isValid()) {
-                qDebug() << "GitHubClient: Following redirect for artifact inspection";
-                inspectArtifactFromUrl(redirectUrl, owner, repo, artifactId, artifactName, branch, zipPath);
+                // A partial download the user chose to resume is finished first
+                QString partialPath = zipPath + ".partial";
+                if (resumeOffsetFor(artifactId, partialPath) > 0) {
+                    qDebug() << "GitHubClient: Following redirect for artifact inspection (resuming download)";
+                    inspectArtifactFromUrl(redirectUrl, owner, repo, artifactId, artifactName, branch, zipPath);
+                } else {
+                    qDebug() << "GitHubClient: Following redirect for remote artifact inspection";
+                    inspectArtifactRemotely(redirectUrl, owner, repo, artifactId, artifactName, branch, zipPath);
+                }
                 return;
             }
         }
@@ -537,12 +572,8 @@ void GitHubClient::inspectArtifactFromUrl(const QUrl &url, const QString &owner,
     QString partialPath = zipPath + ".partial";
 
     // Check if we're resuming a partial download
-    qint64 startOffset = 0;
-    if (_partialArtifactDownload.isValid &&
-        _partialArtifactDownload.artifactId == artifactId &&
-        QFile::exists(_partialArtifactDownload.partialPath)) {
-        startOffset = _partialArtifactDownload.bytesDownloaded;
-        partialPath = _partialArtifactDownload.partialPath;
+    qint64 startOffset = resumeOffsetFor(artifactId, partialPath);
+    if (startOffset > 0) {
         qDebug() << "GitHubClient: Resuming artifact download from offset:" << startOffset;
     }
 
@@ -567,7 +598,11 @@ void GitHubClient::inspectArtifactFromUrl(const QUrl &url, const QString &owner,
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                          QNetworkRequest::NoLessSafeRedirectPolicy);
 
-    // Store metadata for partial download tracking
+    // Store metadata for partial download tracking (starting over, nothing of
+    // an earlier write carries over)
+    if (startOffset == 0) {
+        _partialArtifactDownload = PartialArtifactDownload();
+    }
     _partialArtifactDownload.partialPath = partialPath;
     _partialArtifactDownload.finalPath = zipPath;
     _partialArtifactDownload.owner = owner;
@@ -578,16 +613,9 @@ void GitHubClient::inspectArtifactFromUrl(const QUrl &url, const QString &owner,
     _partialArtifactDownload.downloadUrl = url;
 
     // Open the file for writing (append if resuming)
-    _activeInspectionFile = new QFile(partialPath);
-    QIODevice::OpenMode mode = startOffset > 0 ? (QIODevice::WriteOnly | QIODevice::Append)
-                                                : QIODevice::WriteOnly;
-    if (!_activeInspectionFile->open(mode)) {
-        emit error(tr("Failed to open file for writing: %1").arg(_activeInspectionFile->errorString()));
-        delete _activeInspectionFile;
-        _activeInspectionFile = nullptr;
+    if (!openActiveArtifactFile(partialPath, startOffset)) {
         return;
     }
-    _activeInspectionBytesWritten = startOffset;
 
     QNetworkReply *reply = _networkManager.get(request);
     _activeInspectionReply = reply;
@@ -595,20 +623,12 @@ void GitHubClient::inspectArtifactFromUrl(const QUrl &url, const QString &owner,
     _activeInspectionPartialPath = partialPath;
 
     // Write data incrementally as it arrives
-    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
-        if (this->_activeInspectionFile && this->_activeInspectionFile->isOpen()) {
-            QByteArray data = reply->readAll();
-            qint64 written = this->_activeInspectionFile->write(data);
-            if (written > 0) {
-                this->_activeInspectionBytesWritten += written;
-            }
-        }
-    });
+    streamReplyToActiveFile(reply);
 
-    connect(reply, &QNetworkReply::downloadProgress, this, [this, startOffset](qint64 bytesReceived, qint64 bytesTotal) {
+    connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 bytesReceived, qint64 bytesTotal) {
         // Adjust for resume offset
-        qint64 totalReceived = startOffset + bytesReceived;
-        qint64 totalSize = (bytesTotal > 0) ? (startOffset + bytesTotal) : 0;
+        qint64 totalReceived = _activeInspectionResumeOffset + bytesReceived;
+        qint64 totalSize = (bytesTotal > 0) ? (_activeInspectionResumeOffset + bytesTotal) : 0;
 
         // Store total size for partial download info
         if (totalSize > 0) {
@@ -619,53 +639,180 @@ void GitHubClient::inspectArtifactFromUrl(const QUrl &url, const QString &owner,
     });
 
     connect(reply, &QNetworkReply::finished, this, [this, reply, owner, repo, artifactId, artifactName, branch, zipPath, partialPath]() {
-        this->_activeInspectionReply = nullptr;
-        this->_activeInspectionZipPath.clear();
-        this->_activeInspectionPartialPath.clear();
-
-        // Close and clean up the file
-        if (this->_activeInspectionFile) {
-            this->_activeInspectionFile->flush();
-            this->_activeInspectionFile->close();
-            delete this->_activeInspectionFile;
-            this->_activeInspectionFile = nullptr;
-        }
-
-        reply->deleteLater();
+        QString errorMessage;
+        bool ok = finishActiveArtifactFile(reply, partialPath, zipPath, errorMessage);
 
         // Check if cancelled (OperationCanceledError)
-        if (reply->error() == QNetworkReply::OperationCanceledError) {
+        if (reply->error() == QNetworkReply::OperationCanceledError && errorMessage.isEmpty()) {
             qDebug() << "GitHubClient: Artifact inspection cancelled by user";
             return;
         }
 
-        if (reply->error() != QNetworkReply::NoError) {
-            emit error(tr("Failed to download artifact for inspection: %1").arg(reply->errorString()));
-            // Clean up partial file on error
-            QFile::remove(partialPath);
-            clearPartialArtifactDownload();
+        if (!ok) {
+            emit error(tr("Failed to download artifact for inspection: %1").arg(errorMessage));
             return;
         }
 
-        // Rename partial file to final path
-        if (QFile::exists(zipPath)) {
-            QFile::remove(zipPath);
+        qDebug() << "GitHubClient: Artifact downloaded for inspection, size:" << QFileInfo(zipPath).size();
+
+        // Scan the ZIP for all image files (WIC + SPU)
+        QJsonArray imageFiles = listImageFilesInZip(zipPath);
+        emit artifactContentsReady(artifactId, artifactName, owner, repo, branch, imageFiles, zipPath);
+    });
+}
+
+qint64 GitHubClient::resumeOffsetFor(qint64 artifactId, QString &partialPath) const
+{
+    if (!_partialArtifactDownload.isValid ||
+        _partialArtifactDownload.artifactId != artifactId ||
+        _partialArtifactDownload.bytesDownloaded <= 0) {
+        return 0;
+    }
+
+    // Only trust the partial file if it is exactly as long as recorded
+    QFileInfo fileInfo(_partialArtifactDownload.partialPath);
+    if (!fileInfo.exists() || fileInfo.size() != _partialArtifactDownload.bytesDownloaded) {
+        return 0;
+    }
+
+    partialPath = _partialArtifactDownload.partialPath;
+    return _partialArtifactDownload.bytesDownloaded;
+}
+
+bool GitHubClient::openActiveArtifactFile(const QString &partialPath, qint64 startOffset)
+{
+    _activeInspectionFile = new QFile(partialPath);
+    QIODevice::OpenMode mode = startOffset > 0 ? (QIODevice::WriteOnly | QIODevice::Append)
+                                                : QIODevice::WriteOnly;
+    if (!_activeInspectionFile->open(mode)) {
+        emit error(tr("Failed to open file for writing: %1").arg(_activeInspectionFile->errorString()));
+        delete _activeInspectionFile;
+        _activeInspectionFile = nullptr;
+        return false;
+    }
+
+    _activeInspectionBytesWritten = startOffset;
+    _activeInspectionResumeOffset = startOffset;
+    _activeInspectionWriteError.clear();
+    return true;
+}
+
+void GitHubClient::streamReplyToActiveFile(QNetworkReply *reply)
+{
+    // Bound what Qt buffers for us; the rest stays in the socket until we catch up
+    reply->setReadBufferSize(ARTIFACT_READ_BUFFER_SIZE);
+
+    // A server that ignores the Range header sends the whole file with 200
+    connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply]() {
+        if (reply != _activeInspectionReply || !_activeInspectionFile || _activeInspectionResumeOffset == 0) {
+            return;
+        }
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (statusCode == 200) {
+            qDebug() << "GitHubClient: Server ignored Range request, restarting artifact download";
+            _activeInspectionFile->resize(0);
+            _activeInspectionBytesWritten = 0;
+            _activeInspectionResumeOffset = 0;
+            _partialArtifactDownload.bytesDownloaded = 0;
+            _partialArtifactDownload.isValid = false;
         }
-        if (!QFile::rename(partialPath, zipPath)) {
-            emit error(tr("Failed to finalize artifact download"));
+    });
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        if (reply != _activeInspectionReply || !_activeInspectionFile || !_activeInspectionFile->isOpen()) {
             return;
         }
 
-        qDebug() << "GitHubClient: Artifact downloaded for inspection, size:" << _activeInspectionBytesWritten;
-        _activeInspectionBytesWritten = 0;
+        while (reply->bytesAvailable() > 0) {
+            QByteArray data = reply->read(ARTIFACT_READ_BUFFER_SIZE);
+            if (data.isEmpty()) {
+                break;
+            }
+            if (_activeInspectionFile->write(data) != data.size()) {
+                qWarning() << "GitHubClient: Failed to write artifact data:" << _activeInspectionFile->errorString();
+                _activeInspectionWriteError = _activeInspectionFile->errorString();
+                reply->abort();
+                return;
+            }
+            _activeInspectionBytesWritten += data.size();
+        }
+    });
+}
 
-        // Clear partial download state since we completed successfully
-        clearPartialArtifactDownload();
+bool GitHubClient::finishActiveArtifactFile(QNetworkReply *reply, const QString &partialPath,
+                                            const QString &finalPath, QString &errorMessage)
+{
+    // Drain anything still buffered (nothing arrives after finished)
+    if (_activeInspectionFile && _activeInspectionFile->isOpen() &&
+        reply->error() == QNetworkReply::NoError && _activeInspectionWriteError.isEmpty()) {
+        while (reply->bytesAvailable() > 0) {
+            QByteArray data = reply->read(ARTIFACT_READ_BUFFER_SIZE);
+            if (_activeInspectionFile->write(data) != data.size()) {
+                _activeInspectionWriteError = _activeInspectionFile->errorString();
+                break;
+            }
+            _activeInspectionBytesWritten += data.size();
+        }
+    }
 
-        // Scan the ZIP for all image files (WIC + SPU)
-        QJsonArray imageFiles = listImageFilesInZip(zipPath);
-        emit artifactContentsReady(artifactId, artifactName, owner, repo, branch, imageFiles, zipPath);
-    });
+    // Close and clean up the file
+    if (_activeInspectionFile) {
+        _activeInspectionFile->flush();
+        _activeInspectionFile->close();
+        delete _activeInspectionFile;
+        _activeInspectionFile = nullptr;
+    }
+
+    _activeInspectionReply = nullptr;
+    _activeInspectionZipPath.clear();
+    _activeInspectionPartialPath.clear();
+    reply->deleteLater();
+
+    qint64 bytesWritten = _activeInspectionBytesWritten;
+    _activeInspectionBytesWritten = 0;
+    _activeInspectionResumeOffset = 0;
+    errorMessage = _activeInspectionWriteError;
+    _activeInspectionWriteError.clear();
+
+    // Cancellation already saved or discarded the partial file
+    if (reply->error() == QNetworkReply::OperationCanceledError && errorMessage.isEmpty()) {
+        return false;
+    }
+
+    if (reply->error() != QNetworkReply::NoError || !errorMessage.isEmpty()) {
+        if (errorMessage.isEmpty()) {
+            errorMessage = reply->errorString();
+        }
+
+        // A dropped connection leaves a valid prefix that the next attempt can
+        // resume with a Range request; an HTTP error response does not
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        // (a failed local write aborts the reply, and its last chunk may be torn)
+        if (bytesWritten > 0 && statusCode < 400 &&
+            reply->error() != QNetworkReply::OperationCanceledError) {
+            _partialArtifactDownload.bytesDownloaded = bytesWritten;
+            _partialArtifactDownload.isValid = true;
+            savePartialArtifactDownload();
+            qDebug() << "GitHubClient: Kept" << bytesWritten << "bytes of failed artifact download for resume";
+        } else {
+            QFile::remove(partialPath);
+            clearPartialArtifactDownload();
+        }
+        return false;
+    }
+
+    // Rename partial file to final path
+    if (QFile::exists(finalPath)) {
+        QFile::remove(finalPath);
+    }
+    if (!QFile::rename(partialPath, finalPath)) {
+        errorMessage = tr("Failed to finalize artifact download");
+        return false;
+    }
+
+    // Clear partial download state since we completed successfully
+    clearPartialArtifactDownload();
+    return true;
 }
 
 QJsonArray GitHubClient::listWicFilesInZip(const QString &zipPath)
@@ -779,28 +926,13 @@ QJsonArray GitHubClient::listImageFilesInZip(const QString &zipPath)
         return imageFiles;
     }
 
-    // Image file extensions to look for
-    QStringList wicExtensions = {".wic", ".wic.gz", ".wic.xz", ".wic.zst", ".wic.bz2"};
-
     while (archive_read_next_header(a, &entry) == ARCHIVE_OK) {
         QString entryName = QString::fromUtf8(archive_entry_pathname(entry));
         qint64 entrySize = archive_entry_size(entry);
         QString displayName = QFileInfo(entryName).fileName();
 
         // Determine the image type from extension
-        QString type;
-        if (entryName.endsWith(".spu", Qt::CaseInsensitive)) {
-            type = "spu";
-        } else if (entryName.endsWith(".vsi", Qt::CaseInsensitive)) {
-            type = "vsi";
-        } else {
-            for (const QString &ext : wicExtensions) {
-                if (entryName.endsWith(ext, Qt::CaseInsensitive)) {
-                    type = "wic";
-                    break;
-                }
-            }
-        }
+        QString type = imageTypeForEntry(entryName);
 
         if (!type.isEmpty()) {
             QJsonObject imageFile;
@@ -822,6 +954,191 @@ QJsonArray GitHubClient::listImageFilesInZip(const QString &zipPath)
     return imageFiles;
 }
 
+QString GitHubClient::imageTypeForEntry(const QString &entryName)
+{
+    static const QStringList wicExtensions = {".wic", ".wic.gz", ".wic.xz", ".wic.zst", ".wic.bz2"};
+
+    if (entryName.endsWith(".spu", Qt::CaseInsensitive)) {
+        return "spu";
+    }
+    if (entryName.endsWith(".vsi", Qt::CaseInsensitive)) {
+        return "vsi";
+    }
+    for (const QString &ext : wicExtensions) {
+        if (entryName.endsWith(ext, Qt::CaseInsensitive)) {
+            return "wic";
+        }
+    }
+    return QString();
+}
+
+void GitHubClient::inspectArtifactRemotely(const QUrl &url, const QString &owner, const QString &repo,
+                                            qint64 artifactId, const QString &artifactName,
+                                            const QString &branch, const QString &zipPath)
+{
+    // Anything unexpected (no Range support, unusual ZIP layout) falls back to
+    // downloading the whole artifact, which is what inspection always did
+    auto fallback = [this, url, owner, repo, artifactId, artifactName, branch, zipPath](const QString &reason) {
+        if (_inspectionCancelled) {
+            return;
+        }
+        qDebug() << "GitHubClient: Remote artifact inspection not possible (" << reason << "), downloading artifact";
+        inspectArtifactFromUrl(url, owner, repo, artifactId, artifactName, branch, zipPath);
+    };
+
+    auto finish = [this, owner, repo, artifactId, artifactName, branch, zipPath](const ZipCentralDirectory &directory) {
+        QJsonArray imageFiles;
+        for (const ZipCentralDirectory::Entry &entry : directory.entries()) {
+            QString type = imageTypeForEntry(entry.name);
+            if (type.isEmpty()) {
+                continue;
+            }
+
+            QJsonObject imageFile;
+            imageFile["filename"] = entry.name;
+            imageFile["size"] = qint64(entry.uncompressedSize);
+            imageFile["display_name"] = QFileInfo(entry.name).fileName();
+            imageFile["type"] = type;
+            imageFile["compressed_size"] = qint64(entry.compressedSize);
+            imageFile["compression"] = ZipCentralDirectory::methodName(entry.method);
+            imageFile["local_header_offset"] = qint64(entry.localHeaderOffset);
+            imageFiles.append(imageFile);
+            qDebug() << "GitHubClient: Found" << type.toUpper() << "file:" << entry.name;
+        }
+
+        qDebug() << "GitHubClient: Found" << imageFiles.size() << "image files in remote ZIP";
+        emit artifactContentsReady(artifactId, artifactName, owner, repo, branch, imageFiles, zipPath);
+    };
+
+    // The first byte tells us the archive size (Content-Range) and whether Range works at all
+    fetchArtifactRange(url, 0, 0, [this, url, fallback, finish](bool ok, const QByteArray &, qint64 archiveSize) {
+        if (_inspectionCancelled) {
+            return;
+        }
+        if (!ok || archiveSize <= 0) {
+            fallback("no range support");
+            return;
+        }
+
+        qint64 tailStart = qMax<qint64>(0, archiveSize - ZipCentralDirectory::TAIL_SIZE);
+        fetchArtifactRange(url, tailStart, archiveSize - 1,
+                           [this, url, fallback, finish, archiveSize, tailStart](bool ok, const QByteArray &tail, qint64) {
+            if (_inspectionCancelled) {
+                return;
+            }
+            if (!ok || tail.size() != archiveSize - tailStart) {
+                fallback("failed to fetch archive tail");
+                return;
+            }
+
+            QString errorMessage;
+            ZipCentralDirectory::Location location = ZipCentralDirectory::locate(tail, quint64(archiveSize), &errorMessage);
+            if (!location.valid) {
+                fallback(errorMessage);
+                return;
+            }
+            if (location.size > quint64(MAX_REMOTE_DIRECTORY_SIZE)) {
+                fallback("central directory too large");
+                return;
+            }
+
+            // Small archives: the directory is already in the tail
+            if (location.offset >= quint64(tailStart)) {
+                QByteArray directoryData = tail.mid(qsizetype(location.offset - quint64(tailStart)), qsizetype(location.size));
+                ZipCentralDirectory directory = ZipCentralDirectory::parse(directoryData, location, &errorMessage);
+                if (!directory.isValid()) {
+                    fallback(errorMessage);
+                    return;
+                }
+                finish(directory);
+                return;
+            }
+
+            fetchArtifactRange(url, qint64(location.offset), qint64(location.offset + location.size) - 1,
+                               [this, fallback, finish, location](bool ok, const QByteArray &directoryData, qint64) {
+                if (_inspectionCancelled) {
+                    return;
+                }
+                if (!ok) {
+                    fallback("failed to fetch central directory");
+                    return;
+                }
+
+                QString errorMessage;
+                ZipCentralDirectory directory = ZipCentralDirectory::parse(directoryData, location, &errorMessage);
+                if (!directory.isValid()) {
+                    fallback(errorMessage);
+                    return;
+                }
+                finish(directory);
+            });
+        });
+    });
+}
+
+void GitHubClient::fetchArtifactRange(const QUrl &url, qint64 first, qint64 last,
+                                      const std::function<void(bool ok, const QByteArray &data, qint64 totalSize)> &done)
+{
+    bool isGitHubUrl = url.host().endsWith("github.com") || url.host().endsWith("githubusercontent.com");
+
+    QNetworkRequest request;
+    if (isGitHubUrl) {
+        request = createAuthenticatedRequest(url);
+    } else {
+        request.setUrl(url);
+        request.setHeader(QNetworkRequest::UserAgentHeader, "Laerdal-SimServer-Imager/1.0");
+    }
+    request.setTransferTimeout(API_TIMEOUT_MS);
+    request.setRawHeader("Range", QString("bytes=%1-%2").arg(first).arg(last).toUtf8());
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    QNetworkReply *reply = _networkManager.get(request);
+    _activeInspectionReply = reply;
+
+    // A server that ignores Range would start sending the whole artifact
+    auto rangeIgnored = std::make_shared<bool>(false);
+    connect(reply, &QNetworkReply::metaDataChanged, this, [reply, rangeIgnored]() {
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (statusCode == 200) {
+            *rangeIgnored = true;
+            reply->abort();
+        }
+    });
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply, rangeIgnored, first, last, done]() {
+        if (_activeInspectionReply == reply) {
+            _activeInspectionReply = nullptr;
+        }
+        reply->deleteLater();
+
+        // Cancelled by the user - nothing to report
+        if (reply->error() == QNetworkReply::OperationCanceledError && !*rangeIgnored) {
+            return;
+        }
+
+        int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (*rangeIgnored || reply->error() != QNetworkReply::NoError || statusCode != 206) {
+            qDebug() << "GitHubClient: Range request failed, status:" << statusCode << reply->errorString();
+            done(false, QByteArray(), 0);
+            return;
+        }
+
+        // Content-Range: bytes first-last/total
+        QByteArray contentRange = reply->rawHeader("Content-Range");
+        qint64 totalSize = contentRange.mid(contentRange.indexOf('/') + 1).toLongLong();
+
+        QByteArray data = reply->readAll();
+        if (data.size() != last - first + 1) {
+            qDebug() << "GitHubClient: Range request returned" << data.size() << "bytes, expected" << (last - first + 1);
+            done(false, QByteArray(), 0);
+            return;
+        }
+
+        done(true, data, totalSize);
+    });
+}
+
 void GitHubClient::inspectArtifactSpuContents(const QString &owner, const QString &repo,
                                                qint64 artifactId, const QString &artifactName,
                                                const QString &branch)
@@ -876,44 +1193,63 @@ void GitHubClient::inspectArtifactSpuFromUrl(const QUrl &url, const QString &own
     // No timeout for downloads - they can take a long time for large files
     request.setTransferTimeout(0);
 
+    // Stream into a partial file, resuming an earlier attempt for this artifact
+    QString partialPath = zipPath + ".partial";
+    qint64 startOffset = resumeOffsetFor(artifactId, partialPath);
+    if (startOffset > 0) {
+        qDebug() << "GitHubClient: Resuming artifact download from offset:" << startOffset;
+        request.setRawHeader("Range", QString("bytes=%1-").arg(startOffset).toUtf8());
+    } else {
+        // Starting over, nothing of an earlier write carries over
+        _partialArtifactDownload = PartialArtifactDownload();
+    }
+
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                          QNetworkRequest::NoLessSafeRedirectPolicy);
 
+    _partialArtifactDownload.partialPath = partialPath;
+    _partialArtifactDownload.finalPath = zipPath;
+    _partialArtifactDownload.owner = owner;
+    _partialArtifactDownload.repo = repo;
+    _partialArtifactDownload.branch = branch;
+    _partialArtifactDownload.artifactName = artifactName;
+    _partialArtifactDownload.artifactId = artifactId;
+    _partialArtifactDownload.downloadUrl = url;
+
+    if (!openActiveArtifactFile(partialPath, startOffset)) {
+        return;
+    }
+
     QNetworkReply *reply = _networkManager.get(request);
     _activeInspectionReply = reply;
     _activeInspectionZipPath = zipPath;
+    _activeInspectionPartialPath = partialPath;
+    streamReplyToActiveFile(reply);
 
     connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 bytesReceived, qint64 bytesTotal) {
-        emit artifactDownloadProgress(bytesReceived, bytesTotal);
+        qint64 totalSize = (bytesTotal > 0) ? (_activeInspectionResumeOffset + bytesTotal) : bytesTotal;
+        if (totalSize > 0) {
+            _partialArtifactDownload.totalSize = totalSize;
+        }
+        emit artifactDownloadProgress(_activeInspectionResumeOffset + bytesReceived, totalSize);
     });
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, owner, repo, artifactId, artifactName, branch, zipPath]() {
-        _activeInspectionReply = nullptr;
-        _activeInspectionZipPath.clear();
-        reply->deleteLater();
+    connect(reply, &QNetworkReply::finished, this, [this, reply, owner, repo, artifactId, artifactName, branch, zipPath, partialPath]() {
+        QString errorMessage;
+        bool ok = finishActiveArtifactFile(reply, partialPath, zipPath, errorMessage);
 
         // Check if cancelled (OperationCanceledError)
-        if (reply->error() == QNetworkReply::OperationCanceledError) {
+        if (reply->error() == QNetworkReply::OperationCanceledError && errorMessage.isEmpty()) {
             qDebug() << "GitHubClient: SPU artifact inspection cancelled by user";
             return;
         }
 
-        if (reply->error() != QNetworkReply::NoError) {
-            emit error(tr("Failed to download artifact for SPU inspection: %1").arg(reply->errorString()));
-            return;
-        }
-
-        QFile file(zipPath);
-        if (!file.open(QIODevice::WriteOnly)) {
-            emit error(tr("Failed to save artifact for SPU inspection: %1").arg(file.errorString()));
+        if (!ok) {
+            emit error(tr("Failed to download artifact for SPU inspection: %1").arg(errorMessage));
             return;
         }
 
-        QByteArray data = reply->readAll();
-        file.write(data);
-        file.close();
-
-        qDebug() << "GitHubClient: Artifact downloaded for SPU inspection, size:" << data.size();
+        qDebug() << "GitHubClient: Artifact downloaded for SPU inspection, size:" << QFileInfo(zipPath).size();
 
         // Scan the ZIP for SPU files
         QJsonArray spuFiles = listSpuFilesInZip(zipPath);
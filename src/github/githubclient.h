@@ -14,6 +14,7 @@
 #include <QNetworkReply>
 #include <QFile>
 #include <QUrl>
+#include <functional>
 
 #ifndef CLI_ONLY_BUILD
 #include <QQmlEngine>
@@ -173,15 +174,18 @@ public:
     QString authToken() const { return _authToken; }
 
     /**
-     * @brief Download an artifact and inspect its contents for WIC files
+     * @brief Inspect an artifact's contents for WIC and SPU files
      * @param owner Repository owner
      * @param repo Repository name
      * @param artifactId Artifact ID
      * @param artifactName Original artifact name for display
      * @param branch Branch name the artifact came from
      *
-     * Downloads the artifact ZIP to a temporary location and emits
-     * artifactContentsReady with the list of WIC files found.
+     * Reads only the ZIP central directory through HTTP Range requests when
+     * the storage server allows it; otherwise (or when resuming a partial
+     * download) downloads the artifact ZIP to the cache. Emits
+     * artifactContentsReady with the list of image files found. The ZIP path
+     * passed along only exists if the artifact was downloaded.
      */
     Q_INVOKABLE void inspectArtifactContents(const QString &owner, const QString &repo,
                                               qint64 artifactId, const QString &artifactName,
@@ -362,10 +366,17 @@ private:
     QJsonArray filterWicArtifacts(const QJsonArray &artifacts,
                                    const QString &owner, const QString &repo,
                                    const QString &branch, const QString &runCreatedAt);
-    void downloadArtifactFromUrl(const QUrl &url, const QString &destinationPath);
+    void downloadArtifactFromUrl(const QUrl &url, const QString &owner, const QString &repo,
+                                 qint64 artifactId, const QString &destinationPath);
     void inspectArtifactFromUrl(const QUrl &url, const QString &owner, const QString &repo,
                                  qint64 artifactId, const QString &artifactName,
                                  const QString &branch, const QString &zipPath);
+    void inspectArtifactRemotely(const QUrl &url, const QString &owner, const QString &repo,
+                                 qint64 artifactId, const QString &artifactName,
+                                 const QString &branch, const QString &zipPath);
+    void fetchArtifactRange(const QUrl &url, qint64 first, qint64 last,
+                            const std::function<void(bool ok, const QByteArray &data, qint64 totalSize)> &done);
+    static QString imageTypeForEntry(const QString &entryName);
     QJsonArray listWicFilesInZip(const QString &zipPath);
     QJsonArray listSpuFilesInZip(const QString &zipPath);
     QJsonArray listImageFilesInZip(const QString &zipPath);  // Combined WIC + SPU
@@ -373,12 +384,27 @@ private:
                                     qint64 artifactId, const QString &artifactName,
                                     const QString &branch, const QString &zipPath);
 
+    // Artifact download helpers shared by the write and inspection paths
+    qint64 resumeOffsetFor(qint64 artifactId, QString &partialPath) const;
+    bool openActiveArtifactFile(const QString &partialPath, qint64 startOffset);
+    void streamReplyToActiveFile(QNetworkReply *reply);
+    bool finishActiveArtifactFile(QNetworkReply *reply, const QString &partialPath,
+                                  const QString &finalPath, QString &errorMessage);
+
     static constexpr const char* API_BASE_URL = "https://api.github.com";
     static constexpr const char* RAW_BASE_URL = "https://raw.githubusercontent.com";
 
     // Timeouts in milliseconds
     static constexpr int API_TIMEOUT_MS = 30000;  // 30 seconds for API calls
 
+    // Artifact ZIPs are several GB; at most this much of one is held in memory.
+    // Qt stops reading from the socket once its buffer is full, so a slow disk
+    // throttles the download instead of growing RSS.
+    static constexpr qint64 ARTIFACT_READ_BUFFER_SIZE = 4 * 1024 * 1024;
+
+    // Remote inspection falls back to a full download for directories larger than this
+    static constexpr qint64 MAX_REMOTE_DIRECTORY_SIZE = 64 * 1024 * 1024;
+
     QNetworkAccessManager _networkManager;
     QString _authToken;
 
@@ -425,6 +451,8 @@ private:
     QString _activeInspectionPartialPath;  // Partial file path during download
     QFile *_activeInspectionFile = nullptr;  // File handle for incremental writes
     qint64 _activeInspectionBytesWritten = 0;  // Bytes written to partial file
+    qint64 _activeInspectionResumeOffset = 0;  // Bytes already on disk when the request started
+    QString _activeInspectionWriteError;  // Set when writing the partial file failed
 
     // Metadata for resumable artifact download
     struct PartialArtifactDownload {
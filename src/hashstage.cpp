@@ -0,0 +1,140 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "hashstage.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t ZERO_CHUNK_SIZE = 1024 * 1024;
+
+std::uint64_t elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - since).count());
+}
+
+} // namespace
+
+HashStage::HashStage(HashFunction hash)
+    : _hash(std::move(hash)), _busy(false), _stopping(false), _busyMs(0), _idleWaitMs(0)
+{
+    _thread = std::thread(&HashStage::_run, this);
+}
+
+HashStage::~HashStage()
+{
+    stop();
+}
+
+void HashStage::add(const char *data, std::size_t len, Callback onHashed)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(Entry{data, len, 0, std::move(onHashed)});
+    }
+    _queued.notify_one();
+}
+
+void HashStage::addZeros(std::uint64_t len)
+{
+    if (len == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(Entry{nullptr, 0, len, nullptr});
+    }
+    _queued.notify_one();
+}
+
+void HashStage::waitForIdle()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(_mutex);
+    _drained.wait(lock, [this] { return (_queue.empty() && !_busy) || _stopping; });
+    _idleWaitMs += elapsedMs(start);
+}
+
+void HashStage::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_stopping && !_thread.joinable())
+            return;
+        _stopping = true;
+    }
+    _queued.notify_all();
+    _drained.notify_all();
+
+    if (_thread.joinable())
+        _thread.join();
+
+    // Release whatever was still waiting to be hashed
+    std::deque<Entry> remaining;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        remaining.swap(_queue);
+    }
+    for (Entry &entry : remaining)
+    {
+        if (entry.onHashed)
+            entry.onHashed();
+    }
+}
+
+std::uint64_t HashStage::busyMs() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _busyMs;
+}
+
+std::uint64_t HashStage::idleWaitMs() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idleWaitMs;
+}
+
+void HashStage::_run()
+{
+    static const std::vector<char> zeros(ZERO_CHUNK_SIZE, 0);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        _queued.wait(lock, [this] { return !_queue.empty() || _stopping; });
+        if (_stopping)
+            break;
+
+        Entry entry = std::move(_queue.front());
+        _queue.pop_front();
+        _busy = true;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        if (entry.data)
+        {
+            _hash(entry.data, entry.len);
+        }
+        for (std::uint64_t remaining = entry.zeros; remaining > 0;)
+        {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, zeros.size()));
+            _hash(zeros.data(), chunk);
+            remaining -= chunk;
+        }
+        std::uint64_t took = elapsedMs(start);
+
+        if (entry.onHashed)
+            entry.onHashed();
+
+        lock.lock();
+        _busy = false;
+        _busyMs += took;
+        if (_queue.empty())
+            _drained.notify_all();
+    }
+}
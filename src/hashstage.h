@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef HASHSTAGE_H
+#define HASHSTAGE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Feeds a running hash from its own thread, strictly in queue order
+ *
+ * The zero-copy write path used to hash each decompressed buffer inline on the
+ * extract thread, so decompression and SHA256 shared one core. With a hash
+ * stage the extract thread only queues the buffer; the stage thread hashes it
+ * and then runs the buffer's callback, which lets the owner release the buffer
+ * once both hashing and the device write have completed.
+ *
+ * Buffers must stay valid until their callback has run. Everything that goes
+ * into the hash while the stage is running has to be queued here, since the
+ * hash result depends on the order of the data.
+ */
+class HashStage
+{
+public:
+    using HashFunction = std::function<void(const char *data, std::size_t len)>;
+    using Callback = std::function<void()>;
+
+    explicit HashStage(HashFunction hash);
+    ~HashStage();
+
+    HashStage(const HashStage&) = delete;
+    HashStage& operator=(const HashStage&) = delete;
+
+    // Queue len bytes at data; onHashed runs on the stage thread afterwards
+    void add(const char *data, std::size_t len, Callback onHashed = nullptr);
+
+    // Queue len zero bytes (ranges that were skipped rather than written)
+    void addZeros(std::uint64_t len);
+
+    // Block until everything queued so far has been hashed
+    void waitForIdle();
+
+    /**
+     * @brief Stop the thread
+     *
+     * Entries still queued are not hashed, but their callbacks still run so
+     * buffers waiting on them are released. The hash is incomplete afterwards,
+     * so this is for cancellation and teardown.
+     */
+    void stop();
+
+    // Time the stage thread spent hashing, and time producers spent in waitForIdle()
+    std::uint64_t busyMs() const;
+    std::uint64_t idleWaitMs() const;
+
+private:
+    struct Entry {
+        const char *data;
+        std::size_t len;
+        std::uint64_t zeros;
+        Callback onHashed;
+    };
+
+    void _run();
+
+    HashFunction _hash;
+    std::thread _thread;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _queued;    // Signalled when work is added or on stop
+    std::condition_variable _drained;   // Signalled when the queue runs empty
+    std::deque<Entry> _queue;
+    bool _busy;
+    bool _stopping;
+
+    std::uint64_t _busyMs;
+    std::uint64_t _idleWaitMs;
+};
+
+#endif // HASHSTAGE_H
@@ -67,6 +67,7 @@
 #include <QFutureWatcher>
 #include "archiveentryiodevice.h"
 #include "archiveentryextractthread.h"
+#include "blockmap.h"
 #include <QJsonObject>
 #include <QTranslator>
 #include <QPasswordDigestor>
@@ -103,6 +104,43 @@ using namespace ImageOptions;
 
 namespace {
     constexpr uint MAX_SUBITEMS_DEPTH = 16;
+
+    /* Yocto builds publish a bmaptool block map next to each .wic image.
+     * Returns the places it may be found for the given source, in the
+     * order bmaptool itself would try them. */
+    QList<QByteArray> blockMapSourcesFor(const QUrl &src)
+    {
+        QList<QByteArray> sources;
+
+        if (src.scheme() == "archive")
+        {
+            if (src.fragment().contains(".wic", Qt::CaseInsensitive))
+            {
+                for (const QString &name : BlockMap::siblingNames(src.fragment()))
+                    sources.append(QString("archive://%1#%2").arg(src.path(), name).toUtf8());
+            }
+        }
+        else if (src.path().contains(".wic", Qt::CaseInsensitive))
+        {
+            for (const QString &name : BlockMap::siblingNames(src.path()))
+            {
+                QUrl sibling(src);
+                sibling.setPath(name);
+                sources.append(sibling.toString(QUrl::FullyEncoded).toLatin1());
+            }
+        }
+
+        return sources;
+    }
+
+    /* Platform specific paths for writing to the given devices */
+    QList<QByteArray> writeDevicePathsFor(const QStringList &devices)
+    {
+        QList<QByteArray> paths;
+        for (const QString &device : devices)
+            paths.append(PlatformQuirks::getWriteDevicePath(device).toLatin1());
+        return paths;
+    }
 } // namespace anonymous
 
 // Initialize static member for secure boot CLI override
@@ -112,7 +150,7 @@ ImageWriter::ImageWriter(QObject *parent)
     : QObject(parent),
       _cacheManager(nullptr),
       _waitingForCacheVerification(false),
-      _src(), _repo(QUrl(QString(OSLIST_URL))),
+      _src(), _repo(QUrl(QString(OSLIST_URL))), _allowSystemAdditionalDsts(false),
       _dst(), _parentCategory(), _osName(), _osReleaseDate(), _currentLang(), _currentLangcode(), _currentKeyboard(),
       _expectedHash(), _cmdline(), _config(), _firstrun(), _cloudinit(), _cloudinitNetwork(), _initFormat(),
       _downloadLen(0), _extrLen(0), _devLen(0), _dlnow(0), _verifynow(0),
@@ -156,6 +194,8 @@ ImageWriter::ImageWriter(QObject *parent)
     _debugAsyncIO = true;       // Async I/O enabled by default for performance
     _debugIPv4Only = false;     // Use both IPv4 and IPv6 by default
     _debugSkipEndOfDevice = false; // Normal behavior; enable for counterfeit cards
+    _debugTrailingVerify = false;  // Verify after writing; enable to read back while writing
+    _debugFastVerify = false;      // Compare written and read-back data with SHA256
     
     // Calculate optimal async queue depth based on system memory
     _debugAsyncQueueDepth = SystemMemoryManager::instance().getOptimalAsyncQueueDepth();
@@ -322,6 +362,12 @@ ImageWriter::ImageWriter(QObject *parent)
     // Connect to specific device removal events
     connect(&_drivelist, &DriveListModel::deviceRemoved,
             this, &ImageWriter::onSelectedDeviceRemoved);
+
+    // Drives multi-selected in the list are written together with the main destination
+    connect(&_drivelist, &DriveListModel::selectionChanged,
+            this, [this]() {
+                setAdditionalDsts(_drivelist.selectedDevices());
+            });
     
     // Connect drive list poll timing events for performance tracking
     // Only record polls that take longer than 200ms to avoid noise from normal fast polls
@@ -698,6 +744,61 @@ void ImageWriter::setDst(const QString &device, quint64 deviceSize)
     }
 
     qDebug() << "Device selection changed to:" << device;
+
+    // A drive picked as the main destination is not written a second time
+    _updateAdditionalDsts();
+}
+
+void ImageWriter::setAdditionalDsts(const QStringList &devices, bool allowSystemDrives)
+{
+    _requestedAdditionalDsts = devices;
+    _allowSystemAdditionalDsts = allowSystemDrives;
+    _updateAdditionalDsts();
+}
+
+void ImageWriter::_updateAdditionalDsts()
+{
+    QStringList devices;
+    for (const QString &device : std::as_const(_requestedAdditionalDsts))
+    {
+        if (device == _dst || devices.contains(device))
+            continue;
+
+        // The same checks the main destination gets when it is selected.
+        // Drives not in the list yet (command line) are validated by the caller.
+        if (const DriveListItem *drive = _drivelist.findDrive(device))
+        {
+            if (drive->property("isReadOnly").toBool())
+            {
+                qDebug() << "Not writing to read-only device" << device;
+                continue;
+            }
+            if (drive->property("isSystem").toBool() && !_allowSystemAdditionalDsts)
+            {
+                qDebug() << "Not writing to system drive" << device;
+                continue;
+            }
+        }
+        devices.append(device);
+    }
+
+    if (devices != _additionalDsts)
+    {
+        _additionalDsts = devices;
+        qDebug() << "Additional devices to write to:" << _additionalDsts;
+    }
+}
+
+void ImageWriter::_configureAdditionalTargets(DownloadThread *thread)
+{
+    if (_additionalDsts.isEmpty())
+        return;
+
+    thread->setAdditionalTargets(writeDevicePathsFor(_additionalDsts));
+    connect(thread, &DownloadThread::targetFailed, this, [this](const QString &device, const QString &msg) {
+        qDebug() << "Write to" << device << "failed:" << msg;
+        emit targetFailed(device, msg);
+    });
 }
 
 /* Returns true if src and dst are set and destination device is still valid */
@@ -838,10 +939,14 @@ void ImageWriter::startWrite()
             thread->setDebugAsyncQueueDepth(_debugAsyncQueueDepth);
             thread->setDebugIPv4Only(_debugIPv4Only);
             thread->setDebugSkipEndOfDevice(_debugSkipEndOfDevice);
+            thread->setDebugTrailingVerify(_debugTrailingVerify);
+            thread->setVerifyDigest(_debugFastVerify ? VerifyDigest::Algorithm::Xxh3_128 : VerifyDigest::Algorithm::Sha256);
             thread->setVerifyEnabled(_verifyEnabled);
 
             _thread = thread;
 
+            _configureAdditionalTargets(_thread);
+
             connect(_thread, SIGNAL(success()), SLOT(onSuccess()));
             connect(_thread, SIGNAL(error(QString)), SLOT(onError(QString)));
             connect(_thread, SIGNAL(finalizing()), SLOT(onFinalizing()));
@@ -1167,6 +1272,7 @@ void ImageWriter::startWrite()
     QElapsedTimer cacheLookupTimer;
     cacheLookupTimer.start();
     bool potentialCacheHit = !_expectedHash.isEmpty() && _cacheManager->hasPotentialCache(_expectedHash);
+    bool cachedImageExpanded = false;
     _performanceStats->recordEvent(PerformanceStats::EventType::CacheLookup,
         static_cast<quint32>(cacheLookupTimer.elapsed()), true,
         potentialCacheHit ? "potential_hit" : (_expectedHash.isEmpty() ? "no_hash" : "miss"));
@@ -1174,21 +1280,24 @@ void ImageWriter::startWrite()
     if (potentialCacheHit)
     {
         // Use background cache manager to check cache file integrity
-        CacheManager::CacheStatus cacheStatus = _cacheManager->getCacheStatus();
+        CacheManager::CacheStatus cacheStatus = _cacheManager->getCacheStatus(_expectedHash);
         qDebug() << "Cache status: verificationComplete=" << cacheStatus.verificationComplete
                  << "isValid=" << cacheStatus.isValid
                  << "file=" << cacheStatus.cacheFileName;
 
         if (cacheStatus.verificationComplete && cacheStatus.isValid)
         {
-            qDebug() << "Using verified cache file (background verified):" << cacheStatus.cacheFileName;
+            qDebug() << "Using verified cache file (background verified):" << cacheStatus.cacheFileName
+                     << (cacheStatus.expanded ? "(expanded)" : "");
             // Use cached file
+            _cacheManager->markUsed(_expectedHash);
             urlstr = QUrl::fromLocalFile(cacheStatus.cacheFileName).toString(_src.FullyEncoded).toLatin1();
+            cachedImageExpanded = cacheStatus.expanded;
         }
         else if (cacheStatus.verificationComplete && !cacheStatus.isValid)
         {
             qDebug() << "Cache file failed background integrity check, invalidating and proceeding with download";
-            _cacheManager->invalidateCache();
+            _cacheManager->invalidateCache(_expectedHash);
             // Continue with original URL - cache will be recreated during download
         }
         else
@@ -1251,7 +1360,10 @@ void ImageWriter::startWrite()
     }
     else if (QUrl(urlstr).isLocalFile())
     {
-        _thread = new LocalFileExtractThread(urlstr, writeDevicePath.toLatin1(), _expectedHash, this);
+        LocalFileExtractThread *localThread = new LocalFileExtractThread(urlstr, writeDevicePath.toLatin1(), _expectedHash, this);
+        // Expanded cache entries are already decompressed
+        localThread->setSparseImage(cachedImageExpanded);
+        _thread = localThread;
     }
     else
     {
@@ -1266,6 +1378,7 @@ void ImageWriter::startWrite()
 
     // Set the extract size for accurate write progress (compressed images have larger extracted size)
     _thread->setExtractTotal(_extrLen > 0 ? _extrLen : _downloadLen);
+    _thread->setDownloadSize(_downloadLen);
 
     connect(_thread, SIGNAL(success()), SLOT(onSuccess()));
     connect(_thread, SIGNAL(error(QString)), SLOT(onError(QString)));
@@ -1493,6 +1606,12 @@ void ImageWriter::startWrite()
                     PerformanceStats::EventType::AsyncIOTiming,
                     totalMs, bytesWritten, true, metadata);
             });
+    connect(_thread, &DownloadThread::eventWriteTuning,
+            this, [this](int queueDepth, quint32 writeSizeKB, quint32 throughputKBps, quint32 avgLatencyUs, QString reason){
+                QString metadata = QString("reason: %1; queueDepth: %2; writeSizeKB: %3; throughputKBps: %4; avgLatencyUs: %5")
+                    .arg(reason).arg(queueDepth).arg(writeSizeKB).arg(throughputKBps).arg(avgLatencyUs);
+                _performanceStats->recordEvent(PerformanceStats::EventType::WriteTuning, 0, true, metadata);
+            });
     
     // Forward bottleneck state to QML for UI feedback
     connect(_thread, &DownloadThread::bottleneckStateChanged,
@@ -1546,22 +1665,33 @@ void ImageWriter::startWrite()
     _thread->setDebugAsyncQueueDepth(_debugAsyncQueueDepth);
     _thread->setDebugIPv4Only(_debugIPv4Only);
     _thread->setDebugSkipEndOfDevice(_debugSkipEndOfDevice);
+    _thread->setDebugTrailingVerify(_debugTrailingVerify);
+    _thread->setVerifyDigest(_debugFastVerify ? VerifyDigest::Algorithm::Xxh3_128 : VerifyDigest::Algorithm::Sha256);
+
+    _configureAdditionalTargets(_thread);
+
+    // VSI images carry their own sparse information
+    if (!_multipleFilesInZip && !lowercaseurl.endsWith(".vsi"))
+    {
+        _thread->setBlockMapSources(blockMapSourcesFor(_src));
+    }
 
     // Only set up cache operations for remote downloads, not when using cached files as source
     if (!_expectedHash.isEmpty() && !QUrl(urlstr).isLocalFile())
     {
         // Use CacheManager to setup cache for download
         QString cacheFilePath;
-        if (_cacheManager->setupCacheForDownload(_expectedHash, _downloadLen, cacheFilePath))
+        bool expanded = _canCacheExpanded();
+        if (_cacheManager->setupCacheForDownload(_expectedHash, expanded ? _extrLen : _downloadLen, cacheFilePath))
         {
-            qDebug() << "Setting up cache file for download:" << cacheFilePath;
-            _thread->setCacheFile(cacheFilePath, _downloadLen);
+            qDebug() << "Setting up cache file for download:" << cacheFilePath << (expanded ? "(expanded)" : "");
+            _thread->setCacheFile(cacheFilePath, _downloadLen, expanded);
             // Connect to CacheManager for cache updates (extract uncompressed hash from signal)
             connect(_thread, &DownloadThread::cacheFileHashUpdated,
-                    this, [this](const QByteArray& cacheFileHash, const QByteArray& imageHash) {
+                    this, [this, expanded](const QByteArray& cacheFileHash, const QByteArray& imageHash) {
                         qDebug() << "DownloadThread cache update - cacheFileHash:" << cacheFileHash << "imageHash:" << imageHash;
                         // Update cache with both uncompressed hash (imageHash) and compressed hash (cacheFileHash)
-                        _cacheManager->updateCacheFile(imageHash, cacheFileHash);
+                        _cacheManager->updateCacheFile(imageHash, cacheFileHash, expanded);
                     });
             // Connect partial cache preservation for resume support
             // Use DirectConnection to ensure the slot executes immediately when signal is emitted,
@@ -1672,7 +1802,7 @@ void ImageWriter::skipCacheVerification()
 
     // Proceed with download (not using cache)
     qDebug() << "Cache verification skipped, invalidating cache and proceeding with download";
-    _cacheManager->invalidateCache();
+    _cacheManager->invalidateCache(_expectedHash);
     _continueStartWriteAfterCacheVerification(false); // false = cache not valid, use download
 }
 
@@ -3506,6 +3636,32 @@ void ImageWriter::setDebugSkipEndOfDevice(bool enabled)
     }
 }
 
+bool ImageWriter::getDebugTrailingVerify() const
+{
+    return _debugTrailingVerify;
+}
+
+void ImageWriter::setDebugTrailingVerify(bool enabled)
+{
+    if (_debugTrailingVerify != enabled) {
+        _debugTrailingVerify = enabled;
+        qDebug() << "Debug: Trailing verify" << (enabled ? "enabled" : "disabled");
+    }
+}
+
+bool ImageWriter::getDebugFastVerify() const
+{
+    return _debugFastVerify;
+}
+
+void ImageWriter::setDebugFastVerify(bool enabled)
+{
+    if (_debugFastVerify != enabled) {
+        _debugFastVerify = enabled;
+        qDebug() << "Debug: Verify digest" << (enabled ? "XXH3-128" : "SHA256");
+    }
+}
+
 // Platform-specific implementation (defined in platform-specific source files)
 extern QString getRsaKeyFingerprint(const QString &keyPath);
 
@@ -3964,9 +4120,9 @@ void ImageWriter::onCacheVerificationProgress(qint64 bytesProcessed, qint64 tota
     }
 }
 
-void ImageWriter::onCacheVerificationComplete(bool isValid)
+void ImageWriter::onCacheVerificationComplete(bool isValid, const QByteArray &hash)
 {
-    if (!_waitingForCacheVerification) {
+    if (!_waitingForCacheVerification || hash != _expectedHash) {
         return; // Not waiting for this verification
     }
 
@@ -4031,17 +4187,29 @@ void ImageWriter::onSelectedDeviceRemoved(const QString &device)
     }
 }
 
+bool ImageWriter::_canCacheExpanded() const
+{
+    // Only the plain download extractor hands its decompressed output to the
+    // cache, and the budget check needs the decompressed size up front
+    return _cacheManager->expandedCache() && !_multipleFilesInZip && _extrLen > 0 &&
+           !_cacheManager->getCacheStatus().customCacheFile &&
+           _thread && _thread->metaObject() == &DownloadExtractThread::staticMetaObject;
+}
+
 void ImageWriter::_continueStartWriteAfterCacheVerification(bool cacheIsValid)
 {
     QString urlstr = _src.toString(_src.FullyEncoded);
 
+    bool cachedImageExpanded = false;
     if (cacheIsValid) {
         QString cacheFilePath = _cacheManager->getCacheFilePath(_expectedHash);
-        qDebug() << "Using verified cache file:" << cacheFilePath;
+        cachedImageExpanded = _cacheManager->getCacheStatus(_expectedHash).expanded;
+        qDebug() << "Using verified cache file:" << cacheFilePath << (cachedImageExpanded ? "(expanded)" : "");
+        _cacheManager->markUsed(_expectedHash);
         urlstr = QUrl::fromLocalFile(cacheFilePath).toString(_src.FullyEncoded);
     } else {
         qDebug() << "Cache file invalid, invalidating and using original URL";
-        _cacheManager->invalidateCache();
+        _cacheManager->invalidateCache(_expectedHash);
     }
 
     // Proactive validation for local sources before spawning threads
@@ -4072,7 +4240,12 @@ void ImageWriter::_continueStartWriteAfterCacheVerification(bool cacheIsValid)
         if (lowercaseurl.endsWith(".vsi"))
             _thread = new VsiExtractThread(urlstr.toLatin1(), writeDevicePath.toLatin1(), _expectedHash, this);
         else
-            _thread = new LocalFileExtractThread(urlstr.toLatin1(), writeDevicePath.toLatin1(), _expectedHash, this);
+        {
+            LocalFileExtractThread *localThread = new LocalFileExtractThread(urlstr.toLatin1(), writeDevicePath.toLatin1(), _expectedHash, this);
+            // Expanded cache entries are already decompressed
+            localThread->setSparseImage(cachedImageExpanded);
+            _thread = localThread;
+        }
     }
     else
     {
@@ -4093,6 +4266,7 @@ void ImageWriter::_continueStartWriteAfterCacheVerification(bool cacheIsValid)
 
     // Set the extract size for accurate write progress (compressed images have larger extracted size)
     _thread->setExtractTotal(_extrLen > 0 ? _extrLen : _downloadLen);
+    _thread->setDownloadSize(_downloadLen);
 
     connect(_thread, SIGNAL(success()), SLOT(onSuccess()));
     connect(_thread, SIGNAL(error(QString)), SLOT(onError(QString)));
@@ -4320,6 +4494,12 @@ void ImageWriter::_continueStartWriteAfterCacheVerification(bool cacheIsValid)
                     PerformanceStats::EventType::AsyncIOTiming,
                     totalMs, bytesWritten, true, metadata);
             });
+    connect(_thread, &DownloadThread::eventWriteTuning,
+            this, [this](int queueDepth, quint32 writeSizeKB, quint32 throughputKBps, quint32 avgLatencyUs, QString reason){
+                QString metadata = QString("reason: %1; queueDepth: %2; writeSizeKB: %3; throughputKBps: %4; avgLatencyUs: %5")
+                    .arg(reason).arg(queueDepth).arg(writeSizeKB).arg(throughputKBps).arg(avgLatencyUs);
+                _performanceStats->recordEvent(PerformanceStats::EventType::WriteTuning, 0, true, metadata);
+            });
     
     // Forward bottleneck state to QML for UI feedback
     connect(_thread, &DownloadThread::bottleneckStateChanged,
@@ -4365,22 +4545,25 @@ void ImageWriter::_continueStartWriteAfterCacheVerification(bool cacheIsValid)
     qDebug() << "_continueStartWrite: Passing to thread - initFormat:" << _initFormat << "cloudinit empty:" << _cloudinit.isEmpty() << "cloudinitNetwork empty:" << _cloudinitNetwork.isEmpty();
     _thread->setImageCustomisation(_config, _cmdline, _firstrun, _cloudinit, _cloudinitNetwork, _initFormat, _advancedOptions);
 
+    _configureAdditionalTargets(_thread);
+
     // Handle caching setup for downloads using CacheManager
     // Only set up caching when we're downloading (not using cached file as source)
     if (!_expectedHash.isEmpty() && !cacheIsValid)
     {
         // Use CacheManager to setup cache for download
         QString cacheFilePath;
-        if (_cacheManager->setupCacheForDownload(_expectedHash, _downloadLen, cacheFilePath))
+        bool expanded = _canCacheExpanded();
+        if (_cacheManager->setupCacheForDownload(_expectedHash, expanded ? _extrLen : _downloadLen, cacheFilePath))
         {
-            qDebug() << "Setting up cache file for download:" << cacheFilePath;
-            _thread->setCacheFile(cacheFilePath, _downloadLen);
+            qDebug() << "Setting up cache file for download:" << cacheFilePath << (expanded ? "(expanded)" : "");
+            _thread->setCacheFile(cacheFilePath, _downloadLen, expanded);
             // Connect to CacheManager for cache updates (pass both hashes correctly)
             connect(_thread, &DownloadThread::cacheFileHashUpdated,
-                    this, [this](const QByteArray& cacheFileHash, const QByteArray& imageHash) {
+                    this, [this, expanded](const QByteArray& cacheFileHash, const QByteArray& imageHash) {
                         qDebug() << "DownloadThread cache update - cacheFileHash:" << cacheFileHash << "imageHash:" << imageHash;
                         // Update cache with both uncompressed hash (imageHash) and compressed hash (cacheFileHash)
-                        _cacheManager->updateCacheFile(imageHash, cacheFileHash);
+                        _cacheManager->updateCacheFile(imageHash, cacheFileHash, expanded);
                     });
             // Connect partial cache preservation for resume support
             // Use DirectConnection to ensure the slot executes immediately when signal is emitted,
@@ -5036,6 +5219,13 @@ void ImageWriter::setSrcSpuArtifact(qint64 artifactId, const QString &owner,
     qDebug() << "  SPU filename:" << spuFilename;
     qDebug() << "  ZIP path:" << zipPath;
 
+    // Remote inspection lists the artifact without downloading it; stream it instead
+    if (zipPath.isEmpty() || !QFile::exists(zipPath)) {
+        qDebug() << "  ZIP not downloaded, streaming the SPU from the artifact";
+        setSrcSpuArtifactStreaming(artifactId, owner, repo, branch, spuFilename);
+        return;
+    }
+
     _isSpuCopyMode = true;
     _spuArchivePath = zipPath;
     _spuEntryName = spuFilename;
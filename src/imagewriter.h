@@ -111,6 +111,10 @@ public:
     /* Set device to write to */
     Q_INVOKABLE void setDst(const QString &device, quint64 deviceSize = 0);
 
+    /* Set further devices to write the same image to (flash several at once).
+       Read-only drives and, unless allowSystemDrives is set, system drives are left out. */
+    Q_INVOKABLE void setAdditionalDsts(const QStringList &devices, bool allowSystemDrives = false);
+
     /* Set verification enabled */
     Q_INVOKABLE void setVerifyEnabled(bool verify);
 
@@ -323,6 +327,10 @@ public:
     Q_INVOKABLE void setDebugIPv4Only(bool enabled);
     Q_INVOKABLE bool getDebugSkipEndOfDevice() const;
     Q_INVOKABLE void setDebugSkipEndOfDevice(bool enabled);
+    Q_INVOKABLE bool getDebugTrailingVerify() const;
+    Q_INVOKABLE void setDebugTrailingVerify(bool enabled);
+    Q_INVOKABLE bool getDebugFastVerify() const;
+    Q_INVOKABLE void setDebugFastVerify(bool enabled);
     
     // Customisation API
     Q_INVOKABLE void applyCustomisationFromSettings(const QVariantMap &settings);  // Main entry: generates scripts from settings
@@ -481,6 +489,7 @@ signals:
     void verifyProgress(QVariant now, QVariant total);
     void error(QVariant msg);
     void success();
+    void targetFailed(QVariant device, QVariant msg);
     void fileSelected(QVariant filename);
     void cancelled();
     void finalizing();
@@ -532,7 +541,7 @@ protected slots:
     void onNetworkConnectionStats(const QString &statsMetadata, const QUrl &url);
     void onSTPdetected();
     void onCacheVerificationProgress(qint64 bytesProcessed, qint64 totalBytes);
-    void onCacheVerificationComplete(bool isValid);
+    void onCacheVerificationComplete(bool isValid, const QByteArray &hash);
     void onSelectedDeviceRemoved(const QString &device);
     void onOsListRefreshTimeout();
 
@@ -562,6 +571,8 @@ private:
 
 protected:
     QUrl _src, _repo, _startupImageUrl;
+    QStringList _requestedAdditionalDsts, _additionalDsts;
+    bool _allowSystemAdditionalDsts;
     QString _dst, _parentCategory, _osName, _osReleaseDate, _currentLang, _currentLangcode, _currentKeyboard;
     QByteArray _expectedHash, _cmdline, _config, _firstrun, _cloudinit, _cloudinitNetwork, _initFormat;
     ImageOptions::AdvancedOptions _advancedOptions;
@@ -619,6 +630,8 @@ protected:
     int _debugAsyncQueueDepth;
     bool _debugIPv4Only;
     bool _debugSkipEndOfDevice;
+    bool _debugTrailingVerify;
+    bool _debugFastVerify;
 
     // Laerdal-specific: GitHub and repository management
     GitHubAuth *_githubAuth;
@@ -649,6 +662,9 @@ protected:
     void _applySystemdCustomisationFromSettings(const QVariantMap &s);
     void _applyCloudInitCustomisationFromSettings(const QVariantMap &s);
     void _continueStartWriteAfterCacheVerification(bool cacheIsValid);
+    bool _canCacheExpanded() const;
+    void _updateAdditionalDsts();
+    void _configureAdditionalTargets(DownloadThread *thread);
     void scheduleOsListRefresh();
 };
 
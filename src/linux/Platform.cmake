@@ -22,8 +22,9 @@ set(PLATFORM_SOURCES
     linux/linuxdrivelist.cpp
     linux/stpanalyzer.h
     linux/stpanalyzer.cpp
+    linux/drivehotplugmonitor.h
+    linux/drivehotplugmonitor.cpp
     linux/acceleratedcryptographichash_gnutls.cpp
-    linux/bootimgcreator_linux.cpp
     linux/rsakeyfingerprint_linux.cpp
     linux/file_operations_linux.cpp
     linux/platformquirks_linux.cpp
@@ -0,0 +1,392 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "drivehotplugmonitor.h"
+#include "linuxdrivelist.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+namespace {
+
+// Multicast groups of NETLINK_KOBJECT_UEVENT
+constexpr unsigned int GROUP_KERNEL = 1;
+constexpr unsigned int GROUP_UDEV = 2;
+
+// Header udevd puts in front of the properties it rebroadcasts
+struct UdevMonitorHeader {
+    char prefix[8];         // "libudev"
+    unsigned int magic;     // 0xfeedcafe, network byte order
+    unsigned int headerSize;
+    unsigned int propertiesOff;
+    unsigned int propertiesLen;
+};
+constexpr unsigned int UDEV_MONITOR_MAGIC = 0xfeedcafe;
+
+// Inserting a card produces a burst of disk and partition events; describe
+// the disk once the burst is over. Without udevd, also leave the kernel a
+// moment to finish creating the device nodes.
+constexpr int SETTLE_MS_UDEV = 100;
+constexpr int SETTLE_MS_KERNEL = 500;
+
+constexpr int DEFAULT_FALLBACK_INTERVAL_MS = 30000;
+constexpr int RECEIVE_BUFFER_SIZE = 1024 * 1024;
+
+bool sameDrive(const Drivelist::DeviceDescriptor &a, const Drivelist::DeviceDescriptor &b)
+{
+    return a.device == b.device
+        && a.description == b.description
+        && a.busType == b.busType
+        && a.size == b.size
+        && a.blockSize == b.blockSize
+        && a.logicalBlockSize == b.logicalBlockSize
+        && a.mountpoints == b.mountpoints
+        && a.mountpointLabels == b.mountpointLabels
+        && a.isReadOnly == b.isReadOnly
+        && a.isSystem == b.isSystem
+        && a.isVirtual == b.isVirtual
+        && a.isRemovable == b.isRemovable
+        && a.isCard == b.isCard
+        && a.isSCSI == b.isSCSI
+        && a.isUSB == b.isUSB;
+}
+
+// "/devices/pci0000:00/.../block/sdb/sdb1" -> "/dev/sdb" for a partition
+QString diskForDevpath(const QByteArray &devpath, bool isPartition)
+{
+    QList<QByteArray> parts = devpath.split('/');
+    while (!parts.isEmpty() && parts.last().isEmpty())
+        parts.removeLast();
+
+    int index = parts.size() - (isPartition ? 2 : 1);
+    if (index < 0 || parts.at(index).isEmpty())
+        return QString();
+
+    // sysfs replaces '/' in kernel names (cciss!c0d0) with '!'
+    QByteArray name = parts.at(index);
+    name.replace('!', '/');
+    return QStringLiteral("/dev/") + QString::fromLocal8Bit(name);
+}
+
+} // namespace
+
+DriveHotplugMonitor::DriveHotplugMonitor(QObject *parent)
+    : QObject(parent), _s(-1), _mountsFd(-1), _fromUdev(false), _paused(false), _published(false),
+      _fullRescanPending(false), _qsn(nullptr), _mountsQsn(nullptr)
+{
+    _settleTimer.setSingleShot(true);
+    connect(&_settleTimer, &QTimer::timeout, this, &DriveHotplugMonitor::applyPendingChanges);
+
+    _fallbackTimer.setInterval(DEFAULT_FALLBACK_INTERVAL_MS);
+    connect(&_fallbackTimer, &QTimer::timeout, this, &DriveHotplugMonitor::rescan);
+}
+
+DriveHotplugMonitor::~DriveHotplugMonitor()
+{
+    stop();
+}
+
+bool DriveHotplugMonitor::start()
+{
+    if (_s != -1)
+        return true; /* Already listening */
+
+    _s = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (_s < 0)
+    {
+        qDebug() << "DriveHotplugMonitor: cannot open uevent socket:" << strerror(errno);
+        _s = -1;
+        return false;
+    }
+
+    _fromUdev = QFile::exists("/run/udev/control");
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = _fromUdev ? GROUP_UDEV : GROUP_KERNEL;
+    if (bind(_s, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        qDebug() << "DriveHotplugMonitor: cannot bind uevent socket:" << strerror(errno);
+        close(_s);
+        _s = -1;
+        return false;
+    }
+
+    int on = 1;
+    setsockopt(_s, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+    int rcvbuf = RECEIVE_BUFFER_SIZE;
+    if (setsockopt(_s, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+        setsockopt(_s, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    _qsn = new QSocketNotifier(_s, QSocketNotifier::Read, this);
+    connect(_qsn, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), SLOT(onUevent(QSocketDescriptor,QSocketNotifier::Type)));
+
+    /* Mounting does not produce a uevent, but the mount table signals POLLPRI on every change */
+    _mountsFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (_mountsFd >= 0)
+    {
+        _mountsQsn = new QSocketNotifier(_mountsFd, QSocketNotifier::Exception, this);
+        connect(_mountsQsn, SIGNAL(activated(QSocketDescriptor,QSocketNotifier::Type)), SLOT(onMountsChanged(QSocketDescriptor,QSocketNotifier::Type)));
+    }
+
+    _settleTimer.setInterval(_fromUdev ? SETTLE_MS_UDEV : SETTLE_MS_KERNEL);
+    if (!_paused)
+        _fallbackTimer.start();
+
+    qDebug() << "DriveHotplugMonitor: listening for" << (_fromUdev ? "udev" : "kernel") << "block device events";
+    return true;
+}
+
+void DriveHotplugMonitor::stop()
+{
+    _settleTimer.stop();
+    _fallbackTimer.stop();
+
+    if (_mountsFd != -1)
+    {
+        _mountsQsn->setEnabled(false);
+        _mountsQsn->deleteLater();
+        _mountsQsn = nullptr;
+        close(_mountsFd);
+        _mountsFd = -1;
+    }
+    if (_s != -1)
+    {
+        _qsn->setEnabled(false);
+        _qsn->deleteLater();
+        _qsn = nullptr;
+        close(_s);
+        _s = -1;
+    }
+}
+
+void DriveHotplugMonitor::setPaused(bool paused)
+{
+    if (_paused == paused)
+        return;
+
+    _paused = paused;
+    if (paused)
+    {
+        _settleTimer.stop();
+        _fallbackTimer.stop();
+        return;
+    }
+
+    if (_s != -1)
+        _fallbackTimer.start();
+    if (!_published)
+        _fullRescanPending = true;
+    if (_fullRescanPending || !_dirtyDisks.isEmpty())
+        _update();
+}
+
+void DriveHotplugMonitor::setFallbackInterval(int ms)
+{
+    _fallbackTimer.setInterval(ms);
+}
+
+void DriveHotplugMonitor::rescan()
+{
+    _fullRescanPending = true;
+    _update();
+}
+
+void DriveHotplugMonitor::onUevent(QSocketDescriptor, QSocketNotifier::Type)
+{
+    char buf[8192];
+    char control[CMSG_SPACE(sizeof(struct ucred))];
+
+    for (;;)
+    {
+        struct sockaddr_nl sender;
+        struct iovec iov = { buf, sizeof(buf) };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &sender;
+        msg.msg_namelen = sizeof(sender);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(_s, &msg, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOBUFS)
+            {
+                /* Events were dropped; we no longer know which disks changed */
+                qDebug() << "DriveHotplugMonitor: uevent socket overflowed, rescanning";
+                _fullRescanPending = true;
+                _scheduleUpdate();
+                continue;
+            }
+            break; /* EAGAIN: drained */
+        }
+        if (msg.msg_flags & MSG_TRUNC)
+            continue;
+
+        /* Only trust the kernel, or udevd running as root */
+        if ((!_fromUdev && sender.nl_pid != 0) || (_fromUdev && sender.nl_pid == 0))
+            continue;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_type != SCM_CREDENTIALS)
+            continue;
+        struct ucred cred;
+        memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+        if (cred.uid != 0)
+            continue;
+
+        /* Both formats are NUL separated KEY=value pairs after a header */
+        ssize_t pos, end = n;
+        if (n >= ssize_t(sizeof(UdevMonitorHeader)) && memcmp(buf, "libudev", 8) == 0)
+        {
+            UdevMonitorHeader header;
+            memcpy(&header, buf, sizeof(header));
+            if (ntohl(header.magic) != UDEV_MONITOR_MAGIC || header.propertiesOff >= size_t(n))
+                continue;
+            pos = header.propertiesOff;
+            end = qMin<ssize_t>(n, ssize_t(header.propertiesOff) + ssize_t(header.propertiesLen));
+        }
+        else
+        {
+            /* Kernel: "action@devpath" */
+            pos = ssize_t(strnlen(buf, size_t(n))) + 1;
+        }
+
+        QByteArray subsystem, devtype, devpath;
+        while (pos < end)
+        {
+            QByteArray line(buf + pos, int(strnlen(buf + pos, size_t(end - pos))));
+            pos += line.size() + 1;
+            if (line.startsWith("SUBSYSTEM="))
+                subsystem = line.mid(10);
+            else if (line.startsWith("DEVTYPE="))
+                devtype = line.mid(8);
+            else if (line.startsWith("DEVPATH="))
+                devpath = line.mid(8);
+        }
+        if (subsystem != "block" || devpath.isEmpty())
+            continue;
+
+        /* A partition changing changes the labels shown for its disk */
+        QString disk = diskForDevpath(devpath, devtype == "partition");
+        if (!disk.isEmpty())
+        {
+            _dirtyDisks.insert(disk);
+            _scheduleUpdate();
+        }
+    }
+}
+
+void DriveHotplugMonitor::onMountsChanged(QSocketDescriptor, QSocketNotifier::Type)
+{
+    _fullRescanPending = true;
+    _scheduleUpdate();
+}
+
+void DriveHotplugMonitor::applyPendingChanges()
+{
+    if (!_paused)
+        _update();
+}
+
+void DriveHotplugMonitor::_scheduleUpdate()
+{
+    if (!_paused && !_settleTimer.isActive())
+        _settleTimer.start();
+}
+
+void DriveHotplugMonitor::_update()
+{
+    _settleTimer.stop();
+
+    QElapsedTimer t1;
+    t1.start();
+    bool changed = false;
+
+    if (_fullRescanPending)
+    {
+        _fullRescanPending = false;
+        _dirtyDisks.clear();
+        if (_fallbackTimer.isActive())
+            _fallbackTimer.start(); /* Restart the interval */
+
+        std::map<std::string, Drivelist::DeviceDescriptor> fresh;
+        for (const auto &d : Drivelist::ListStorageDevices())
+            fresh.emplace(d.device, d);
+
+        changed = fresh.size() != _devices.size()
+            || !std::equal(fresh.begin(), fresh.end(), _devices.begin(),
+                           [](const auto &a, const auto &b) { return a.first == b.first && sameDrive(a.second, b.second); });
+        _devices.swap(fresh);
+    }
+    else if (!_dirtyDisks.isEmpty())
+    {
+        QStringList disks(_dirtyDisks.cbegin(), _dirtyDisks.cend());
+        _dirtyDisks.clear();
+
+        std::map<std::string, Drivelist::DeviceDescriptor> described;
+        for (const auto &d : Drivelist::ListStorageDevices(disks))
+            described.emplace(d.device, d);
+
+        for (const QString &disk : disks)
+        {
+            std::string key = disk.toStdString();
+            auto now = described.find(key);
+            auto before = _devices.find(key);
+
+            if (now == described.end())
+            {
+                if (before != _devices.end())
+                {
+                    _devices.erase(before);
+                    changed = true;
+                }
+            }
+            else if (before == _devices.end() || !sameDrive(before->second, now->second))
+            {
+                _devices[key] = now->second;
+                changed = true;
+            }
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    quint32 elapsed = static_cast<quint32>(t1.elapsed());
+    emit scanned(elapsed);
+    if (elapsed > 1000)
+        qDebug() << "Enumerating drives took a long time:" << elapsed/1000.0 << "seconds";
+
+    _publish(changed);
+}
+
+void DriveHotplugMonitor::_publish(bool changed)
+{
+    if (!changed && _published)
+        return;
+
+    _published = true;
+    std::vector<Drivelist::DeviceDescriptor> list;
+    list.reserve(_devices.size());
+    for (const auto &entry : _devices)
+        list.push_back(entry.second);
+    emit driveListChanged(list);
+}
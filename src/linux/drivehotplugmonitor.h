@@ -0,0 +1,88 @@
+#ifndef DRIVEHOTPLUGMONITOR_H
+#define DRIVEHOTPLUGMONITOR_H
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <map>
+#include <string>
+#include <vector>
+#include "../dependencies/drivelist/src/drivelist.hpp"
+
+/**
+ * @brief Event-driven replacement for polling lsblk on Linux
+ *
+ * Listens for block device uevents on a NETLINK_KOBJECT_UEVENT socket and
+ * for mount table changes on /proc/self/mountinfo, and keeps a table of
+ * disks that is updated one disk at a time. When udevd is running its
+ * rebroadcast is used instead of the raw kernel event, so that filesystem
+ * labels have been probed by the time the disk is described.
+ *
+ * A full rescan still runs at start, on request, after a missed event
+ * (socket overflow), when the mount table changes, and every
+ * fallback interval as a safety net.
+ *
+ * Must be created in, and used from, a thread running an event loop.
+ */
+class DriveHotplugMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DriveHotplugMonitor(QObject *parent = nullptr);
+    virtual ~DriveHotplugMonitor();
+
+    /**
+     * @brief Open the uevent socket
+     * @return false if netlink is unavailable; the caller should poll instead
+     */
+    bool start();
+    void stop();
+
+    /**
+     * @brief Hold back updates, e.g. while writing
+     *
+     * Events received while paused are remembered and applied on resume.
+     */
+    void setPaused(bool paused);
+
+    void setFallbackInterval(int ms);
+
+public slots:
+    void rescan();
+
+signals:
+    /**
+     * @brief Emitted with the full drive list, only when it changed
+     */
+    void driveListChanged(std::vector<Drivelist::DeviceDescriptor> list);
+
+    /**
+     * @brief Emitted after each enumeration with its duration
+     */
+    void scanned(quint32 durationMs);
+
+protected:
+    int _s, _mountsFd;
+    bool _fromUdev, _paused, _published, _fullRescanPending;
+    QSocketNotifier *_qsn, *_mountsQsn;
+    QTimer _settleTimer, _fallbackTimer;
+    QSet<QString> _dirtyDisks;
+    std::map<std::string, Drivelist::DeviceDescriptor> _devices;
+
+    void _scheduleUpdate();
+    void _update();
+    void _publish(bool changed);
+
+protected slots:
+    void onUevent(QSocketDescriptor socket, QSocketNotifier::Type type);
+    void onMountsChanged(QSocketDescriptor socket, QSocketNotifier::Type type);
+    void applyPendingChanges();
+};
+
+#endif // DRIVEHOTPLUGMONITOR_H
@@ -9,10 +9,14 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/sysmacros.h>
 #include <linux/fs.h>
+#include <linux/falloc.h>
 #include <errno.h>
 #include <sstream>
+#include <fstream>
 #include <cstring>
+#include <algorithm>
 
 // io_uring support (Linux 5.1+)
 #ifdef HAVE_LIBURING
@@ -96,6 +100,57 @@ void LinuxFileOperations::CleanupIOUring() {
     pending_callbacks_.clear();
 }
 
+bool LinuxFileOperations::ApplyBufferRegistration() {
+    if (ring_ == nullptr || registered_buffers_.empty()) {
+        return false;
+    }
+
+    std::vector<struct iovec> iovecs;
+    iovecs.reserve(registered_buffers_.size());
+    for (const WriteBuffer& buffer : registered_buffers_) {
+        iovecs.push_back({const_cast<std::uint8_t*>(buffer.data), buffer.size});
+    }
+
+    // Pinned pages count against RLIMIT_MEMLOCK unless running with CAP_IPC_LOCK
+    int ret = io_uring_register_buffers(ring_, iovecs.data(), static_cast<unsigned>(iovecs.size()));
+    if (ret < 0) {
+        std::ostringstream oss;
+        oss << "io_uring_register_buffers failed: " << strerror(-ret)
+            << ", writes will use unregistered buffers";
+        Log(oss.str());
+        registered_buffers_.clear();
+        return false;
+    }
+
+    std::uint64_t total = 0;
+    for (const WriteBuffer& buffer : registered_buffers_) {
+        total += buffer.size;
+    }
+    std::ostringstream oss;
+    oss << "io_uring: registered " << registered_buffers_.size() << " write buffers ("
+        << (total / (1024 * 1024)) << " MB)";
+    Log(oss.str());
+    return true;
+}
+
+int LinuxFileOperations::FindRegisteredBuffer(const std::uint8_t* data, std::size_t size) const {
+    // Last buffer starting at or before data; the write has to lie entirely inside it
+    auto address = reinterpret_cast<std::uintptr_t>(data);
+    auto it = std::upper_bound(registered_buffers_.begin(), registered_buffers_.end(), address,
+                               [](std::uintptr_t a, const WriteBuffer& buffer) {
+                                   return a < reinterpret_cast<std::uintptr_t>(buffer.data);
+                               });
+    if (it == registered_buffers_.begin()) {
+        return -1;
+    }
+    --it;
+    std::uintptr_t offset = address - reinterpret_cast<std::uintptr_t>(it->data);
+    if (offset > it->size || size > it->size - offset) {
+        return -1;
+    }
+    return static_cast<int>(it - registered_buffers_.begin());
+}
+
 void LinuxFileOperations::ProcessCompletions(bool wait) {
     if (ring_ == nullptr || pending_writes_.load() == 0) {
         return;
@@ -153,7 +208,7 @@ void LinuxFileOperations::ProcessCompletions(bool wait) {
         }
         
         // Record write latency (submit to completion) - uses base class's thread-safe stats
-        write_latency_stats_.recordCompletion(submit_time);
+        write_latency_stats_.recordCompletion(submit_time, expected_size);
         
         FileError error = FileError::kSuccess;
         if (result < 0) {
@@ -201,6 +256,8 @@ void LinuxFileOperations::ProcessCompletions(bool wait) {
 // Stubs when liburing is not available
 bool LinuxFileOperations::InitIOUring() { return false; }
 void LinuxFileOperations::CleanupIOUring() { pending_callbacks_.clear(); }
+bool LinuxFileOperations::ApplyBufferRegistration() { return false; }
+int LinuxFileOperations::FindRegisteredBuffer(const std::uint8_t*, std::size_t) const { return -1; }
 void LinuxFileOperations::ProcessCompletions(bool) {}
 #endif
 
@@ -467,6 +524,105 @@ std::uint64_t LinuxFileOperations::Tell() const {
   return (pos == -1) ? 0 : static_cast<std::uint64_t>(pos);
 }
 
+FileError LinuxFileOperations::SkipSequential(std::uint64_t size) {
+  if (!IsOpen()) {
+    return FileError::kOpenError;
+  }
+
+  // io_uring writes are submitted with explicit offsets, so in-flight writes are not
+  // affected by moving the file position. No need to drain the queue like Seek() does.
+  std::uint64_t target = Tell() + size;
+  if (lseek(fd_, static_cast<off_t>(target), SEEK_SET) == -1) {
+    last_error_code_ = errno;
+    return FileError::kSeekError;
+  }
+
+  async_write_offset_ = target;
+  return FileError::kSuccess;
+}
+
+FileError LinuxFileOperations::ZeroRange(std::uint64_t offset, std::uint64_t length) {
+  if (!IsOpen()) {
+    return FileError::kOpenError;
+  }
+  if (length == 0) {
+    return FileError::kSuccess;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    last_error_code_ = errno;
+    return FileError::kWriteError;
+  }
+
+  if (S_ISBLK(st.st_mode)) {
+    // Let the device zero the range (WRITE ZEROES / discard with guaranteed zeroing)
+    std::uint64_t range[2] = {offset, length};
+    if (ioctl(fd_, BLKZEROOUT, &range) == -1) {
+      last_error_code_ = errno;
+      std::ostringstream oss;
+      oss << "BLKZEROOUT failed: " << strerror(errno);
+      Log(oss.str());
+      return FileError::kWriteError;
+    }
+    return FileError::kSuccess;
+  }
+
+  // Regular file: punch a hole for the part inside the file, extend for the rest
+  std::uint64_t end = offset + length;
+  std::uint64_t current_size = static_cast<std::uint64_t>(st.st_size);
+  if (offset < current_size) {
+    std::uint64_t punch_length = std::min(end, current_size) - offset;
+    if (fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                  static_cast<off_t>(offset), static_cast<off_t>(punch_length)) != 0) {
+      last_error_code_ = errno;
+      std::ostringstream oss;
+      oss << "fallocate(PUNCH_HOLE) failed: " << strerror(errno);
+      Log(oss.str());
+      return FileError::kWriteError;
+    }
+  }
+  if (end > current_size && ftruncate(fd_, static_cast<off_t>(end)) != 0) {
+    last_error_code_ = errno;
+    return FileError::kSizeError;
+  }
+
+  return FileError::kSuccess;
+}
+
+bool LinuxFileOperations::HasFastZeroRange() const {
+  if (!IsOpen()) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    return false;
+  }
+  if (S_ISREG(st.st_mode)) {
+    // Not every filesystem can punch holes (vfat, some network and FUSE
+    // filesystems). Punching past the end of the file changes nothing where
+    // it is supported and fails with EOPNOTSUPP where it is not
+    return fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, st.st_size, 4096) == 0;
+  }
+  if (!S_ISBLK(st.st_mode)) {
+    return false;
+  }
+
+  // BLKZEROOUT falls back to writing zero pages in the kernel unless the device
+  // advertises WRITE ZEROES. Partitions have no queue directory of their own.
+  std::ostringstream dev;
+  dev << "/sys/dev/block/" << major(st.st_rdev) << ":" << minor(st.st_rdev);
+  for (const char* queue : {"/queue/write_zeroes_max_bytes", "/../queue/write_zeroes_max_bytes"}) {
+    std::ifstream sysfs(dev.str() + queue);
+    std::uint64_t max_bytes = 0;
+    if (sysfs >> max_bytes) {
+      return max_bytes > 0;
+    }
+  }
+  return false;
+}
+
 FileError LinuxFileOperations::ForceSync() {
   if (!IsOpen()) {
     return FileError::kOpenError;
@@ -497,6 +653,35 @@ FileError LinuxFileOperations::Flush() {
   return FileError::kSuccess;
 }
 
+FileError LinuxFileOperations::StartWriteback(std::uint64_t offset, std::uint64_t length) {
+  if (!IsOpen()) {
+    return FileError::kOpenError;
+  }
+
+  // Async writes still in flight are not dirty yet and are simply not covered
+  if (sync_file_range(fd_, static_cast<off64_t>(offset), static_cast<off64_t>(length),
+                      SYNC_FILE_RANGE_WRITE) != 0) {
+    last_error_code_ = errno;
+    return FileError::kSyncError;
+  }
+
+  return FileError::kSuccess;
+}
+
+FileError LinuxFileOperations::WaitForWriteback(std::uint64_t offset, std::uint64_t length) {
+  if (!IsOpen()) {
+    return FileError::kOpenError;
+  }
+
+  if (sync_file_range(fd_, static_cast<off64_t>(offset), static_cast<off64_t>(length),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+    last_error_code_ = errno;
+    return FileError::kSyncError;
+  }
+
+  return FileError::kSuccess;
+}
+
 void LinuxFileOperations::PrepareForSequentialRead(std::uint64_t offset, std::uint64_t length) {
   if (!IsOpen()) {
     return;
@@ -559,10 +744,13 @@ bool LinuxFileOperations::SetAsyncQueueDepth(int depth) {
       delete ring_;
       ring_ = nullptr;
       io_uring_available_ = false;
+      registered_buffers_.clear();
     } else {
       std::ostringstream oss;
       oss << "io_uring resized to queue depth " << depth;
       Log(oss.str());
+      // Registrations belong to the old ring
+      ApplyBufferRegistration();
     }
   }
 #endif
@@ -599,14 +787,16 @@ FileError LinuxFileOperations::AsyncWriteSequential(const std::uint8_t* data, st
   // Process any completed writes first (non-blocking)
   ProcessCompletions(false);
 
-  // With O_DIRECT, limit effective queue depth to prevent massive latency buildup.
+  // With a write controller the depth follows the measured completions.
+  // Without one, limit the depth under O_DIRECT to prevent massive latency buildup:
   // USB devices can only complete one write at a time (~800ms for 8MB at 10MB/s).
   // A deep queue just means waiting 800ms * 256 = 200+ seconds for draining.
   // Use a small limit (4) for responsive progress and fast drain at end of write.
-  int effectiveQueueLimit = using_direct_io_ ? std::min(async_queue_depth_, 4) : async_queue_depth_;
+  int effectiveQueueLimit = write_controller_ ? InFlightLimit(async_queue_depth_)
+                          : using_direct_io_ ? std::min(async_queue_depth_, 4) : async_queue_depth_;
 
   // Log once when queue depth is limited due to O_DIRECT
-  if (using_direct_io_ && effectiveQueueLimit < async_queue_depth_ && !logged_queue_limit_) {
+  if (!write_controller_ && using_direct_io_ && effectiveQueueLimit < async_queue_depth_ && !logged_queue_limit_) {
     std::ostringstream oss;
     oss << "Effective queue depth limited to " << effectiveQueueLimit
         << " (configured: " << async_queue_depth_ << ") due to O_DIRECT";
@@ -651,8 +841,15 @@ FileError LinuxFileOperations::AsyncWriteSequential(const std::uint8_t* data, st
   
   pending_writes_.fetch_add(1);
   
-  // Set up the SQE for a write
-  io_uring_prep_write(sqe, fd_, data, static_cast<unsigned>(size), static_cast<off_t>(write_offset));
+  // Set up the SQE for a write. Writes from a registered buffer skip the
+  // per-write page pinning in the kernel.
+  int buf_index = FindRegisteredBuffer(data, size);
+  if (buf_index >= 0) {
+    io_uring_prep_write_fixed(sqe, fd_, data, static_cast<unsigned>(size),
+                              static_cast<off_t>(write_offset), buf_index);
+  } else {
+    io_uring_prep_write(sqe, fd_, data, static_cast<unsigned>(size), static_cast<off_t>(write_offset));
+  }
   io_uring_sqe_set_data64(sqe, write_id);
 
   // Submit immediately - for USB storage devices, the device is the bottleneck,
@@ -716,6 +913,35 @@ void LinuxFileOperations::CancelAsyncIO() {
 #endif
 }
 
+bool LinuxFileOperations::RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) {
+#ifdef HAVE_LIBURING
+  if (!io_uring_available_ || ring_ == nullptr) {
+    return false;
+  }
+
+  // Writes in flight may be using the current registration
+  WaitForPendingWrites();
+  if (!registered_buffers_.empty()) {
+    io_uring_unregister_buffers(ring_);
+    registered_buffers_.clear();
+  }
+
+  for (const WriteBuffer& buffer : buffers) {
+    if (buffer.data != nullptr && buffer.size > 0) {
+      registered_buffers_.push_back(buffer);
+    }
+  }
+  std::sort(registered_buffers_.begin(), registered_buffers_.end(),
+            [](const WriteBuffer& a, const WriteBuffer& b) {
+              return reinterpret_cast<std::uintptr_t>(a.data) < reinterpret_cast<std::uintptr_t>(b.data);
+            });
+  return ApplyBufferRegistration();
+#else
+  (void)buffers;
+  return false;
+#endif
+}
+
 FileError LinuxFileOperations::WaitForPendingWrites() {
 #ifdef HAVE_LIBURING
   if (!io_uring_available_ || ring_ == nullptr) {
@@ -49,11 +49,17 @@ class LinuxFileOperations : public FileOperations {
   // File positioning
   FileError Seek(std::uint64_t position) override;
   std::uint64_t Tell() const override;
-  
+  FileError SkipSequential(std::uint64_t size) override;
+  FileError ZeroRange(std::uint64_t offset, std::uint64_t length) override;
+  bool HasFastZeroRange() const override;
+
   // Sync operations
   FileError ForceSync() override;
   FileError Flush() override;
-  
+  bool CanControlWriteback() const override { return IsOpen() && !using_direct_io_; }
+  FileError StartWriteback(std::uint64_t offset, std::uint64_t length) override;
+  FileError WaitForWriteback(std::uint64_t offset, std::uint64_t length) override;
+
   // Sequential read optimization
   void PrepareForSequentialRead(std::uint64_t offset, std::uint64_t length) override;
   
@@ -88,6 +94,7 @@ class LinuxFileOperations : public FileOperations {
   void PollAsyncCompletions() override;
   FileError WaitForPendingWrites() override;
   void CancelAsyncIO() override;
+  bool RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) override;
   // GetAsyncIOStats() inherited from FileOperations base class
 
  private:
@@ -106,6 +113,10 @@ class LinuxFileOperations : public FileOperations {
   bool io_uring_available_;
   io_uring* ring_;
   bool logged_queue_limit_;  // Log queue depth limit once
+
+  // Buffers registered with the ring, sorted by address so the index of the
+  // one a write comes from can be found; re-registered when the ring is resized
+  std::vector<WriteBuffer> registered_buffers_;
   
   // Track callbacks by user_data pointer
   struct PendingWrite {
@@ -124,6 +135,8 @@ class LinuxFileOperations : public FileOperations {
   
   bool InitIOUring();
   void CleanupIOUring();
+  bool ApplyBufferRegistration();
+  int FindRegisteredBuffer(const std::uint8_t* data, std::size_t size) const;
   void ProcessCompletions(bool wait);
 };
 
@@ -5,6 +5,7 @@
 
 #include "../dependencies/drivelist/src/drivelist.hpp"
 #include "../embedded_config.h"
+#include "linuxdrivelist.h"
 #include <QProcess>
 #include <QJsonArray>
 #include <QJsonDocument>
@@ -44,7 +45,7 @@ namespace Drivelist
         }
     }
 
-    std::vector<Drivelist::DeviceDescriptor> ListStorageDevices()
+    static std::vector<Drivelist::DeviceDescriptor> _listStorageDevices(const QStringList &devices)
     {
         std::vector<DeviceDescriptor> deviceList;
 
@@ -57,13 +58,17 @@ namespace Drivelist
             "--output", "kname,type,subsystems,ro,rm,hotplug,size,phy-sec,log-sec,label,vendor,model,mountpoint",
             "--exclude", "7"
         };
+        args.append(devices);
         p.start("lsblk", args);
         p.waitForFinished(2000);
         QByteArray output = p.readAll();
 
-        if (p.exitStatus() != QProcess::NormalExit || p.exitCode() || output.isEmpty())
+        /* When asked about specific disks lsblk exits non-zero if some of them
+           have just gone away, but still lists the ones that are left */
+        if (p.exitStatus() != QProcess::NormalExit || (p.exitCode() && devices.isEmpty()) || output.isEmpty())
         {
-            qDebug() << "Error executing lsblk";
+            if (devices.isEmpty())
+                qDebug() << "Error executing lsblk";
             return deviceList;
         }
 
@@ -224,4 +229,17 @@ namespace Drivelist
 
         return deviceList;
     }
+
+    std::vector<Drivelist::DeviceDescriptor> ListStorageDevices()
+    {
+        return _listStorageDevices(QStringList());
+    }
+
+    std::vector<Drivelist::DeviceDescriptor> ListStorageDevices(const QStringList &devices)
+    {
+        if (devices.isEmpty())
+            return std::vector<DeviceDescriptor>();
+
+        return _listStorageDevices(devices);
+    }
 }
@@ -0,0 +1,23 @@
+#ifndef LINUXDRIVELIST_H
+#define LINUXDRIVELIST_H
+
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "../dependencies/drivelist/src/drivelist.hpp"
+#include <QStringList>
+#include <vector>
+
+namespace Drivelist
+{
+    /*
+     * Describe only the given whole disks (e.g. "/dev/sdb"), for callers that
+     * keep their own device table up to date from hotplug events.
+     * Disks that no longer exist are left out of the result.
+     */
+    std::vector<DeviceDescriptor> ListStorageDevices(const QStringList &devices);
+}
+
+#endif // LINUXDRIVELIST_H
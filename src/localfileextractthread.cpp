@@ -11,9 +11,21 @@
 
 #include <QUrl>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+// Holes in a sparse source shorter than this are read and written like data
+static constexpr quint64 MIN_SPARSE_SKIP_BYTES = 1024 * 1024;
 
 LocalFileExtractThread::LocalFileExtractThread(const QByteArray &url, const QByteArray &dst, const QByteArray &expectedHash, QObject *parent)
-    : DownloadExtractThread(url, dst, expectedHash, parent)
+    : DownloadExtractThread(url, dst, expectedHash, parent),
+      _stopReading(false), _readError(false), _lastReaderWaitMs(0), _rawImage(false),
+      _sparseImage(false), _zeroBlock(nullptr)
 {
     // Prevent the machine from sleeping while the download/extraction is in progress.
     try
@@ -34,14 +46,20 @@ LocalFileExtractThread::LocalFileExtractThread(const QByteArray &url, const QByt
 LocalFileExtractThread::~LocalFileExtractThread()
 {
     _cancelled = true;
-    
+    _stopReading = true;
+
+    wait();
+    _stopReader();
+
     // Ensure input file is always closed to prevent file handle leaks
+    // (only after the reader thread is gone, it reads from it)
     if (_inputfile.isOpen()) {
         _inputfile.close();
     }
-    
-    wait();
+
     qFreeAligned(_inputBuf);
+    if (_zeroBlock)
+        qFreeAligned(_zeroBlock);
 
     // Release the inhibition on suspending the system.
     if (_suspendInhibitor != nullptr) {
@@ -49,11 +67,17 @@ LocalFileExtractThread::~LocalFileExtractThread()
     }
 }
 
+void LocalFileExtractThread::setSparseImage(bool sparse)
+{
+    _sparseImage = sparse;
+}
+
 void LocalFileExtractThread::_cancelExtract()
 {
     _cancelled = true;
-    if (_inputfile.isOpen())
-        _inputfile.close();
+    _stopReading = true;
+    if (_ringBuffer)
+        _ringBuffer->cancel();
 }
 
 void LocalFileExtractThread::run()
@@ -78,49 +102,174 @@ void LocalFileExtractThread::run()
 
     // Test if this file can be handled by libarchive
     bool canUseArchive = false;
-    if (isImage())
+    if (isImage() && !_sparseImage)
     {
         canUseArchive = _testArchiveFormat();
     }
+
+    // A sparse source is read extent by extent, find them before reading starts
+    if (isImage() && _sparseImage)
+    {
+        _extents = rpi_imager::ListDataExtents(_inputfile.handle(), static_cast<std::uint64_t>(_inputfile.size()),
+                                               MIN_SPARSE_SKIP_BYTES);
+    }
     
+    // From here on the source is read by the prefetching reader thread
+    _startReader();
+
     if (isImage() && canUseArchive)
         extractImageRun();  // Use libarchive for compressed/archive files
+    else if (isImage() && _sparseImage)
+    {
+        _rawImage = true;
+        extractSparseImageRun();  // Decompressed image with holes, copy the data only
+    }
     else if (isImage() && !canUseArchive)
+    {
+        _rawImage = true;
         extractRawImageRun();  // Direct copy for raw disk images
+    }
     else
         extractMultiFileRun();
 
+    _stopReader();
+    _inputfile.close();
+
     if (_cancelled)
         _closeFiles();
 }
 
-ssize_t LocalFileExtractThread::_on_read(struct archive *, const void **buff)
+void LocalFileExtractThread::_startReader()
+{
+    _stopReading = false;
+    _readError = false;
+
+#ifdef Q_OS_LINUX
+    // The file is consumed strictly in order; let the kernel read ahead further
+    posix_fadvise(_inputfile.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    _readerThread = std::thread(&LocalFileExtractThread::_readerRun, this);
+}
+
+void LocalFileExtractThread::_stopReader()
+{
+    if (!_readerThread.joinable())
+        return;
+
+    // The reader may be blocked on a full ring buffer if extraction stopped early
+    _stopReading = true;
+    _readerThread.join();
+}
+
+void LocalFileExtractThread::_readerRun()
+{
+    // Sparse sources are only read within their data extents; slots never
+    // span two extents, so the consumer can tell where the holes are
+    bool sparse = _isImage && _sparseImage;
+    size_t nextExtent = 0;
+    quint64 extentEnd = 0;
+
+    while (!_stopReading && !_cancelled && !_ringBuffer->isCancelled())
+    {
+        quint64 pos = static_cast<quint64>(_inputfile.pos());
+        if (sparse && pos >= extentEnd)
+        {
+            quint64 holeEnd = nextExtent < _extents.size() ? _extents[nextExtent].offset
+                                                            : static_cast<quint64>(_inputfile.size());
+            _lastDlNow += holeEnd - pos;  // Holes count as read
+            if (nextExtent == _extents.size())
+                break;
+
+            const rpi_imager::FileExtent &extent = _extents[nextExtent++];
+            if (!_inputfile.seek(static_cast<qint64>(extent.offset)))
+            {
+                qDebug() << "Local file reader: seek error:" << _inputfile.errorString();
+                _readError = true;
+                break;
+            }
+            pos = extent.offset;
+            extentEnd = extent.offset + extent.length;
+        }
+
+        RingBuffer::Slot *slot = _ringBuffer->acquireWriteSlot(100);  // 100ms timeout
+        if (!slot)
+            continue;
+
+        quint64 want = slot->capacity;
+        if (sparse)
+            want = qMin(want, extentEnd - pos);
+        qint64 len = _inputfile.read(slot->data, static_cast<qint64>(want));
+        if (len <= 0)
+        {
+            // An empty slot would read as end of stream, hand it back unused
+            _ringBuffer->abortWriteSlot(slot);
+            if (len < 0)
+            {
+                qDebug() << "Local file reader: read error:" << _inputfile.errorString();
+                _readError = true;
+            }
+            break;
+        }
+
+        _lastDlNow += len;
+        _ringBuffer->commitWriteSlot(slot, static_cast<size_t>(len));
+    }
+
+    // Always let the consumer see the end, also when stopped early
+    _ringBuffer->producerDone();
+}
+
+RingBuffer::Slot *LocalFileExtractThread::_acquireFilledSlot()
+{
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+
+    RingBuffer::Slot *slot = _ringBuffer->acquireReadSlot(100);  // 100ms timeout
+    while (!slot && !_cancelled && !_ringBuffer->isCancelled() && !_ringBuffer->isComplete())
+    {
+        slot = _ringBuffer->acquireReadSlot(100);
+    }
+
+    _totalRingBufferWaitMs.fetch_add(static_cast<quint64>(waitTimer.elapsed()));
+    if (slot)
+        _bytesReadFromRingBuffer.fetch_add(static_cast<quint64>(slot->size));
+    return slot;
+}
+
+ssize_t LocalFileExtractThread::_on_read(struct archive *a, const void **buff)
 {
     if (_cancelled)
         return -1;
 
-    *buff = _inputBuf;
-    ssize_t len = _inputfile.read(_inputBuf, _inputBufSize);
+    // Hands out the next slot filled by the reader thread (zero-copy)
+    ssize_t len = DownloadExtractThread::_on_read(a, buff);
 
     if (len > 0)
     {
-        _lastDlNow += len;
+        // Hash what libarchive consumes, on this thread, so the result is
+        // complete when extraction finishes
         if (!_isImage)
         {
-            _inputHash.addData(_inputBuf, len);
+            _inputHash.addData(static_cast<const char *>(*buff), len);
         }
-        
+
         // Emit progress updates for local file extraction
         _emitProgressUpdate();
     }
+    else if (_readError)
+    {
+        archive_set_error(a, EIO, "Error reading from image file");
+        return -1;
+    }
 
     return len;
 }
 
-int LocalFileExtractThread::_on_close(struct archive *)
+int LocalFileExtractThread::_on_close(struct archive *a)
 {
-    _inputfile.close();
-    return 0;
+    // Releases the last slot; the reader thread still owns the file
+    return DownloadExtractThread::_on_close(a);
 }
 
 void LocalFileExtractThread::extractRawImageRun()
@@ -129,29 +278,31 @@ void LocalFileExtractThread::extractRawImageRun()
     
     qint64 totalBytes = _inputfile.size();
     qint64 bytesRead = 0;
+    RingBuffer *ring = _ringBuffer.get();
     
     while (bytesRead < totalBytes && !_cancelled)
     {
-        qint64 chunkSize = qMin((qint64)_inputBufSize, totalBytes - bytesRead);
-        qint64 len = _inputfile.read(_inputBuf, chunkSize);
-        
-        if (len <= 0)
+        RingBuffer::Slot *slot = _acquireFilledSlot();
+        if (!slot)
         {
-            if (len < 0)
+            if (_readError)
                 _onDownloadError(tr("Error reading from image file"));
             break;
         }
         
-        // Write the data directly to the output device
-        size_t written = _writeFile(_inputBuf, len);
-        if (written != (size_t)len)
+        // Write the slot directly to the output device; it goes back to the
+        // reader once the (possibly asynchronous) write has completed
+        size_t len = slot->size;
+        size_t written = _writeFile(slot->data, len, [ring, slot]() {
+            ring->releaseReadSlot(slot);
+        });
+        if (written != len)
         {
             _onDownloadError(tr("Error writing to device"));
             break;
         }
         
         bytesRead += len;
-        _lastDlNow = bytesRead;
         
         // Emit progress updates
         _emitProgressUpdate();
@@ -168,6 +319,86 @@ void LocalFileExtractThread::extractRawImageRun()
     }
 }
 
+void LocalFileExtractThread::extractSparseImageRun()
+{
+    qDebug() << "Writing decompressed image from" << _extents.size() << "data extents";
+
+    quint64 totalBytes = static_cast<quint64>(_inputfile.size());
+    quint64 pos = 0;
+    RingBuffer *ring = _ringBuffer.get();
+
+    // The hole before each extent is skipped, then its data written as read;
+    // the last round only handles the hole at the end
+    for (size_t i = 0; i <= _extents.size() && !_cancelled; i++)
+    {
+        quint64 dataStart = i < _extents.size() ? _extents[i].offset : totalBytes;
+        quint64 dataEnd = i < _extents.size() ? dataStart + _extents[i].length : totalBytes;
+
+        if (!_writeHole(dataStart - pos))
+        {
+            _onDownloadError(tr("Error writing to device"));
+            return;
+        }
+        pos = dataStart;
+
+        while (pos < dataEnd && !_cancelled)
+        {
+            RingBuffer::Slot *slot = _acquireFilledSlot();
+            if (!slot)
+            {
+                if (!_cancelled)
+                    _onDownloadError(_readError ? tr("Error reading from image file")
+                                                : tr("Failed to read complete image file"));
+                return;
+            }
+
+            size_t len = slot->size;
+            size_t written = _writeFile(slot->data, len, [ring, slot]() {
+                ring->releaseReadSlot(slot);
+            });
+            if (written != len)
+            {
+                _onDownloadError(tr("Error writing to device"));
+                return;
+            }
+
+            pos += len;
+            _emitProgressUpdate();
+        }
+    }
+
+    if (!_cancelled)
+    {
+        qDebug() << "Sparse image extraction completed successfully";
+        _writeComplete();
+    }
+}
+
+bool LocalFileExtractThread::_writeHole(quint64 len)
+{
+    if (len == 0 || _skipSparseRange(len))
+        return true;
+
+    // The device does not read back zeros for ranges we skip, so write them
+    if (!_zeroBlock)
+    {
+        _zeroBlock = (char *) qMallocAligned(_inputBufSize, 4096);
+        if (!_zeroBlock)
+            return false;
+        memset(_zeroBlock, 0, _inputBufSize);
+    }
+
+    while (len > 0 && !_cancelled)
+    {
+        size_t chunk = static_cast<size_t>(qMin(len, static_cast<quint64>(_inputBufSize)));
+        if (_writeFile(_zeroBlock, chunk) != chunk)
+            return false;
+        len -= chunk;
+        _emitProgressUpdate();
+    }
+    return true;
+}
+
 bool LocalFileExtractThread::_testArchiveFormat()
 {
     // Test if libarchive can handle this file format AND actually extract data from it
@@ -247,7 +478,21 @@ void LocalFileExtractThread::_updateBottleneckState()
     // When the write queue isn't full but throughput is low, the bottleneck is either:
     // - DiskRead: local disk can't provide data fast enough
     // - Decompression: CPU-bound decompression is slow (for compressed files)
+    //
+    // The reader thread shows which: if the consumer had to wait on the input ring
+    // since the last update, or the ring is nearly empty, the reader is behind.
     _upstreamBottleneckType = BottleneckState::DiskRead;
+    if (_ringBuffer && _ringBuffer->numSlots() > 0 && _readerThread.joinable())
+    {
+        uint64_t producerStalls, consumerStalls, producerWaitMs, consumerWaitMs;
+        _ringBuffer->getStarvationStats(producerStalls, consumerStalls, producerWaitMs, consumerWaitMs);
+        bool readerStalled = consumerWaitMs > _lastReaderWaitMs;
+        _lastReaderWaitMs = consumerWaitMs;
+
+        bool ringLow = _ringBuffer->getCommittedCount() < _ringBuffer->numSlots() / 4;
+        if (!readerStalled && !ringLow)
+            _upstreamBottleneckType = _rawImage ? BottleneckState::None : BottleneckState::Decompression;
+    }
 
     // Call base class to perform the actual bottleneck state update
     DownloadThread::_updateBottleneckState();
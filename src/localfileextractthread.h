@@ -7,8 +7,12 @@
  */
 
 #include "downloadextractthread.h"
+#include "sparse_file_extents.h"
 #include "suspend_inhibitor.h"
 #include <QFile>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 // Forward declarations for libarchive
 struct archive;
@@ -21,6 +25,13 @@ public:
     explicit LocalFileExtractThread(const QByteArray &url, const QByteArray &dst = "", const QByteArray &expectedHash = "", QObject *parent = nullptr);
     virtual ~LocalFileExtractThread();
 
+    /*
+     * The source is a decompressed image whose holes read as zeros, such as
+     * an expanded cache file. It is copied as is: only its data extents are
+     * read, and the holes are skipped on the target where the device allows.
+     */
+    void setSparseImage(bool sparse);
+
 protected:
     virtual void _cancelExtract();
     virtual void run() override;
@@ -28,6 +39,8 @@ protected:
     virtual int _on_close(struct archive *a) override;
     virtual void _updateBottleneckState() override;
     void extractRawImageRun();
+    void extractSparseImageRun();
+    bool _writeHole(quint64 len);
     bool _testArchiveFormat();
     static ssize_t _archive_read_test(struct archive *, void *client_data, const void **buff);
     static int _archive_close_test(struct archive *, void *client_data);
@@ -35,6 +48,26 @@ protected:
     char *_inputBuf;
     size_t _inputBufSize;
 
+    /*
+     * Prefetching reader: fills the input ring buffer from _inputfile on its
+     * own thread, so reading the source overlaps with decompression and
+     * writing instead of happening inside _on_read().
+     */
+    void _startReader();
+    void _stopReader();
+    void _readerRun();
+    RingBuffer::Slot *_acquireFilledSlot();
+    std::thread _readerThread;
+    std::atomic<bool> _stopReading;
+    std::atomic<bool> _readError;
+    quint64 _lastReaderWaitMs;  // Consumer wait on the input ring at the last bottleneck update
+    bool _rawImage;             // Copying a raw image, nothing is decompressed
+
+    // Sparse source state (see setSparseImage)
+    bool _sparseImage;
+    std::vector<rpi_imager::FileExtent> _extents;  // Data extents, read by the reader thread in order
+    char *_zeroBlock;                               // Written for holes the device cannot skip
+
 private:
     SuspendInhibitor *_suspendInhibitor;
 };
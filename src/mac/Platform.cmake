@@ -36,7 +36,6 @@ set(PLATFORM_SOURCES
     mac/acceleratedcryptographichash_commoncrypto.cpp
     mac/macfile.cpp
     mac/macfile.h
-    mac/bootimgcreator_macos.cpp
     mac/rsakeyfingerprint_macos.mm
     dependencies/mountutils/src/darwin/functions.cpp
     dependencies/drivelist/src/darwin/list.mm
@@ -533,7 +533,7 @@ FileError MacOSFileOperations::AsyncWriteSequential(const std::uint8_t* data, st
     ssize_t written = pwrite(fd_, data, size, static_cast<off_t>(write_offset));
     
     // Record completion latency (thread-safe via atomic operations)
-    stats->recordCompletion(submit_time);
+    stats->recordCompletion(submit_time, size);
     
     FileError result = FileError::kSuccess;
     if (written < 0 || static_cast<size_t>(written) != size) {
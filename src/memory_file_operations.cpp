@@ -0,0 +1,360 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "memory_file_operations.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace rpi_imager {
+
+namespace {
+
+bool IsAllZero(const std::uint8_t* data, std::size_t size) {
+  return std::all_of(data, data + size, [](std::uint8_t b) { return b == 0; });
+}
+
+}  // namespace
+
+MemoryFileOperations::MemoryFileOperations() : MemoryFileOperations(Options()) {}
+
+MemoryFileOperations::MemoryFileOperations(const Options& options) : options_(options) {
+  if (options_.page_size == 0) {
+    options_.page_size = Options().page_size;
+  }
+}
+
+MemoryFileOperations::~MemoryFileOperations() {
+  CancelAsyncIO();
+}
+
+FileError MemoryFileOperations::ReadAtOffset(std::uint64_t offset, std::uint8_t* data, std::size_t size) const {
+  if (!InRange(offset, size)) {
+    return FileError::kReadError;
+  }
+
+  while (size > 0) {
+    const std::size_t page = static_cast<std::size_t>(offset / options_.page_size);
+    const std::size_t in_page = static_cast<std::size_t>(offset % options_.page_size);
+    const std::size_t chunk = std::min(size, options_.page_size - in_page);
+
+    if (pages_[page]) {
+      std::memcpy(data, pages_[page].get() + in_page, chunk);
+    } else {
+      std::memset(data, 0, chunk);
+    }
+    offset += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  return FileError::kSuccess;
+}
+
+std::vector<std::uint8_t> MemoryFileOperations::Contents() const {
+  std::vector<std::uint8_t> contents(static_cast<std::size_t>(size_));
+  ReadAtOffset(0, contents.data(), contents.size());
+  return contents;
+}
+
+std::uint64_t MemoryFileOperations::AllocatedBytes() const {
+  std::uint64_t pages = std::count_if(pages_.begin(), pages_.end(),
+                                      [](const auto& page) { return page != nullptr; });
+  return pages * options_.page_size;
+}
+
+FileError MemoryFileOperations::OpenDevice(const std::string& path) {
+  // Only an image created earlier can be reopened
+  if (name_.empty() || path != name_) {
+    return FileError::kOpenError;
+  }
+  open_ = true;
+  position_ = 0;
+  device_free_time_ = Clock::time_point();
+  first_async_error_ = FileError::kSuccess;
+  write_latency_stats_.reset();
+  return FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::CreateTestFile(const std::string& path, std::uint64_t size) {
+  Close();
+
+  FileError error = Allocate(size);
+  if (error != FileError::kSuccess) {
+    return error;
+  }
+  name_ = path;
+  return OpenDevice(path);
+}
+
+FileError MemoryFileOperations::WriteAtOffset(
+    std::uint64_t offset,
+    const std::uint8_t* data,
+    std::size_t size) {
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  if (!InRange(offset, size)) {
+    return FileError::kWriteError;
+  }
+
+  // A synchronous write lands after the writes queued before it
+  WaitForPendingWrites();
+  std::this_thread::sleep_until(ScheduleWrite(size));
+  return Store(offset, data, size);
+}
+
+FileError MemoryFileOperations::GetSize(std::uint64_t& size) {
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  size = size_;
+  return FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::Close() {
+  WaitForPendingWrites();
+  open_ = false;
+  position_ = 0;
+  return FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::WriteSequential(const std::uint8_t* data, std::size_t size) {
+  FileError error = WriteAtOffset(position_, data, size);
+  if (error == FileError::kSuccess) {
+    position_ += size;
+  }
+  return error;
+}
+
+FileError MemoryFileOperations::ReadSequential(std::uint8_t* data, std::size_t size, std::size_t& bytes_read) {
+  bytes_read = 0;
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  if (position_ >= size_) {
+    return FileError::kSuccess;
+  }
+  const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size, size_ - position_));
+  FileError error = ReadAtOffset(position_, data, chunk);
+  if (error == FileError::kSuccess) {
+    bytes_read = chunk;
+    position_ += chunk;
+  }
+  return error;
+}
+
+bool MemoryFileOperations::SetAsyncQueueDepth(int depth) {
+  async_queue_depth_ = std::max(depth, 1);
+  return true;
+}
+
+FileError MemoryFileOperations::AsyncWriteSequential(const std::uint8_t* data, std::size_t size,
+                                                     AsyncWriteCallback callback) {
+  if (!open_) {
+    if (callback) callback(FileError::kOpenError, 0);
+    return FileError::kOpenError;
+  }
+
+  if (async_queue_depth_ <= 1) {
+    FileError result = WriteSequential(data, size);
+    if (callback) callback(result, result == FileError::kSuccess ? size : 0);
+    return result;
+  }
+
+  if (first_async_error_ != FileError::kSuccess) {
+    if (callback) callback(first_async_error_, 0);
+    return first_async_error_;
+  }
+  if (!InRange(position_, size)) {
+    if (callback) callback(FileError::kWriteError, 0);
+    return FileError::kWriteError;
+  }
+
+  ReapCompletions(false);
+  while (GetPendingWriteCount() >= InFlightLimit(async_queue_depth_)) {
+    ReapCompletions(true);
+  }
+
+  write_latency_stats_.recordSubmit();
+  pending_.push_back(PendingWrite{position_, data, size, std::move(callback),
+                                  Clock::now(), ScheduleWrite(size)});
+  position_ += size;
+  return FileError::kSuccess;
+}
+
+void MemoryFileOperations::PollAsyncCompletions() {
+  ReapCompletions(false);
+}
+
+FileError MemoryFileOperations::WaitForPendingWrites() {
+  while (!pending_.empty()) {
+    ReapCompletions(true);
+  }
+  return first_async_error_;
+}
+
+void MemoryFileOperations::CancelAsyncIO() {
+  // Nothing queued has reached the arena yet, so dropping it is enough
+  while (!pending_.empty()) {
+    PendingWrite write = std::move(pending_.front());
+    pending_.pop_front();
+    if (write.callback) write.callback(FileError::kCancelled, 0);
+  }
+  if (first_async_error_ == FileError::kSuccess) {
+    first_async_error_ = FileError::kCancelled;
+  }
+  device_free_time_ = Clock::time_point();
+}
+
+FileError MemoryFileOperations::Seek(std::uint64_t position) {
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  if (position > size_) {
+    return FileError::kSeekError;
+  }
+  position_ = position;
+  return FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::SkipSequential(std::uint64_t size) {
+  // Queued writes carry their own offsets, so there is nothing to drain
+  return Seek(position_ + size);
+}
+
+FileError MemoryFileOperations::ZeroRange(std::uint64_t offset, std::uint64_t length) {
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  if (!InRange(offset, length)) {
+    return FileError::kWriteError;
+  }
+  WaitForPendingWrites();
+
+  while (length > 0) {
+    const std::size_t page = static_cast<std::size_t>(offset / options_.page_size);
+    const std::size_t in_page = static_cast<std::size_t>(offset % options_.page_size);
+    const std::size_t chunk = static_cast<std::size_t>(
+        std::min<std::uint64_t>(length, options_.page_size - in_page));
+
+    if (pages_[page]) {
+      if (options_.sparse && chunk == options_.page_size) {
+        pages_[page].reset();
+      } else {
+        std::memset(pages_[page].get() + in_page, 0, chunk);
+      }
+    }
+    offset += chunk;
+    length -= chunk;
+  }
+  return FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::ForceSync() {
+  if (!open_) {
+    return FileError::kOpenError;
+  }
+  return WaitForPendingWrites() == FileError::kSuccess ? FileError::kSuccess : FileError::kSyncError;
+}
+
+FileError MemoryFileOperations::Flush() {
+  return open_ ? FileError::kSuccess : FileError::kOpenError;
+}
+
+FileError MemoryFileOperations::SetDirectIOEnabled(bool enabled) {
+  return enabled ? FileError::kOpenError : FileError::kSuccess;
+}
+
+FileError MemoryFileOperations::Allocate(std::uint64_t size) {
+  pages_.clear();
+  size_ = 0;
+
+  const std::uint64_t page_count = (size + options_.page_size - 1) / options_.page_size;
+  try {
+    pages_.resize(static_cast<std::size_t>(page_count));
+    if (!options_.sparse) {
+      for (auto& page : pages_) {
+        page.reset(new std::uint8_t[options_.page_size]());
+      }
+    }
+  } catch (const std::bad_alloc&) {
+    pages_.clear();
+    return FileError::kSizeError;
+  }
+
+  size_ = size;
+  return FileError::kSuccess;
+}
+
+bool MemoryFileOperations::InRange(std::uint64_t offset, std::uint64_t size) const {
+  return offset <= size_ && size <= size_ - offset;
+}
+
+FileError MemoryFileOperations::Store(std::uint64_t offset, const std::uint8_t* data, std::size_t size) {
+  while (size > 0) {
+    const std::size_t page = static_cast<std::size_t>(offset / options_.page_size);
+    const std::size_t in_page = static_cast<std::size_t>(offset % options_.page_size);
+    const std::size_t chunk = std::min(size, options_.page_size - in_page);
+
+    // Zeros written to a hole leave it a hole
+    if (!pages_[page] && !IsAllZero(data, chunk)) {
+      pages_[page].reset(new (std::nothrow) std::uint8_t[options_.page_size]());
+      if (!pages_[page]) {
+        return FileError::kWriteError;
+      }
+    }
+    if (pages_[page]) {
+      std::memcpy(pages_[page].get() + in_page, data, chunk);
+    }
+    offset += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  return FileError::kSuccess;
+}
+
+MemoryFileOperations::Clock::time_point MemoryFileOperations::ScheduleWrite(std::size_t size) {
+  const Clock::time_point now = Clock::now();
+  if (options_.write_latency.count() == 0 && options_.write_bandwidth == 0) {
+    return now;
+  }
+
+  // The transfer starts once the previous one is off the bus; the latency
+  // runs after it and does not hold up the next transfer
+  const Clock::time_point start = std::max(now, device_free_time_);
+  std::chrono::nanoseconds transfer{0};
+  if (options_.write_bandwidth > 0) {
+    transfer = std::chrono::nanoseconds(
+        static_cast<std::int64_t>(static_cast<double>(size) * 1e9 / static_cast<double>(options_.write_bandwidth)));
+  }
+  device_free_time_ = start + transfer;
+  return device_free_time_ + options_.write_latency;
+}
+
+void MemoryFileOperations::ReapCompletions(bool wait) {
+  if (pending_.empty()) {
+    return;
+  }
+  if (wait) {
+    std::this_thread::sleep_until(pending_.front().complete_time);
+  }
+
+  // Writes complete in the order they were queued
+  const Clock::time_point now = Clock::now();
+  while (!pending_.empty() && pending_.front().complete_time <= now) {
+    PendingWrite write = std::move(pending_.front());
+    pending_.pop_front();
+
+    FileError result = Store(write.offset, write.data, write.size);
+    if (result != FileError::kSuccess && first_async_error_ == FileError::kSuccess) {
+      first_async_error_ = result;
+    }
+    write_latency_stats_.recordCompletion(write.submit_time, write.size);
+    if (write.callback) write.callback(result, result == FileError::kSuccess ? write.size : 0);
+  }
+}
+
+}  // namespace rpi_imager
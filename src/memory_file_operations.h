@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef MEMORY_FILE_OPERATIONS_H_
+#define MEMORY_FILE_OPERATIONS_H_
+
+#include "file_operations.h"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rpi_imager {
+
+// FileOperations backed by memory instead of a file or device.
+//
+// CreateTestFile() sets up an image of the requested size; the path is only
+// kept as a name. The image is an arena of fixed-size pages. A sparse arena
+// allocates a page on the first non-zero write to it, so a mostly empty
+// multi-GB image costs only what was written. Writes cannot grow the image.
+// The contents stay available after Close(), so a volume can be assembled with
+// DiskFormatter and DeviceWrapper and then taken out as a whole.
+//
+// Optionally the writes behave like a device with a fixed per-write latency
+// and a write bandwidth. Transfers are serialised, and the latency of queued
+// async writes overlaps, the way it does on a card reader with a command
+// queue. Each write completes at a time computed from those two numbers
+// alone, so a run over the pipeline is repeatable without a device.
+class MemoryFileOperations : public FileOperations {
+ public:
+  struct Options {
+    bool sparse = false;                          // Allocate pages on first write
+    std::size_t page_size = 64 * 1024;            // Arena granularity
+    std::chrono::microseconds write_latency{0};   // Added to every write
+    std::uint64_t write_bandwidth = 0;            // Bytes per second, 0 = unlimited
+  };
+
+  MemoryFileOperations();
+  explicit MemoryFileOperations(const Options& options);
+  ~MemoryFileOperations() override;
+
+  MemoryFileOperations(const MemoryFileOperations&) = delete;
+  MemoryFileOperations& operator=(const MemoryFileOperations&) = delete;
+
+  // Copy part of the image out; unwritten pages of a sparse image read as zeros
+  FileError ReadAtOffset(std::uint64_t offset, std::uint8_t* data, std::size_t size) const;
+
+  // A copy of the whole image, including everything written so far
+  std::vector<std::uint8_t> Contents() const;
+
+  // Memory held by the arena's pages
+  std::uint64_t AllocatedBytes() const;
+
+  // FileOperations
+  FileError OpenDevice(const std::string& path) override;
+  FileError CreateTestFile(const std::string& path, std::uint64_t size) override;
+  FileError WriteAtOffset(
+      std::uint64_t offset,
+      const std::uint8_t* data,
+      std::size_t size) override;
+  FileError GetSize(std::uint64_t& size) override;
+  FileError Close() override;
+  bool IsOpen() const override { return open_; }
+
+  FileError WriteSequential(const std::uint8_t* data, std::size_t size) override;
+  FileError ReadSequential(std::uint8_t* data, std::size_t size, std::size_t& bytes_read) override;
+
+  // Async writes land in the arena when they complete, not when they are
+  // queued, so a caller that reuses a buffer too early is caught
+  bool SetAsyncQueueDepth(int depth) override;
+  int GetAsyncQueueDepth() const override { return async_queue_depth_; }
+  bool IsAsyncIOSupported() const override { return true; }
+  FileError AsyncWriteSequential(const std::uint8_t* data, std::size_t size,
+                                 AsyncWriteCallback callback = nullptr) override;
+  int GetPendingWriteCount() const override { return static_cast<int>(pending_.size()); }
+  void PollAsyncCompletions() override;
+  FileError WaitForPendingWrites() override;
+  void CancelAsyncIO() override;
+
+  FileError Seek(std::uint64_t position) override;
+  std::uint64_t Tell() const override { return position_; }
+  FileError SkipSequential(std::uint64_t size) override;
+  FileError ZeroRange(std::uint64_t offset, std::uint64_t length) override;
+  bool HasFastZeroRange() const override { return open_; }
+
+  FileError ForceSync() override;
+  FileError Flush() override;
+  void PrepareForSequentialRead(std::uint64_t, std::uint64_t) override {}
+
+  int GetHandle() const override { return -1; }
+  int GetLastErrorCode() const override { return 0; }
+  bool IsDirectIOEnabled() const override { return false; }
+  FileError SetDirectIOEnabled(bool enabled) override;
+  DirectIOInfo GetDirectIOInfo() const override { return DirectIOInfo(); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct PendingWrite {
+    std::uint64_t offset;
+    const std::uint8_t* data;
+    std::size_t size;
+    AsyncWriteCallback callback;
+    Clock::time_point submit_time;
+    Clock::time_point complete_time;
+  };
+
+  // Set up an empty arena for an image of the given size
+  FileError Allocate(std::uint64_t size);
+
+  // True if [offset, offset + size) lies within the image
+  bool InRange(std::uint64_t offset, std::uint64_t size) const;
+
+  // Copy into the arena, allocating pages as needed
+  FileError Store(std::uint64_t offset, const std::uint8_t* data, std::size_t size);
+
+  // When a write of this size queued now completes on the simulated device
+  Clock::time_point ScheduleWrite(std::size_t size);
+
+  // Complete queued writes that are due; with wait, block for at least one
+  void ReapCompletions(bool wait);
+
+  Options options_;
+  std::string name_;
+  std::vector<std::unique_ptr<std::uint8_t[]>> pages_;
+  std::uint64_t size_ = 0;
+  std::uint64_t position_ = 0;
+  bool open_ = false;
+
+  Clock::time_point device_free_time_;
+  int async_queue_depth_ = 1;
+  std::deque<PendingWrite> pending_;
+  FileError first_async_error_ = FileError::kSuccess;
+};
+
+}  // namespace rpi_imager
+
+#endif  // MEMORY_FILE_OPERATIONS_H_
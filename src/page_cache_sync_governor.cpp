@@ -0,0 +1,83 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "page_cache_sync_governor.h"
+#include <algorithm>
+
+namespace rpi_imager {
+
+namespace {
+
+constexpr double kTargetDrainSeconds = 1.0;  // A range should take about this long to write back
+constexpr double kDrainSmoothing = 0.25;     // Weight of a new drain measurement
+constexpr std::uint64_t kConstrainedDivisor = 4;
+
+}  // namespace
+
+PageCacheSyncGovernor::PageCacheSyncGovernor(const Limits& limits) : limits_(limits) {
+  limits_.min_range_bytes = std::max<std::uint64_t>(limits_.min_range_bytes, 1);
+  limits_.max_range_bytes = std::max(limits_.max_range_bytes, limits_.min_range_bytes);
+}
+
+std::uint64_t PageCacheSyncGovernor::RangeBytes() const {
+  std::uint64_t range = drain_rate_ > 0 ? static_cast<std::uint64_t>(drain_rate_ * kTargetDrainSeconds)
+                                        : limits_.initial_range_bytes;
+  if (constrained_) {
+    range /= kConstrainedDivisor;
+  }
+  return std::clamp(range, limits_.min_range_bytes, limits_.max_range_bytes);
+}
+
+PageCacheSyncGovernor::Decision PageCacheSyncGovernor::Check(std::uint64_t unsynced_bytes,
+                                                             std::chrono::milliseconds since_last_sync,
+                                                             const Sample& sample) {
+  const bool pressure_known = sample.memory_pressure >= 0;
+  const bool dirty_known = limits_.dirty_limit_bytes > 0 && sample.dirty_bytes >= 0;
+  const std::uint64_t dirty = dirty_known
+      ? static_cast<std::uint64_t>(sample.dirty_bytes + std::max<std::int64_t>(sample.writeback_bytes, 0))
+      : 0;
+
+  const bool pressure = pressure_known && sample.memory_pressure >= limits_.pressure_threshold;
+  const bool over_dirty_limit = dirty_known && dirty >= limits_.dirty_limit_bytes;
+  if (pressure || over_dirty_limit) {
+    constrained_ = true;
+  } else if ((pressure_known || dirty_known) &&
+             (!pressure_known || sample.memory_pressure < limits_.pressure_threshold / 2) &&
+             (!dirty_known || dirty < limits_.dirty_limit_bytes / 2)) {
+    // Go back to full ranges only once well clear of both limits
+    constrained_ = false;
+  }
+
+  const std::uint64_t range = RangeBytes();
+  if (unsynced_bytes == 0) {
+    return {false, range, nullptr};
+  }
+  // Pushing out less than the smallest range costs more in syncs than it frees
+  if (unsynced_bytes >= limits_.min_range_bytes) {
+    if (pressure) {
+      return {true, range, "memory pressure"};
+    }
+    if (over_dirty_limit) {
+      return {true, range, "dirty limit"};
+    }
+  }
+  if (unsynced_bytes >= range) {
+    return {true, range, "range full"};
+  }
+  if (since_last_sync >= limits_.max_interval) {
+    return {true, range, "interval"};
+  }
+  return {false, range, nullptr};
+}
+
+void PageCacheSyncGovernor::RecordDrain(std::uint64_t bytes, std::chrono::microseconds elapsed) {
+  if (bytes == 0 || elapsed.count() <= 0) {
+    return;
+  }
+  const double rate = static_cast<double>(bytes) / std::chrono::duration<double>(elapsed).count();
+  drain_rate_ = drain_rate_ > 0 ? drain_rate_ + kDrainSmoothing * (rate - drain_rate_) : rate;
+}
+
+}  // namespace rpi_imager
@@ -0,0 +1,75 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef PAGE_CACHE_SYNC_GOVERNOR_H_
+#define PAGE_CACHE_SYNC_GOVERNOR_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace rpi_imager {
+
+// Decides when to push written data out of the page cache while an image is
+// written without direct I/O.
+//
+// Data is pushed in ranges: once a range is full, writeback of it is started
+// and the previous range is waited for, so at most about two ranges are dirty
+// at any time and the wait only blocks when the device falls behind. The
+// range is sized to what the device drains in about a second, measured from
+// the ranges already written back, within fixed bounds. Writeback is started
+// early when the kernel holds more dirty data than the given limit, or when
+// memory pressure shows that other tasks are stalling on reclaim; in both
+// cases later ranges are kept small until the pressure is gone.
+//
+// Not thread safe: call from the thread that writes.
+class PageCacheSyncGovernor {
+ public:
+  struct Limits {
+    std::uint64_t min_range_bytes = 8ull * 1024 * 1024;
+    std::uint64_t max_range_bytes = 256ull * 1024 * 1024;
+    std::uint64_t initial_range_bytes = 32ull * 1024 * 1024;
+    std::chrono::milliseconds max_interval{5000};   // Longest time unsynced data may wait
+    std::uint64_t dirty_limit_bytes = 0;            // System-wide Dirty + Writeback, 0 = ignore
+    double pressure_threshold = 10.0;               // Memory PSI "some avg10" in percent
+  };
+
+  // Kernel page cache state; negative values are unknown
+  struct Sample {
+    std::int64_t dirty_bytes = -1;
+    std::int64_t writeback_bytes = -1;
+    double memory_pressure = -1;
+  };
+
+  struct Decision {
+    bool sync;
+    std::uint64_t range_bytes;      // Range size the decision was made against
+    const char* reason;             // "range full", "dirty limit", "memory pressure", "interval"
+  };
+
+  explicit PageCacheSyncGovernor(const Limits& limits);
+
+  // Whether to push the data written since the last sync out now
+  Decision Check(std::uint64_t unsynced_bytes, std::chrono::milliseconds since_last_sync,
+                 const Sample& sample);
+
+  // Record that a range of the given size was written back to the device in
+  // the given time, measured from when its writeback was started
+  void RecordDrain(std::uint64_t bytes, std::chrono::microseconds elapsed);
+
+  // Measured device drain rate in bytes per second, 0 until measured
+  double DrainRate() const { return drain_rate_; }
+
+  // Current range size
+  std::uint64_t RangeBytes() const;
+
+ private:
+  Limits limits_;
+  double drain_rate_ = 0;
+  bool constrained_ = false;  // Dirty limit or memory pressure hit recently
+};
+
+}  // namespace rpi_imager
+
+#endif  // PAGE_CACHE_SYNC_GOVERNOR_H_
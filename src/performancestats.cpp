@@ -420,6 +420,7 @@ QString PerformanceStats::eventTypeName(EventType type)
         case EventType::WriteAfterSyncImpact: return "writeAfterSyncImpact";
         case EventType::AsyncIOConfig: return "asyncIOConfig";
         case EventType::AsyncIOTiming: return "asyncIOTiming";
+        case EventType::WriteTuning: return "writeTuning";
         
         // Cycle boundaries
         case EventType::CycleStart: return "cycleStart";
@@ -84,6 +84,7 @@ public:
         WriteAfterSyncImpact,      // Throughput comparison before/after sync calls
         AsyncIOConfig,             // Async I/O configuration (enabled, supported, queue depth)
         AsyncIOTiming,             // Async I/O wall-clock time and per-write latency stats
+        WriteTuning,               // Queue depth / write size change by the adaptive write controller
         
         // Cycle boundaries (for multi-write sessions)
         CycleStart,            // Start of a new imaging cycle (metadata: image name, device)
@@ -5,6 +5,7 @@
 
 #include "ringbuffer.h"
 #include <QtGlobal>
+#include <algorithm>
 #include <chrono>
 
 RingBuffer::RingBuffer(size_t numSlots, size_t slotSize, size_t alignment)
@@ -15,6 +16,8 @@ RingBuffer::RingBuffer(size_t numSlots, size_t slotSize, size_t alignment)
     , _readIndex(0)
     , _committedCount(0)
     , _availableCount(numSlots)
+    , _recycleIndex(0)
+    , _slotRefs(numSlots, 0)
     , _producerDone(false)
     , _cancelled(false)
     , _producerStalls(0)
@@ -126,6 +129,7 @@ RingBuffer::Slot* RingBuffer::acquireWriteSlot(int timeoutMs)
     // Advance write index and decrement available count
     _writeIndex++;
     _availableCount--;
+    _slotRefs[index] = 1;  // Held by the producer until committed, then by the consumer
     
     return slot;
 }
@@ -145,6 +149,21 @@ void RingBuffer::commitWriteSlot(Slot* slot, size_t dataSize)
     _readAvailable.notify_one();
 }
 
+void RingBuffer::abortWriteSlot(Slot* slot)
+{
+    if (!slot) return;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Single producer: nothing can have been acquired after this slot
+        _writeIndex--;
+        _availableCount++;
+        _slotRefs[static_cast<size_t>(slot - _slots.data())] = 0;
+    }
+
+    _writeAvailable.notify_one();
+}
+
 RingBuffer::Slot* RingBuffer::acquireReadSlot(int timeoutMs)
 {
     std::unique_lock<std::mutex> lock(_mutex);
@@ -210,21 +229,43 @@ RingBuffer::Slot* RingBuffer::acquireReadSlot(int timeoutMs)
     return slot;
 }
 
+void RingBuffer::retainSlot(Slot* slot)
+{
+    if (!slot) return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _slotRefs[static_cast<size_t>(slot - _slots.data())]++;
+}
+
 void RingBuffer::releaseReadSlot(Slot* slot)
 {
     if (!slot) return;
     
-    slot->size = 0;  // Reset size
-    
     {
         std::lock_guard<std::mutex> lock(_mutex);
-        _availableCount++;
+        int &refs = _slotRefs[static_cast<size_t>(slot - _slots.data())];
+        if (refs > 0 && --refs > 0) {
+            return;  // Still in use by another holder
+        }
+        slot->size = 0;  // Reset size
+        _recycleSlots();
     }
     
     // Signal producer that slot is available
     _writeAvailable.notify_one();
 }
 
+void RingBuffer::_recycleSlots()
+{
+    // The producer refills slots in ring order, so a slot released ahead of an
+    // older one that is still held has to wait for it. Slots used as a plain
+    // pool (acquired for writing and released without a commit) count too.
+    while (_recycleIndex < _writeIndex && _slotRefs[_recycleIndex % _numSlots] == 0) {
+        _recycleIndex++;
+        _availableCount++;
+    }
+}
+
 void RingBuffer::producerDone()
 {
     {
@@ -270,6 +311,8 @@ void RingBuffer::reset()
     _readIndex = 0;
     _committedCount = 0;
     _availableCount = _numSlots;
+    _recycleIndex = 0;
+    std::fill(_slotRefs.begin(), _slotRefs.end(), 0);
     _producerDone = false;
     _cancelled = false;
     _producerStalls = 0;
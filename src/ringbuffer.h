@@ -90,6 +90,17 @@ public:
      */
     void commitWriteSlot(Slot* slot, size_t dataSize);
 
+    /**
+     * @brief Hand back the most recently acquired write slot unused (producer side)
+     *
+     * For producers that acquire a slot before they know whether data will
+     * arrive. Committing an empty slot instead would look like end of stream
+     * to the consumer.
+     *
+     * @param slot The slot to hand back; must be the last one acquired
+     */
+    void abortWriteSlot(Slot* slot);
+
     /**
      * @brief Acquire a slot for reading (consumer side)
      * 
@@ -109,6 +120,19 @@ public:
      */
     void releaseReadSlot(Slot* slot);
 
+    /**
+     * @brief Keep a slot from being reused until a matching releaseReadSlot()
+     *
+     * Lets a second reader, e.g. the cache writer, use the slot data in place
+     * alongside the consumer. The producer side calls this before committing
+     * or releasing the slot; the slot is only refilled once the consumer and
+     * every extra holder have released it. Slots are refilled in ring order, so a slot
+     * held longer also holds back the slots after it.
+     *
+     * @param slot The slot to retain
+     */
+    void retainSlot(Slot* slot);
+
     /**
      * @brief Signal that producer is done (no more data will be written)
      */
@@ -139,6 +163,14 @@ public:
      */
     size_t numSlots() const { return _numSlots; }
 
+    /**
+     * @brief Get the buffer behind a slot, e.g. to register it for I/O
+     *
+     * Slot buffers are allocated once and keep their address for the
+     * lifetime of the ring buffer.
+     */
+    const char* slotBuffer(size_t index) const { return _memory[index]; }
+
     /**
      * @brief Get number of committed (filled) slots waiting to be read
      *
@@ -188,6 +220,8 @@ private:
     std::atomic<size_t> _readIndex;   // Next slot to read
     std::atomic<size_t> _committedCount;  // Number of committed (readable) slots
     std::atomic<size_t> _availableCount;  // Number of available (writable) slots
+    size_t _recycleIndex;                 // Next handed out slot to return to the producer
+    std::vector<int> _slotRefs;           // Holders of each slot, guarded by _mutex
     
     // Synchronization
     std::mutex _mutex;
@@ -197,6 +231,9 @@ private:
     // State
     std::atomic<bool> _producerDone;
     std::atomic<bool> _cancelled;
+
+    // Return released slots to the producer in ring order; call with _mutex held
+    void _recycleSlots();
     
     // Starvation tracking for diagnostics
     std::atomic<uint64_t> _producerStalls;      // Times producer waited for free slot
@@ -32,6 +32,11 @@
 #include <QCryptographicHash>
 #endif
 
+#ifdef HAVE_GNUTLS
+#include <gnutls/gnutls.h>
+#include <gnutls/abstract.h>
+#endif
+
 SecureBoot::SecureBoot()
 {
 }
@@ -86,13 +91,8 @@ QMap<QString, QByteArray> SecureBoot::extractFatPartitionFiles(DeviceWrapperFatP
     return files;
 }
 
-bool SecureBoot::createBootImg(const QMap<QString, QByteArray> &files, const QString &outputPath)
+qint64 SecureBoot::bootImgSize(const QMap<QString, QByteArray> &files)
 {
-    if (files.isEmpty()) {
-        qDebug() << "SecureBoot::createBootImg: no files to pack";
-        return false;
-    }
-
     // Calculate required size for FAT32 image (with overhead)
     qint64 totalSize = 0;
     for (const QByteArray &content : files) {
@@ -106,13 +106,35 @@ bool SecureBoot::createBootImg(const QMap<QString, QByteArray> &files, const QSt
     if (imgSize < FAT32_MIN_SIZE) {
         imgSize = FAT32_MIN_SIZE;
     }
+    return imgSize;
+}
+
+bool SecureBoot::createBootImg(const QMap<QString, QByteArray> &files, const QString &outputPath)
+{
+    if (files.isEmpty()) {
+        qDebug() << "SecureBoot::createBootImg: no files to pack";
+        return false;
+    }
 
+    qint64 imgSize = bootImgSize(files);
     qDebug() << "SecureBoot: creating boot.img of size" << imgSize << "bytes for" << files.size() << "files";
     
-    // Delegate to platform-specific helper
     return BootImgCreator::createBootImg(files, outputPath, imgSize);
 }
 
+QByteArray SecureBoot::buildBootImg(const QMap<QString, QByteArray> &files)
+{
+    if (files.isEmpty()) {
+        qDebug() << "SecureBoot::buildBootImg: no files to pack";
+        return QByteArray();
+    }
+
+    qint64 imgSize = bootImgSize(files);
+    qDebug() << "SecureBoot: building boot.img of size" << imgSize << "bytes for" << files.size() << "files";
+
+    return BootImgCreator::buildBootImg(files, imgSize);
+}
+
 QByteArray SecureBoot::sha256File(const QString &filePath)
 {
     QFile file(filePath);
@@ -212,9 +234,62 @@ QByteArray SecureBoot::rsaSign(const QByteArray &data, const QString &rsaKeyPath
     QByteArray result(reinterpret_cast<const char*>(bytes), length);
     CFRelease(signature);
     
+    return result.toHex();
+#elif defined(HAVE_GNUTLS)
+    // On Linux, sign in-process with GnuTLS. Signing a SHA-256 hash with an RSA
+    // key wraps it in the PKCS#1 DigestInfo and pads it as PKCS#1 v1.5, which is
+    // what "openssl rsautl -sign -pkcs" produces for the DER-wrapped digest
+    if (data.size() != 32) {
+        qDebug() << "SecureBoot::rsaSign: invalid digest size:" << data.size();
+        return QByteArray();
+    }
+
+    QFile keyFile(rsaKeyPath);
+    if (!keyFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "SecureBoot::rsaSign: failed to open key file" << rsaKeyPath;
+        return QByteArray();
+    }
+    QByteArray pemData = keyFile.readAll();
+    keyFile.close();
+
+    gnutls_privkey_t privateKey;
+    int ret = gnutls_privkey_init(&privateKey);
+    if (ret < 0) {
+        qDebug() << "SecureBoot::rsaSign: gnutls_privkey_init failed:" << gnutls_strerror(ret);
+        return QByteArray();
+    }
+
+    // Accepts both PKCS#1 ("RSA PRIVATE KEY") and unencrypted PKCS#8 PEM keys
+    gnutls_datum_t pem = {reinterpret_cast<unsigned char *>(pemData.data()), static_cast<unsigned int>(pemData.size())};
+    ret = gnutls_privkey_import_x509_raw(privateKey, &pem, GNUTLS_X509_FMT_PEM, nullptr, 0);
+    if (ret < 0) {
+        qDebug() << "SecureBoot::rsaSign: failed to import private key:" << gnutls_strerror(ret);
+        gnutls_privkey_deinit(privateKey);
+        return QByteArray();
+    }
+
+    if (gnutls_privkey_get_pk_algorithm(privateKey, nullptr) != GNUTLS_PK_RSA) {
+        qDebug() << "SecureBoot::rsaSign: key is not an RSA key";
+        gnutls_privkey_deinit(privateKey);
+        return QByteArray();
+    }
+
+    QByteArray digest = data;
+    gnutls_datum_t hash = {reinterpret_cast<unsigned char *>(digest.data()), static_cast<unsigned int>(digest.size())};
+    gnutls_datum_t signature = {nullptr, 0};
+    ret = gnutls_privkey_sign_hash(privateKey, GNUTLS_DIG_SHA256, 0, &hash, &signature);
+    gnutls_privkey_deinit(privateKey);
+    if (ret < 0) {
+        qDebug() << "SecureBoot::rsaSign: failed to sign data:" << gnutls_strerror(ret);
+        return QByteArray();
+    }
+
+    QByteArray result(reinterpret_cast<const char *>(signature.data), static_cast<qsizetype>(signature.size));
+    gnutls_free(signature.data);
+
     return result.toHex();
 #else
-    // On Linux/Windows, use openssl rsautl to sign the pre-computed digest
+    // On Windows, use openssl rsautl to sign the pre-computed digest
     // We need to wrap the 32-byte SHA-256 digest in PKCS#1 DigestInfo DER structure
     QByteArray derWrapped;
     // DigestInfo for SHA-256: SEQUENCE { AlgorithmIdentifier, OCTET STRING }
@@ -264,20 +339,42 @@ bool SecureBoot::generateBootSig(const QString &bootImgPath, const QString &rsaK
 {
     qDebug() << "SecureBoot: generating boot.sig for" << bootImgPath;
 
-    // Calculate SHA-256 hash of boot.img (returns hex-encoded string)
-    QByteArray hashHex = sha256File(bootImgPath);
-    if (hashHex.isEmpty()) {
-        qDebug() << "SecureBoot::generateBootSig: failed to hash boot.img";
+    QFile imgFile(bootImgPath);
+    if (!imgFile.open(QIODevice::ReadOnly)) {
+        qDebug() << "SecureBoot::generateBootSig: failed to open" << bootImgPath;
+        return false;
+    }
+    QByteArray sig = bootSig(imgFile.readAll(), rsaKeyPath);
+    imgFile.close();
+    if (sig.isEmpty()) {
+        return false;
+    }
+
+    // Create boot.sig file
+    QFile sigFile(bootSigPath);
+    if (!sigFile.open(QIODevice::WriteOnly) || sigFile.write(sig) != sig.size()) {
+        qDebug() << "SecureBoot::generateBootSig: failed to create" << bootSigPath;
         return false;
     }
+    sigFile.close();
+
+    qDebug() << "SecureBoot: boot.sig created successfully at" << bootSigPath;
+    return true;
+}
+
+QByteArray SecureBoot::bootSig(const QByteArray &bootImg, const QString &rsaKeyPath)
+{
+    // Calculate SHA-256 hash of boot.img
+    AcceleratedCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(bootImg);
+    QByteArray hashBytes = hash.result();
+    QByteArray hashHex = hashBytes.toHex();
 
     qDebug() << "SecureBoot: boot.img SHA-256:" << hashHex;
 
-    // Convert hex hash to raw bytes for signing
-    QByteArray hashBytes = QByteArray::fromHex(hashHex);
     if (hashBytes.size() != 32) {
-        qDebug() << "SecureBoot::generateBootSig: invalid hash size:" << hashBytes.size();
-        return false;
+        qDebug() << "SecureBoot::bootSig: invalid hash size:" << hashBytes.size();
+        return QByteArray();
     }
 
     // Get current timestamp
@@ -288,35 +385,26 @@ bool SecureBoot::generateBootSig(const QString &bootImgPath, const QString &rsaK
     // The signature is computed over the raw 32-byte SHA-256 hash
     QByteArray signature = rsaSign(hashBytes, rsaKeyPath);
     if (signature.isEmpty()) {
-        qDebug() << "SecureBoot::generateBootSig: failed to sign boot.img";
-        return false;
+        qDebug() << "SecureBoot::bootSig: failed to sign boot.img";
+        return QByteArray();
     }
 
     qDebug() << "SecureBoot: RSA signature:" << signature;
 
-    // Create boot.sig file
-    QFile sigFile(bootSigPath);
-    if (!sigFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        qDebug() << "SecureBoot::generateBootSig: failed to create" << bootSigPath;
-        return false;
-    }
-
-    // Write boot.sig in the format expected by Raspberry Pi secure boot:
+    // boot.sig in the format expected by Raspberry Pi secure boot:
     // SHA-256 hash (hex)
     // ts: timestamp
     // rsa2048: signature (hex)
-    sigFile.write(hashHex);
-    sigFile.write("\n");
-    sigFile.write("ts: ");
-    sigFile.write(QByteArray::number(timestamp));
-    sigFile.write("\n");
-    sigFile.write("rsa2048: ");
-    sigFile.write(signature);
-    sigFile.write("\n");
-    sigFile.close();
-
-    qDebug() << "SecureBoot: boot.sig created successfully at" << bootSigPath;
-    return true;
+    QByteArray sig;
+    sig.append(hashHex);
+    sig.append("\n");
+    sig.append("ts: ");
+    sig.append(QByteArray::number(timestamp));
+    sig.append("\n");
+    sig.append("rsa2048: ");
+    sig.append(signature);
+    sig.append("\n");
+    return sig;
 }
 
 qint64 SecureBoot::getCurrentTimestamp()
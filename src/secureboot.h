@@ -33,6 +33,13 @@ public:
      */
     static bool createBootImg(const QMap<QString, QByteArray> &files, const QString &outputPath);
 
+    /**
+     * Build a FAT32 boot.img from a map of files in memory
+     * @param files Map of filename -> file contents
+     * @return The image, or empty on error
+     */
+    static QByteArray buildBootImg(const QMap<QString, QByteArray> &files);
+
     /**
      * Generate boot.sig signature file for a boot.img
      * @param bootImgPath Path to the boot.img file
@@ -42,6 +49,14 @@ public:
      */
     static bool generateBootSig(const QString &bootImgPath, const QString &rsaKeyPath, const QString &bootSigPath);
 
+    /**
+     * Generate the contents of boot.sig for a boot.img held in memory
+     * @param bootImg The boot.img contents
+     * @param rsaKeyPath Path to RSA 2048-bit private key (PEM format)
+     * @return boot.sig contents, or empty on error
+     */
+    static QByteArray bootSig(const QByteArray &bootImg, const QString &rsaKeyPath);
+
     /**
      * Generate SHA-256 hash of a file
      * @param filePath Path to the file
@@ -49,6 +64,13 @@ public:
      */
     static QByteArray sha256File(const QString &filePath);
 
+    /**
+     * Size of the FAT32 image needed for a set of files
+     * @param files Map of filename -> file contents
+     * @return Image size in bytes
+     */
+    static qint64 bootImgSize(const QMap<QString, QByteArray> &files);
+
     /**
      * Sign data with RSA PKCS#1 v1.5 using a private key
      * @param data Data to sign
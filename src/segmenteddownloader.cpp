@@ -0,0 +1,452 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "segmenteddownloader.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct ProbeState {
+    std::string contentRange;
+    std::string acceptRanges;
+};
+
+bool headerIs(const std::string &line, const char *name)
+{
+    size_t len = strlen(name);
+    if (line.size() <= len || line[len] != ':')
+        return false;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (tolower(static_cast<unsigned char>(line[i])) != tolower(static_cast<unsigned char>(name[i])))
+            return false;
+    }
+    return true;
+}
+
+std::string headerValue(const std::string &line)
+{
+    size_t start = line.find(':') + 1;
+    while (start < line.size() && line[start] == ' ')
+        start++;
+    size_t end = line.find_last_not_of(" \r\n");
+    return (end == std::string::npos || end < start) ? std::string() : line.substr(start, end - start + 1);
+}
+
+size_t probeHeaderCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    auto *state = static_cast<ProbeState *>(userdata);
+    std::string line(ptr, size * nmemb);
+
+    // A new status line starts the headers of the next response in a redirect chain
+    if (line.compare(0, 5, "HTTP/") == 0)
+    {
+        state->contentRange.clear();
+        state->acceptRanges.clear();
+    }
+    else if (headerIs(line, "Content-Range"))
+    {
+        state->contentRange = headerValue(line);
+    }
+    else if (headerIs(line, "Accept-Ranges"))
+    {
+        state->acceptRanges = headerValue(line);
+    }
+
+    return size * nmemb;
+}
+
+// Content-Range: bytes <from>-<to>/<total>, 0 if the total is missing or unknown
+quint64 contentRangeTotal(const std::string &contentRange)
+{
+    size_t slash = contentRange.rfind('/');
+    if (slash == std::string::npos)
+        return 0;
+
+    char *end = nullptr;
+    const char *totalStr = contentRange.c_str() + slash + 1;
+    unsigned long long total = strtoull(totalStr, &end, 10);
+    return end == totalStr ? 0 : total;
+}
+
+} // namespace
+
+SegmentedDownloader::SegmentedDownloader(CURL *templateHandle, quint64 startOffset, quint64 totalSize)
+    : _template(templateHandle), _multi(curl_multi_init()), _startOffset(startOffset), _totalSize(totalSize),
+      _segmentCount((totalSize - startOffset + SEGMENT_SIZE - 1) / SEGMENT_SIZE),
+      _nextToSchedule(0), _headIndex(0), _deliveredOffset(startOffset), _deliverFailed(false),
+      _activeTransfers(0)
+{
+}
+
+SegmentedDownloader::~SegmentedDownloader()
+{
+    for (auto &entry : _segments)
+    {
+        if (entry.second->handle)
+        {
+            curl_multi_remove_handle(_multi, entry.second->handle);
+            curl_easy_cleanup(entry.second->handle);
+        }
+    }
+    for (CURL *handle : _idleHandles)
+        curl_easy_cleanup(handle);
+
+    curl_multi_cleanup(_multi);
+}
+
+bool SegmentedDownloader::probeRangeSupport(CURL *templateHandle, quint64 &totalSize)
+{
+    CURL *probe = curl_easy_duphandle(templateHandle);
+    if (!probe)
+        return false;
+
+    ProbeState state;
+
+    curl_easy_setopt(probe, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) 0);
+    curl_easy_setopt(probe, CURLOPT_RANGE, "0-0");
+    curl_easy_setopt(probe, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(probe, CURLOPT_WRITEFUNCTION, &SegmentedDownloader::_discardCallback);
+    curl_easy_setopt(probe, CURLOPT_WRITEDATA, nullptr);
+    curl_easy_setopt(probe, CURLOPT_HEADERFUNCTION, &probeHeaderCallback);
+    curl_easy_setopt(probe, CURLOPT_HEADERDATA, &state);
+    curl_easy_setopt(probe, CURLOPT_TIMEOUT, 30L);
+
+    CURLcode ret = curl_easy_perform(probe);
+    long httpCode = 0;
+    curl_easy_getinfo(probe, CURLINFO_RESPONSE_CODE, &httpCode);
+    curl_easy_cleanup(probe);
+
+    if (ret != CURLE_OK || httpCode != 206)
+    {
+        qDebug() << "Segmented download: server does not support range requests"
+                 << "(HTTP" << httpCode << ", Accept-Ranges:" << state.acceptRanges.c_str() << ")";
+        return false;
+    }
+
+    quint64 total = contentRangeTotal(state.contentRange);
+    if (total == 0)
+    {
+        qDebug() << "Segmented download: unknown total size in Content-Range:" << state.contentRange.c_str();
+        return false;
+    }
+
+    totalSize = total;
+    return true;
+}
+
+CURLcode SegmentedDownloader::run(const DataCallback &deliver, const CancelCheck &isCancelled, const HeaderCallback &onHeader)
+{
+    if (!_multi)
+        return CURLE_OUT_OF_MEMORY;
+
+    _deliver = deliver;
+    _onHeader = onHeader;
+
+    qDebug() << "Segmented download:" << _segmentCount << "segments of" << SEGMENT_SIZE / (1024 * 1024)
+             << "MB over" << CONNECTIONS << "connections, starting at offset" << _startOffset;
+
+    QElapsedTimer timer;
+    timer.start();
+    CURLcode result = CURLE_OK;
+
+    _scheduleSegments();
+
+    while (_headIndex < _segmentCount)
+    {
+        if (isCancelled())
+        {
+            result = CURLE_ABORTED_BY_CALLBACK;
+            break;
+        }
+
+        int running = 0;
+        CURLMcode mc = curl_multi_perform(_multi, &running);
+        if (mc != CURLM_OK)
+        {
+            qDebug() << "Segmented download: curl_multi_perform failed:" << curl_multi_strerror(mc);
+            result = CURLE_RECV_ERROR;
+            break;
+        }
+
+        int pending = 0;
+        while (CURLMsg *msg = curl_multi_info_read(_multi, &pending))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            Segment *segment = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char **>(&segment));
+            CURLcode code = msg->data.result;
+            curl_multi_remove_handle(_multi, msg->easy_handle);
+            _activeTransfers--;
+
+            if (code == CURLE_OK && segment->received == segment->length)
+            {
+                if (segment->index == 0)
+                {
+                    curl_easy_getinfo(segment->handle, CURLINFO_NAMELOOKUP_TIME, &_stats.dnsTime);
+                    curl_easy_getinfo(segment->handle, CURLINFO_CONNECT_TIME, &_stats.connectTime);
+                    curl_easy_getinfo(segment->handle, CURLINFO_APPCONNECT_TIME, &_stats.tlsTime);
+                    curl_easy_getinfo(segment->handle, CURLINFO_STARTTRANSFER_TIME, &_stats.startTransferTime);
+                    curl_easy_getinfo(segment->handle, CURLINFO_HTTP_VERSION, &_stats.httpVersion);
+                }
+                segment->done = true;
+                _releaseHandle(segment);
+                continue;
+            }
+
+            if (_deliverFailed || isCancelled())
+            {
+                result = CURLE_WRITE_ERROR;
+                break;
+            }
+
+            if (segment->rangeRejected)
+                code = CURLE_RANGE_ERROR;
+            else if (code == CURLE_OK)
+                code = CURLE_PARTIAL_FILE;
+
+            // Ranges the server refuses are not going to work on a retry either
+            if (code != CURLE_RANGE_ERROR && segment->retries < MAX_SEGMENT_RETRIES)
+            {
+                segment->retries++;
+                qDebug() << "Segmented download: segment" << segment->index << "failed at"
+                         << segment->received << "of" << segment->length << "bytes:"
+                         << curl_easy_strerror(code) << "- retrying";
+                if (_startSegment(segment))
+                    continue;
+            }
+
+            qDebug() << "Segmented download: giving up on segment" << segment->index << ":" << curl_easy_strerror(code);
+            result = code;
+            break;
+        }
+
+        if (result != CURLE_OK)
+            break;
+
+        if (!_advanceHead())
+        {
+            result = CURLE_WRITE_ERROR;
+            break;
+        }
+
+        _scheduleSegments();
+
+        if (_headIndex < _segmentCount)
+        {
+            if (_activeTransfers == 0)
+            {
+                // Nothing in flight and the head cannot advance: no handle could be started
+                result = CURLE_FAILED_INIT;
+                break;
+            }
+            curl_multi_wait(_multi, nullptr, 0, 100, nullptr);
+        }
+    }
+
+    _stats.elapsedMs = timer.elapsed();
+
+    if (result == CURLE_OK)
+    {
+        qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+        qDebug() << "Segmented download done in" << elapsedMs / 1000 << "seconds,"
+                 << ((_totalSize - _startOffset) / 1024) * 1000 / elapsedMs << "KB/s";
+    }
+
+    return result;
+}
+
+size_t SegmentedDownloader::_writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    auto *segment = static_cast<Segment *>(userdata);
+    return segment->owner->_onData(segment, ptr, size * nmemb);
+}
+
+size_t SegmentedDownloader::_headerCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+    auto *segment = static_cast<Segment *>(userdata);
+    std::string line(ptr, size * nmemb);
+
+    // A new status line starts the headers of the next response in a redirect chain
+    if (line.compare(0, 5, "HTTP/") == 0)
+        segment->reportedTotal = 0;
+    else if (headerIs(line, "Content-Range"))
+        segment->reportedTotal = contentRangeTotal(headerValue(line));
+
+    // Those of the first segment stand in for the headers of a single stream download
+    if (segment->index == 0 && segment->retries == 0 && segment->owner->_onHeader)
+        segment->owner->_onHeader(line);
+
+    return size * nmemb;
+}
+
+size_t SegmentedDownloader::_discardCallback(char *, size_t size, size_t nmemb, void *)
+{
+    return size * nmemb;
+}
+
+size_t SegmentedDownloader::_onData(Segment *segment, const char *data, size_t len)
+{
+    if (!segment->statusChecked)
+    {
+        // A server answering 200 would send the whole file instead of our range
+        long httpCode = 0;
+        curl_easy_getinfo(segment->handle, CURLINFO_RESPONSE_CODE, &httpCode);
+        if (httpCode != 206)
+        {
+            qDebug() << "Segmented download: expected HTTP 206 for segment" << segment->index << "but got" << httpCode;
+            segment->rangeRejected = true;
+            return 0;
+        }
+        // Without a probe the size came from the caller, it may be off
+        if (segment->reportedTotal != _totalSize)
+        {
+            qDebug() << "Segmented download: server reports a size of" << segment->reportedTotal
+                     << "bytes for segment" << segment->index << "but expected" << _totalSize;
+            segment->rangeRejected = true;
+            return 0;
+        }
+        segment->statusChecked = true;
+    }
+
+    if (segment->received + len > segment->length)
+        return 0;
+
+    if (segment->index == _headIndex && segment->buffered.empty())
+    {
+        if (_deliver(data, len) != len)
+        {
+            _deliverFailed = true;
+            return 0;
+        }
+        _deliveredOffset += len;
+    }
+    else
+    {
+        if (segment->buffered.capacity() < segment->length)
+            segment->buffered.reserve(segment->length);
+        segment->buffered.append(data, len);
+    }
+
+    segment->received += len;
+    _stats.bytes += len;
+    return len;
+}
+
+bool SegmentedDownloader::_startSegment(Segment *segment)
+{
+    if (!segment->handle)
+    {
+        segment->handle = _acquireHandle();
+        if (!segment->handle)
+            return false;
+    }
+
+    quint64 from = segment->start + segment->received;
+    quint64 to = segment->start + segment->length - 1;
+    std::string range = std::to_string(from) + "-" + std::to_string(to);
+
+    segment->statusChecked = false;
+    segment->reportedTotal = 0;
+    curl_easy_setopt(segment->handle, CURLOPT_RANGE, range.c_str());
+    curl_easy_setopt(segment->handle, CURLOPT_WRITEDATA, segment);
+    curl_easy_setopt(segment->handle, CURLOPT_HEADERDATA, segment);
+    curl_easy_setopt(segment->handle, CURLOPT_PRIVATE, segment);
+
+    if (curl_multi_add_handle(_multi, segment->handle) != CURLM_OK)
+        return false;
+
+    _activeTransfers++;
+    return true;
+}
+
+void SegmentedDownloader::_scheduleSegments()
+{
+    while (_activeTransfers < CONNECTIONS
+           && _nextToSchedule < _segmentCount
+           && _nextToSchedule < _headIndex + MAX_WINDOW_SEGMENTS)
+    {
+        auto segment = std::make_unique<Segment>();
+        segment->owner = this;
+        segment->index = _nextToSchedule;
+        segment->start = _startOffset + _nextToSchedule * SEGMENT_SIZE;
+        segment->length = qMin(SEGMENT_SIZE, _totalSize - segment->start);
+
+        Segment *raw = segment.get();
+        _segments[_nextToSchedule] = std::move(segment);
+        _nextToSchedule++;
+
+        if (!_startSegment(raw))
+        {
+            qDebug() << "Segmented download: could not start segment" << raw->index;
+            break;
+        }
+    }
+}
+
+bool SegmentedDownloader::_advanceHead()
+{
+    while (_headIndex < _segmentCount)
+    {
+        auto it = _segments.find(_headIndex);
+        if (it == _segments.end())
+            return true;
+
+        Segment *segment = it->second.get();
+        if (!segment->buffered.empty())
+        {
+            if (_deliver(segment->buffered.data(), segment->buffered.size()) != segment->buffered.size())
+            {
+                _deliverFailed = true;
+                return false;
+            }
+            _deliveredOffset += segment->buffered.size();
+            std::string().swap(segment->buffered);
+        }
+
+        if (!segment->done)
+            return true;
+
+        _segments.erase(it);
+        _headIndex++;
+    }
+
+    return true;
+}
+
+CURL *SegmentedDownloader::_acquireHandle()
+{
+    if (!_idleHandles.empty())
+    {
+        CURL *handle = _idleHandles.back();
+        _idleHandles.pop_back();
+        return handle;
+    }
+
+    CURL *handle = curl_easy_duphandle(_template);
+    if (!handle)
+        return nullptr;
+
+    curl_easy_setopt(handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t) 0);
+    curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &SegmentedDownloader::_writeCallback);
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, &SegmentedDownloader::_headerCallback);
+    return handle;
+}
+
+void SegmentedDownloader::_releaseHandle(Segment *segment)
+{
+    if (segment->handle)
+    {
+        _idleHandles.push_back(segment->handle);
+        segment->handle = nullptr;
+    }
+}
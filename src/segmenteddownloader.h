@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef SEGMENTEDDOWNLOADER_H
+#define SEGMENTEDDOWNLOADER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+#include <QtGlobal>
+#include <curl/curl.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Downloads a file over several concurrent HTTP range requests
+ *
+ * A single TCP stream is limited by latency on long-distance links. This
+ * splits the remaining file into fixed-size segments, fetches a few of them
+ * at a time over a curl multi handle, and hands the data to the consumer
+ * strictly in file order.
+ *
+ * The segment at the head of the stream is passed through as it arrives.
+ * Segments further ahead are held in memory until the head catches up. The
+ * number of segments in flight or waiting is capped, which bounds the
+ * reorder memory to MAX_WINDOW_SEGMENTS * SEGMENT_SIZE.
+ */
+class SegmentedDownloader
+{
+public:
+    // Called with in-order data. Must return len, anything else aborts the download.
+    using DataCallback = std::function<size_t(const char *data, size_t len)>;
+    using CancelCheck = std::function<bool()>;
+    using HeaderCallback = std::function<void(const std::string &header)>;
+
+    static constexpr int CONNECTIONS = 4;
+    static constexpr quint64 SEGMENT_SIZE = 8ULL * 1024 * 1024;
+    static constexpr quint64 MAX_WINDOW_SEGMENTS = CONNECTIONS * 2;
+    static constexpr int MAX_SEGMENT_RETRIES = 3;
+
+    // Smaller downloads are not worth the extra connections
+    static constexpr quint64 MIN_SEGMENTED_SIZE = 64ULL * 1024 * 1024;
+
+    /**
+     * @param templateHandle Fully configured easy handle (URL, proxy, headers, TLS).
+     *                       It is duplicated for each connection and left untouched.
+     * @param startOffset First byte to download (non-zero when resuming)
+     * @param totalSize Size of the complete file
+     */
+    SegmentedDownloader(CURL *templateHandle, quint64 startOffset, quint64 totalSize);
+    ~SegmentedDownloader();
+
+    SegmentedDownloader(const SegmentedDownloader&) = delete;
+    SegmentedDownloader& operator=(const SegmentedDownloader&) = delete;
+
+    /**
+     * @brief Check whether the server honours range requests
+     *
+     * Requests the first byte of the file. Only a 206 response with a
+     * Content-Range that reveals the full size counts as support; the
+     * Accept-Ranges header alone is not trusted. Not needed when the size
+     * is known: every segment checks the server's Content-Range anyway.
+     *
+     * @param templateHandle Handle to duplicate for the probe
+     * @param totalSize Receives the full file size on success
+     */
+    static bool probeRangeSupport(CURL *templateHandle, quint64 &totalSize);
+
+    /**
+     * @brief Run the download to completion, cancellation or failure
+     *
+     * A server that ignores the ranges, or reports a different file size in
+     * its Content-Range, fails the download with CURLE_RANGE_ERROR before
+     * any of the data is delivered.
+     *
+     * @param onHeader Optional callback receiving the response header lines of the first segment
+     * @return CURLE_OK on success, the failing curl code otherwise
+     */
+    CURLcode run(const DataCallback &deliver, const CancelCheck &isCancelled, const HeaderCallback &onHeader = nullptr);
+
+    /**
+     * @brief Offset up to which data has been delivered in order
+     *
+     * After a failure the download can be resumed from here with a single stream.
+     */
+    quint64 deliveredOffset() const { return _deliveredOffset; }
+
+    /**
+     * @brief Transfer statistics of the last run()
+     *
+     * The connection timings are those of the first segment, the other
+     * connections are set up in parallel with it.
+     */
+    struct Stats {
+        quint64 bytes = 0;          // Received over all connections
+        qint64 elapsedMs = 0;
+        double dnsTime = 0, connectTime = 0, tlsTime = 0, startTransferTime = 0;  // Seconds
+        long httpVersion = 0;
+    };
+
+    const Stats &stats() const { return _stats; }
+
+private:
+    struct Segment {
+        SegmentedDownloader *owner = nullptr;
+        CURL *handle = nullptr;
+        quint64 index = 0;
+        quint64 start = 0;          // Absolute offset of the first byte
+        quint64 length = 0;
+        quint64 received = 0;
+        std::string buffered;       // Data received while not at the head of the stream
+        quint64 reportedTotal = 0;  // File size from the Content-Range of the response
+        int retries = 0;
+        bool statusChecked = false;
+        bool rangeRejected = false;     // Server answered without honouring the range
+        bool done = false;
+    };
+
+    static size_t _writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static size_t _headerCallback(char *ptr, size_t size, size_t nmemb, void *userdata);
+    static size_t _discardCallback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    size_t _onData(Segment *segment, const char *data, size_t len);
+    bool _startSegment(Segment *segment);
+    void _scheduleSegments();
+    bool _advanceHead();
+    CURL *_acquireHandle();
+    void _releaseHandle(Segment *segment);
+
+    CURL *_template;
+    CURLM *_multi;
+    quint64 _startOffset;
+    quint64 _totalSize;
+    quint64 _segmentCount;
+    quint64 _nextToSchedule;
+    quint64 _headIndex;
+    quint64 _deliveredOffset;
+    bool _deliverFailed;
+    DataCallback _deliver;
+    HeaderCallback _onHeader;
+    Stats _stats;
+
+    std::map<quint64, std::unique_ptr<Segment>> _segments;  // Scheduled but not yet fully delivered
+    std::vector<CURL *> _idleHandles;                        // Kept for connection reuse
+    int _activeTransfers;
+};
+
+#endif // SEGMENTEDDOWNLOADER_H
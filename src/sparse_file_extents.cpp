@@ -0,0 +1,90 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "sparse_file_extents.h"
+
+#include <cerrno>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+namespace rpi_imager {
+
+namespace {
+
+// Appends [start, end), merging it with the previous extent (or the start of
+// the file) when the hole in between is too short to skip
+void AddExtent(std::vector<FileExtent>& extents, std::uint64_t start, std::uint64_t end,
+               std::uint64_t min_hole_bytes) {
+  std::uint64_t previous_end = extents.empty() ? 0 : extents.back().offset + extents.back().length;
+  if (start - previous_end < min_hole_bytes) {
+    if (extents.empty()) {
+      extents.push_back({0, end});
+    } else {
+      extents.back().length = end - extents.back().offset;
+    }
+    return;
+  }
+  extents.push_back({start, end - start});
+}
+
+std::vector<FileExtent> WholeFile(std::uint64_t size) {
+  if (size == 0) {
+    return {};
+  }
+  return {{0, size}};
+}
+
+}  // namespace
+
+std::vector<FileExtent> ListDataExtents(int fd, std::uint64_t size, std::uint64_t min_hole_bytes) {
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+  std::vector<FileExtent> extents;
+  std::uint64_t pos = 0;
+
+  while (pos < size) {
+    off_t data = lseek(fd, static_cast<off_t>(pos), SEEK_DATA);
+    if (data < 0) {
+      if (errno == ENXIO) {
+        break;  // Only a hole is left
+      }
+      return WholeFile(size);  // Holes cannot be reported here
+    }
+    if (static_cast<std::uint64_t>(data) >= size) {
+      break;
+    }
+
+    off_t hole = lseek(fd, data, SEEK_HOLE);
+    if (hole < 0) {
+      return WholeFile(size);
+    }
+
+    std::uint64_t end = static_cast<std::uint64_t>(hole) < size ? static_cast<std::uint64_t>(hole) : size;
+    AddExtent(extents, static_cast<std::uint64_t>(data), end, min_hole_bytes);
+    pos = end;
+  }
+
+  // A short hole at the end is not worth skipping either
+  if (!extents.empty()) {
+    FileExtent& last = extents.back();
+    if (size - (last.offset + last.length) < min_hole_bytes) {
+      last.length = size - last.offset;
+    }
+  } else if (size < min_hole_bytes) {
+    return WholeFile(size);
+  }
+
+  return extents;
+#else
+  (void)fd;
+  (void)min_hole_bytes;
+  return WholeFile(size);
+#endif
+}
+
+}  // namespace rpi_imager
@@ -0,0 +1,31 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef SPARSE_FILE_EXTENTS_H_
+#define SPARSE_FILE_EXTENTS_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace rpi_imager {
+
+// A range of a file that holds data. Everything between extents reads as zeros.
+struct FileExtent {
+  std::uint64_t offset = 0;
+  std::uint64_t length = 0;
+};
+
+// Lists the data extents in the first size bytes of the file open as fd,
+// using SEEK_DATA/SEEK_HOLE, in file order.
+//
+// Holes shorter than min_hole_bytes are folded into the data around them, so
+// callers only see holes worth skipping. Where the platform or file system
+// cannot report holes, the whole range comes back as a single extent.
+// Moves the file offset of fd.
+std::vector<FileExtent> ListDataExtents(int fd, std::uint64_t size, std::uint64_t min_hole_bytes);
+
+}  // namespace rpi_imager
+
+#endif  // SPARSE_FILE_EXTENTS_H_
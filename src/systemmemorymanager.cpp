@@ -64,6 +64,48 @@ qint64 SystemMemoryManager::getAvailableMemoryMB()
     return availableMB;
 }
 
+SystemMemoryManager::PageCacheState SystemMemoryManager::getPageCacheState()
+{
+    QMutexLocker locker(&_pageCacheMutex);
+    if (_pageCacheSampleTimer.isValid() && _pageCacheSampleTimer.elapsed() < PAGE_CACHE_SAMPLE_INTERVAL_MS) {
+        return _pageCacheState;
+    }
+
+    PageCacheState state;
+#ifdef Q_OS_LINUX
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        // Values are in kB, e.g. "Dirty:             1234 kB"
+        const QList<QByteArray> lines = meminfo.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("Dirty:")) {
+                state.dirtyBytes = line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            } else if (line.startsWith("Writeback:")) {
+                state.writebackBytes = line.mid(10).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+    }
+
+    // "some avg10=1.23 avg60=..." - share of time some task stalled on memory;
+    // missing on kernels without CONFIG_PSI
+    QFile pressure("/proc/pressure/memory");
+    if (pressure.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QByteArray some = pressure.readLine();
+        const int start = some.indexOf("avg10=");
+        if (some.startsWith("some") && start >= 0) {
+            bool ok = false;
+            const double avg10 = some.mid(start + 6).split(' ').first().toDouble(&ok);
+            if (ok) {
+                state.memoryPressure = avg10;
+            }
+        }
+    }
+#endif
+    _pageCacheState = state;
+    _pageCacheSampleTimer.start();
+    return state;
+}
+
 SystemMemoryManager::SyncConfiguration SystemMemoryManager::calculateSyncConfiguration()
 {
     qint64 totalMemMB = getTotalMemoryMB();
@@ -319,6 +361,17 @@ size_t SystemMemoryManager::getOptimalWriteBufferSize()
     return bufferSize;
 }
 
+size_t SystemMemoryManager::getMaxWriteBufferSize()
+{
+    // Every write ring slot is this large, so only allow larger writes where
+    // the extra ring memory is not a burden
+    size_t bufferSize = getOptimalWriteBufferSize();
+    if (getTotalMemoryMB() >= 4096) {
+        bufferSize *= 4;
+    }
+    return bufferSize;
+}
+
 size_t SystemMemoryManager::getAdaptiveVerifyBufferSize(qint64 fileSize)
 {
     qint64 totalMemMB = getTotalMemoryMB();
@@ -361,6 +414,36 @@ size_t SystemMemoryManager::getAdaptiveVerifyBufferSize(qint64 fileSize)
     return memoryAdjustedSize;
 }
 
+SystemMemoryManager::VerifyPipelineConfiguration SystemMemoryManager::calculateVerifyPipelineConfiguration(qint64 fileSize)
+{
+    VerifyPipelineConfiguration config;
+    config.bufferSize = getAdaptiveVerifyBufferSize(fileSize);
+
+    qint64 totalMemMB = getTotalMemoryMB();
+
+    // Reads and hashing run at similar speeds on typical hardware, so a few
+    // buffers are enough to keep both busy. Extra depth mainly absorbs jitter
+    // from USB card readers.
+    size_t depth;
+    if (totalMemMB < LOW_MEMORY_THRESHOLD_MB) {
+        depth = 2;
+    } else if (totalMemMB < HIGH_MEMORY_THRESHOLD_MB) {
+        depth = 4;
+    } else {
+        depth = 8;
+    }
+
+    // Keep the pipeline within 128MB regardless of buffer size
+    const size_t maxPipelineBytes = 128 * 1024 * 1024;
+    size_t maxDepth = qMax(static_cast<size_t>(1), maxPipelineBytes / config.bufferSize - 1);
+    config.readAheadDepth = qMin(depth, maxDepth);
+
+    // One more buffer than the depth: the one currently being hashed
+    config.bufferCount = config.readAheadDepth + 1;
+
+    return config;
+}
+
 size_t SystemMemoryManager::getOptimalInputBufferSize()
 {
     qint64 totalMemMB = getTotalMemoryMB();
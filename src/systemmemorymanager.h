@@ -8,6 +8,8 @@
 
 #include <QtGlobal>
 #include <QString>
+#include <QElapsedTimer>
+#include <QMutex>
 
 /**
  * @brief Platform-agnostic system memory management interface
@@ -27,6 +29,24 @@ public:
         QString memoryTier;          // Description of memory tier (for logging)
     };
 
+    /**
+     * @brief Configuration for the pipelined post-write verification
+     */
+    struct VerifyPipelineConfiguration {
+        size_t bufferSize;           // Size of each aligned read buffer in bytes
+        size_t bufferCount;          // Number of buffers shared between reader and hasher
+        size_t readAheadDepth;       // How many reads may complete ahead of the hasher
+    };
+
+    /**
+     * @brief Snapshot of the kernel page cache, for the sync governor
+     */
+    struct PageCacheState {
+        qint64 dirtyBytes = -1;      // Dirty pages waiting for writeback, -1 if unknown
+        qint64 writebackBytes = -1;  // Pages being written back, -1 if unknown
+        double memoryPressure = -1;  // Memory PSI "some avg10" in percent, -1 if unknown
+    };
+
     /**
      * @brief Get the singleton instance
      */
@@ -44,6 +64,17 @@ public:
      */
     qint64 getAvailableMemoryMB();
 
+    /**
+     * @brief Sample dirty and writeback page counts and memory pressure
+     *
+     * Reads /proc/meminfo and /proc/pressure/memory on Linux, at most every
+     * PAGE_CACHE_SAMPLE_INTERVAL_MS; calls in between return the last sample,
+     * as writes come far more often than these values change. Other platforms
+     * report everything as unknown.
+     * @return Current page cache state
+     */
+    PageCacheState getPageCacheState();
+
     /**
      * @brief Calculate optimal sync configuration based on system memory
      * @return SyncConfiguration with adaptive intervals
@@ -62,6 +93,15 @@ public:
      */
     size_t getOptimalWriteBufferSize();
 
+    /**
+     * @brief Largest write size the adaptive write controller may move to
+     *
+     * Write buffers are allocated at this size so the controller can make
+     * writes larger than getOptimalWriteBufferSize() at run time.
+     * @return Maximum write size in bytes
+     */
+    size_t getMaxWriteBufferSize();
+
     /**
      * @brief Calculate adaptive verification buffer size based on file size and available memory
      * @param fileSize Size of file to be verified in bytes
@@ -69,6 +109,17 @@ public:
      */
     size_t getAdaptiveVerifyBufferSize(qint64 fileSize);
 
+    /**
+     * @brief Calculate buffer count and read-ahead depth for pipelined verification
+     * 
+     * Verification reads the device on one thread and hashes on another. The
+     * buffers let reads run ahead of hashing, so both overlap instead of alternating.
+     * 
+     * @param fileSize Size of data to be verified in bytes
+     * @return Buffer size, count and read-ahead depth for the verify pipeline
+     */
+    VerifyPipelineConfiguration calculateVerifyPipelineConfiguration(qint64 fileSize);
+
     /**
      * @brief Calculate optimal input buffer size for downloads/streams
      * @return Optimal buffer size for input operations in bytes
@@ -137,6 +188,12 @@ private:
     // Cached values to avoid repeated system calls
     mutable qint64 _cachedTotalMemoryMB = -1;
     mutable qint64 _cachedAvailableMemoryMB = -1;
+
+    // Last page cache sample, shared by all writers
+    static constexpr qint64 PAGE_CACHE_SAMPLE_INTERVAL_MS = 100;
+    QMutex _pageCacheMutex;
+    PageCacheState _pageCacheState;
+    QElapsedTimer _pageCacheSampleTimer;
 };
 
 #endif // SYSTEMMEMORYMANAGER_H
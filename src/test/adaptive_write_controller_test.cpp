@@ -0,0 +1,141 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "adaptive_write_controller.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+using rpi_imager::AdaptiveWriteController;
+
+namespace {
+
+constexpr std::size_t MB = 1024 * 1024;
+
+// A device that transfers one command at a time, each taking a fixed
+// overhead plus its size over the bandwidth, and completes a command a fixed
+// latency after its transfer. The writer always has data, so the controller's
+// settings are all that limit it.
+struct SimulatedDevice {
+  double bandwidth;                     // Bytes per second
+  std::chrono::microseconds overhead;   // Per command, not overlapped
+  std::chrono::microseconds latency;    // Per command, overlapped by queueing
+};
+
+class Simulation {
+ public:
+  explicit Simulation(AdaptiveWriteController& controller) : controller_(controller) {}
+
+  // Run a number of writes through the device; returns the throughput of the last quarter
+  double Run(const SimulatedDevice& device, int writes) {
+    using Clock = AdaptiveWriteController::Clock;
+    std::uint64_t tail_bytes = 0;
+    Clock::time_point tail_start;
+
+    for (int n = 0; n < writes; ++n) {
+      while (static_cast<int>(in_flight_.size()) < controller_.InFlightLimit()) {
+        const std::size_t size = controller_.ChunkSize();
+        const Clock::time_point start = std::max(now_, bus_free_);
+        bus_free_ = start + device.overhead + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(size) / device.bandwidth));
+        in_flight_.push_back({now_, bus_free_ + device.latency, size});
+      }
+
+      Write write = in_flight_.front();
+      in_flight_.pop_front();
+      now_ = std::max(now_, write.complete);
+      controller_.RecordCompletion(
+          write.size, std::chrono::duration_cast<std::chrono::microseconds>(now_ - write.submit), now_);
+
+      if (n == writes * 3 / 4) {
+        tail_start = now_;
+      } else if (n > writes * 3 / 4) {
+        tail_bytes += write.size;
+      }
+    }
+    return static_cast<double>(tail_bytes) / std::chrono::duration<double>(now_ - tail_start).count();
+  }
+
+ private:
+  struct Write {
+    AdaptiveWriteController::Clock::time_point submit;
+    AdaptiveWriteController::Clock::time_point complete;
+    std::size_t size;
+  };
+
+  AdaptiveWriteController& controller_;
+  AdaptiveWriteController::Clock::time_point now_;
+  AdaptiveWriteController::Clock::time_point bus_free_;
+  std::deque<Write> in_flight_;
+};
+
+AdaptiveWriteController::Limits depthOnly() {
+  AdaptiveWriteController::Limits limits;
+  limits.max_depth = 16;
+  limits.initial_depth = 4;
+  limits.min_chunk = limits.max_chunk = 1 * MB;
+  return limits;
+}
+
+// 1 MB transfers in 1 ms with 10 ms to complete: 11 writes in flight keep it busy
+const SimulatedDevice kNvmeEnclosure{1000.0 * MB, std::chrono::microseconds(0), std::chrono::milliseconds(10)};
+
+// A card reader that handles one command at a time
+const SimulatedDevice kCardReader{20.0 * MB, std::chrono::microseconds(500), std::chrono::microseconds(0)};
+
+// A reader that spends 40 ms on every command before any data moves
+const SimulatedDevice kSlowCommands{20.0 * MB, std::chrono::milliseconds(40), std::chrono::microseconds(0)};
+
+}  // namespace
+
+TEST_CASE("AdaptiveWriteController deepens the queue while it pays", "[adaptivewrite]") {
+  AdaptiveWriteController controller(depthOnly());
+  Simulation sim(controller);
+
+  double throughput = sim.Run(kNvmeEnclosure, 2000);
+  REQUIRE(controller.InFlightLimit() >= 11);
+  REQUIRE(throughput > 0.9 * 1000 * MB);
+}
+
+TEST_CASE("AdaptiveWriteController keeps a serial device at a shallow queue", "[adaptivewrite]") {
+  AdaptiveWriteController controller(depthOnly());
+  Simulation sim(controller);
+
+  sim.Run(kCardReader, 500);
+  REQUIRE(controller.InFlightLimit() == 1);
+  REQUIRE(controller.ChunkSize() == 1 * MB);
+}
+
+TEST_CASE("AdaptiveWriteController grows writes when per-command overhead dominates", "[adaptivewrite]") {
+  AdaptiveWriteController::Limits limits = depthOnly();
+  limits.min_chunk = 256 * 1024;
+  limits.max_chunk = 8 * MB;
+  limits.initial_chunk = 1 * MB;
+  AdaptiveWriteController controller(limits);
+  Simulation sim(controller);
+
+  sim.Run(kSlowCommands, 1000);
+  REQUIRE(controller.ChunkSize() == 8 * MB);
+}
+
+TEST_CASE("AdaptiveWriteController backs off when the device slows down", "[adaptivewrite]") {
+  AdaptiveWriteController controller(depthOnly());
+  std::vector<AdaptiveWriteController::Decision> decisions;
+  controller.SetDecisionCallback([&decisions](const AdaptiveWriteController::Decision& d) {
+    decisions.push_back(d);
+  });
+  Simulation sim(controller);
+
+  sim.Run(kNvmeEnclosure, 2000);
+  const int converged = controller.InFlightLimit();
+  decisions.clear();
+
+  sim.Run(kCardReader, 500);
+  REQUIRE_FALSE(decisions.empty());
+  REQUIRE(std::string(decisions.front().reason) == "back off");
+  REQUIRE(decisions.front().depth == converged / 2);
+  REQUIRE(controller.InFlightLimit() == 1);
+}
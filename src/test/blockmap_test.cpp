@@ -0,0 +1,312 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "blockmap.h"
+#include "memory_file_operations.h"
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QString>
+#include <vector>
+
+using rpi_imager::FileError;
+using rpi_imager::MemoryFileOperations;
+
+namespace {
+
+const QByteArray ZERO_CHECKSUM(64, '0');
+
+QByteArray makeBmap(const QByteArray &version, const QByteArray &body, bool withFileChecksum)
+{
+    QByteArray xml =
+        "<?xml version=\"1.0\" ?>\n"
+        "<bmap version=\"" + version + "\">\n"
+        "    <ImageSize> 20000 </ImageSize>\n"
+        "    <BlockSize> 4096 </BlockSize>\n"
+        "    <BlocksCount> 5 </BlocksCount>\n"
+        "    <MappedBlocksCount> 3 </MappedBlocksCount>\n";
+    if (withFileChecksum)
+        xml += "    <ChecksumType> sha256 </ChecksumType>\n"
+               "    <BmapFileChecksum> " + ZERO_CHECKSUM + " </BmapFileChecksum>\n";
+    xml += "    <BlockMap>\n" + body + "    </BlockMap>\n</bmap>\n";
+
+    if (withFileChecksum)
+    {
+        QByteArray digest = QCryptographicHash::hash(xml, QCryptographicHash::Sha256).toHex();
+        xml.replace(ZERO_CHECKSUM, digest);
+    }
+    return xml;
+}
+
+const QByteArray RANGES =
+    "        <Range chksum=\"AAAA\"> 0-1 </Range>\n"
+    "        <Range chksum=\"bbbb\"> 4 </Range>\n";
+
+struct BlockRange
+{
+    quint64 first, last;
+};
+
+// A recognisable image: every byte depends on its offset
+QByteArray makeImage(qsizetype size)
+{
+    QByteArray image(size, Qt::Uninitialized);
+    for (qsizetype i = 0; i < size; i++)
+        image[i] = static_cast<char>((i * 7 + i / 4096) & 0xff);
+    return image;
+}
+
+// A version 2 bmap of 4 KiB blocks for the image, with the real checksum of each range
+BlockMap mapFor(const QByteArray &image, const std::vector<BlockRange> &blocks)
+{
+    const quint64 blocksCount = (image.size() + 4095) / 4096;
+    quint64 mapped = 0;
+    QByteArray body;
+    for (const BlockRange &range : blocks)
+    {
+        const qsizetype offset = static_cast<qsizetype>(range.first * 4096);
+        const qsizetype end = qMin(static_cast<qsizetype>((range.last + 1) * 4096), image.size());
+        const QByteArray digest = QCryptographicHash::hash(image.mid(offset, end - offset), QCryptographicHash::Sha256).toHex();
+        body += "        <Range chksum=\"" + digest + "\"> " + QByteArray::number(range.first)
+                + "-" + QByteArray::number(range.last) + " </Range>\n";
+        mapped += range.last - range.first + 1;
+    }
+
+    QByteArray xml =
+        "<?xml version=\"1.0\" ?>\n"
+        "<bmap version=\"2.0\">\n"
+        "    <ImageSize> " + QByteArray::number(image.size()) + " </ImageSize>\n"
+        "    <BlockSize> 4096 </BlockSize>\n"
+        "    <BlocksCount> " + QByteArray::number(blocksCount) + " </BlocksCount>\n"
+        "    <MappedBlocksCount> " + QByteArray::number(mapped) + " </MappedBlocksCount>\n"
+        "    <BlockMap>\n" + body + "    </BlockMap>\n</bmap>\n";
+    return BlockMap::parse(xml);
+}
+
+// A device of the image's size, filled with 0xee so that skipped blocks stand out
+void createDevice(MemoryFileOperations &device, qsizetype size)
+{
+    REQUIRE(device.CreateTestFile("device", static_cast<std::uint64_t>(size)) == FileError::kSuccess);
+    std::vector<std::uint8_t> fill(static_cast<size_t>(size), 0xee);
+    REQUIRE(device.WriteAtOffset(0, fill.data(), fill.size()) == FileError::kSuccess);
+}
+
+// Passes the image on in chunks, the way extraction hands over its buffers
+BlockMapWriter::Result writeImage(BlockMapWriter &writer, MemoryFileOperations &device, const QByteArray &image,
+                                  qsizetype chunk, bool canSkip, quint64 *skipped = nullptr)
+{
+    BlockMapWriter::SpanFunction write = [&device](const char *data, size_t len) {
+        return device.WriteSequential(reinterpret_cast<const std::uint8_t *>(data), len) == FileError::kSuccess;
+    };
+    BlockMapWriter::SpanFunction skip = [&device, skipped](const char *, size_t len) {
+        if (skipped)
+            *skipped += len;
+        return device.SkipSequential(len) == FileError::kSuccess;
+    };
+
+    for (qsizetype pos = 0; pos < image.size(); pos += chunk)
+    {
+        const qsizetype len = qMin(chunk, image.size() - pos);
+        BlockMapWriter::Result result = writer.write(image.constData() + pos, static_cast<size_t>(len),
+                                                     write, canSkip ? skip : BlockMapWriter::SpanFunction());
+        if (result != BlockMapWriter::Result::Ok)
+            return result;
+    }
+    return BlockMapWriter::Result::Ok;
+}
+
+QByteArray deviceContents(const MemoryFileOperations &device)
+{
+    std::vector<std::uint8_t> contents = device.Contents();
+    return QByteArray(reinterpret_cast<const char *>(contents.data()), static_cast<qsizetype>(contents.size()));
+}
+
+} // namespace
+
+TEST_CASE("BlockMap parses a version 2 bmap file", "[blockmap]") {
+    QString error;
+    BlockMap map = BlockMap::parse(makeBmap("2.0", RANGES, true), &error);
+
+    REQUIRE(map.isValid());
+    REQUIRE(error.isEmpty());
+    REQUIRE(map.imageSize() == 20000);
+    REQUIRE(map.blockSize() == 4096);
+    REQUIRE(map.checksumAlgorithm() == QCryptographicHash::Sha256);
+    REQUIRE(map.ranges().size() == 2);
+
+    REQUIRE(map.ranges().at(0).offset == 0);
+    REQUIRE(map.ranges().at(0).length == 8192);
+    REQUIRE(map.ranges().at(0).checksum == "aaaa");
+
+    // The last block is clamped to the image size
+    REQUIRE(map.ranges().at(1).offset == 16384);
+    REQUIRE(map.ranges().at(1).length == 20000 - 16384);
+    REQUIRE(map.mappedBytes() == 8192 + 20000 - 16384);
+}
+
+TEST_CASE("BlockMap defaults to SHA1 for version 1 files", "[blockmap]") {
+    BlockMap map = BlockMap::parse(makeBmap("1.3", RANGES, false));
+
+    REQUIRE(map.isValid());
+    REQUIRE(map.checksumAlgorithm() == QCryptographicHash::Sha1);
+}
+
+TEST_CASE("BlockMap rejects a corrupted bmap file", "[blockmap]") {
+    QByteArray xml = makeBmap("2.0", RANGES, true);
+    xml.replace("0-1", "0-2");
+
+    QString error;
+    REQUIRE_FALSE(BlockMap::parse(xml, &error).isValid());
+    REQUIRE_FALSE(error.isEmpty());
+}
+
+TEST_CASE("BlockMap rejects inconsistent ranges", "[blockmap]") {
+    SECTION("overlapping") {
+        QByteArray body = "<Range> 0-2 </Range><Range> 2 </Range>";
+        REQUIRE_FALSE(BlockMap::parse(makeBmap("2.0", body, false)).isValid());
+    }
+    SECTION("out of bounds") {
+        QByteArray body = "<Range> 0-1 </Range><Range> 5 </Range>";
+        REQUIRE_FALSE(BlockMap::parse(makeBmap("2.0", body, false)).isValid());
+    }
+    SECTION("mapped block count mismatch") {
+        QByteArray body = "<Range> 0-3 </Range>";
+        REQUIRE_FALSE(BlockMap::parse(makeBmap("2.0", body, false)).isValid());
+    }
+}
+
+TEST_CASE("BlockMap rejects unsupported versions", "[blockmap]") {
+    REQUIRE_FALSE(BlockMap::parse(makeBmap("3.0", RANGES, false)).isValid());
+    REQUIRE_FALSE(BlockMap::parse("not xml").isValid());
+}
+
+TEST_CASE("BlockMap lists sibling file names like bmaptool", "[blockmap]") {
+    QStringList names = BlockMap::siblingNames("/images/core-image.wic.xz");
+
+    REQUIRE(names.size() == 3);
+    REQUIRE(names.at(0) == "/images/core-image.wic.xz.bmap");
+    REQUIRE(names.at(1) == "/images/core-image.wic.bmap");
+    REQUIRE(names.at(2) == "/images/core-image.bmap");
+}
+
+TEST_CASE("BlockMapWriter skips the unmapped gaps between ranges", "[blockmap]") {
+    // The last range ends in a partial block
+    const QByteArray image = makeImage(16 * 4096 - 100);
+    BlockMap map = mapFor(image, {{0, 1}, {5, 5}, {8, 9}, {12, 15}});
+    REQUIRE(map.isValid());
+
+    MemoryFileOperations device;
+    createDevice(device, image.size());
+    BlockMapWriter writer(map, 4096);
+
+    quint64 skipped = 0;
+    REQUIRE(writeImage(writer, device, image, 3 * 4096, true, &skipped) == BlockMapWriter::Result::Ok);
+    REQUIRE(writer.isComplete());
+    REQUIRE(writer.offset() == static_cast<quint64>(image.size()));
+    REQUIRE(device.Tell() == static_cast<std::uint64_t>(image.size()));
+
+    // Blocks 2-4, 6-7 and 10-11 are skipped, also where a gap crosses a buffer boundary
+    REQUIRE(writer.bytesSkipped() == 7 * 4096);
+    REQUIRE(skipped == writer.bytesSkipped());
+
+    const QByteArray contents = deviceContents(device);
+    for (const BlockMap::Range &range : map.ranges())
+    {
+        const qsizetype offset = static_cast<qsizetype>(range.offset);
+        const qsizetype length = static_cast<qsizetype>(range.length);
+        REQUIRE(contents.mid(offset, length) == image.mid(offset, length));
+    }
+    REQUIRE(contents.mid(2 * 4096, 3 * 4096) == QByteArray(3 * 4096, '\xee'));
+    REQUIRE(contents.mid(6 * 4096, 2 * 4096) == QByteArray(2 * 4096, '\xee'));
+    REQUIRE(contents.mid(10 * 4096, 2 * 4096) == QByteArray(2 * 4096, '\xee'));
+
+    // The digests taken while writing are those of the ranges
+    REQUIRE(writer.digests().size() == map.ranges().size());
+    for (qsizetype i = 0; i < map.ranges().size(); i++)
+        REQUIRE(writer.digests().at(i) == map.ranges().at(i).checksum);
+}
+
+TEST_CASE("BlockMapWriter writes gaps it cannot skip", "[blockmap]") {
+    const QByteArray image = makeImage(16 * 4096);
+    BlockMap map = mapFor(image, {{0, 1}, {5, 5}, {8, 9}, {12, 15}});
+    REQUIRE(map.isValid());
+
+    MemoryFileOperations device;
+    createDevice(device, image.size());
+
+    SECTION("unaligned buffers") {
+        // No gap starts and ends on a 4 KiB boundary within a buffer of 3000 bytes
+        BlockMapWriter writer(map, 4096);
+        REQUIRE(writeImage(writer, device, image, 3000, true) == BlockMapWriter::Result::Ok);
+        REQUIRE(writer.bytesSkipped() == 0);
+        REQUIRE(writer.digests().size() == map.ranges().size());
+        REQUIRE(writer.digests().last() == map.ranges().last().checksum);
+        REQUIRE(deviceContents(device) == image);
+    }
+    SECTION("gaps below the minimum") {
+        BlockMapWriter writer(map, 3 * 4096);
+        REQUIRE(writeImage(writer, device, image, 8 * 4096, true) == BlockMapWriter::Result::Ok);
+
+        // Only blocks 2-4 are large enough to be skipped
+        REQUIRE(writer.bytesSkipped() == 3 * 4096);
+        const QByteArray contents = deviceContents(device);
+        REQUIRE(contents.left(2 * 4096) == image.left(2 * 4096));
+        REQUIRE(contents.mid(2 * 4096, 3 * 4096) == QByteArray(3 * 4096, '\xee'));
+        REQUIRE(contents.mid(5 * 4096) == image.mid(5 * 4096));
+    }
+    SECTION("no skip function") {
+        BlockMapWriter writer(map, 4096);
+        REQUIRE(writeImage(writer, device, image, 8 * 4096, false) == BlockMapWriter::Result::Ok);
+        REQUIRE(writer.bytesSkipped() == 0);
+        REQUIRE(deviceContents(device) == image);
+    }
+}
+
+TEST_CASE("BlockMapWriter writes data past the mapped image as is", "[blockmap]") {
+    const QByteArray image = makeImage(8 * 4096);
+    BlockMap map = mapFor(image, {{0, 0}});
+    REQUIRE(map.isValid());
+
+    // The image turns out longer than the bmap describes
+    const QByteArray longer = image + makeImage(4 * 4096);
+    MemoryFileOperations device;
+    createDevice(device, longer.size());
+    BlockMapWriter writer(map, 4096);
+
+    REQUIRE(writeImage(writer, device, longer, 12 * 4096, true) == BlockMapWriter::Result::Ok);
+    REQUIRE(writer.isComplete());
+    REQUIRE(writer.bytesSkipped() == 7 * 4096);
+    REQUIRE(deviceContents(device).mid(8 * 4096) == longer.mid(8 * 4096));
+}
+
+TEST_CASE("BlockMapWriter stops at a range that does not match its checksum", "[blockmap]") {
+    QByteArray image = makeImage(16 * 4096);
+    BlockMap map = mapFor(image, {{0, 1}, {5, 6}, {12, 15}});
+    REQUIRE(map.isValid());
+    image[6 * 4096 + 10] = static_cast<char>(image.at(6 * 4096 + 10) ^ 1);
+
+    MemoryFileOperations device;
+    createDevice(device, image.size());
+    BlockMapWriter writer(map, 4096);
+
+    REQUIRE(writeImage(writer, device, image, 4096, true) == BlockMapWriter::Result::ChecksumMismatch);
+    REQUIRE(writer.mismatchOffset() == 5 * 4096);
+    REQUIRE_FALSE(writer.isComplete());
+    REQUIRE(writer.digests().size() == 1);
+}
+
+TEST_CASE("BlockMapWriter knows when the image ended early", "[blockmap]") {
+    const QByteArray image = makeImage(16 * 4096);
+    BlockMap map = mapFor(image, {{0, 1}, {12, 15}});
+    REQUIRE(map.isValid());
+
+    MemoryFileOperations device;
+    createDevice(device, image.size());
+    BlockMapWriter writer(map, 4096);
+
+    REQUIRE(writeImage(writer, device, image.left(13 * 4096), 4096, true) == BlockMapWriter::Result::Ok);
+    REQUIRE_FALSE(writer.isComplete());
+    REQUIRE(writer.offset() == 13 * 4096);
+}
@@ -0,0 +1,123 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "bootimgcreator.h"
+#include "devicewrapper.h"
+#include "devicewrapperfatpartition.h"
+#include "disk_formatter.h"
+#include "memory_file_operations.h"
+#include <cstring>
+
+namespace {
+
+constexpr qint64 kImageSize = 33 * 1024 * 1024;
+
+quint16 le16(const QByteArray &data, int offset)
+{
+    auto u = reinterpret_cast<const uchar *>(data.constData() + offset);
+    return quint16(u[0] | (u[1] << 8));
+}
+
+quint32 le32(const QByteArray &data, int offset)
+{
+    return quint32(le16(data, offset)) | (quint32(le16(data, offset + 2)) << 16);
+}
+
+// Loads a finished image back into memory, the way the device side sees it
+class ImageReader
+{
+public:
+    explicit ImageReader(const QByteArray &image)
+    {
+        _ops.CreateTestFile("boot.img", std::uint64_t(image.size()));
+        _ops.WriteAtOffset(0, reinterpret_cast<const std::uint8_t *>(image.constData()), std::size_t(image.size()));
+        _dw = new DeviceWrapper(&_ops);
+        _fat = new DeviceWrapperFatPartition(_dw, 0, quint64(image.size()), _dw);
+    }
+
+    ~ImageReader() { delete _dw; }
+
+    DeviceWrapperFatPartition *fat() { return _fat; }
+
+private:
+    rpi_imager::MemoryFileOperations _ops;
+    DeviceWrapper *_dw;
+    DeviceWrapperFatPartition *_fat;
+};
+
+QMap<QString, QByteArray> bootFiles()
+{
+    QMap<QString, QByteArray> files;
+    files["config.txt"] = QByteArray("arm_64bit=1\n");
+    files["Image"] = QByteArray(3 * 1024 * 1024 + 17, 'k');
+    files["overlays/vc4-kms-v3d.dtbo"] = QByteArray(5000, 'o');
+    files["overlays/README"] = QByteArray(10, 'r');
+    files["dtbs/vendor/board.dtb"] = QByteArray(70000, 'd');
+    return files;
+}
+
+}  // namespace
+
+TEST_CASE("BootImgCreator builds a FAT32 volume without a partition table", "[bootimgcreator]") {
+    QByteArray image = BootImgCreator::buildBootImg(bootFiles(), kImageSize);
+    REQUIRE(image.size() == kImageSize);
+
+    // Boot sector at the very start, no MBR in front of it
+    REQUIRE(le16(image, 510) == 0xAA55);
+    REQUIRE(std::memcmp(image.constData() + 82, "FAT32   ", 8) == 0);
+    REQUIRE(le32(image, 28) == 0);
+
+    // Enough clusters that readers do not take it for FAT16
+    const quint32 bytesPerSector = le16(image, 11);
+    const quint32 sectorsPerCluster = quint8(image[13]);
+    const quint32 reserved = le16(image, 14);
+    const quint32 fats = quint8(image[16]);
+    const quint32 totalSectors = le32(image, 32);
+    const quint32 fatSectors = le32(image, 36);
+    REQUIRE(bytesPerSector * totalSectors == quint64(kImageSize));
+    REQUIRE((totalSectors - reserved - fats * fatSectors) / sectorsPerCluster >= 65525);
+
+    // Backup boot sector where the BPB says it is
+    const quint32 backup = le16(image, 50);
+    REQUIRE(image.mid(backup * bytesPerSector, 512) == image.left(512));
+}
+
+TEST_CASE("BootImgCreator stores files in root and nested directories", "[bootimgcreator]") {
+    QMap<QString, QByteArray> files = bootFiles();
+    ImageReader reader(BootImgCreator::buildBootImg(files, kImageSize));
+    DeviceWrapperFatPartition *fat = reader.fat();
+
+    REQUIRE(fat->readFile("config.txt") == files["config.txt"]);
+    REQUIRE(fat->readFile("Image") == files["Image"]);
+    REQUIRE(fat->readFile("overlays/vc4-kms-v3d.dtbo") == files["overlays/vc4-kms-v3d.dtbo"]);
+    REQUIRE(fat->readFile("overlays/README") == files["overlays/README"]);
+
+    // Files in subdirectories must not also show up in the root
+    QStringList listed = fat->listAllFilesRecursive();
+    REQUIRE(listed.size() == files.size());
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it)
+        REQUIRE(listed.contains(it.key()));
+    REQUIRE_FALSE(fat->fileExists("README"));
+}
+
+TEST_CASE("BootImgCreator refuses an empty file set", "[bootimgcreator]") {
+    REQUIRE(BootImgCreator::buildBootImg(QMap<QString, QByteArray>(), kImageSize).isEmpty());
+}
+
+TEST_CASE("DiskFormatter refuses volumes too small to hold any data", "[bootimgcreator]") {
+    // Reserved sectors and FATs alone would not fit; this used to wrap around
+    for (std::uint64_t size : {std::uint64_t(0), std::uint64_t(8 * 1024), std::uint64_t(17 * 1024)}) {
+        INFO(size);
+        auto memory = std::make_unique<rpi_imager::MemoryFileOperations>();
+        REQUIRE(memory->CreateTestFile("tiny.img", size) == rpi_imager::FileError::kSuccess);
+        rpi_imager::DiskFormatter formatter(std::move(memory));
+        auto result = formatter.FormatVolume(size);
+        REQUIRE_FALSE(result);
+        REQUIRE(result.error() == rpi_imager::FormatError::kInsufficientSpace);
+    }
+
+    REQUIRE(BootImgCreator::buildBootImg(bootFiles(), 16 * 1024).isEmpty());
+}
@@ -0,0 +1,153 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "cacheindex.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace {
+
+const QDateTime BASE_TIME = QDateTime::fromSecsSinceEpoch(1700000000).toUTC();
+
+CacheIndex::Entry makeEntry(const CacheIndex &index, const QByteArray &hash, qint64 size, int ageSecs)
+{
+    CacheIndex::Entry entry;
+    entry.hash = hash;
+    entry.fileHash = hash + "f";
+    entry.fileName = index.filePathFor(hash);
+    entry.size = size;
+    entry.lastUsed = BASE_TIME.addSecs(-ageSecs);
+    return entry;
+}
+
+}  // namespace
+
+TEST_CASE("CacheIndex round-trips entries through the index file", "[cacheindex]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    CacheIndex index(dir.path());
+    CacheIndex::Entry entry = makeEntry(index, "aa11", 1234, 60);
+    entry.verifiedAt = BASE_TIME;
+    index.insert(entry);
+    index.insert(makeEntry(index, "bb22", 10, 0));
+    REQUIRE(index.save());
+
+    CacheIndex loaded(dir.path());
+    REQUIRE(loaded.load());
+    REQUIRE(loaded.count() == 2);
+
+    const CacheIndex::Entry *found = loaded.find("aa11");
+    REQUIRE(found != nullptr);
+    REQUIRE(found->fileHash == "aa11f");
+    REQUIRE(found->fileName == index.filePathFor("aa11"));
+    REQUIRE(found->size == 1234);
+    REQUIRE(found->lastUsed == BASE_TIME.addSecs(-60));
+    REQUIRE(found->verifiedAt == BASE_TIME);
+    REQUIRE_FALSE(loaded.find("bb22")->verifiedAt.isValid());
+    REQUIRE_FALSE(found->expanded);
+    REQUIRE(found->diskBytes == 0);
+    REQUIRE(loaded.totalSize() == 1244);
+}
+
+TEST_CASE("CacheIndex counts expanded entries by their space on disk", "[cacheindex]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    CacheIndex index(dir.path());
+    CacheIndex::Entry sparse = makeEntry(index, "aa11", 1000, 300);
+    sparse.expanded = true;
+    sparse.diskBytes = 100;
+    index.insert(sparse);
+    index.insert(makeEntry(index, "bb22", 40, 100));
+    REQUIRE(index.totalSize() == 140);
+    REQUIRE(index.save());
+
+    CacheIndex loaded(dir.path());
+    REQUIRE(loaded.load());
+    const CacheIndex::Entry *found = loaded.find("aa11");
+    REQUIRE(found != nullptr);
+    REQUIRE(found->expanded);
+    REQUIRE(found->size == 1000);
+    REQUIRE(found->diskBytes == 100);
+
+    // Evicting the expanded entry frees what it takes on disk, not its size
+    REQUIRE(loaded.evictionCandidates(200, 60).isEmpty());
+    REQUIRE(loaded.evictionCandidates(200, 100) == QList<QByteArray>{"aa11"});
+}
+
+TEST_CASE("CacheIndex ignores entries pointing outside the cache directory", "[cacheindex]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    QFile file(QDir(dir.path()).filePath("index.json"));
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(R"({"version": 1, "entries": [
+        {"hash": "aa", "file": "aa.cache", "size": 1},
+        {"hash": "bb", "file": "../bb.cache", "size": 1},
+        {"hash": "cc", "file": "/etc/passwd", "size": 1}
+    ]})");
+    file.close();
+
+    CacheIndex index(dir.path());
+    REQUIRE(index.load());
+    REQUIRE(index.count() == 1);
+    REQUIRE(index.contains("aa"));
+}
+
+TEST_CASE("CacheIndex rejects a corrupt index file", "[cacheindex]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    QFile file(QDir(dir.path()).filePath("index.json"));
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write("{ not json");
+    file.close();
+
+    CacheIndex index(dir.path());
+    REQUIRE_FALSE(index.load());
+    REQUIRE(index.count() == 0);
+}
+
+TEST_CASE("CacheIndex evicts least recently used entries first", "[cacheindex]") {
+    CacheIndex index("/cache");
+    index.insert(makeEntry(index, "old", 40, 300));
+    index.insert(makeEntry(index, "mid", 40, 200));
+    index.insert(makeEntry(index, "new", 40, 100));
+
+    // Everything fits, nothing to evict
+    REQUIRE(index.evictionCandidates(200, 40).isEmpty());
+
+    // Room for 40 more bytes within 120 means one entry has to go
+    REQUIRE(index.evictionCandidates(120, 40) == QList<QByteArray>{"old"});
+    REQUIRE(index.evictionCandidates(120, 41) == (QList<QByteArray>{"old", "mid"}));
+
+    // The entry being replaced is never picked
+    REQUIRE(index.evictionCandidates(120, 40, "old") == QList<QByteArray>{"mid"});
+}
+
+TEST_CASE("CacheIndex only asks for verification of changed files", "[cacheindex]") {
+    CacheIndex::Entry entry;
+    REQUIRE(CacheIndex::needsVerification(entry, BASE_TIME));
+
+    entry.verifiedAt = BASE_TIME;
+    REQUIRE_FALSE(CacheIndex::needsVerification(entry, BASE_TIME));
+    REQUIRE_FALSE(CacheIndex::needsVerification(entry, BASE_TIME.addSecs(-10)));
+    REQUIRE(CacheIndex::needsVerification(entry, BASE_TIME.addSecs(10)));
+    REQUIRE(CacheIndex::needsVerification(entry, QDateTime()));
+}
+
+TEST_CASE("CacheIndex names cache files after the image hash", "[cacheindex]") {
+    CacheIndex index("/cache");
+    REQUIRE(index.filePathFor("ABCdef0123") == "/cache/abcdef0123.cache");
+
+    // Anything that is not a plain hex digest never ends up in a path
+    QString path = index.filePathFor("../../etc/passwd");
+    REQUIRE(path.startsWith("/cache/"));
+    REQUIRE_FALSE(path.contains(".."));
+}
@@ -0,0 +1,117 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "directhttpreceiver.h"
+#include <QByteArray>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Clears the proxy variables libcurl honours for the duration of a test
+class NoProxyEnvironment {
+ public:
+  NoProxyEnvironment() {
+    for (const char* var : kVars) {
+      saved_.push_back(qgetenv(var));
+      qunsetenv(var);
+    }
+  }
+  ~NoProxyEnvironment() {
+    for (size_t i = 0; i < saved_.size(); ++i) {
+      if (!saved_[i].isEmpty()) {
+        qputenv(kVars[i], saved_[i]);
+      }
+    }
+  }
+
+ private:
+  static constexpr const char* kVars[] = {"http_proxy", "HTTP_PROXY", "all_proxy", "ALL_PROXY"};
+  std::vector<QByteArray> saved_;
+};
+
+bool parse(const std::string& head, quint64 start_offset, DirectHttpReceiver::ResponseHead& result) {
+  return DirectHttpReceiver::parseHead(head, start_offset, result);
+}
+
+bool parse(const std::string& head, quint64 start_offset = 0) {
+  DirectHttpReceiver::ResponseHead result;
+  return parse(head, start_offset, result);
+}
+
+}  // namespace
+
+TEST_CASE("DirectHttpReceiver treats loopback, private and link-local addresses as local", "[directhttpreceiver]") {
+  for (const char* ip : {"127.0.0.1", "127.1.2.3", "10.0.0.5", "172.16.0.1", "172.31.255.254", "192.168.1.10",
+                         "169.254.3.4", "::1", "fd12:3456::1", "fc00::1", "fe80::1", "FE80::abcd", "::ffff:192.168.0.2"}) {
+    INFO(ip);
+    REQUIRE(DirectHttpReceiver::isLocalAddress(ip));
+  }
+}
+
+TEST_CASE("DirectHttpReceiver does not treat public or malformed addresses as local", "[directhttpreceiver]") {
+  for (const char* ip : {"8.8.8.8", "172.15.0.1", "172.32.0.1", "192.169.0.1", "169.253.0.1", "11.0.0.1",
+                         "2001:db8::1", "::ffff:8.8.8.8", "256.1.1.1", "10.0.0.1x", "", "localhost"}) {
+    INFO(ip);
+    REQUIRE_FALSE(DirectHttpReceiver::isLocalAddress(ip));
+  }
+}
+
+TEST_CASE("DirectHttpReceiver only takes plain http URLs without a proxy", "[directhttpreceiver]") {
+  NoProxyEnvironment environment;
+  REQUIRE(DirectHttpReceiver::isCandidate("http://192.168.1.2/image.img.xz", ""));
+  REQUIRE_FALSE(DirectHttpReceiver::isCandidate("https://192.168.1.2/image.img.xz", ""));
+  REQUIRE_FALSE(DirectHttpReceiver::isCandidate("ftp://192.168.1.2/image.img.xz", ""));
+  REQUIRE_FALSE(DirectHttpReceiver::isCandidate("http://192.168.1.2/image.img.xz", "http://proxy:3128"));
+
+  qputenv("http_proxy", "http://proxy:3128");
+  REQUIRE_FALSE(DirectHttpReceiver::isCandidate("http://192.168.1.2/image.img.xz", ""));
+  qunsetenv("http_proxy");
+}
+
+TEST_CASE("DirectHttpReceiver accepts a plain response with a Content-Length", "[directhttpreceiver]") {
+  DirectHttpReceiver::ResponseHead result;
+  REQUIRE(parse("HTTP/1.1 200 OK\r\nServer: test\r\ncontent-length: 1048576\r\n\r\n", 0, result));
+  REQUIRE(result.contentLength == 1048576);
+  REQUIRE(result.lines.size() == 3);
+  REQUIRE(result.lines.front() == "HTTP/1.1 200 OK\r\n");
+
+  // Accept-Ranges only matters to resuming, which checks the 206 response itself
+  REQUIRE(parse("HTTP/1.1 200 OK\r\nAccept-Ranges: bytes\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE(parse("HTTP/1.0 200 OK\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE(parse("HTTP/1.1 200 OK\r\nContent-Length: 10\r\nContent-Encoding: identity\r\n\r\n"));
+}
+
+TEST_CASE("DirectHttpReceiver leaves responses without a usable Content-Length to curl", "[directhttpreceiver]") {
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nAccept-Ranges: bytes\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nContent-Length:\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nContent-Length: 12abc\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nContent-Length: 10\r\nContent-Encoding: gzip\r\n\r\n"));
+}
+
+TEST_CASE("DirectHttpReceiver checks a resumed response covers the requested offset", "[directhttpreceiver]") {
+  REQUIRE(parse("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 4096-8191/8192\r\nContent-Length: 4096\r\n\r\n",
+                4096));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\nContent-Length: 8192\r\n\r\n", 4096));
+  REQUIRE_FALSE(parse("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 0-8191/8192\r\nContent-Length: 8192\r\n\r\n",
+                      4096));
+  REQUIRE_FALSE(parse("HTTP/1.1 206 Partial Content\r\nContent-Length: 4096\r\n\r\n", 4096));
+  REQUIRE_FALSE(parse("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 0-9/10\r\nContent-Length: 10\r\n\r\n"));
+}
+
+TEST_CASE("DirectHttpReceiver rejects malformed responses", "[directhttpreceiver]") {
+  REQUIRE_FALSE(parse(""));
+  REQUIRE_FALSE(parse("\r\n"));
+  REQUIRE_FALSE(parse("garbage\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/2 200\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 OK\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 404 Not Found\r\nContent-Length: 10\r\n\r\n"));
+
+  // Headers end at the first empty line, a length after it does not count
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\r\n\r\nContent-Length: 10\r\n\r\n"));
+  REQUIRE_FALSE(parse("HTTP/1.1 200 OK\nContent-Length: 10\n\n"));
+}
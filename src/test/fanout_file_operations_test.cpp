@@ -0,0 +1,267 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "fanout_file_operations.h"
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <thread>
+#include <vector>
+
+using rpi_imager::FanOutFileOperations;
+using rpi_imager::FileError;
+using rpi_imager::FileOperations;
+
+namespace {
+
+// In-memory device that can be told to fail its writes
+class MemoryDevice : public FileOperations {
+ public:
+  static inline std::atomic<int> next_serial{0};
+
+  explicit MemoryDevice(std::size_t size) : data(size, 0) {}
+
+  FileError OpenDevice(const std::string&) override { return FileError::kSuccess; }
+  FileError CreateTestFile(const std::string&, std::uint64_t) override { return FileError::kSuccess; }
+  FileError WriteAtOffset(std::uint64_t offset, const std::uint8_t* buf, std::size_t size) override {
+    if (fail_writes || offset + size > data.size()) return FileError::kWriteError;
+    std::memcpy(data.data() + offset, buf, size);
+    return FileError::kSuccess;
+  }
+  FileError GetSize(std::uint64_t& size) override { size = data.size(); return FileError::kSuccess; }
+  FileError Close() override { open = false; return FileError::kSuccess; }
+  bool IsOpen() const override { return open; }
+
+  FileError WriteSequential(const std::uint8_t* buf, std::size_t size) override {
+    // Counts this device's calls per thread, so a thread that is reused
+    // across operations shows up
+    thread_local std::map<int, int> calls_on_thread;
+    most_calls_on_one_thread = std::max(most_calls_on_one_thread, ++calls_on_thread[serial]);
+    FileError r = WriteAtOffset(pos, buf, size);
+    if (r == FileError::kSuccess) pos += size;
+    return r;
+  }
+  FileError ReadSequential(std::uint8_t* buf, std::size_t size, std::size_t& bytes_read) override {
+    bytes_read = std::min<std::size_t>(size, data.size() - pos);
+    std::memcpy(buf, data.data() + pos, bytes_read);
+    pos += bytes_read;
+    return FileError::kSuccess;
+  }
+
+  FileError Seek(std::uint64_t position) override { pos = position; return FileError::kSuccess; }
+  std::uint64_t Tell() const override { return pos; }
+  FileError ForceSync() override { return FileError::kSuccess; }
+  FileError Flush() override { return FileError::kSuccess; }
+  void PrepareForSequentialRead(std::uint64_t, std::uint64_t) override {}
+  int GetHandle() const override { return -1; }
+  int GetLastErrorCode() const override { return fail_writes ? 5 : 0; }
+  bool IsDirectIOEnabled() const override { return false; }
+  FileError SetDirectIOEnabled(bool) override { return FileError::kSuccess; }
+  DirectIOInfo GetDirectIOInfo() const override { return DirectIOInfo(); }
+  FileError ZeroRange(std::uint64_t offset, std::uint64_t length) override {
+    if (fail_writes || offset + length > data.size()) return FileError::kWriteError;
+    std::memset(data.data() + offset, 0, length);
+    return FileError::kSuccess;
+  }
+  bool HasFastZeroRange() const override { return true; }
+
+  // With complete_on_thread, writes complete on a thread of their own
+  FileError AsyncWriteSequential(const std::uint8_t* buf, std::size_t size, AsyncWriteCallback callback) override {
+    if (!complete_on_thread) return FileOperations::AsyncWriteSequential(buf, size, callback);
+    FileError r = WriteSequential(buf, size);
+    completions.emplace_back([r, size, callback]() {
+      if (callback) callback(r, r == FileError::kSuccess ? size : 0);
+    });
+    return FileError::kSuccess;
+  }
+  FileError WaitForPendingWrites() override {
+    for (std::thread& t : completions) t.join();
+    completions.clear();
+    return FileError::kSuccess;
+  }
+
+  bool RegisterWriteBuffers(const std::vector<WriteBuffer>& buffers) override {
+    registered = buffers.size();
+    return supports_registration;
+  }
+
+  std::vector<std::uint8_t> data;
+  std::uint64_t pos = 0;
+  bool fail_writes = false;
+  bool open = true;
+  bool supports_registration = true;
+  std::size_t registered = 0;
+  int serial = next_serial++;
+  int most_calls_on_one_thread = 0;
+  bool complete_on_thread = false;
+  std::vector<std::thread> completions;
+};
+
+struct FanOutFixture {
+  FanOutFileOperations fanout;
+  std::vector<MemoryDevice*> devices;
+
+  explicit FanOutFixture(std::vector<std::size_t> sizes) {
+    for (std::size_t n = 0; n < sizes.size(); ++n) {
+      auto device = std::make_unique<MemoryDevice>(sizes[n]);
+      devices.push_back(device.get());
+      fanout.AddTarget("/dev/test" + std::to_string(n), std::move(device));
+    }
+  }
+};
+
+const std::uint8_t PATTERN[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+}  // namespace
+
+TEST_CASE("FanOutFileOperations writes to every target", "[fanout]") {
+  FanOutFixture f({64, 64, 64});
+
+  REQUIRE(f.fanout.Seek(8) == FileError::kSuccess);
+  REQUIRE(f.fanout.WriteSequential(PATTERN, sizeof(PATTERN)) == FileError::kSuccess);
+
+  for (MemoryDevice* device : f.devices) {
+    REQUIRE(std::memcmp(device->data.data() + 8, PATTERN, sizeof(PATTERN)) == 0);
+    REQUIRE(device->Tell() == 16);
+  }
+}
+
+TEST_CASE("FanOutFileOperations reads from the active target only", "[fanout]") {
+  FanOutFixture f({64, 64});
+  f.devices[1]->data[0] = 42;
+
+  f.fanout.SetActiveTarget(1);
+  REQUIRE(f.fanout.Seek(0) == FileError::kSuccess);
+
+  std::uint8_t byte = 0;
+  std::size_t read = 0;
+  REQUIRE(f.fanout.ReadSequential(&byte, 1, read) == FileError::kSuccess);
+  REQUIRE(read == 1);
+  REQUIRE(byte == 42);
+  REQUIRE(f.devices[0]->Tell() == 0);
+}
+
+TEST_CASE("FanOutFileOperations drops a failing target and carries on", "[fanout]") {
+  FanOutFixture f({64, 64, 64});
+  std::vector<std::size_t> failed;
+  f.fanout.SetTargetFailedCallback([&failed](std::size_t index, const std::string&) { failed.push_back(index); });
+
+  f.devices[1]->fail_writes = true;
+  REQUIRE(f.fanout.WriteSequential(PATTERN, sizeof(PATTERN)) == FileError::kSuccess);
+  REQUIRE(f.fanout.WriteSequential(PATTERN, sizeof(PATTERN)) == FileError::kSuccess);
+
+  REQUIRE(failed == std::vector<std::size_t>{1});
+  REQUIRE_FALSE(f.fanout.IsHealthy(1));
+  REQUIRE(f.fanout.HealthyTargetCount() == 2);
+  REQUIRE(f.devices[0]->Tell() == 16);
+  REQUIRE(f.devices[2]->Tell() == 16);
+  REQUIRE(f.fanout.GetLastErrorCode() == 5);
+
+  // Only once every target has failed is the error reported
+  f.devices[0]->fail_writes = true;
+  f.devices[2]->fail_writes = true;
+  REQUIRE(f.fanout.WriteSequential(PATTERN, sizeof(PATTERN)) != FileError::kSuccess);
+  REQUIRE(f.fanout.HealthyTargetCount() == 0);
+}
+
+TEST_CASE("FanOutFileOperations completes an async write once for all targets", "[fanout]") {
+  FanOutFixture f({64, 64});
+  f.devices[0]->fail_writes = true;
+
+  int calls = 0;
+  FileError result = FileError::kWriteError;
+  std::size_t written = 0;
+  REQUIRE(f.fanout.AsyncWriteSequential(PATTERN, sizeof(PATTERN),
+      [&](FileError r, std::size_t n) { ++calls; result = r; written = n; }) == FileError::kSuccess);
+
+  REQUIRE(f.fanout.WaitForPendingWrites() == FileError::kSuccess);
+  REQUIRE(calls == 1);
+  REQUIRE(result == FileError::kSuccess);
+  REQUIRE(written == sizeof(PATTERN));
+  REQUIRE_FALSE(f.fanout.IsHealthy(0));
+}
+
+TEST_CASE("FanOutFileOperations registers write buffers with every target", "[fanout]") {
+  FanOutFixture f({64, 64});
+  std::uint8_t slots[2][16];
+  std::vector<FileOperations::WriteBuffer> buffers = {{slots[0], sizeof(slots[0])}, {slots[1], sizeof(slots[1])}};
+
+  // One target that can use them is enough
+  f.devices[0]->supports_registration = false;
+  REQUIRE(f.fanout.RegisterWriteBuffers(buffers));
+  REQUIRE(f.devices[0]->registered == 2);
+  REQUIRE(f.devices[1]->registered == 2);
+
+  f.devices[1]->supports_registration = false;
+  REQUIRE_FALSE(f.fanout.RegisterWriteBuffers({}));
+  REQUIRE(f.devices[1]->registered == 0);
+}
+
+TEST_CASE("FanOutFileOperations reports the smallest device size", "[fanout]") {
+  FanOutFixture f({128, 64, 256});
+
+  std::uint64_t size = 0;
+  REQUIRE(f.fanout.GetSize(size) == FileError::kSuccess);
+  REQUIRE(size == 64);
+
+  f.fanout.MarkFailed(1);
+  REQUIRE(f.fanout.GetSize(size) == FileError::kSuccess);
+  REQUIRE(size == 128);
+}
+
+TEST_CASE("FanOutFileOperations drops a target that fails to zero a range", "[fanout]") {
+  FanOutFixture f({64, 64, 64});
+  std::vector<std::size_t> failed;
+  f.fanout.SetTargetFailedCallback([&failed](std::size_t index, const std::string&) { failed.push_back(index); });
+  for (MemoryDevice* device : f.devices) {
+    device->data.assign(64, 0xff);
+  }
+
+  f.devices[2]->fail_writes = true;
+  REQUIRE(f.fanout.ZeroRange(8, 16) == FileError::kSuccess);
+
+  REQUIRE(failed == std::vector<std::size_t>{2});
+  REQUIRE(f.fanout.HealthyTargetCount() == 2);
+  REQUIRE(f.devices[0]->data[8] == 0);
+  REQUIRE(f.devices[1]->data[23] == 0);
+  REQUIRE(f.devices[1]->data[24] == 0xff);
+}
+
+TEST_CASE("FanOutFileOperations keeps a thread per target across operations", "[fanout]") {
+  FanOutFixture f({64, 64, 64});
+
+  for (int n = 0; n < 4; ++n) {
+    REQUIRE(f.fanout.WriteSequential(PATTERN, sizeof(PATTERN)) == FileError::kSuccess);
+  }
+  for (MemoryDevice* device : f.devices) {
+    REQUIRE(device->most_calls_on_one_thread == 4);
+  }
+}
+
+TEST_CASE("FanOutFileOperations aggregates async completions from several threads", "[fanout]") {
+  FanOutFixture f({4096, 4096, 4096});
+  std::atomic<int> failures{0};
+  f.fanout.SetTargetFailedCallback([&failures](std::size_t, const std::string&) { ++failures; });
+  for (MemoryDevice* device : f.devices) {
+    device->complete_on_thread = true;
+  }
+  f.devices[1]->fail_writes = true;
+
+  std::atomic<int> calls{0};
+  std::atomic<int> successes{0};
+  for (int n = 0; n < 64; ++n) {
+    REQUIRE(f.fanout.AsyncWriteSequential(PATTERN, sizeof(PATTERN), [&](FileError r, std::size_t written) {
+      ++calls;
+      if (r == FileError::kSuccess && written == sizeof(PATTERN)) ++successes;
+    }) == FileError::kSuccess);
+  }
+
+  REQUIRE(f.fanout.WaitForPendingWrites() == FileError::kSuccess);
+  REQUIRE(calls == 64);
+  REQUIRE(successes == 64);
+  REQUIRE(failures == 1);
+  REQUIRE_FALSE(f.fanout.IsHealthy(1));
+}
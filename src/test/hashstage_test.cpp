@@ -0,0 +1,89 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "hashstage.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Records everything "hashed", in order
+struct Recorder {
+    std::string data;
+    std::atomic<bool> slow{false};
+
+    HashStage::HashFunction function()
+    {
+        return [this](const char *buf, std::size_t len) {
+            if (slow)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            data.append(buf, len);
+        };
+    }
+};
+
+}  // namespace
+
+TEST_CASE("HashStage hashes buffers and zero ranges in queue order", "[hashstage]") {
+    Recorder recorder;
+    HashStage stage(recorder.function());
+
+    stage.add("abc", 3);
+    stage.addZeros(4);
+    stage.add("de", 2);
+    stage.addZeros(0);
+    stage.add("f", 1);
+    stage.waitForIdle();
+
+    REQUIRE(recorder.data == std::string("abc\0\0\0\0def", 10));
+}
+
+TEST_CASE("HashStage runs each callback after its buffer was hashed", "[hashstage]") {
+    Recorder recorder;
+    recorder.slow = true;
+    HashStage stage(recorder.function());
+
+    std::atomic<int> released{0};
+    std::string seenAtRelease[3];
+    const char *parts[3] = {"one", "two", "three"};
+
+    for (int i = 0; i < 3; i++)
+    {
+        stage.add(parts[i], std::char_traits<char>::length(parts[i]), [&, i]() {
+            seenAtRelease[i] = recorder.data;
+            released++;
+        });
+    }
+
+    // The producer is not held up by hashing
+    REQUIRE(released < 3);
+
+    stage.waitForIdle();
+    REQUIRE(released == 3);
+    REQUIRE(seenAtRelease[0] == "one");
+    REQUIRE(seenAtRelease[1] == "onetwo");
+    REQUIRE(seenAtRelease[2] == "onetwothree");
+}
+
+TEST_CASE("HashStage releases queued buffers when stopped", "[hashstage]") {
+    Recorder recorder;
+    recorder.slow = true;
+    HashStage stage(recorder.function());
+
+    std::atomic<int> released{0};
+    for (int i = 0; i < 20; i++)
+        stage.add("x", 1, [&released]() { released++; });
+
+    stage.stop();
+    REQUIRE(released == 20);
+    REQUIRE(recorder.data.size() < 20);
+
+    // Stopping again, and waiting on a stopped stage, return immediately
+    stage.stop();
+    stage.waitForIdle();
+}
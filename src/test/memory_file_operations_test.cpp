@@ -0,0 +1,180 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "memory_file_operations.h"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using rpi_imager::AdaptiveWriteController;
+using rpi_imager::FileError;
+using rpi_imager::MemoryFileOperations;
+
+namespace {
+
+MemoryFileOperations::Options sparseOptions(std::size_t page_size = 4096) {
+  MemoryFileOperations::Options options;
+  options.sparse = true;
+  options.page_size = page_size;
+  return options;
+}
+
+std::chrono::milliseconds elapsedSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+}
+
+}  // namespace
+
+TEST_CASE("MemoryFileOperations reads back writes across page boundaries", "[memoryfileops]") {
+  MemoryFileOperations ops(sparseOptions(16));
+  REQUIRE(ops.CreateTestFile("image", 100) == FileError::kSuccess);
+
+  std::vector<std::uint8_t> data(40);
+  for (std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<std::uint8_t>(i + 1);
+  REQUIRE(ops.WriteAtOffset(10, data.data(), data.size()) == FileError::kSuccess);
+
+  std::vector<std::uint8_t> contents = ops.Contents();
+  REQUIRE(contents.size() == 100);
+  REQUIRE(contents[9] == 0);
+  REQUIRE(std::vector<std::uint8_t>(contents.begin() + 10, contents.begin() + 50) == data);
+  REQUIRE(contents[50] == 0);
+
+  // Writes must not grow the image
+  REQUIRE(ops.WriteAtOffset(90, data.data(), 20) == FileError::kWriteError);
+
+  std::uint8_t buf[8];
+  std::size_t bytes_read = 0;
+  REQUIRE(ops.Seek(96) == FileError::kSuccess);
+  REQUIRE(ops.ReadSequential(buf, sizeof(buf), bytes_read) == FileError::kSuccess);
+  REQUIRE(bytes_read == 4);
+}
+
+TEST_CASE("MemoryFileOperations keeps untouched and zeroed pages unallocated", "[memoryfileops]") {
+  MemoryFileOperations ops(sparseOptions());
+  REQUIRE(ops.CreateTestFile("image", 1024ull * 1024 * 1024) == FileError::kSuccess);
+  REQUIRE(ops.AllocatedBytes() == 0);
+
+  std::vector<std::uint8_t> zeros(64 * 1024, 0);
+  REQUIRE(ops.WriteAtOffset(0, zeros.data(), zeros.size()) == FileError::kSuccess);
+  REQUIRE(ops.AllocatedBytes() == 0);
+
+  std::vector<std::uint8_t> ones(3 * 4096, 1);
+  REQUIRE(ops.WriteAtOffset(512ull * 1024 * 1024, ones.data(), ones.size()) == FileError::kSuccess);
+  REQUIRE(ops.AllocatedBytes() == 3 * 4096);
+
+  // Whole pages go back to being holes, the partial one is cleared in place
+  REQUIRE(ops.ZeroRange(512ull * 1024 * 1024, 2 * 4096 + 100) == FileError::kSuccess);
+  REQUIRE(ops.AllocatedBytes() == 4096);
+
+  std::uint8_t buf[2];
+  REQUIRE(ops.ReadAtOffset(512ull * 1024 * 1024 + 2 * 4096 + 99, buf, 2) == FileError::kSuccess);
+  REQUIRE(buf[0] == 0);
+  REQUIRE(buf[1] == 1);
+}
+
+TEST_CASE("MemoryFileOperations completes async writes in order", "[memoryfileops]") {
+  MemoryFileOperations ops;
+  REQUIRE(ops.CreateTestFile("image", 64 * 1024) == FileError::kSuccess);
+  REQUIRE(ops.IsAsyncIOSupported());
+  REQUIRE(ops.SetAsyncQueueDepth(4));
+
+  std::vector<std::vector<std::uint8_t>> buffers;
+  for (int i = 0; i < 8; ++i) buffers.emplace_back(4096, static_cast<std::uint8_t>(i + 1));
+
+  std::vector<int> completed;
+  for (int i = 0; i < 8; ++i) {
+    REQUIRE(ops.AsyncWriteSequential(buffers[i].data(), buffers[i].size(),
+                                     [&completed, i](FileError result, std::size_t bytes) {
+                                       REQUIRE(result == FileError::kSuccess);
+                                       REQUIRE(bytes == 4096);
+                                       completed.push_back(i);
+                                     }) == FileError::kSuccess);
+    REQUIRE(ops.GetPendingWriteCount() <= 4);
+  }
+  REQUIRE(ops.Tell() == 8 * 4096);
+  REQUIRE(ops.WaitForPendingWrites() == FileError::kSuccess);
+  REQUIRE((completed == std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7}));
+
+  std::uint8_t last = 0;
+  REQUIRE(ops.ReadAtOffset(8 * 4096 - 1, &last, 1) == FileError::kSuccess);
+  REQUIRE(last == 8);
+}
+
+TEST_CASE("MemoryFileOperations writes land only when they complete", "[memoryfileops]") {
+  MemoryFileOperations::Options options;
+  options.write_latency = std::chrono::milliseconds(50);
+  MemoryFileOperations ops(options);
+  REQUIRE(ops.CreateTestFile("image", 4096) == FileError::kSuccess);
+  REQUIRE(ops.SetAsyncQueueDepth(2));
+
+  std::vector<std::uint8_t> data(4096, 0x5A);
+  REQUIRE(ops.AsyncWriteSequential(data.data(), data.size()) == FileError::kSuccess);
+  REQUIRE(ops.Contents()[0] == 0);
+
+  // Cancelled writes never reach the image
+  ops.CancelAsyncIO();
+  REQUIRE(ops.GetPendingWriteCount() == 0);
+  REQUIRE(ops.Contents()[0] == 0);
+  REQUIRE(ops.WaitForPendingWrites() == FileError::kCancelled);
+}
+
+TEST_CASE("MemoryFileOperations models latency and bandwidth", "[memoryfileops]") {
+  MemoryFileOperations::Options options;
+  options.write_latency = std::chrono::milliseconds(20);
+  options.write_bandwidth = 100 * 1024 * 1024;  // 1 MB in 10 ms
+
+  std::vector<std::uint8_t> data(1024 * 1024, 1);
+
+  SECTION("Synchronous writes pay the latency every time") {
+    MemoryFileOperations ops(options);
+    REQUIRE(ops.CreateTestFile("image", 4 * data.size()) == FileError::kSuccess);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) REQUIRE(ops.WriteSequential(data.data(), data.size()) == FileError::kSuccess);
+    REQUIRE(elapsedSince(start) >= std::chrono::milliseconds(4 * 30));
+  }
+
+  SECTION("Queued writes overlap the latency but not the transfers") {
+    MemoryFileOperations ops(options);
+    REQUIRE(ops.CreateTestFile("image", 4 * data.size()) == FileError::kSuccess);
+    REQUIRE(ops.SetAsyncQueueDepth(4));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) REQUIRE(ops.AsyncWriteSequential(data.data(), data.size()) == FileError::kSuccess);
+    REQUIRE(ops.WaitForPendingWrites() == FileError::kSuccess);
+    auto elapsed = elapsedSince(start);
+    REQUIRE(elapsed >= std::chrono::milliseconds(4 * 10 + 20));
+    REQUIRE(elapsed < std::chrono::milliseconds(4 * 30));
+
+    std::uint32_t wall_ms, count, min_us, max_us, avg_us;
+    ops.GetAsyncIOStats(wall_ms, count, min_us, max_us, avg_us);
+    REQUIRE(count == 4);
+    REQUIRE(min_us >= 30000);
+  }
+}
+
+TEST_CASE("MemoryFileOperations keeps no more writes in flight than the write controller allows", "[memoryfileops]") {
+  MemoryFileOperations::Options options;
+  options.write_latency = std::chrono::milliseconds(5);
+  MemoryFileOperations ops(options);
+  REQUIRE(ops.CreateTestFile("image", 64 * 4096) == FileError::kSuccess);
+  REQUIRE(ops.SetAsyncQueueDepth(8));
+
+  AdaptiveWriteController::Limits limits;
+  limits.max_depth = 8;
+  limits.initial_depth = 2;
+  auto controller = std::make_shared<AdaptiveWriteController>(limits);
+  ops.SetWriteController(controller);
+
+  // The controller may move the limit as completions come in
+  std::vector<std::uint8_t> data(4096, 1);
+  for (int i = 0; i < 16; ++i) {
+    REQUIRE(ops.AsyncWriteSequential(data.data(), data.size()) == FileError::kSuccess);
+    REQUIRE(ops.GetPendingWriteCount() <= controller->InFlightLimit());
+  }
+  REQUIRE(controller->InFlightLimit() < 8);
+  REQUIRE(ops.WaitForPendingWrites() == FileError::kSuccess);
+}
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "page_cache_sync_governor.h"
+#include <string>
+
+using rpi_imager::PageCacheSyncGovernor;
+
+namespace {
+
+constexpr std::uint64_t MB = 1024 * 1024;
+
+PageCacheSyncGovernor::Limits defaultLimits() {
+  PageCacheSyncGovernor::Limits limits;
+  limits.min_range_bytes = 8 * MB;
+  limits.max_range_bytes = 256 * MB;
+  limits.initial_range_bytes = 32 * MB;
+  limits.max_interval = std::chrono::milliseconds(5000);
+  limits.dirty_limit_bytes = 400 * MB;
+  return limits;
+}
+
+PageCacheSyncGovernor::Sample idle() {
+  PageCacheSyncGovernor::Sample sample;
+  sample.dirty_bytes = 0;
+  sample.writeback_bytes = 0;
+  sample.memory_pressure = 0;
+  return sample;
+}
+
+std::string reason(const PageCacheSyncGovernor::Decision& decision) {
+  return decision.reason ? decision.reason : "";
+}
+
+const std::chrono::milliseconds kSoon(100);
+
+}  // namespace
+
+TEST_CASE("PageCacheSyncGovernor sizes ranges to the measured drain rate", "[pagecachesync]") {
+  PageCacheSyncGovernor governor(defaultLimits());
+  REQUIRE(governor.RangeBytes() == 32 * MB);
+  REQUIRE_FALSE(governor.Check(31 * MB, kSoon, idle()).sync);
+  REQUIRE(reason(governor.Check(32 * MB, kSoon, idle())) == "range full");
+
+  // A card that drains 20 MB/s gets ranges of about a second of writeback
+  governor.RecordDrain(20 * MB, std::chrono::seconds(1));
+  REQUIRE(governor.RangeBytes() == 20 * MB);
+  REQUIRE(governor.Check(20 * MB, kSoon, idle()).sync);
+
+  // The rate is smoothed, a single fast range does not jump to it
+  governor.RecordDrain(200 * MB, std::chrono::seconds(1));
+  REQUIRE(governor.RangeBytes() > 20 * MB);
+  REQUIRE(governor.RangeBytes() < 100 * MB);
+
+  // And ranges stay within the limits
+  for (int i = 0; i < 50; ++i) governor.RecordDrain(2000 * MB, std::chrono::seconds(1));
+  REQUIRE(governor.RangeBytes() == 256 * MB);
+  for (int i = 0; i < 50; ++i) governor.RecordDrain(1 * MB, std::chrono::seconds(1));
+  REQUIRE(governor.RangeBytes() == 8 * MB);
+}
+
+TEST_CASE("PageCacheSyncGovernor syncs early when the kernel holds too much dirty data", "[pagecachesync]") {
+  PageCacheSyncGovernor governor(defaultLimits());
+  governor.RecordDrain(100 * MB, std::chrono::seconds(1));
+
+  PageCacheSyncGovernor::Sample sample = idle();
+  sample.dirty_bytes = 300 * MB;
+  sample.writeback_bytes = 150 * MB;
+
+  // Too little of our own data to be worth a sync
+  REQUIRE_FALSE(governor.Check(4 * MB, kSoon, sample).sync);
+  auto decision = governor.Check(10 * MB, kSoon, sample);
+  REQUIRE(decision.sync);
+  REQUIRE(reason(decision) == "dirty limit");
+  REQUIRE(governor.RangeBytes() == 25 * MB);
+
+  // Ranges stay small until the dirty data is well under the limit
+  sample.dirty_bytes = 150 * MB;
+  sample.writeback_bytes = 100 * MB;
+  REQUIRE(governor.Check(30 * MB, kSoon, sample).sync);
+  sample.dirty_bytes = 100 * MB;
+  sample.writeback_bytes = 50 * MB;
+  REQUIRE_FALSE(governor.Check(30 * MB, kSoon, sample).sync);
+  REQUIRE(governor.RangeBytes() == 100 * MB);
+}
+
+TEST_CASE("PageCacheSyncGovernor syncs early under memory pressure", "[pagecachesync]") {
+  PageCacheSyncGovernor governor(defaultLimits());
+
+  PageCacheSyncGovernor::Sample sample = idle();
+  sample.memory_pressure = 25.0;
+  auto decision = governor.Check(8 * MB, kSoon, sample);
+  REQUIRE(decision.sync);
+  REQUIRE(reason(decision) == "memory pressure");
+  REQUIRE(governor.RangeBytes() == 8 * MB);
+}
+
+TEST_CASE("PageCacheSyncGovernor falls back to ranges and time without kernel data", "[pagecachesync]") {
+  PageCacheSyncGovernor::Limits limits = defaultLimits();
+  limits.dirty_limit_bytes = 0;
+  PageCacheSyncGovernor governor(limits);
+
+  PageCacheSyncGovernor::Sample unknown;
+  unknown.dirty_bytes = 1000 * MB;  // Ignored without a dirty limit
+  REQUIRE_FALSE(governor.Check(16 * MB, kSoon, unknown).sync);
+  REQUIRE(reason(governor.Check(1, std::chrono::milliseconds(5000), unknown)) == "interval");
+  REQUIRE_FALSE(governor.Check(0, std::chrono::milliseconds(60000), unknown).sync);
+}
@@ -0,0 +1,134 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace {
+
+RingBuffer::Slot* produce(RingBuffer& ring, bool retain) {
+  RingBuffer::Slot* slot = ring.acquireWriteSlot(10);
+  REQUIRE(slot != nullptr);
+  if (retain) {
+    ring.retainSlot(slot);
+  }
+  ring.commitWriteSlot(slot, 1);
+  return slot;
+}
+
+void consume(RingBuffer& ring) {
+  RingBuffer::Slot* slot = ring.acquireReadSlot(10);
+  REQUIRE(slot != nullptr);
+  ring.releaseReadSlot(slot);
+}
+
+}  // namespace
+
+TEST_CASE("RingBuffer refills a retained slot only once every holder released it", "[ringbuffer]") {
+  RingBuffer ring(2, 4096);
+
+  RingBuffer::Slot* shared = produce(ring, true);
+  consume(ring);
+  produce(ring, false);
+
+  // The consumer is done with the shared slot, the extra holder is not
+  REQUIRE(ring.acquireWriteSlot(10) == nullptr);
+
+  ring.releaseReadSlot(shared);
+  REQUIRE(ring.acquireWriteSlot(10) == shared);
+}
+
+TEST_CASE("RingBuffer refills slots in ring order", "[ringbuffer]") {
+  RingBuffer ring(2, 4096);
+
+  RingBuffer::Slot* shared = produce(ring, true);
+  produce(ring, false);
+  consume(ring);
+  consume(ring);
+
+  // The second slot is free, but the held first one is next in line
+  REQUIRE(ring.acquireWriteSlot(10) == nullptr);
+
+  ring.releaseReadSlot(shared);
+  REQUIRE(ring.acquireWriteSlot(10) == shared);
+  REQUIRE(ring.acquireWriteSlot(10) != nullptr);
+}
+
+TEST_CASE("RingBuffer lets a retain be undone before the slot is committed", "[ringbuffer]") {
+  RingBuffer ring(1, 4096);
+
+  RingBuffer::Slot* slot = ring.acquireWriteSlot(10);
+  REQUIRE(slot != nullptr);
+  ring.retainSlot(slot);
+  ring.releaseReadSlot(slot);
+  ring.commitWriteSlot(slot, 1);
+
+  // Only the consumer holds it now
+  consume(ring);
+  REQUIRE(ring.acquireWriteSlot(10) == slot);
+}
+
+TEST_CASE("RingBuffer recycles slots used as a pool without commits", "[ringbuffer]") {
+  RingBuffer ring(2, 4096);
+
+  // The write ring hands slots straight to async writes, which release them
+  RingBuffer::Slot* first = ring.acquireWriteSlot(10);
+  RingBuffer::Slot* second = ring.acquireWriteSlot(10);
+  REQUIRE(first != nullptr);
+  REQUIRE(second != nullptr);
+  REQUIRE(ring.acquireWriteSlot(10) == nullptr);
+
+  // Completions out of order: the first slot still holds back the second
+  ring.releaseReadSlot(second);
+  REQUIRE(ring.acquireWriteSlot(10) == nullptr);
+
+  ring.releaseReadSlot(first);
+  REQUIRE(ring.acquireWriteSlot(10) == first);
+  REQUIRE(ring.acquireWriteSlot(10) == second);
+}
+
+TEST_CASE("RingBuffer keeps a slot from a prefetching reader until its hash is done", "[ringbuffer]") {
+  // The raw image write path: a reader thread fills slots while each slot is
+  // written synchronously and hashed alongside, and only released after both
+  RingBuffer ring(2, 4096);
+  std::string source(64 * 4096, '\0');
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = static_cast<char>(i * 7 + i / 4096);
+  }
+
+  std::thread reader([&]() {
+    for (size_t pos = 0; pos < source.size(); pos += 4096) {
+      RingBuffer::Slot* slot = nullptr;
+      while (!slot) {
+        slot = ring.acquireWriteSlot(100);
+      }
+      std::copy_n(source.data() + pos, 4096, slot->data);
+      ring.commitWriteSlot(slot, 4096);
+    }
+    ring.producerDone();
+  });
+
+  std::string written;
+  std::string hashed;
+  while (RingBuffer::Slot* slot = ring.acquireReadSlot(1000)) {
+    std::future<void> hash = std::async(std::launch::async, [&hashed, slot]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      hashed.append(slot->data, slot->size);
+    });
+    written.append(slot->data, slot->size);
+    hash.wait();
+    ring.releaseReadSlot(slot);
+  }
+  reader.join();
+
+  REQUIRE(written == source);
+  REQUIRE(hashed == source);
+}
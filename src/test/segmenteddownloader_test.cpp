@@ -0,0 +1,313 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "segmenteddownloader.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr quint64 kSegment = SegmentedDownloader::SEGMENT_SIZE;
+
+// Two full segments and a short one
+std::string makeBody() {
+  std::string body(2 * kSegment + 1024 * 1024, '\0');
+  for (size_t i = 0; i < body.size(); ++i) {
+    body[i] = static_cast<char>((i >> 12) ^ i);
+  }
+  return body;
+}
+
+// Minimal HTTP/1.1 server on the loopback interface, one request per connection
+class RangeServer {
+ public:
+  struct Options {
+    bool range_support = true;
+    int first_segment_delay_ms = 0;  // Holds back the response for the head segment
+    int first_headers_delay_ms = 0;  // Holds back even the headers of that response
+    quint64 truncate_from = UINT64_MAX;  // First request starting here is cut off halfway
+  };
+
+  RangeServer(const std::string& body, Options options) : body_(body), options_(options) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), len) == 0 && listen(listen_fd_, 16) == 0 &&
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+      port_ = ntohs(addr.sin_port);
+    }
+    accept_thread_ = std::thread([this]() { AcceptLoop(); });
+  }
+
+  ~RangeServer() {
+    stop_ = true;
+    accept_thread_.join();
+    for (std::thread& thread : connections_) {
+      thread.join();
+    }
+    close(listen_fd_);
+  }
+
+  std::string Url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/image.img"; }
+
+  // Start offsets of the requests received, and of the responses sent in full
+  std::vector<quint64> Requests() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requests_;
+  }
+  std::vector<quint64> Completed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return completed_;
+  }
+
+ private:
+  void AcceptLoop() {
+    while (!stop_) {
+      pollfd pfd = {listen_fd_, POLLIN, 0};
+      if (poll(&pfd, 1, 50) <= 0) {
+        continue;
+      }
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd >= 0) {
+        connections_.emplace_back([this, fd]() {
+          Serve(fd);
+          close(fd);
+        });
+      }
+    }
+  }
+
+  void Serve(int fd) {
+    std::string request;
+    char buf[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        return;
+      }
+      request.append(buf, static_cast<size_t>(n));
+    }
+
+    quint64 from = 0;
+    quint64 to = body_.size() - 1;
+    unsigned long long a = 0, b = 0;
+    size_t range = request.find("Range: bytes=");
+    bool ranged = options_.range_support && range != std::string::npos &&
+                  sscanf(request.c_str() + range, "Range: bytes=%llu-%llu", &a, &b) == 2;
+    if (ranged) {
+      from = a;
+      to = std::min<quint64>(b, body_.size() - 1);
+    }
+
+    bool truncate = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests_.push_back(from);
+      if (from == options_.truncate_from && !truncated_) {
+        truncated_ = true;
+        truncate = true;
+      }
+    }
+
+    if (from == 0 && to > 0 && options_.first_headers_delay_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options_.first_headers_delay_ms));
+    }
+
+    std::string header = ranged ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    header += "Content-Length: " + std::to_string(to - from + 1) + "\r\n";
+    if (ranged) {
+      header += "Content-Range: bytes " + std::to_string(from) + "-" + std::to_string(to) + "/" +
+                std::to_string(body_.size()) + "\r\n";
+    }
+    header += "Connection: close\r\n\r\n";
+    if (!SendAll(fd, header.data(), header.size())) {
+      return;
+    }
+
+    if (from == 0 && to > 0 && options_.first_segment_delay_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options_.first_segment_delay_ms));
+    }
+
+    quint64 length = to - from + 1;
+    if (truncate) {
+      length /= 2;
+    }
+    if (SendAll(fd, body_.data() + from, length) && !truncate) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      completed_.push_back(from);
+    }
+  }
+
+  static bool SendAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+      ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+      if (n <= 0) {
+        return false;
+      }
+      data += n;
+      len -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  const std::string& body_;
+  Options options_;
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::atomic<bool> stop_{false};
+  std::thread accept_thread_;
+  std::vector<std::thread> connections_;
+  std::mutex mutex_;
+  std::vector<quint64> requests_;
+  std::vector<quint64> completed_;
+  bool truncated_ = false;
+};
+
+struct Download {
+  CURLcode result = CURLE_OK;
+  std::string data;
+  quint64 delivered_offset = 0;
+  SegmentedDownloader::Stats stats;
+};
+
+// Downloads the file assuming the given size, the body's if 0
+Download download(const RangeServer& server, const std::string& body, quint64 total_size = 0,
+                  std::vector<std::string>* headers = nullptr) {
+  CURL* handle = curl_easy_init();
+  curl_easy_setopt(handle, CURLOPT_URL, server.Url().c_str());
+
+  Download result;
+  SegmentedDownloader downloader(handle, 0, total_size ? total_size : body.size());
+  result.result = downloader.run(
+      [&result](const char* data, size_t len) {
+        result.data.append(data, len);
+        return len;
+      },
+      []() { return false; },
+      [headers](const std::string& header) {
+        if (headers) {
+          headers->push_back(header);
+        }
+      });
+  result.delivered_offset = downloader.deliveredOffset();
+  result.stats = downloader.stats();
+
+  curl_easy_cleanup(handle);
+  return result;
+}
+
+}  // namespace
+
+TEST_CASE("SegmentedDownloader delivers segments in order when they complete out of order", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer::Options options;
+  options.first_segment_delay_ms = 500;
+  RangeServer server(body, options);
+
+  Download result = download(server, body);
+  REQUIRE(result.result == CURLE_OK);
+  REQUIRE(result.data.size() == body.size());
+  REQUIRE(result.data == body);
+  REQUIRE(result.delivered_offset == body.size());
+  REQUIRE(result.stats.bytes == body.size());
+
+  // The later segments were held back until the head segment arrived
+  std::vector<quint64> completed = server.Completed();
+  REQUIRE(completed.size() == 3);
+  REQUIRE(completed.back() == 0);
+}
+
+TEST_CASE("SegmentedDownloader retries a failed segment from where it stopped", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer::Options options;
+  options.truncate_from = kSegment;
+  RangeServer server(body, options);
+
+  Download result = download(server, body);
+  REQUIRE(result.result == CURLE_OK);
+  REQUIRE(result.data == body);
+
+  // One request per segment, plus one for the rest of the cut off segment
+  std::vector<quint64> requests = server.Requests();
+  REQUIRE(requests.size() == 4);
+  REQUIRE(std::count(requests.begin(), requests.end(), kSegment) == 1);
+  REQUIRE(std::count(requests.begin(), requests.end(), kSegment + kSegment / 2) == 1);
+}
+
+TEST_CASE("SegmentedDownloader leaves servers without range support to a single stream", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer::Options options;
+  options.range_support = false;
+  RangeServer server(body, options);
+
+  CURL* handle = curl_easy_init();
+  curl_easy_setopt(handle, CURLOPT_URL, server.Url().c_str());
+  quint64 total = 0;
+  REQUIRE_FALSE(SegmentedDownloader::probeRangeSupport(handle, total));
+  curl_easy_cleanup(handle);
+
+  // Segments fail without delivering anything, so the caller can continue
+  // with a single stream from the delivered offset
+  Download result = download(server, body);
+  REQUIRE(result.result == CURLE_RANGE_ERROR);
+  REQUIRE(result.data.empty());
+  REQUIRE(result.delivered_offset == 0);
+}
+
+TEST_CASE("SegmentedDownloader reports the connection timings of the first segment", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer::Options options;
+  options.first_headers_delay_ms = 300;
+  RangeServer server(body, options);
+
+  // The other segments complete first, their responses started right away
+  Download result = download(server, body);
+  REQUIRE(result.result == CURLE_OK);
+  REQUIRE(server.Completed().back() == 0);
+  REQUIRE(result.stats.startTransferTime >= 0.25);
+}
+
+TEST_CASE("SegmentedDownloader passes on the response headers of the first segment only", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer server(body, RangeServer::Options());
+
+  std::vector<std::string> headers;
+  Download result = download(server, body, 0, &headers);
+  REQUIRE(result.result == CURLE_OK);
+
+  REQUIRE(std::count_if(headers.begin(), headers.end(),
+                        [](const std::string& line) { return line.compare(0, 5, "HTTP/") == 0; }) == 1);
+  REQUIRE(std::count_if(headers.begin(), headers.end(), [](const std::string& line) {
+            return line.compare(0, 23, "Content-Range: bytes 0-") == 0;
+          }) == 1);
+}
+
+TEST_CASE("SegmentedDownloader rejects a size the server does not confirm", "[segmenteddownloader]") {
+  const std::string body = makeBody();
+  RangeServer server(body, RangeServer::Options());
+
+  // Without a probe the size comes from the caller; a wrong one must not cut the file short
+  Download result = download(server, body, body.size() - 1024);
+  REQUIRE(result.result == CURLE_RANGE_ERROR);
+  REQUIRE(result.data.empty());
+  REQUIRE(result.delivered_offset == 0);
+}
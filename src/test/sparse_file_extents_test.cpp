@@ -0,0 +1,89 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "sparse_file_extents.h"
+#include <QByteArray>
+#include <QTemporaryFile>
+
+using rpi_imager::FileExtent;
+using rpi_imager::ListDataExtents;
+
+namespace {
+
+constexpr qint64 KB = 1024;
+constexpr qint64 MB = 1024 * 1024;
+
+// An 8 MB file with 64 KB of data at the start and at 4 MB, holes elsewhere
+// where the file system supports them
+bool writeSparseFile(QTemporaryFile &file)
+{
+    if (!file.open())
+        return false;
+    QByteArray data(64 * KB, 'x');
+    return file.write(data) == data.size() && file.seek(4 * MB) && file.write(data) == data.size() &&
+           file.resize(8 * MB) && file.flush();
+}
+
+bool covers(const std::vector<FileExtent> &extents, std::uint64_t offset, std::uint64_t length)
+{
+    for (const FileExtent &extent : extents) {
+        if (extent.offset <= offset && offset + length <= extent.offset + extent.length)
+            return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST_CASE("ListDataExtents finds the data in a sparse file", "[sparsefileextents]") {
+    QTemporaryFile file;
+    REQUIRE(writeSparseFile(file));
+
+    std::vector<FileExtent> extents = ListDataExtents(file.handle(), 8 * MB, 1 * MB);
+    REQUIRE_FALSE(extents.empty());
+    REQUIRE(covers(extents, 0, 64 * KB));
+    REQUIRE(covers(extents, 4 * MB, 64 * KB));
+
+    // Extents are in order, within the file, and only separated by holes worth skipping
+    std::uint64_t previousEnd = 0;
+    for (size_t i = 0; i < extents.size(); ++i) {
+        REQUIRE(extents[i].length > 0);
+        REQUIRE(extents[i].offset + extents[i].length <= 8 * MB);
+        if (i > 0)
+            REQUIRE(extents[i].offset - previousEnd >= 1 * MB);
+        previousEnd = extents[i].offset + extents[i].length;
+    }
+
+    // Where holes are reported, far less than the whole file has to be read
+    if (extents.size() > 1) {
+        std::uint64_t dataBytes = 0;
+        for (const FileExtent &extent : extents)
+            dataBytes += extent.length;
+        REQUIRE(dataBytes < 8 * MB);
+    }
+}
+
+TEST_CASE("ListDataExtents folds holes too short to skip into the data", "[sparsefileextents]") {
+    QTemporaryFile file;
+    REQUIRE(writeSparseFile(file));
+
+    std::vector<FileExtent> extents = ListDataExtents(file.handle(), 8 * MB, 16 * MB);
+    REQUIRE(extents.size() == 1);
+    REQUIRE(extents[0].offset == 0);
+    REQUIRE(extents[0].length == 8 * MB);
+}
+
+TEST_CASE("ListDataExtents only looks at the requested range", "[sparsefileextents]") {
+    QTemporaryFile file;
+    REQUIRE(writeSparseFile(file));
+
+    std::vector<FileExtent> extents = ListDataExtents(file.handle(), 2 * MB, 1 * MB);
+    REQUIRE(extents.size() == 1);
+    REQUIRE(extents[0].offset == 0);
+    REQUIRE(extents[0].length <= 2 * MB);
+
+    REQUIRE(ListDataExtents(file.handle(), 0, 1 * MB).empty());
+}
@@ -0,0 +1,101 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "trailingverifier.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t CHUNK = 4096;
+
+// A "device" whose contents are a function of the offset
+struct Device {
+    std::string contents;
+    std::atomic<int> reads{0};
+    std::uint64_t failAt = UINT64_MAX;
+
+    explicit Device(std::size_t size)
+    {
+        for (std::size_t i = 0; i < size; i++)
+            contents.push_back(static_cast<char>('a' + (i * 7) % 26));
+    }
+
+    TrailingVerifier::ReadFunction reader()
+    {
+        return [this](std::uint64_t offset, char *buf, std::size_t len) {
+            reads++;
+            if (offset + len > failAt)
+                return false;
+            std::memcpy(buf, contents.data() + offset, len);
+            return true;
+        };
+    }
+};
+
+void waitFor(const TrailingVerifier &verifier, std::uint64_t end)
+{
+    for (int i = 0; i < 500 && verifier.verifiedEnd() < end && !verifier.failed(); i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+}
+
+}  // namespace
+
+TEST_CASE("TrailingVerifier hashes whole chunks behind the safe end", "[trailingverifier]") {
+    Device device(20 * CHUNK);
+    std::string hashed;
+    TrailingVerifier verifier(CHUNK, 2 * CHUNK, device.reader(),
+                              [&hashed](const char *data, std::size_t len) { hashed.append(data, len); });
+
+    // Less than a chunk available: nothing is read
+    verifier.setSafeEnd(2 * CHUNK);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(device.reads == 0);
+    REQUIRE(verifier.verifiedEnd() == CHUNK);
+
+    verifier.setSafeEnd(8 * CHUNK);
+    waitFor(verifier, 7 * CHUNK);
+    REQUIRE(verifier.verifiedEnd() == 7 * CHUNK);
+
+    // The safe end never moves backwards
+    verifier.setSafeEnd(4 * CHUNK);
+    verifier.setSafeEnd(10 * CHUNK);
+    waitFor(verifier, 9 * CHUNK);
+
+    const std::uint64_t end = verifier.finish();
+    REQUIRE(end == 9 * CHUNK);
+    REQUIRE_FALSE(verifier.failed());
+    REQUIRE(hashed == device.contents.substr(CHUNK, 8 * CHUNK));
+}
+
+TEST_CASE("TrailingVerifier stops at the first read error", "[trailingverifier]") {
+    Device device(20 * CHUNK);
+    device.failAt = 5 * CHUNK;
+    std::string hashed;
+    TrailingVerifier verifier(0, CHUNK, device.reader(),
+                              [&hashed](const char *data, std::size_t len) { hashed.append(data, len); });
+
+    verifier.setSafeEnd(20 * CHUNK);
+    waitFor(verifier, 20 * CHUNK);
+
+    REQUIRE(verifier.finish() == 5 * CHUNK);
+    REQUIRE(verifier.failed());
+    REQUIRE(hashed == device.contents.substr(0, 5 * CHUNK));
+}
+
+TEST_CASE("TrailingVerifier finishes without reading when nothing was written", "[trailingverifier]") {
+    Device device(CHUNK);
+    TrailingVerifier verifier(0, CHUNK, device.reader(), [](const char *, std::size_t) {});
+
+    REQUIRE(verifier.finish() == 0);
+    REQUIRE(device.reads == 0);
+
+    // Finishing again (and destroying afterwards) is harmless
+    REQUIRE(verifier.finish() == 0);
+}
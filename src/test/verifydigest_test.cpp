@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "verifydigest.h"
+
+namespace {
+
+QByteArray digestOf(VerifyDigest::Algorithm algorithm, const QByteArray &data, int chunk)
+{
+    VerifyDigest digest(algorithm);
+    for (qsizetype pos = 0; pos < data.size(); pos += chunk)
+        digest.addData(data.constData() + pos, static_cast<int>(qMin<qsizetype>(chunk, data.size() - pos)));
+    return digest.result();
+}
+
+// Image-like test data: not all zeros, not random
+QByteArray testData(qsizetype size)
+{
+    QByteArray data(size, '\0');
+    quint32 x = 0x12345678;
+    for (qsizetype i = 0; i < size; i++)
+    {
+        x = x * 1103515245 + 12345;
+        data[i] = static_cast<char>((i % 4096) < 1024 ? 0 : (x >> 16));
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST_CASE("VerifyDigest produces the standard digests", "[verifydigest]") {
+    VerifyDigest sha(VerifyDigest::Algorithm::Sha256);
+    REQUIRE(sha.result().toHex() == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+
+    VerifyDigest xxh3(VerifyDigest::Algorithm::Xxh3_128);
+    REQUIRE(xxh3.result().toHex() == "99aa06d3014798d86001c324468d497f");
+    xxh3.addData(QByteArray("abc"));
+    REQUIRE(xxh3.result().toHex() == "06b05ab6733a618578af5f94892f3950");
+
+    xxh3.reset();
+    REQUIRE(xxh3.result().toHex() == "99aa06d3014798d86001c324468d497f");
+
+    REQUIRE(VerifyDigest::algorithmName(VerifyDigest::Algorithm::Xxh3_128) == QStringLiteral("XXH3-128"));
+}
+
+TEST_CASE("VerifyDigest does not depend on how the data is split", "[verifydigest]") {
+    const QByteArray data = testData(1024 * 1024 + 333);
+
+    for (VerifyDigest::Algorithm algorithm : {VerifyDigest::Algorithm::Sha256, VerifyDigest::Algorithm::Xxh3_128})
+    {
+        const QByteArray whole = digestOf(algorithm, data, static_cast<int>(data.size()));
+        REQUIRE(digestOf(algorithm, data, 4096) == whole);
+        REQUIRE(digestOf(algorithm, data, 65537) == whole);
+        REQUIRE(digestOf(algorithm, data, 1) == digestOf(algorithm, data, 7));
+    }
+}
+
+TEST_CASE("VerifyDigest notices a single flipped bit", "[verifydigest]") {
+    const QByteArray data = testData(256 * 1024);
+    QByteArray corrupted = data;
+    corrupted[200000] = static_cast<char>(corrupted[200000] ^ 0x01);
+
+    for (VerifyDigest::Algorithm algorithm : {VerifyDigest::Algorithm::Sha256, VerifyDigest::Algorithm::Xxh3_128})
+        REQUIRE(digestOf(algorithm, data, 4096) != digestOf(algorithm, corrupted, 4096));
+}
+
+// Not run by ctest; run with: verifydigest_test "[benchmark]"
+TEST_CASE("VerifyDigest backend throughput", "[.][benchmark]") {
+    // Hashed in the 4 MiB pieces the verify pipeline reads
+    const QByteArray data = testData(64 * 1024 * 1024);
+    constexpr int chunk = 4 * 1024 * 1024;
+
+    BENCHMARK("SHA256, 64 MiB") {
+        return digestOf(VerifyDigest::Algorithm::Sha256, data, chunk);
+    };
+
+    BENCHMARK("XXH3-128, 64 MiB") {
+        return digestOf(VerifyDigest::Algorithm::Xxh3_128, data, chunk);
+    };
+}
@@ -0,0 +1,192 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "vsiformat.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <cstddef>
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+
+constexpr int BLOCK_SIZE = 4096;
+
+// Record stream for an image of blockCount blocks where every third block is sparse
+QByteArray makeRecords(int blockCount)
+{
+    QByteArray records;
+    for (int i = 0; i < blockCount; i++)
+    {
+        if (i % 3 == 2)
+        {
+            records.append('\x00');
+        }
+        else
+        {
+            records.append('\x01');
+            records.append(QByteArray(BLOCK_SIZE, static_cast<char>('a' + i % 26)));
+        }
+    }
+    return records;
+}
+
+QByteArray deflate(const QByteArray &data)
+{
+    uLongf size = compressBound(data.size());
+    QByteArray out(size, Qt::Uninitialized);
+    REQUIRE(compress2(reinterpret_cast<Bytef *>(out.data()), &size,
+                      reinterpret_cast<const Bytef *>(data.constData()), data.size(), Z_BEST_SPEED) == Z_OK);
+    out.resize(size);
+    return out;
+}
+
+VsiHeader makeHeader(int blockCount, const QByteArray &payload)
+{
+    VsiHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, VsiFormat::MAGIC_V1, 4);
+    header.blockSize = BLOCK_SIZE;
+    header.uncompressedSize = static_cast<int64_t>(blockCount) * BLOCK_SIZE;
+    QByteArray md5 = QCryptographicHash::hash(payload, QCryptographicHash::Md5);
+    std::memcpy(header.md5, md5.constData(), 16);
+    std::strcpy(header.label, "test");
+    return header;
+}
+
+QString writeVsi1(const QTemporaryDir &dir, int blockCount, const QByteArray &records)
+{
+    QByteArray payload = deflate(records);
+    VsiHeader header = makeHeader(blockCount, payload);
+
+    QString path = QDir(dir.path()).filePath("in.vsi");
+    QFile file(path);
+    REQUIRE(file.open(QIODevice::WriteOnly));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(payload);
+    return path;
+}
+
+}  // namespace
+
+TEST_CASE("VsiFormat converts VSI1 to independently inflatable groups", "[vsiformat]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    // A bit more than two groups, so the last one is short
+    const int blocksPerGroup = VsiFormat::TARGET_GROUP_BYTES / BLOCK_SIZE;
+    const int blockCount = 2 * blocksPerGroup + 7;
+    const QByteArray records = makeRecords(blockCount);
+    const QString input = writeVsi1(dir, blockCount, records);
+    const QString output = QDir(dir.path()).filePath("out.vsi");
+
+    QString error;
+    REQUIRE(VsiFormat::convertToVsi2(input, output, error));
+
+    QFile file(output);
+    REQUIRE(file.open(QIODevice::ReadOnly));
+    VsiHeader header;
+    REQUIRE(file.read(reinterpret_cast<char *>(&header), sizeof(header)) == static_cast<qint64>(sizeof(header)));
+    REQUIRE(VsiFormat::version(header) == 2);
+    REQUIRE(header.uncompressedSize == static_cast<int64_t>(blockCount) * BLOCK_SIZE);
+    REQUIRE(QByteArray(header.label) == "test");
+
+    // The header MD5 covers everything that follows
+    const qint64 payloadStart = file.pos();
+    QByteArray md5 = QCryptographicHash::hash(file.readAll(), QCryptographicHash::Md5);
+    REQUIRE(md5 == QByteArray(reinterpret_cast<const char *>(header.md5), 16));
+    file.seek(payloadStart);
+
+    VsiFormat::GroupIndex index;
+    QByteArray raw;
+    REQUIRE(VsiFormat::readGroupIndex(&file, header, index, raw, &error));
+    REQUIRE(index.blocksPerGroup == static_cast<quint32>(blocksPerGroup));
+    REQUIRE(index.compressedSizes.size() == 3);
+    REQUIRE(raw.size() == 5 * 4);
+
+    // Concatenating the inflated groups gives back the original record stream
+    QByteArray inflated;
+    for (quint32 size : index.compressedSizes)
+    {
+        QByteArray group;
+        REQUIRE(VsiFormat::inflateGroup(file.read(size), index.maxGroupBytes(header), group));
+        inflated.append(group);
+    }
+    REQUIRE(file.atEnd());
+    REQUIRE(inflated == records);
+}
+
+TEST_CASE("VsiFormat refuses to convert damaged or already converted images", "[vsiformat]") {
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    const QString input = writeVsi1(dir, 10, makeRecords(10));
+    const QString output = QDir(dir.path()).filePath("out.vsi");
+    QString error;
+
+    SECTION("MD5 mismatch") {
+        QFile file(input);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        file.seek(offsetof(VsiHeader, md5));
+        file.write("0123456789abcdef", 16);
+        file.close();
+
+        REQUIRE_FALSE(VsiFormat::convertToVsi2(input, output, error));
+        REQUIRE_FALSE(QFile::exists(output));
+    }
+
+    SECTION("Already VSI2") {
+        REQUIRE(VsiFormat::convertToVsi2(input, output, error));
+        const QString again = QDir(dir.path()).filePath("again.vsi");
+        REQUIRE_FALSE(VsiFormat::convertToVsi2(output, again, error));
+        REQUIRE_FALSE(QFile::exists(again));
+    }
+}
+
+TEST_CASE("VsiFormat rejects group tables that do not match the header", "[vsiformat]") {
+    VsiHeader header = makeHeader(100, QByteArray());
+    std::memcpy(header.magic, VsiFormat::MAGIC_V2, 4);
+
+    auto tableFor = [](quint32 groupCount, quint32 blocksPerGroup, quint32 sizes) {
+        QByteArray table((2 + groupCount) * 4, Qt::Uninitialized);
+        qToLittleEndian<quint32>(groupCount, table.data());
+        qToLittleEndian<quint32>(blocksPerGroup, table.data() + 4);
+        for (quint32 i = 0; i < groupCount; i++)
+            qToLittleEndian<quint32>(sizes, table.data() + (2 + i) * 4);
+        return table;
+    };
+
+    auto read = [&header](QByteArray table) {
+        QBuffer buffer(&table);
+        buffer.open(QIODevice::ReadOnly);
+        VsiFormat::GroupIndex index;
+        QByteArray raw;
+        return VsiFormat::readGroupIndex(&buffer, header, index, raw);
+    };
+
+    REQUIRE(read(tableFor(4, 25, 10)));
+    REQUIRE_FALSE(read(tableFor(3, 25, 10)));            // Too few groups for the image
+    REQUIRE_FALSE(read(tableFor(4, 25, 0)));             // Empty group
+    REQUIRE_FALSE(read(tableFor(4, 25, 10).left(20)));   // Truncated table
+    REQUIRE_FALSE(read(tableFor(1, 0, 10)));             // No blocks per group
+}
+
+TEST_CASE("VsiFormat only inflates complete groups within the size limit", "[vsiformat]") {
+    const QByteArray records = makeRecords(6);
+    const QByteArray compressed = deflate(records);
+    QByteArray out;
+
+    REQUIRE(VsiFormat::inflateGroup(compressed, records.size(), out));
+    REQUIRE(out == records);
+
+    REQUIRE_FALSE(VsiFormat::inflateGroup(compressed, records.size() - 1, out));
+    REQUIRE_FALSE(VsiFormat::inflateGroup(compressed.left(compressed.size() / 2), records.size(), out));
+    REQUIRE_FALSE(VsiFormat::inflateGroup(compressed + "x", records.size(), out));
+}
@@ -0,0 +1,216 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include <catch2/catch_test_macros.hpp>
+#include "zipcentraldirectory.h"
+
+namespace {
+
+void put16(QByteArray &out, quint16 v)
+{
+    out.append(char(v & 0xFF));
+    out.append(char(v >> 8));
+}
+
+void put32(QByteArray &out, quint32 v)
+{
+    put16(out, quint16(v & 0xFFFF));
+    put16(out, quint16(v >> 16));
+}
+
+void put64(QByteArray &out, quint64 v)
+{
+    put32(out, quint32(v & 0xFFFFFFFF));
+    put32(out, quint32(v >> 32));
+}
+
+// Writes stored entries the way zip(1) does; with zip64 set, every size and
+// offset goes through the ZIP64 extra field and end records
+class ZipBuilder
+{
+public:
+    explicit ZipBuilder(bool zip64 = false) : _zip64(zip64) {}
+
+    void add(const QByteArray &name, const QByteArray &content)
+    {
+        const quint64 offset = _archive.size();
+
+        put32(_archive, 0x04034b50);
+        put16(_archive, 20);
+        put16(_archive, 0);
+        put16(_archive, 0);
+        put32(_archive, 0);
+        put32(_archive, 0x12345678);
+        put32(_archive, quint32(content.size()));
+        put32(_archive, quint32(content.size()));
+        put16(_archive, quint16(name.size()));
+        put16(_archive, 0);
+        _archive.append(name);
+        _archive.append(content);
+
+        QByteArray extra;
+        if (_zip64) {
+            put16(extra, 0x0001);
+            put16(extra, 24);
+            put64(extra, quint64(content.size()));
+            put64(extra, quint64(content.size()));
+            put64(extra, offset);
+        }
+
+        const quint32 small = _zip64 ? 0xFFFFFFFF : quint32(content.size());
+        put32(_directory, 0x02014b50);
+        put16(_directory, 45);
+        put16(_directory, 45);
+        put16(_directory, 0);
+        put16(_directory, 0);
+        put32(_directory, 0);
+        put32(_directory, 0x12345678);
+        put32(_directory, small);
+        put32(_directory, small);
+        put16(_directory, quint16(name.size()));
+        put16(_directory, quint16(extra.size()));
+        put16(_directory, 0);
+        put16(_directory, 0);
+        put16(_directory, 0);
+        put32(_directory, 0);
+        put32(_directory, _zip64 ? 0xFFFFFFFF : quint32(offset));
+        _directory.append(name);
+        _directory.append(extra);
+        _count++;
+    }
+
+    QByteArray finish(const QByteArray &comment = QByteArray())
+    {
+        QByteArray out = _archive;
+        const quint64 directoryOffset = out.size();
+        out.append(_directory);
+
+        if (_zip64) {
+            const quint64 recordOffset = out.size();
+            put32(out, 0x06064b50);
+            put64(out, 44);
+            put16(out, 45);
+            put16(out, 45);
+            put32(out, 0);
+            put32(out, 0);
+            put64(out, _count);
+            put64(out, _count);
+            put64(out, quint64(_directory.size()));
+            put64(out, directoryOffset);
+
+            put32(out, 0x07064b50);
+            put32(out, 0);
+            put64(out, recordOffset);
+            put32(out, 1);
+        }
+
+        put32(out, 0x06054b50);
+        put16(out, 0);
+        put16(out, 0);
+        put16(out, _zip64 ? 0xFFFF : quint16(_count));
+        put16(out, _zip64 ? 0xFFFF : quint16(_count));
+        put32(out, _zip64 ? 0xFFFFFFFF : quint32(_directory.size()));
+        put32(out, _zip64 ? 0xFFFFFFFF : quint32(directoryOffset));
+        put16(out, quint16(comment.size()));
+        out.append(comment);
+        return out;
+    }
+
+private:
+    bool _zip64;
+    QByteArray _archive;
+    QByteArray _directory;
+    quint64 _count = 0;
+};
+
+// What the remote inspector does: fetch the tail, then the directory
+ZipCentralDirectory readRemote(const QByteArray &archive)
+{
+    const qint64 tailLength = qMin<qint64>(archive.size(), ZipCentralDirectory::TAIL_SIZE);
+    QByteArray tail = archive.right(tailLength);
+
+    ZipCentralDirectory::Location location = ZipCentralDirectory::locate(tail, quint64(archive.size()));
+    if (!location.valid)
+        return ZipCentralDirectory();
+
+    return ZipCentralDirectory::parse(archive.mid(qsizetype(location.offset), qsizetype(location.size)), location);
+}
+
+}  // namespace
+
+TEST_CASE("ZipCentralDirectory lists entries of a small archive", "[zipcentraldirectory]") {
+    ZipBuilder builder;
+    builder.add("images/", QByteArray());
+    builder.add("images/core-image.wic.xz", QByteArray(1000, 'x'));
+    builder.add("system.spu", QByteArray(300, 'y'));
+    QByteArray archive = builder.finish("built by CI");
+
+    ZipCentralDirectory directory = readRemote(archive);
+    REQUIRE(directory.isValid());
+    REQUIRE(directory.entries().size() == 3);
+
+    const ZipCentralDirectory::Entry &wic = directory.entries().at(1);
+    REQUIRE(wic.name == QStringLiteral("images/core-image.wic.xz"));
+    REQUIRE(wic.uncompressedSize == 1000);
+    REQUIRE(wic.compressedSize == 1000);
+    REQUIRE(wic.method == 0);
+    REQUIRE(wic.crc32 == 0x12345678);
+    REQUIRE(archive.mid(qsizetype(wic.localHeaderOffset), 4) == QByteArray("PK\x03\x04", 4));
+
+    REQUIRE(directory.entries().at(2).localHeaderOffset > wic.localHeaderOffset);
+    REQUIRE(ZipCentralDirectory::methodName(0) == QStringLiteral("stored"));
+    REQUIRE(ZipCentralDirectory::methodName(8) == QStringLiteral("deflate"));
+}
+
+TEST_CASE("ZipCentralDirectory finds the directory from only the archive tail", "[zipcentraldirectory]") {
+    ZipBuilder builder;
+    builder.add("big.wic", QByteArray(300 * 1024, 'z'));
+    builder.add("small.wic", QByteArray(10, 'z'));
+    QByteArray archive = builder.finish(QByteArray(1000, 'c'));
+    REQUIRE(archive.size() > ZipCentralDirectory::TAIL_SIZE);
+
+    ZipCentralDirectory directory = readRemote(archive);
+    REQUIRE(directory.isValid());
+    REQUIRE(directory.entries().size() == 2);
+    REQUIRE(directory.entries().at(0).uncompressedSize == 300 * 1024);
+    REQUIRE(directory.entries().at(1).name == QStringLiteral("small.wic"));
+}
+
+TEST_CASE("ZipCentralDirectory reads ZIP64 sizes and offsets", "[zipcentraldirectory]") {
+    ZipBuilder builder(true);
+    builder.add("a.wic.zst", QByteArray(64, 'a'));
+    builder.add("b.spu", QByteArray(128, 'b'));
+    QByteArray archive = builder.finish();
+
+    ZipCentralDirectory directory = readRemote(archive);
+    REQUIRE(directory.isValid());
+    REQUIRE(directory.entries().size() == 2);
+
+    const ZipCentralDirectory::Entry &spu = directory.entries().at(1);
+    REQUIRE(spu.name == QStringLiteral("b.spu"));
+    REQUIRE(spu.uncompressedSize == 128);
+    REQUIRE(spu.compressedSize == 128);
+    REQUIRE(archive.mid(qsizetype(spu.localHeaderOffset), 4) == QByteArray("PK\x03\x04", 4));
+}
+
+TEST_CASE("ZipCentralDirectory rejects data that is not a ZIP", "[zipcentraldirectory]") {
+    QString error;
+    ZipCentralDirectory::Location location =
+        ZipCentralDirectory::locate(QByteArray(4096, '\0'), 4096, &error);
+    REQUIRE_FALSE(location.valid);
+    REQUIRE_FALSE(error.isEmpty());
+
+    ZipBuilder builder;
+    builder.add("one.wic", QByteArray(16, '1'));
+    QByteArray archive = builder.finish();
+    location = ZipCentralDirectory::locate(archive, quint64(archive.size()));
+    REQUIRE(location.valid);
+
+    // A directory cut short must not be accepted
+    QByteArray truncated = archive.mid(qsizetype(location.offset), qsizetype(location.size) - 10);
+    ZipCentralDirectory::Location shorter = location;
+    shorter.size -= 10;
+    REQUIRE_FALSE(ZipCentralDirectory::parse(truncated, shorter).isValid());
+}
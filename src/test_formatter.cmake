@@ -18,6 +18,8 @@ if(BUILD_TESTING)
   add_executable(
     disk_formatter_test
     disk_formatter.h disk_formatter.cpp file_operations.h file_operations.cpp
+    adaptive_write_controller.h adaptive_write_controller.cpp
+    memory_file_operations.h memory_file_operations.cpp
     ${PLATFORM_FILE_OPS} disk_formatter_test.cpp)
 
   target_compile_features(disk_formatter_test PRIVATE cxx_std_20)
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "trailingverifier.h"
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+constexpr std::size_t READ_ALIGNMENT = 4096;
+
+struct AlignedFree {
+    void operator()(char *p) const { std::free(p); }
+};
+
+} // namespace
+
+TrailingVerifier::TrailingVerifier(std::uint64_t start, std::size_t chunkSize, ReadFunction read, HashFunction hash)
+    : _read(std::move(read)), _hash(std::move(hash)), _chunkSize(chunkSize),
+      _safeEnd(start), _verifiedEnd(start), _stopping(false), _failed(false), _busyMs(0)
+{
+    _thread = std::thread(&TrailingVerifier::_run, this);
+}
+
+TrailingVerifier::~TrailingVerifier()
+{
+    finish();
+}
+
+void TrailingVerifier::setSafeEnd(std::uint64_t end)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (end <= _safeEnd)
+            return;
+        _safeEnd = end;
+    }
+    _advanced.notify_one();
+}
+
+std::uint64_t TrailingVerifier::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _advanced.notify_all();
+
+    if (_thread.joinable())
+        _thread.join();
+
+    return verifiedEnd();
+}
+
+bool TrailingVerifier::failed() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failed;
+}
+
+std::uint64_t TrailingVerifier::verifiedEnd() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _verifiedEnd;
+}
+
+std::uint64_t TrailingVerifier::busyMs() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _busyMs;
+}
+
+void TrailingVerifier::_run()
+{
+    // Size rounded up, since aligned_alloc wants a multiple of the alignment
+    std::unique_ptr<char, AlignedFree> buf(static_cast<char *>(
+        std::aligned_alloc(READ_ALIGNMENT, (_chunkSize + READ_ALIGNMENT - 1) / READ_ALIGNMENT * READ_ALIGNMENT)));
+    if (!buf)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _failed = true;
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;)
+    {
+        // Only whole chunks, so reads stay aligned and the tail is left for the final pass
+        _advanced.wait(lock, [this] { return _stopping || _safeEnd - _verifiedEnd >= _chunkSize; });
+        if (_stopping)
+            break;
+
+        const std::uint64_t offset = _verifiedEnd;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        const bool ok = _read(offset, buf.get(), _chunkSize);
+        if (ok)
+            _hash(buf.get(), _chunkSize);
+        auto took = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count());
+
+        lock.lock();
+        _busyMs += took;
+        if (!ok)
+        {
+            _failed = true;
+            break;
+        }
+        _verifiedEnd = offset + _chunkSize;
+    }
+}
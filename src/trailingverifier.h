@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef TRAILINGVERIFIER_H
+#define TRAILINGVERIFIER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Reads back and hashes written data while the write is still going
+ *
+ * Normally the verify pass only starts once the whole image has been written,
+ * so a write takes write time plus full read time. The trailing verifier
+ * follows behind the write cursor instead: the writer reports how far the
+ * device is known to hold the written data (setSafeEnd), and the verifier
+ * thread reads and hashes whole chunks up to that point. When the write is
+ * done, finish() says how far it got and only the rest needs reading.
+ *
+ * Data is hashed strictly in device order, starting at the start offset, so
+ * the caller can continue the same hash from finish()'s return value.
+ */
+class TrailingVerifier
+{
+public:
+    // Read exactly len bytes at offset into buf; false on a read error
+    using ReadFunction = std::function<bool(std::uint64_t offset, char *buf, std::size_t len)>;
+    using HashFunction = std::function<void(const char *data, std::size_t len)>;
+
+    /**
+     * @param start Device offset to start reading at
+     * @param chunkSize Size of each read; a multiple of 4096 for O_DIRECT
+     */
+    TrailingVerifier(std::uint64_t start, std::size_t chunkSize, ReadFunction read, HashFunction hash);
+    ~TrailingVerifier();
+
+    TrailingVerifier(const TrailingVerifier&) = delete;
+    TrailingVerifier& operator=(const TrailingVerifier&) = delete;
+
+    // Everything before end is on the device and may be read back
+    void setSafeEnd(std::uint64_t end);
+
+    /**
+     * @brief Stop after the chunk being read, and wait for the thread
+     * @return Offset up to which data was read and hashed
+     */
+    std::uint64_t finish();
+
+    // A read failed; the verifier stopped at verifiedEnd()
+    bool failed() const;
+    std::uint64_t verifiedEnd() const;
+
+    // Time the verifier thread spent reading and hashing
+    std::uint64_t busyMs() const;
+
+private:
+    void _run();
+
+    ReadFunction _read;
+    HashFunction _hash;
+    const std::size_t _chunkSize;
+    std::thread _thread;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _advanced;  // Signalled when the safe end moves or on finish
+    std::uint64_t _safeEnd;
+    std::uint64_t _verifiedEnd;
+    bool _stopping;
+    bool _failed;
+    std::uint64_t _busyMs;
+};
+
+#endif // TRAILINGVERIFIER_H
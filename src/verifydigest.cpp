@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "verifydigest.h"
+#include "acceleratedcryptographichash.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+#include <new>
+
+struct VerifyDigest::impl {
+    explicit impl(Algorithm algorithm)
+    {
+        if (algorithm == Algorithm::Xxh3_128)
+        {
+            _xxh3 = XXH3_createState();
+            if (!_xxh3)
+                throw std::bad_alloc();
+            XXH3_128bits_reset(_xxh3);
+        }
+        else
+        {
+            _sha256 = std::make_unique<AcceleratedCryptographicHash>(QCryptographicHash::Sha256);
+        }
+    }
+
+    ~impl()
+    {
+        if (_xxh3)
+            XXH3_freeState(_xxh3);
+    }
+
+    void addData(const char *data, int length)
+    {
+        if (_xxh3)
+            XXH3_128bits_update(_xxh3, data, static_cast<size_t>(length));
+        else
+            _sha256->addData(data, length);
+    }
+
+    QByteArray result() const
+    {
+        if (!_xxh3)
+            return _sha256->result();
+
+        // Canonical (big-endian) form, so the hex string matches xxhsum's
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(_xxh3));
+        return QByteArray(reinterpret_cast<const char *>(canonical.digest), sizeof(canonical.digest));
+    }
+
+    void reset()
+    {
+        if (_xxh3)
+            XXH3_128bits_reset(_xxh3);
+        else
+            _sha256->reset();
+    }
+
+private:
+    std::unique_ptr<AcceleratedCryptographicHash> _sha256;
+    XXH3_state_t *_xxh3 = nullptr;
+};
+
+VerifyDigest::VerifyDigest(Algorithm algorithm)
+    : p_Impl(std::make_unique<impl>(algorithm)), _algorithm(algorithm)
+{
+}
+
+VerifyDigest::~VerifyDigest() = default;
+
+void VerifyDigest::addData(const char *data, int length)
+{
+    p_Impl->addData(data, length);
+}
+
+void VerifyDigest::addData(const QByteArray &data)
+{
+    p_Impl->addData(data.constData(), static_cast<int>(data.size()));
+}
+
+QByteArray VerifyDigest::result() const
+{
+    return p_Impl->result();
+}
+
+void VerifyDigest::reset()
+{
+    p_Impl->reset();
+}
+
+QString VerifyDigest::algorithmName(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Algorithm::Xxh3_128:
+        return QStringLiteral("XXH3-128");
+    case Algorithm::Sha256:
+    default:
+        return QStringLiteral("SHA256");
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#ifndef VERIFYDIGEST_H
+#define VERIFYDIGEST_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+/**
+ * @brief Digest used to compare what was written with what is read back
+ *
+ * That comparison only has to catch corruption, which a strong
+ * non-cryptographic checksum does just as well as SHA256 at a fraction of the
+ * cost: on CPUs without SHA instructions SHA256 is slower than the storage
+ * and ends up limiting both the write and the verify pass. SHA256 is still
+ * what gets compared with the extract_sha256 from the OS list; this class is
+ * only for the write/read-back comparison.
+ *
+ * Same interface as AcceleratedCryptographicHash.
+ */
+class VerifyDigest
+{
+public:
+    enum class Algorithm {
+        Sha256,     ///< AcceleratedCryptographicHash (platform SHA256)
+        Xxh3_128    ///< xxHash XXH3, 128-bit, SIMD where available
+    };
+
+    explicit VerifyDigest(Algorithm algorithm = Algorithm::Sha256);
+    ~VerifyDigest();
+
+    VerifyDigest(const VerifyDigest&) = delete;
+    VerifyDigest& operator=(const VerifyDigest&) = delete;
+
+    void addData(const char *data, int length);
+    void addData(const QByteArray &data);
+    QByteArray result() const;
+    void reset();
+
+    Algorithm algorithm() const { return _algorithm; }
+    static QString algorithmName(Algorithm algorithm);
+
+private:
+    struct impl;
+    std::unique_ptr<impl> p_Impl;
+    Algorithm _algorithm;
+};
+
+#endif // VERIFYDIGEST_H
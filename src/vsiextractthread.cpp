@@ -12,11 +12,22 @@
 #include <QUrl>
 #include <QDebug>
 #include <QCryptographicHash>
+#include <QThread>
+#include <QtConcurrent/qtconcurrentrun.h>
 #include <cstring>
+#include <deque>
 
 // Page alignment for Direct I/O
 static constexpr size_t PAGE_ALIGNMENT = 4096;
 
+// Shorter sparse runs are written as zeros: splitting the write buffer around
+// them would cost more in small writes than skipping saves
+static constexpr quint64 MIN_SPARSE_SKIP_BYTES = 1024 * 1024;
+
+// VSI2 groups inflate to up to 16MB each; more workers than this rarely
+// outrun the device and only cost memory
+static constexpr int MAX_INFLATE_WORKERS = 8;
+
 VsiExtractThread::VsiExtractThread(const QByteArray &url, const QByteArray &dst,
                                    const QByteArray &expectedHash, QObject *parent)
     : DownloadExtractThread(url, dst, expectedHash, parent)
@@ -28,6 +39,7 @@ VsiExtractThread::VsiExtractThread(const QByteArray &url, const QByteArray &dst,
     , _writeBufferUsed(0)
     , _zeroBlock(nullptr)
     , _zeroBlockSize(0)
+    , _pendingSparseBytes(0)
     , _totalBytesWritten(0)
 {
     std::memset(&_header, 0, sizeof(_header));
@@ -40,6 +52,8 @@ VsiExtractThread::VsiExtractThread(const QByteArray &url, const QByteArray &dst,
 
     // Reserve space for decompression buffer
     _decompressBuffer.reserve(bufferSize);
+
+    _inflatePool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MAX_INFLATE_WORKERS));
 }
 
 VsiExtractThread::~VsiExtractThread()
@@ -81,7 +95,7 @@ bool VsiExtractThread::parseVsiHeader(QIODevice *device, VsiHeader &header)
     }
 
     // Validate magic
-    if (std::memcmp(header.magic, VSI_MAGIC, 4) != 0) {
+    if (VsiFormat::version(header) == 0) {
         qWarning() << "VsiExtractThread: Invalid VSI magic bytes";
         return false;
     }
@@ -99,6 +113,7 @@ bool VsiExtractThread::parseVsiHeader(QIODevice *device, VsiHeader &header)
     }
 
     qDebug() << "VsiExtractThread: Parsed VSI header:"
+             << "version=" << VsiFormat::version(header)
              << "blockSize=" << header.blockSize
              << "uncompressedSize=" << header.uncompressedSize
              << "label=" << QString::fromLatin1(header.label, strnlen(header.label, sizeof(header.label)))
@@ -188,6 +203,45 @@ bool VsiExtractThread::_flushWriteBuffer()
     return true;
 }
 
+bool VsiExtractThread::_appendZeroBlock()
+{
+    if (_writeBufferUsed + _header.blockSize > _writeBufferCapacity) {
+        if (!_flushWriteBuffer()) {
+            return false;
+        }
+    }
+    _appendToWriteBuffer(_zeroBlock, _header.blockSize);
+    return true;
+}
+
+bool VsiExtractThread::_flushSparseRun()
+{
+    if (_pendingSparseBytes == 0) {
+        return true;
+    }
+
+    quint64 runLength = _pendingSparseBytes;
+    _pendingSparseBytes = 0;
+
+    if (runLength >= MIN_SPARSE_SKIP_BYTES) {
+        // Buffered data precedes this run, so write it out before skipping
+        if (!_flushWriteBuffer()) {
+            return false;
+        }
+        if (_skipSparseRange(runLength)) {
+            return true;
+        }
+    }
+
+    // Short run, or the device could not zero the range after all - write the zeros out
+    for (quint64 written = 0; written < runLength; written += _header.blockSize) {
+        if (!_appendZeroBlock()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void VsiExtractThread::extractVsiLocalRun()
 {
     emit preparationStatusUpdate(tr("Opening VSI image file..."));
@@ -209,20 +263,12 @@ void VsiExtractThread::extractVsiLocalRun()
         return;
     }
 
-    // Initialize zlib decompressor
-    if (!_initZlib()) {
-        _onDownloadError(tr("Failed to initialize decompressor"));
-        _closeFiles();
-        return;
-    }
-
     // Allocate page-aligned write buffer for Direct I/O compatibility
     // Use a large buffer (8MB) to reduce number of write calls
     _writeBufferCapacity = 8 * 1024 * 1024;  // 8MB
     _writeBuffer = static_cast<char*>(qMallocAligned(_writeBufferCapacity, PAGE_ALIGNMENT));
     if (!_writeBuffer) {
         _onDownloadError(tr("Failed to allocate write buffer"));
-        _cleanupZlib();
         _closeFiles();
         return;
     }
@@ -234,7 +280,6 @@ void VsiExtractThread::extractVsiLocalRun()
     _zeroBlock = static_cast<char*>(qMallocAligned(_zeroBlockSize, PAGE_ALIGNMENT));
     if (!_zeroBlock) {
         _onDownloadError(tr("Failed to allocate zero block"));
-        _cleanupZlib();
         _closeFiles();
         return;
     }
@@ -245,6 +290,65 @@ void VsiExtractThread::extractVsiLocalRun()
 
     emit preparationStatusUpdate(tr("Extracting VSI image..."));
 
+    bool extracted = VsiFormat::version(_header) == 2 ? _extractGroups(payloadHash)
+                                                      : _extractStream(payloadHash);
+    if (!extracted) {
+        _cleanupZlib();
+        _closeFiles();
+        return;
+    }
+
+    // Flush any remaining data in the write buffer and any trailing sparse run
+    if (!_cancelled && (!_flushSparseRun() || !_flushWriteBuffer())) {
+        _onDownloadError(tr("Error writing final data to device"));
+        _cleanupZlib();
+        _closeFiles();
+        return;
+    }
+
+    _cleanupZlib();
+
+    if (_cancelled) {
+        return;
+    }
+
+    // Verify MD5 checksum
+    QByteArray computedMd5 = payloadHash.result();
+    QByteArray expectedMd5 = QByteArray(reinterpret_cast<const char*>(_header.md5), 16);
+
+    if (computedMd5 != expectedMd5) {
+        qWarning() << "VsiExtractThread: MD5 mismatch - expected:" << expectedMd5.toHex()
+                   << "computed:" << computedMd5.toHex();
+        _onDownloadError(tr("VSI file checksum verification failed"));
+        _closeFiles();
+        return;
+    }
+
+    qDebug() << "VsiExtractThread: MD5 verification passed";
+
+    // Verify we wrote the expected amount
+    if (_totalBytesWritten != static_cast<quint64>(_header.uncompressedSize)) {
+        qWarning() << "VsiExtractThread: Size mismatch - expected:" << _header.uncompressedSize
+                   << "written:" << _totalBytesWritten;
+        _onDownloadError(tr("VSI extraction size mismatch"));
+        _closeFiles();
+        return;
+    }
+
+    qDebug() << "VsiExtractThread: Extraction completed successfully,"
+             << _totalBytesWritten << "bytes written";
+
+    _writeComplete();
+}
+
+bool VsiExtractThread::_extractStream(QCryptographicHash &payloadHash)
+{
+    // Initialize zlib decompressor
+    if (!_initZlib()) {
+        _onDownloadError(tr("Failed to initialize decompressor"));
+        return false;
+    }
+
     // Allocate decompression output buffer
     size_t decompBufSize = _header.blockSize * 4;  // Process multiple blocks at once
     _decompressBuffer.resize(decompBufSize);
@@ -257,7 +361,7 @@ void VsiExtractThread::extractVsiLocalRun()
         qint64 bytesRead = _localFile.read(_inputBuffer.get(), _inputBufferSize);
         if (bytesRead < 0) {
             _onDownloadError(tr("Error reading VSI file"));
-            break;
+            return false;
         }
 
         if (bytesRead == 0) {
@@ -284,9 +388,7 @@ void VsiExtractThread::extractVsiLocalRun()
 
             if (ret == Z_STREAM_ERROR || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
                 _onDownloadError(tr("Decompression error: %1").arg(ret));
-                _cleanupZlib();
-                _closeFiles();
-                return;
+                return false;
             }
 
             size_t decompressedBytes = decompBufSize - _zstream.avail_out;
@@ -294,9 +396,7 @@ void VsiExtractThread::extractVsiLocalRun()
                 _bytesDecompressed += decompressedBytes;
 
                 if (!_processDecompressedData(_decompressBuffer.constData(), decompressedBytes)) {
-                    _cleanupZlib();
-                    _closeFiles();
-                    return;
+                    return false;
                 }
             }
 
@@ -311,47 +411,101 @@ void VsiExtractThread::extractVsiLocalRun()
         _emitProgressUpdate();
     }
 
-    // Flush any remaining data in the write buffer
-    if (!_cancelled && !_flushWriteBuffer()) {
-        _onDownloadError(tr("Error writing final data to device"));
-        _cleanupZlib();
-        _closeFiles();
-        return;
+    return true;
+}
+
+bool VsiExtractThread::_extractGroups(QCryptographicHash &payloadHash)
+{
+    VsiFormat::GroupIndex index;
+    QByteArray rawIndex;
+    QString error;
+    if (!VsiFormat::readGroupIndex(&_localFile, _header, index, rawIndex, &error)) {
+        qWarning() << "VsiExtractThread:" << error;
+        _onDownloadError(tr("Invalid VSI file format"));
+        return false;
     }
 
-    _cleanupZlib();
+    payloadHash.addData(rawIndex);
+    qint64 compressedBytesRead = rawIndex.size();
+    const quint64 maxGroupBytes = index.maxGroupBytes(_header);
+    const qsizetype groupCount = index.compressedSizes.size();
+
+    struct InflatedGroup {
+        bool ok = false;
+        QByteArray data;
+    };
+
+    // Groups are read in file order, which the payload MD5 needs anyway, inflated
+    // on the worker pool and committed strictly in order. Reading stays at most one
+    // group ahead of the workers, so memory is bounded by a few groups per worker.
+    const int maxInFlight = _inflatePool.maxThreadCount() + 1;
+    std::deque<QFuture<InflatedGroup>> inFlight;
+    qsizetype nextRead = 0;
+    qsizetype nextCommit = 0;
+
+    auto drain = [&inFlight]() {
+        for (QFuture<InflatedGroup> &future : inFlight) {
+            future.waitForFinished();
+        }
+        inFlight.clear();
+    };
+
+    qDebug() << "VsiExtractThread: Inflating" << groupCount << "block groups on"
+             << _inflatePool.maxThreadCount() << "workers";
+
+    while (!_cancelled && nextCommit < groupCount) {
+        while (nextRead < groupCount && static_cast<int>(inFlight.size()) < maxInFlight) {
+            const qint64 size = index.compressedSizes[nextRead++];
+            QByteArray compressed = _localFile.read(size);
+            if (compressed.size() != size) {
+                drain();
+                _onDownloadError(tr("Error reading VSI file"));
+                return false;
+            }
 
-    if (_cancelled) {
-        return;
-    }
+            payloadHash.addData(compressed);
+            compressedBytesRead += size;
+            _lastDlNow = VSI_HEADER_SIZE + compressedBytesRead;
 
-    // Verify MD5 checksum
-    QByteArray computedMd5 = payloadHash.result();
-    QByteArray expectedMd5 = QByteArray(reinterpret_cast<const char*>(_header.md5), 16);
+            inFlight.push_back(QtConcurrent::run(&_inflatePool, [compressed, maxGroupBytes]() {
+                InflatedGroup group;
+                group.ok = VsiFormat::inflateGroup(compressed, maxGroupBytes, group.data);
+                return group;
+            }));
+        }
 
-    if (computedMd5 != expectedMd5) {
-        qWarning() << "VsiExtractThread: MD5 mismatch - expected:" << expectedMd5.toHex()
-                   << "computed:" << computedMd5.toHex();
-        _onDownloadError(tr("VSI file checksum verification failed"));
-        _closeFiles();
-        return;
-    }
+        InflatedGroup group = inFlight.front().result();
+        inFlight.pop_front();
 
-    qDebug() << "VsiExtractThread: MD5 verification passed";
+        if (!group.ok) {
+            qWarning() << "VsiExtractThread: Failed to inflate block group" << nextCommit;
+            drain();
+            _onDownloadError(tr("Decompression error in block group %1").arg(nextCommit));
+            return false;
+        }
 
-    // Verify we wrote the expected amount
-    if (_totalBytesWritten != static_cast<quint64>(_header.uncompressedSize)) {
-        qWarning() << "VsiExtractThread: Size mismatch - expected:" << _header.uncompressedSize
-                   << "written:" << _totalBytesWritten;
-        _onDownloadError(tr("VSI extraction size mismatch"));
-        _closeFiles();
-        return;
+        _bytesDecompressed += group.data.size();
+        if (!_processDecompressedData(group.data.constData(), group.data.size())) {
+            drain();
+            return false;
+        }
+        nextCommit++;
+
+        _emitProgressUpdate();
     }
 
-    qDebug() << "VsiExtractThread: Extraction completed successfully,"
-             << _totalBytesWritten << "bytes written";
+    drain();
 
-    _writeComplete();
+    // The payload MD5 covers everything after the header
+    while (!_cancelled && !_localFile.atEnd()) {
+        qint64 bytesRead = _localFile.read(_inputBuffer.get(), _inputBufferSize);
+        if (bytesRead <= 0) {
+            break;
+        }
+        payloadHash.addData(QByteArrayView(_inputBuffer.get(), bytesRead));
+    }
+
+    return true;
 }
 
 void VsiExtractThread::extractVsiNetworkRun()
@@ -388,18 +542,23 @@ bool VsiExtractThread::_processDecompressedData(const char *data, size_t len)
             offset++;
 
             if (delim == 0x00) {
-                // Sparse block - append zeros to write buffer
-                // Check if we need to flush first
-                if (_writeBufferUsed + _header.blockSize > _writeBufferCapacity) {
-                    if (!_flushWriteBuffer()) {
+                // Sparse block - skip it on the device when it can give us zeros for free.
+                // Skipping keeps offsets aligned for Direct I/O only with page-sized blocks.
+                if (_canSkipSparse() && _header.blockSize % PAGE_ALIGNMENT == 0) {
+                    _pendingSparseBytes += _header.blockSize;
+                } else {
+                    // Append zeros (use the pre-allocated zero block)
+                    if (!_flushSparseRun() || !_appendZeroBlock()) {
                         return false;
                     }
                 }
-                // Append zeros (use the pre-allocated zero block)
-                _appendToWriteBuffer(_zeroBlock, _header.blockSize);
                 _totalBytesWritten += _header.blockSize;
             } else if (delim == 0x01) {
-                // Data block - need to read blockSize bytes
+                // Data block - need to read blockSize bytes.
+                // Any sparse run before it has to be skipped first to keep offsets right.
+                if (!_flushSparseRun()) {
+                    return false;
+                }
                 _expectingDelimiter = false;
                 _bytesInCurrentBlock = 0;
             } else {
@@ -6,33 +6,27 @@
  * Copyright (C) 2025 Laerdal Medical
  *
  * VSI (Versioned Sparse Image) extraction thread
- * Handles decompression and writing of Laerdal VSI format disk images
+ * Handles decompression and writing of Laerdal VSI format disk images.
+ * VSI1 is inflated as a single stream; VSI2 block groups are inflated on a
+ * worker pool and committed to the device in order.
  */
 
 #include "downloadextractthread.h"
+#include "vsiformat.h"
 #include <QFile>
+#include <QThreadPool>
 #include <zlib.h>
 #include <memory>
 
+class QCryptographicHash;
+
 class VsiExtractThread : public DownloadExtractThread
 {
     Q_OBJECT
 public:
-    static constexpr size_t VSI_HEADER_SIZE = 128;
-    static constexpr char VSI_MAGIC[4] = {'V', 'S', 'I', '1'};
-
-    // VSI header structure (little-endian, packed)
-#pragma pack(push, 1)
-    struct VsiHeader {
-        char magic[4];           // "VSI1"
-        int32_t blockSize;       // Block size in bytes
-        int64_t uncompressedSize; // Total uncompressed image size
-        uint8_t md5[16];         // MD5 checksum of compressed payload
-        char label[64];          // Image label
-        char version[28];        // Image version string
-        int32_t timestamp;       // Unix timestamp
-    };
-#pragma pack(pop)
+    static constexpr size_t VSI_HEADER_SIZE = VsiFormat::HEADER_SIZE;
+
+    using VsiHeader = ::VsiHeader;
 
     explicit VsiExtractThread(const QByteArray &url, const QByteArray &dst = "",
                               const QByteArray &expectedHash = "", QObject *parent = nullptr);
@@ -49,11 +43,15 @@ protected:
 
 private:
     bool _parseHeader();
+    bool _extractStream(QCryptographicHash &payloadHash);
+    bool _extractGroups(QCryptographicHash &payloadHash);
     bool _initZlib();
     void _cleanupZlib();
     bool _processDecompressedData(const char *data, size_t len);
     bool _flushWriteBuffer();
     void _appendToWriteBuffer(const char *data, size_t len);
+    bool _appendZeroBlock();
+    bool _flushSparseRun();
 
     VsiHeader _header;
     z_stream _zstream;
@@ -79,6 +77,12 @@ private:
     char *_zeroBlock;
     size_t _zeroBlockSize;
 
+    // Run of sparse blocks not yet skipped on the device (see _flushSparseRun)
+    quint64 _pendingSparseBytes;
+
+    // Workers inflating VSI2 block groups
+    QThreadPool _inflatePool;
+
     // MD5 verification of compressed payload
     QByteArray _payloadMd5;
 
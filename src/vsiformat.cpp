@@ -0,0 +1,396 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "vsiformat.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+#include <limits>
+#include <zlib.h>
+
+namespace {
+
+constexpr qint64 IO_CHUNK_SIZE = 1024 * 1024;
+constexpr int MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+constexpr qsizetype TABLE_ENTRY_SIZE = sizeof(quint32);
+
+void setError(QString *errorMessage, const QString &message)
+{
+    if (errorMessage)
+        *errorMessage = message;
+}
+
+// Deflate one group of records and append it to the output file
+bool writeGroup(QFile &output, const QByteArray &records, QList<quint32> &compressedSizes, QString &errorMessage)
+{
+    uLongf compressedSize = compressBound(static_cast<uLong>(records.size()));
+    QByteArray compressed(static_cast<qsizetype>(compressedSize), Qt::Uninitialized);
+
+    int ret = compress2(reinterpret_cast<Bytef *>(compressed.data()), &compressedSize,
+                        reinterpret_cast<const Bytef *>(records.constData()),
+                        static_cast<uLong>(records.size()), Z_DEFAULT_COMPRESSION);
+    if (ret != Z_OK || compressedSize > std::numeric_limits<quint32>::max())
+    {
+        errorMessage = QString("Failed to compress block group %1 (zlib error %2)").arg(compressedSizes.size()).arg(ret);
+        return false;
+    }
+
+    if (output.write(compressed.constData(), static_cast<qint64>(compressedSize)) != static_cast<qint64>(compressedSize))
+    {
+        errorMessage = QString("Error writing %1: %2").arg(output.fileName(), output.errorString());
+        return false;
+    }
+
+    compressedSizes.append(static_cast<quint32>(compressedSize));
+    return true;
+}
+
+}  // namespace
+
+int VsiFormat::version(const VsiHeader &header)
+{
+    if (std::memcmp(header.magic, MAGIC_V1, sizeof(MAGIC_V1)) == 0)
+        return 1;
+    if (std::memcmp(header.magic, MAGIC_V2, sizeof(MAGIC_V2)) == 0)
+        return 2;
+    return 0;
+}
+
+quint64 VsiFormat::blockCount(const VsiHeader &header)
+{
+    if (header.blockSize <= 0 || header.uncompressedSize <= 0)
+        return 0;
+    return (static_cast<quint64>(header.uncompressedSize) + header.blockSize - 1) / header.blockSize;
+}
+
+quint64 VsiFormat::GroupIndex::maxGroupBytes(const VsiHeader &header) const
+{
+    return static_cast<quint64>(blocksPerGroup) * (static_cast<quint64>(header.blockSize) + 1);
+}
+
+bool VsiFormat::readGroupIndex(QIODevice *device, const VsiHeader &header,
+                               GroupIndex &index, QByteArray &rawBytes, QString *errorMessage)
+{
+    rawBytes = device->read(2 * TABLE_ENTRY_SIZE);
+    if (rawBytes.size() != 2 * TABLE_ENTRY_SIZE)
+    {
+        setError(errorMessage, "Truncated VSI2 group table");
+        return false;
+    }
+
+    const quint32 groupCount = qFromLittleEndian<quint32>(rawBytes.constData());
+    index.blocksPerGroup = qFromLittleEndian<quint32>(rawBytes.constData() + TABLE_ENTRY_SIZE);
+    index.compressedSizes.clear();
+
+    if (index.blocksPerGroup == 0 || index.maxGroupBytes(header) > MAX_GROUP_BYTES)
+    {
+        setError(errorMessage, QString("Unsupported VSI2 group size: %1 blocks").arg(index.blocksPerGroup));
+        return false;
+    }
+
+    const quint64 blocks = blockCount(header);
+    if (groupCount != (blocks + index.blocksPerGroup - 1) / index.blocksPerGroup)
+    {
+        setError(errorMessage, QString("VSI2 group count %1 does not match the image size").arg(groupCount));
+        return false;
+    }
+
+    // Don't let a corrupt count make us allocate a huge table
+    const qint64 tableBytes = static_cast<qint64>(groupCount) * TABLE_ENTRY_SIZE;
+    if (!device->isSequential() && device->bytesAvailable() < tableBytes)
+    {
+        setError(errorMessage, "Truncated VSI2 group table");
+        return false;
+    }
+
+    QByteArray table = device->read(tableBytes);
+    if (table.size() != tableBytes)
+    {
+        setError(errorMessage, "Truncated VSI2 group table");
+        return false;
+    }
+
+    index.compressedSizes.reserve(groupCount);
+    for (quint32 i = 0; i < groupCount; i++)
+    {
+        quint32 size = qFromLittleEndian<quint32>(table.constData() + i * TABLE_ENTRY_SIZE);
+        if (size == 0)
+        {
+            setError(errorMessage, QString("VSI2 block group %1 is empty").arg(i));
+            return false;
+        }
+        index.compressedSizes.append(size);
+    }
+
+    rawBytes.append(table);
+    return true;
+}
+
+bool VsiFormat::inflateGroup(const QByteArray &compressed, quint64 maxBytes, QByteArray &out)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+        return false;
+
+    out.resize(static_cast<qsizetype>(maxBytes));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.constData()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    stream.next_out = reinterpret_cast<Bytef *>(out.data());
+    stream.avail_out = static_cast<uInt>(maxBytes);
+
+    // The whole group fits the output buffer, so one call inflates it completely
+    int ret = inflate(&stream, Z_FINISH);
+    bool ok = ret == Z_STREAM_END && stream.avail_in == 0;
+    out.resize(ok ? static_cast<qsizetype>(stream.total_out) : 0);
+
+    inflateEnd(&stream);
+    return ok;
+}
+
+bool VsiFormat::convertToVsi2(const QString &inputPath, const QString &outputPath, QString &errorMessage,
+                              const std::function<void(qint64, qint64)> &progress)
+{
+    QFile input(inputPath);
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        errorMessage = QString("Error opening %1: %2").arg(inputPath, input.errorString());
+        return false;
+    }
+
+    VsiHeader header;
+    if (input.read(reinterpret_cast<char *>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header)))
+    {
+        errorMessage = QString("%1 is too short to be a VSI file").arg(inputPath);
+        return false;
+    }
+    if (version(header) == 2)
+    {
+        errorMessage = QString("%1 already is a VSI2 file").arg(inputPath);
+        return false;
+    }
+    if (version(header) != 1 || header.blockSize <= 0 || header.blockSize > MAX_BLOCK_SIZE
+        || header.uncompressedSize <= 0)
+    {
+        errorMessage = QString("%1 is not a valid VSI1 file").arg(inputPath);
+        return false;
+    }
+
+    const qsizetype blockSize = header.blockSize;
+    const quint64 totalBlocks = blockCount(header);
+    const quint32 blocksPerGroup = static_cast<quint32>(qMax<quint64>(1, TARGET_GROUP_BYTES / blockSize));
+    const quint64 groupCount = (totalBlocks + blocksPerGroup - 1) / blocksPerGroup;
+    if (groupCount > std::numeric_limits<quint32>::max())
+    {
+        errorMessage = QString("%1 has too many blocks to convert").arg(inputPath);
+        return false;
+    }
+
+    QFile output(outputPath);
+    if (!output.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        errorMessage = QString("Error creating %1: %2").arg(outputPath, output.errorString());
+        return false;
+    }
+
+    // Header and group table are rewritten once the group sizes are known
+    const qint64 tableBytes = static_cast<qint64>(2 + groupCount) * TABLE_ENTRY_SIZE;
+    if (output.write(QByteArray(HEADER_SIZE + tableBytes, '\0')) != static_cast<qint64>(HEADER_SIZE) + tableBytes)
+    {
+        errorMessage = QString("Error writing %1: %2").arg(outputPath, output.errorString());
+        output.remove();
+        return false;
+    }
+
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK)
+    {
+        errorMessage = "Failed to initialize decompressor";
+        output.remove();
+        return false;
+    }
+
+    QCryptographicHash inputMd5(QCryptographicHash::Md5);
+    QByteArray inputChunk(IO_CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray inflated(IO_CHUNK_SIZE, Qt::Uninitialized);
+
+    // Records of the group being built
+    QByteArray records;
+    records.reserve(static_cast<qsizetype>(blocksPerGroup) * (blockSize + 1));
+    quint32 blocksInGroup = 0;
+    quint64 blocksSeen = 0;
+    bool expectingDelimiter = true;
+    qsizetype bytesInBlock = 0;
+
+    QList<quint32> compressedSizes;
+    bool streamEnded = false;
+    bool ok = true;
+
+    auto blockDone = [&]() -> bool {
+        blocksSeen++;
+        if (++blocksInGroup < blocksPerGroup)
+            return true;
+        blocksInGroup = 0;
+        bool written = writeGroup(output, records, compressedSizes, errorMessage);
+        records.clear();
+        return written;
+    };
+
+    while (ok)
+    {
+        qint64 bytesRead = input.read(inputChunk.data(), inputChunk.size());
+        if (bytesRead < 0)
+        {
+            errorMessage = QString("Error reading %1: %2").arg(inputPath, input.errorString());
+            ok = false;
+            break;
+        }
+        if (bytesRead == 0)
+            break;
+
+        inputMd5.addData(QByteArrayView(inputChunk.constData(), bytesRead));
+        if (progress)
+            progress(input.pos(), input.size());
+
+        // Anything after the end of the stream only counts towards the MD5
+        if (streamEnded)
+            continue;
+
+        stream.next_in = reinterpret_cast<Bytef *>(inputChunk.data());
+        stream.avail_in = static_cast<uInt>(bytesRead);
+
+        do
+        {
+            stream.next_out = reinterpret_cast<Bytef *>(inflated.data());
+            stream.avail_out = static_cast<uInt>(inflated.size());
+
+            int ret = inflate(&stream, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+            {
+                errorMessage = QString("Decompression error %1 in %2").arg(ret).arg(inputPath);
+                ok = false;
+                break;
+            }
+
+            const char *data = inflated.constData();
+            const qsizetype len = inflated.size() - stream.avail_out;
+            qsizetype offset = 0;
+
+            while (ok && offset < len)
+            {
+                if (expectingDelimiter)
+                {
+                    char delim = data[offset++];
+                    if (blocksSeen == totalBlocks || (delim != 0x00 && delim != 0x01))
+                    {
+                        errorMessage = QString("Invalid VSI data in %1").arg(inputPath);
+                        ok = false;
+                        break;
+                    }
+
+                    records.append(delim);
+                    if (delim == 0x00)
+                    {
+                        ok = blockDone();
+                    }
+                    else
+                    {
+                        expectingDelimiter = false;
+                        bytesInBlock = 0;
+                    }
+                }
+                else
+                {
+                    qsizetype toAppend = qMin(blockSize - bytesInBlock, len - offset);
+                    records.append(data + offset, toAppend);
+                    offset += toAppend;
+                    bytesInBlock += toAppend;
+
+                    if (bytesInBlock == blockSize)
+                    {
+                        expectingDelimiter = true;
+                        ok = blockDone();
+                    }
+                }
+            }
+
+            if (ret == Z_STREAM_END)
+            {
+                streamEnded = true;
+                break;
+            }
+        } while (ok && stream.avail_out == 0);
+    }
+
+    inflateEnd(&stream);
+
+    if (ok && (!streamEnded || !expectingDelimiter || blocksSeen != totalBlocks))
+    {
+        errorMessage = QString("%1 is truncated").arg(inputPath);
+        ok = false;
+    }
+
+    if (ok && QByteArray(reinterpret_cast<const char *>(header.md5), sizeof(header.md5)) != inputMd5.result())
+    {
+        errorMessage = QString("%1 failed its MD5 check").arg(inputPath);
+        ok = false;
+    }
+
+    // The last group holds whatever is left over
+    if (ok && !records.isEmpty())
+        ok = writeGroup(output, records, compressedSizes, errorMessage);
+
+    if (ok && compressedSizes.size() != static_cast<qsizetype>(groupCount))
+    {
+        errorMessage = QString("Unexpected block group count in %1").arg(inputPath);
+        ok = false;
+    }
+
+    if (ok)
+    {
+        QByteArray table(tableBytes, Qt::Uninitialized);
+        qToLittleEndian<quint32>(static_cast<quint32>(groupCount), table.data());
+        qToLittleEndian<quint32>(blocksPerGroup, table.data() + TABLE_ENTRY_SIZE);
+        for (qsizetype i = 0; i < compressedSizes.size(); i++)
+            qToLittleEndian<quint32>(compressedSizes[i], table.data() + (2 + i) * TABLE_ENTRY_SIZE);
+
+        ok = output.seek(HEADER_SIZE) && output.write(table) == tableBytes;
+
+        // The payload MD5 covers the table, so it can only be computed now
+        QCryptographicHash outputMd5(QCryptographicHash::Md5);
+        ok = ok && output.seek(HEADER_SIZE);
+        while (ok && !output.atEnd())
+        {
+            qint64 bytesRead = output.read(inputChunk.data(), inputChunk.size());
+            if (bytesRead <= 0)
+                ok = false;
+            else
+                outputMd5.addData(QByteArrayView(inputChunk.constData(), bytesRead));
+        }
+
+        VsiHeader outputHeader = header;
+        std::memcpy(outputHeader.magic, MAGIC_V2, sizeof(MAGIC_V2));
+        std::memcpy(outputHeader.md5, outputMd5.result().constData(), sizeof(outputHeader.md5));
+        ok = ok && output.seek(0)
+             && output.write(reinterpret_cast<const char *>(&outputHeader), sizeof(outputHeader))
+                    == static_cast<qint64>(sizeof(outputHeader))
+             && output.flush();
+
+        if (!ok)
+            errorMessage = QString("Error writing %1: %2").arg(outputPath, output.errorString());
+    }
+
+    if (!ok)
+    {
+        output.remove();
+        return false;
+    }
+
+    output.close();
+    return true;
+}
@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ *
+ * VSI (Versioned Sparse Image) on-disk format helpers.
+ *
+ * VSI1 is a 128-byte header followed by one zlib stream. The stream holds one
+ * record per image block: a 0x00 byte for an all-zero block, or a 0x01 byte
+ * followed by blockSize bytes of data.
+ *
+ * VSI2 keeps the header (with magic "VSI2") and the record encoding, but
+ * deflates the records in independent groups so they can be inflated in
+ * parallel:
+ *
+ *   header                     128 bytes
+ *   groupCount                 uint32, little-endian
+ *   blocksPerGroup             uint32, little-endian
+ *   compressedSize[groupCount] uint32 each, little-endian
+ *   group 0 .. groupCount-1    one complete zlib stream each
+ *
+ * Every group except the last covers exactly blocksPerGroup blocks. In both
+ * versions the header MD5 covers everything after the header.
+ */
+
+#ifndef VSIFORMAT_H
+#define VSIFORMAT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <cstdint>
+#include <functional>
+
+class QIODevice;
+
+// VSI header structure (little-endian, packed)
+#pragma pack(push, 1)
+struct VsiHeader {
+    char magic[4];           // "VSI1" or "VSI2"
+    int32_t blockSize;       // Block size in bytes
+    int64_t uncompressedSize; // Total uncompressed image size
+    uint8_t md5[16];         // MD5 checksum of compressed payload
+    char label[64];          // Image label
+    char version[28];        // Image version string
+    int32_t timestamp;       // Unix timestamp
+};
+#pragma pack(pop)
+
+namespace VsiFormat
+{
+    constexpr size_t HEADER_SIZE = 128;
+    constexpr char MAGIC_V1[4] = {'V', 'S', 'I', '1'};
+    constexpr char MAGIC_V2[4] = {'V', 'S', 'I', '2'};
+
+    static_assert(sizeof(VsiHeader) == HEADER_SIZE, "VSI header must be 128 bytes");
+
+    // Uncompressed size of the records in one VSI2 group written by convertToVsi2
+    constexpr quint64 TARGET_GROUP_BYTES = 16 * 1024 * 1024;
+
+    // Largest group a reader accepts, bounding per-worker memory
+    constexpr quint64 MAX_GROUP_BYTES = 256 * 1024 * 1024;
+
+    // Format version from the magic bytes, 0 if not a VSI header
+    int version(const VsiHeader &header);
+
+    // Number of blocks the image is made of
+    quint64 blockCount(const VsiHeader &header);
+
+    // Group table following a VSI2 header
+    struct GroupIndex
+    {
+        quint32 blocksPerGroup = 0;
+        QList<quint32> compressedSizes;
+
+        // Largest inflated size of one group: a delimiter plus data per block
+        quint64 maxGroupBytes(const VsiHeader &header) const;
+    };
+
+    /**
+     * @brief Read and validate the group table of a VSI2 file
+     *
+     * The device must be positioned right after the header. The raw table
+     * bytes are returned in rawBytes so they can be fed to the payload MD5.
+     */
+    bool readGroupIndex(QIODevice *device, const VsiHeader &header,
+                        GroupIndex &index, QByteArray &rawBytes, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Inflate one independently compressed VSI2 group
+     *
+     * Thread-safe, so groups can be handed to worker threads. Fails if the
+     * group does not inflate to a complete zlib stream of at most maxBytes.
+     */
+    bool inflateGroup(const QByteArray &compressed, quint64 maxBytes, QByteArray &out);
+
+    /**
+     * @brief Rewrite a VSI1 image as VSI2
+     *
+     * Verifies the VSI1 payload MD5 on the way and writes a new MD5 for the
+     * VSI2 payload; label, version and timestamp are carried over. A VSI2
+     * input is rejected rather than copied. The progress callback receives
+     * the number of input bytes consumed and the input size.
+     */
+    bool convertToVsi2(const QString &inputPath, const QString &outputPath, QString &errorMessage,
+                       const std::function<void(qint64, qint64)> &progress = {});
+}
+
+#endif // VSIFORMAT_H
@@ -37,7 +37,6 @@ set(PLATFORM_SOURCES
     dependencies/drivelist/src/windows/list.cpp
     windows/winfile.cpp
     windows/winfile.h
-    windows/bootimgcreator_windows.cpp
     windows/rsakeyfingerprint_windows.cpp
     windows/diskpart_util.cpp
     windows/diskpart_util.h
@@ -139,7 +139,7 @@ void WindowsFileOperations::ProcessCompletions(bool wait) {
     }
     
     // Record completion latency (thread-safe via atomic operations in base class)
-    write_latency_stats_.recordCompletion(ctx->submit_time);
+    write_latency_stats_.recordCompletion(ctx->submit_time, ctx->size);
     
     FileError error = FileError::kSuccess;
     
@@ -1040,7 +1040,7 @@ FileError WindowsFileOperations::AsyncWriteSequential(const std::uint8_t* data,
   ProcessCompletions(false);
   
   // If queue is full, wait for completions (checking for cancellation)
-  while (pending_writes_.load() >= async_queue_depth_) {
+  while (pending_writes_.load() >= InFlightLimit(async_queue_depth_)) {
     if (cancelled_.load()) {
       if (callback) callback(FileError::kCancelled, 0);
       return FileError::kCancelled;
@@ -1177,7 +1177,7 @@ FileError WindowsFileOperations::WaitForPendingWrites() {
     }
     
     // Record completion latency (thread-safe via atomic operations in base class)
-    write_latency_stats_.recordCompletion(ctx->submit_time);
+    write_latency_stats_.recordCompletion(ctx->submit_time, ctx->size);
     
     FileError error = FileError::kSuccess;
     if (!success) {
@@ -38,7 +38,7 @@ ConfirmDialog {
     // Note: ConfirmDialog already registers "content" and "buttons" groups
     Component.onCompleted: {
         registerFocusGroup("options", function(){
-            return [chkDirectIO.focusItem, chkAsyncIO.focusItem, chkPeriodicSync.focusItem, chkVerboseLogging.focusItem, chkIPv4Only.focusItem, chkSkipEndOfDevice.focusItem]
+            return [chkDirectIO.focusItem, chkAsyncIO.focusItem, chkPeriodicSync.focusItem, chkTrailingVerify.focusItem, chkFastVerify.focusItem, chkVerboseLogging.focusItem, chkIPv4Only.focusItem, chkSkipEndOfDevice.focusItem]
         }, 1)
     }
 
@@ -183,6 +183,26 @@ ConfirmDialog {
                 }
             }
 
+            ImOptionPill {
+                id: chkTrailingVerify
+                text: qsTr("Verify While Writing")
+                accessibleDescription: qsTr("Read back written data during the write, so only the last part is left to verify afterwards. Linux only, single device writes.")
+                Layout.fillWidth: true
+                Component.onCompleted: {
+                    focusItem.activeFocusOnTab = true
+                }
+            }
+
+            ImOptionPill {
+                id: chkFastVerify
+                text: qsTr("Fast Verify Checksum (XXH3)")
+                accessibleDescription: qsTr("Compare written and read-back data with XXH3-128 instead of SHA256. SHA256 is still checked against the published image hash.")
+                Layout.fillWidth: true
+                Component.onCompleted: {
+                    focusItem.activeFocusOnTab = true
+                }
+            }
+
             // Spacer
             Item {
                 Layout.preferredHeight: Style.spacingMedium
@@ -300,6 +320,8 @@ ConfirmDialog {
                             lines.push("Direct I/O: " + (chkDirectIO.checked ? "Enabled" : "Disabled"));
                             lines.push("Async I/O: " + (chkAsyncIO.checked ? "Enabled (depth " + depth + ", ~" + depth + "-" + (depth * 8) + " MB)" : "Disabled"));
                             lines.push("Periodic Sync: " + (chkPeriodicSync.checked ? "Enabled" : "Disabled"));
+                            lines.push("Verify While Writing: " + (chkTrailingVerify.checked ? "Enabled" : "Disabled"));
+                            lines.push("Verify Checksum: " + (chkFastVerify.checked ? "XXH3-128" : "SHA256"));
                             lines.push("IPv4-only: " + (chkIPv4Only.checked ? "Enabled" : "Disabled"));
                             lines.push("Counterfeit Card Mode: " + (chkSkipEndOfDevice.checked ? "Enabled" : "Disabled"));
                             if (chkDirectIO.checked && chkAsyncIO.checked) {
@@ -339,6 +361,8 @@ ConfirmDialog {
             chkAsyncIO.checked = imageWriter.getDebugAsyncIO();
             asyncQueueDepthSlider.value = imageWriter.getDebugAsyncQueueDepth();
             chkPeriodicSync.checked = imageWriter.getDebugPeriodicSync();
+            chkTrailingVerify.checked = imageWriter.getDebugTrailingVerify();
+            chkFastVerify.checked = imageWriter.getDebugFastVerify();
             chkVerboseLogging.checked = imageWriter.getDebugVerboseLogging();
             chkIPv4Only.checked = imageWriter.getDebugIPv4Only();
             chkSkipEndOfDevice.checked = imageWriter.getDebugSkipEndOfDevice();
@@ -354,6 +378,8 @@ ConfirmDialog {
         imageWriter.setDebugAsyncIO(chkAsyncIO.checked);
         imageWriter.setDebugAsyncQueueDepth(Math.round(asyncQueueDepthSlider.value));
         imageWriter.setDebugPeriodicSync(chkPeriodicSync.checked);
+        imageWriter.setDebugTrailingVerify(chkTrailingVerify.checked);
+        imageWriter.setDebugFastVerify(chkFastVerify.checked);
         imageWriter.setDebugVerboseLogging(chkVerboseLogging.checked);
         imageWriter.setDebugIPv4Only(chkIPv4Only.checked);
         imageWriter.setDebugSkipEndOfDevice(chkSkipEndOfDevice.checked);
@@ -362,6 +388,8 @@ ConfirmDialog {
                     ", AsyncIO=" + chkAsyncIO.checked +
                     ", AsyncQueueDepth=" + Math.round(asyncQueueDepthSlider.value) +
                     ", PeriodicSync=" + chkPeriodicSync.checked +
+                    ", TrailingVerify=" + chkTrailingVerify.checked +
+                    ", FastVerify=" + chkFastVerify.checked +
                     ", VerboseLogging=" + chkVerboseLogging.checked +
                     ", IPv4Only=" + chkIPv4Only.checked +
                     ", SkipEndOfDevice=" + chkSkipEndOfDevice.checked);
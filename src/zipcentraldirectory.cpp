@@ -0,0 +1,204 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ */
+
+#include "zipcentraldirectory.h"
+#include <QDebug>
+
+namespace {
+
+constexpr quint32 EOCD_SIGNATURE = 0x06054b50;
+constexpr quint32 ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+constexpr quint32 ZIP64_EOCD_SIGNATURE = 0x06064b50;
+constexpr quint32 CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+
+constexpr int EOCD_SIZE = 22;
+constexpr int ZIP64_LOCATOR_SIZE = 20;
+constexpr int ZIP64_EOCD_SIZE = 56;
+constexpr int CENTRAL_HEADER_SIZE = 46;
+
+constexpr quint16 ZIP64_EXTRA_ID = 0x0001;
+
+quint16 le16(const char *p)
+{
+    auto u = reinterpret_cast<const uchar *>(p);
+    return quint16(u[0] | (u[1] << 8));
+}
+
+quint32 le32(const char *p)
+{
+    return quint32(le16(p)) | (quint32(le16(p + 2)) << 16);
+}
+
+quint64 le64(const char *p)
+{
+    return quint64(le32(p)) | (quint64(le32(p + 4)) << 32);
+}
+
+ZipCentralDirectory::Location failLocate(QString *errorMessage, const QString &msg)
+{
+    qDebug() << "ZipCentralDirectory:" << msg;
+    if (errorMessage)
+        *errorMessage = msg;
+    return ZipCentralDirectory::Location();
+}
+
+ZipCentralDirectory failParse(QString *errorMessage, const QString &msg)
+{
+    qDebug() << "ZipCentralDirectory:" << msg;
+    if (errorMessage)
+        *errorMessage = msg;
+    return ZipCentralDirectory();
+}
+
+} // namespace
+
+ZipCentralDirectory::Location ZipCentralDirectory::locate(const QByteArray &tail, quint64 archiveSize,
+                                                          QString *errorMessage)
+{
+    const qint64 len = tail.size();
+    if (len < EOCD_SIZE || quint64(len) > archiveSize)
+        return failLocate(errorMessage, QStringLiteral("archive tail too short"));
+
+    // The record is followed only by its comment; scan backwards for a signature
+    // whose comment length fits in what is left
+    qint64 eocd = -1;
+    for (qint64 pos = len - EOCD_SIZE; pos >= 0; pos--)
+    {
+        const char *p = tail.constData() + pos;
+        if (le32(p) == EOCD_SIGNATURE && pos + EOCD_SIZE + le16(p + 20) <= len)
+        {
+            eocd = pos;
+            break;
+        }
+    }
+    if (eocd < 0)
+        return failLocate(errorMessage, QStringLiteral("no end of central directory record"));
+
+    const char *p = tail.constData() + eocd;
+    if (le16(p + 4) != 0 || le16(p + 6) != 0)
+        return failLocate(errorMessage, QStringLiteral("multi-disk archives are not supported"));
+
+    Location location;
+    location.entryCount = le16(p + 10);
+    location.size = le32(p + 12);
+    location.offset = le32(p + 16);
+
+    // ZIP64: the locator sits right before the classic record
+    if (eocd >= ZIP64_LOCATOR_SIZE && le32(p - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIGNATURE)
+    {
+        const quint64 tailStart = archiveSize - quint64(len);
+        const quint64 recordOffset = le64(p - ZIP64_LOCATOR_SIZE + 8);
+        if (recordOffset < tailStart || recordOffset - tailStart + ZIP64_EOCD_SIZE > quint64(len))
+            return failLocate(errorMessage, QStringLiteral("ZIP64 end record is outside the fetched tail"));
+
+        const char *r = tail.constData() + (recordOffset - tailStart);
+        if (le32(r) != ZIP64_EOCD_SIGNATURE)
+            return failLocate(errorMessage, QStringLiteral("invalid ZIP64 end record"));
+
+        location.entryCount = le64(r + 32);
+        location.size = le64(r + 40);
+        location.offset = le64(r + 48);
+    }
+    else if (location.entryCount == 0xFFFF || location.size == 0xFFFFFFFF || location.offset == 0xFFFFFFFF)
+    {
+        return failLocate(errorMessage, QStringLiteral("ZIP64 archive without ZIP64 locator"));
+    }
+
+    if (location.offset > archiveSize || location.size > archiveSize - location.offset)
+        return failLocate(errorMessage, QStringLiteral("central directory lies outside the archive"));
+
+    location.valid = true;
+    return location;
+}
+
+ZipCentralDirectory ZipCentralDirectory::parse(const QByteArray &directory, const Location &location,
+                                               QString *errorMessage)
+{
+    if (!location.valid || quint64(directory.size()) != location.size)
+        return failParse(errorMessage, QStringLiteral("central directory size mismatch"));
+
+    ZipCentralDirectory result;
+    result._entries.reserve(int(qMin<quint64>(location.entryCount, 65536)));
+
+    const char *data = directory.constData();
+    const qint64 len = directory.size();
+    qint64 pos = 0;
+
+    while (quint64(result._entries.size()) < location.entryCount)
+    {
+        if (pos + CENTRAL_HEADER_SIZE > len || le32(data + pos) != CENTRAL_HEADER_SIGNATURE)
+            return failParse(errorMessage, QStringLiteral("truncated or corrupt central directory"));
+
+        const char *h = data + pos;
+        const int nameLength = le16(h + 28);
+        const int extraLength = le16(h + 30);
+        const int commentLength = le16(h + 32);
+        if (pos + CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength > len)
+            return failParse(errorMessage, QStringLiteral("central directory entry runs past the end"));
+
+        Entry entry;
+        entry.method = le16(h + 10);
+        entry.crc32 = le32(h + 16);
+        entry.compressedSize = le32(h + 20);
+        entry.uncompressedSize = le32(h + 24);
+        entry.localHeaderOffset = le32(h + 42);
+        entry.name = QString::fromUtf8(h + CENTRAL_HEADER_SIZE, nameLength);
+
+        // Values that did not fit are in the ZIP64 extra field, in this order
+        const char *extra = h + CENTRAL_HEADER_SIZE + nameLength;
+        for (int e = 0; e + 4 <= extraLength;)
+        {
+            const quint16 id = le16(extra + e);
+            const int size = le16(extra + e + 2);
+            if (e + 4 + size > extraLength)
+                break;
+
+            if (id == ZIP64_EXTRA_ID)
+            {
+                const char *field = extra + e + 4;
+                int used = 0;
+                for (quint64 *value : {&entry.uncompressedSize, &entry.compressedSize, &entry.localHeaderOffset})
+                {
+                    if (*value != 0xFFFFFFFF)
+                        continue;
+                    if (used + 8 > size)
+                        return failParse(errorMessage, QStringLiteral("short ZIP64 extra field for %1").arg(entry.name));
+                    *value = le64(field + used);
+                    used += 8;
+                }
+            }
+            e += 4 + size;
+        }
+
+        result._entries.append(entry);
+        pos += CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+    }
+
+    result._valid = true;
+    return result;
+}
+
+QString ZipCentralDirectory::methodName(quint16 method)
+{
+    switch (method)
+    {
+    case 0:
+        return QStringLiteral("stored");
+    case 8:
+        return QStringLiteral("deflate");
+    case 9:
+        return QStringLiteral("deflate64");
+    case 12:
+        return QStringLiteral("bzip2");
+    case 14:
+        return QStringLiteral("lzma");
+    case 93:
+        return QStringLiteral("zstd");
+    case 95:
+        return QStringLiteral("xz");
+    default:
+        return QStringLiteral("method %1").arg(method);
+    }
+}
@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2025 Laerdal Medical
+ *
+ * Reader for the central directory of a ZIP archive that is not on disk.
+ *
+ * The central directory at the end of a ZIP lists every entry with its sizes,
+ * compression method and the offset of its local header. Fetching just the
+ * End-of-Central-Directory record and the directory itself (two small HTTP
+ * Range requests) is enough to list a multi-GB CI artifact without
+ * downloading it.
+ */
+
+#ifndef ZIPCENTRALDIRECTORY_H
+#define ZIPCENTRALDIRECTORY_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class ZipCentralDirectory
+{
+public:
+    struct Entry
+    {
+        QString name;
+        quint64 compressedSize;
+        quint64 uncompressedSize;
+        quint64 localHeaderOffset;  // Offset of the entry's local file header
+        quint16 method;             // 0 = stored, 8 = deflate, ...
+        quint32 crc32;
+    };
+
+    // Where the central directory lives in the archive
+    struct Location
+    {
+        quint64 offset = 0;
+        quint64 size = 0;
+        quint64 entryCount = 0;
+        bool valid = false;
+    };
+
+    // Length of the archive tail that always contains the End-of-Central-Directory
+    // record (with the longest possible comment) and the ZIP64 locator and record
+    static constexpr qint64 TAIL_SIZE = 22 + 65535 + 20 + 56;
+
+    ZipCentralDirectory() = default;
+
+    /**
+     * @brief Find the central directory from the last bytes of an archive
+     *
+     * Handles ZIP64 archives as long as the ZIP64 end record lies within the
+     * tail, which it does for every archive that has no data between that
+     * record and the locator.
+     *
+     * @param tail The last bytes of the archive (TAIL_SIZE, or the whole archive if shorter)
+     * @param archiveSize Total size of the archive
+     * @param errorMessage Receives a description of the problem on failure
+     */
+    static Location locate(const QByteArray &tail, quint64 archiveSize, QString *errorMessage = nullptr);
+
+    /**
+     * @brief Parse the central directory
+     *
+     * @param directory Exactly the bytes described by location
+     * @param location Result of locate()
+     * @param errorMessage Receives a description of the problem on failure
+     * @return Parsed directory, or an invalid one on failure
+     */
+    static ZipCentralDirectory parse(const QByteArray &directory, const Location &location,
+                                     QString *errorMessage = nullptr);
+
+    // Short name for a compression method ("stored", "deflate", ...)
+    static QString methodName(quint16 method);
+
+    bool isValid() const { return _valid; }
+    const QVector<Entry> &entries() const { return _entries; }
+
+private:
+    bool _valid = false;
+    QVector<Entry> _entries;
+};
+
+#endif // ZIPCENTRALDIRECTORY_H